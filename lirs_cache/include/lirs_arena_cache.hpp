@@ -0,0 +1,57 @@
+#ifndef LIRS_ARENA_CACHE_HPP
+#define LIRS_ARENA_CACHE_HPP
+
+/*
+ * In-memory LIRS cache with all nodes in one arena (POSIX)
+ *
+ *    LIRSArena (4 KB / THP / hugetlb pages, optionally pre-faulted)
+ *      └── LIRSImage: header │ nodes │ hash buckets
+ *
+ * The same image as LIRSMappedCache, over anonymous memory instead of a
+ * file: no per-entry allocations, and with huge pages the index and nodes
+ * of a large cache sit in a few hundred TLB entries instead of millions.
+ *
+ * Not thread-safe (like LIRSCache).
+ */
+
+#include "lirs_arena.hpp"
+#include "lirs_image.hpp"
+#include <cstddef>
+#include <functional>
+#include <optional>
+
+template <typename K, typename V, typename Hash = std::hash<K>>
+class LIRSArenaCache {
+public:
+  using Image = LIRSImage<K, V, Hash>;
+
+  explicit LIRSArenaCache(std::size_t capacity, double hir_ratio = 0.01, std::size_t ghost_limit = 0,
+                          LIRSArena::Options options = LIRSArena::Options {})
+    : arena_(Image::region_size(capacity, ghost_limit == 0 ? capacity : ghost_limit), options)
+    , image_(Image::format(this->arena_.data(), this->arena_.size(), capacity, hir_ratio, ghost_limit)) {}
+
+  LIRSArenaCache(const LIRSArenaCache&) = delete;
+  LIRSArenaCache& operator=(const LIRSArenaCache&) = delete;
+
+  std::optional<V> get(const K& key) { return this->image_.get(key); }
+  void put(const K& key, const V& value) { this->image_.put(key, value); }
+  void clear() { this->image_.clear(); }
+
+  std::size_t size() const { return this->image_.size(); }
+  std::size_t capacity() const { return this->image_.capacity(); }
+  bool empty() const { return this->image_.empty(); }
+
+  std::size_t lir_count() const { return this->image_.lir_count(); }
+  std::size_t ghost_count() const { return this->image_.ghost_count(); }
+
+  // arena bytes and the page backing obtained
+  std::size_t memory() const { return this->arena_.size(); }
+  LIRSHugePages backing() const { return this->arena_.backing(); }
+  const char* backing_name() const { return this->arena_.backing_name(); }
+
+private:
+  LIRSArena arena_;
+  Image image_;
+};
+
+#endif
@@ -0,0 +1,643 @@
+#ifndef LIRS_BLOCK_CACHE_HPP
+#define LIRS_BLOCK_CACHE_HPP
+
+/*
+ * LIRS-managed file block cache (POSIX)
+ *
+ *    read(fd, buf, len, offset)
+ *       │
+ *       ├── split into blocks ──► (file id, block no) ──► LIRSCache ──► pool slot
+ *       │                                                   hit: copy out
+ *       └── misses ──► batched read into free pool slots ──► put()
+ *                      (io_uring, pread thread pool or serial pread)
+ *
+ * Blocks live in one preallocated pool aligned to kAlignment, so slots are
+ * valid O_DIRECT targets whenever block_size is a multiple of the device
+ * block size.  The cache value is only the slot index; evicted slots return
+ * to the free list through the removal listener.  A file id is assigned per
+ * (st_dev, st_ino), so every descriptor of the same file shares blocks.
+ *
+ * Misses go to a LIRSBlockReader (lirs_block_io.hpp): by default io_uring
+ * with the pool registered as fixed buffers, so concurrent readers share one
+ * submission and data lands directly in the slots; a pread thread pool when
+ * io_uring is unavailable.
+ *
+ * Readahead (set_readahead): a read that continues the previous one on the
+ * same file extends a per-file window, which doubles up to the configured
+ * maximum.  A background thread fetches the window ahead of the reader and
+ * inserts the blocks with put_cold(): resident HIR at the bottom of Q, no S
+ * entry until referenced, so prefetching never displaces LIR blocks.  Blocks
+ * referenced before eviction count as useful prefetches, the rest as wasted.
+ *
+ * Thread-safe: cache state is guarded by one mutex, I/O runs outside it.
+ */
+
+#include "lirs_cache.hpp"
+#include "lirs_block_io.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <optional>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+struct LIRSBlockKey {
+  std::uint64_t file;
+  std::uint64_t block;
+
+  bool operator==(const LIRSBlockKey& other) const { return this->file == other.file && this->block == other.block; }
+};
+
+template <>
+struct std::hash<LIRSBlockKey> {
+  std::size_t operator()(const LIRSBlockKey& key) const {
+
+    std::uint64_t h = key.file * 0x9E3779B97F4A7C15ULL ^ key.block;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    return static_cast<std::size_t>(h ^ (h >> 32));
+  }
+};
+
+// fixed-size aligned block slots
+class LIRSBlockPool {
+public:
+  static constexpr std::size_t kAlignment = 4096;
+
+  LIRSBlockPool(std::size_t slots, std::size_t block_size)
+    : block_size_(block_size), slots_(slots), memory_(nullptr) {
+
+    if (block_size == 0 || block_size % kAlignment != 0) throw std::invalid_argument("Block size must be a multiple of 4096");
+
+    this->memory_ = static_cast<char*>(std::aligned_alloc(kAlignment, slots * block_size));
+    if (this->memory_ == nullptr) throw std::bad_alloc();
+
+    this->free_.reserve(slots);
+    for (std::size_t i = slots; i > 0; i--) this->free_.push_back(static_cast<std::uint32_t>(i - 1));
+    return;
+  }
+
+  ~LIRSBlockPool() { std::free(this->memory_); }
+
+  LIRSBlockPool(const LIRSBlockPool&) = delete;
+  LIRSBlockPool& operator=(const LIRSBlockPool&) = delete;
+
+  char* data(std::uint32_t slot) { return this->memory_ + static_cast<std::size_t>(slot) * this->block_size_; }
+  char* memory() { return this->memory_; }
+
+  std::size_t block_size() const { return this->block_size_; }
+  std::size_t slots() const { return this->slots_; }
+  std::size_t available() const { return this->free_.size(); }
+
+  // caller synchronizes acquire/release
+  bool acquire(std::uint32_t& slot) {
+
+    if (this->free_.empty()) return false;
+    slot = this->free_.back();
+    this->free_.pop_back();
+    return true;
+  }
+
+  void release(std::uint32_t slot) {
+
+    this->free_.push_back(slot);
+    return;
+  }
+
+private:
+  std::size_t block_size_;
+  std::size_t slots_;
+  char* memory_;
+  std::vector<std::uint32_t> free_;
+};
+
+class LIRSBlockCache {
+public:
+  struct Block {
+    std::uint32_t slot;    // pool slot
+    std::uint32_t length;  // valid bytes (short only for the last block of a file)
+  };
+
+  struct Stats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t bytes_fetched = 0;
+    std::uint64_t prefetched = 0;        // blocks inserted by readahead
+    std::uint64_t prefetch_useful = 0;   // ... later referenced
+    std::uint64_t prefetch_wasted = 0;   // ... evicted or invalidated unreferenced
+  };
+
+  enum class IO {
+    Auto,        // io_uring, else the thread pool
+    Uring,       // io_uring or throw std::system_error
+    ThreadPool,  // pread on worker threads
+    Pread        // pread on the calling thread, one block at a time
+  };
+
+  // capacity in blocks; in_flight extra slots let concurrent misses fill before insertion
+  LIRSBlockCache(std::size_t capacity, std::size_t block_size = 4096, double hir_ratio = 0.01,
+                 std::size_t in_flight = 64, IO io = IO::Auto)
+    : cache_(capacity, hir_ratio), pool_(capacity + 1 + in_flight, block_size) {
+
+    char* memory = this->pool_.memory();
+    std::size_t bytes = this->pool_.slots() * block_size;
+
+    switch (io) {
+      case IO::Auto: this->reader_ = make_block_reader(memory, bytes); break;
+#if defined(LIRS_HAS_IO_URING)
+      case IO::Uring: this->reader_ = std::make_unique<LIRSUringReader>(256, memory, bytes); break;
+#else
+      case IO::Uring: throw std::system_error(ENOSYS, std::generic_category(), "io_uring");
+#endif
+      case IO::ThreadPool: this->reader_ = std::make_unique<LIRSThreadPoolReader>(); break;
+      case IO::Pread: break;
+    }
+
+    this->cache_.set_removal_listener([this](const LIRSBlockKey& key, Block& block) {
+
+      if (!this->prefetched_.empty() && this->prefetched_.erase(key) > 0) this->stats_.prefetch_wasted++;
+      this->pool_.release(block.slot);
+      this->slot_freed_.notify_one();
+    });
+    return;
+  }
+
+  ~LIRSBlockCache() {
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex_);
+      this->stopping_ = true;
+    }
+    this->prefetch_ready_.notify_all();
+    if (this->prefetcher_.joinable()) this->prefetcher_.join();
+
+    for (const Prefetch& job : this->prefetch_queue_) ::close(job.fd);
+  }
+
+  LIRSBlockCache(const LIRSBlockCache&) = delete;
+  LIRSBlockCache& operator=(const LIRSBlockCache&) = delete;
+
+  // prefetch up to max_window blocks ahead of sequential readers; 0 disables
+  void set_readahead(std::size_t max_window) {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->readahead_ = max_window;
+    if (max_window > 0 && !this->prefetcher_.joinable()) this->prefetcher_ = std::thread([this] { this->run_prefetcher(); });
+    return;
+  }
+
+  // open a file for cached reads, with O_DIRECT when requested and supported
+  static int open_file(const char* path, bool direct) {
+
+    int flags = O_RDONLY | O_CLOEXEC;
+#if defined(O_DIRECT)
+    if (direct) {
+
+      int fd = ::open(path, flags | O_DIRECT);
+      if (fd >= 0 || errno != EINVAL) return fd;
+    }
+#else
+    (void)direct;
+#endif
+    return ::open(path, flags);
+  }
+
+  // pread() through the cache; returns bytes read (short at end of file) or -1 with errno set
+  ssize_t read(int fd, void* buf, std::size_t len, off_t offset) {
+
+    if (len == 0) return 0;
+    if (offset < 0) {
+
+      errno = EINVAL;
+      return -1;
+    }
+
+    std::uint64_t file;
+    std::uint64_t file_size;
+    if (!this->file_id(fd, file, &file_size)) return -1;
+
+    const std::size_t bs = this->pool_.block_size();
+    const std::uint64_t first = static_cast<std::uint64_t>(offset) / bs;
+    const std::uint64_t last = (static_cast<std::uint64_t>(offset) + len - 1) / bs;
+
+    std::vector<Fetch> misses;
+    std::vector<std::uint32_t> lengths(static_cast<std::size_t>(last - first + 1), 0);
+
+    // hits are copied under the lock, before the slot can be reused
+    {
+      std::lock_guard<std::mutex> lock(this->mutex_);
+
+      for (std::uint64_t block = first; block <= last; block++) {
+
+        std::optional<Block> hit = this->cache_.get(LIRSBlockKey { file, block });
+        if (!hit) {
+
+          misses.push_back(Fetch { block, 0, 0 });
+          continue;
+        }
+
+        this->stats_.hits++;
+        if (!this->prefetched_.empty() && this->prefetched_.erase(LIRSBlockKey { file, block }) > 0) this->stats_.prefetch_useful++;
+
+        lengths[block - first] = hit->length;
+        this->copy_out(buf, len, offset, block, this->pool_.data(hit->slot), hit->length);
+      }
+      this->stats_.misses += misses.size();
+
+      if (this->readahead_ > 0) this->readahead(fd, file, file_size, first, last, !misses.empty());
+    }
+
+    // fetch misses outside the lock in batches bounded by the free slots, then insert
+    for (std::size_t next = 0; next < misses.size();) {
+
+      Fetch* batch = misses.data() + next;
+      std::size_t count = this->fetch(fd, batch, misses.size() - next);
+      if (count == 0) return -1;
+
+      for (std::size_t i = 0; i < count; i++) {
+
+        lengths[batch[i].block - first] = batch[i].length;
+        this->copy_out(buf, len, offset, batch[i].block, this->pool_.data(batch[i].slot), batch[i].length);
+      }
+      this->insert(file, batch, count);
+      next += count;
+    }
+
+    // bytes available before the first short block
+    std::size_t done = 0;
+    for (std::uint64_t block = first; block <= last; block++) {
+
+      std::uint64_t start = block * bs;
+      std::uint64_t end = start + lengths[block - first];
+      std::uint64_t from = std::max<std::uint64_t>(start, static_cast<std::uint64_t>(offset));
+      std::uint64_t to = std::min<std::uint64_t>(end, static_cast<std::uint64_t>(offset) + len);
+
+      if (to > from) done += static_cast<std::size_t>(to - from);
+      if (lengths[block - first] < bs) break;
+    }
+    return static_cast<ssize_t>(done);
+  }
+
+  // drop cached blocks overlapping [offset, offset + len), e.g. after a write
+  void invalidate(int fd, off_t offset, std::size_t len) {
+
+    std::uint64_t file;
+    if (len == 0 || !this->file_id(fd, file)) return;
+
+    const std::size_t bs = this->pool_.block_size();
+    std::lock_guard<std::mutex> lock(this->mutex_);
+
+    for (std::uint64_t block = static_cast<std::uint64_t>(offset) / bs;
+         block <= (static_cast<std::uint64_t>(offset) + len - 1) / bs; block++) {
+
+      this->cache_.erase(LIRSBlockKey { file, block });
+    }
+    return;
+  }
+
+  Stats stats() const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->stats_;
+  }
+
+  std::size_t size() const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->cache_.size();
+  }
+
+  std::size_t capacity() const { return this->cache_.capacity(); }
+  std::size_t block_size() const { return this->pool_.block_size(); }
+
+  // name of the miss backend, e.g. "io_uring (fixed buffers)"
+  const char* io_backend() const { return this->reader_ ? this->reader_->name() : "pread"; }
+
+protected:
+  struct Fetch {
+    std::uint64_t block;
+    std::uint32_t slot;
+    std::uint32_t length;
+  };
+
+  // take up to count free slots, waiting only while none is free (never while holding one)
+  std::size_t acquire_slots(Fetch* misses, std::size_t count) {
+
+    std::unique_lock<std::mutex> lock(this->mutex_);
+    this->slot_freed_.wait(lock, [&] { return this->pool_.available() > 0; });
+
+    std::size_t taken = 0;
+    while (taken < count && this->pool_.acquire(misses[taken].slot)) taken++;
+    return taken;
+  }
+
+  // read a batch of missing blocks into fresh slots; returns blocks read, 0 on error
+  std::size_t fetch(int fd, Fetch* misses, std::size_t count) {
+
+    std::size_t taken = this->acquire_slots(misses, count);
+    return this->read_slots(fd, misses, taken) ? taken : 0;
+  }
+
+  // fill acquired slots; on error the slots are released and errno is set
+  bool read_slots(int fd, Fetch* misses, std::size_t taken) {
+
+    const std::size_t bs = this->pool_.block_size();
+
+    // one batch for the backend; short reads that are not end of file finish below
+    std::vector<std::size_t> got(taken, 0);
+    if (this->reader_) {
+
+      std::vector<LIRSBlockRead> requests(taken);
+      for (std::size_t i = 0; i < taken; i++) {
+
+        requests[i] = LIRSBlockRead { fd, this->pool_.data(misses[i].slot), bs, static_cast<off_t>(misses[i].block * bs), 0 };
+      }
+      this->reader_->read_batch(requests.data(), taken);
+
+      for (std::size_t i = 0; i < taken; i++) {
+
+        if (requests[i].result < 0) {
+
+          this->release_slots(misses, taken);
+          errno = static_cast<int>(-requests[i].result);
+          return false;
+        }
+        got[i] = static_cast<std::size_t>(requests[i].result);
+      }
+    }
+
+    for (std::size_t i = 0; i < taken; i++) {
+
+      if (this->reader_ && got[i] == 0) {
+
+        misses[i].length = 0;
+        continue;
+      }
+      if (!this->read_block(fd, misses[i], got[i])) {
+
+        int error = errno;
+        this->release_slots(misses, taken);
+        errno = error;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // read the block from byte got onwards (got > 0 when a batch already filled part of it)
+  bool read_block(int fd, Fetch& miss, std::size_t got = 0) {
+
+    const std::size_t bs = this->pool_.block_size();
+    char* data = this->pool_.data(miss.slot);
+
+    // a partial, unaligned batch read already reached end of file
+    bool eof = got % LIRSBlockPool::kAlignment != 0;
+
+    while (!eof && got < bs) {
+
+      ssize_t n = ::pread(fd, data + got, bs - got, static_cast<off_t>(miss.block * bs + got));
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0) return false;
+      if (n == 0) break;
+      got += static_cast<std::size_t>(n);
+
+      // O_DIRECT reads stay aligned: a short read means end of file
+      if (got % LIRSBlockPool::kAlignment != 0) break;
+    }
+
+    miss.length = static_cast<std::uint32_t>(got);
+    return true;
+  }
+
+  void release_slots(const Fetch* misses, std::size_t count) {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    for (std::size_t i = 0; i < count; i++) this->pool_.release(misses[i].slot);
+    this->slot_freed_.notify_all();
+    return;
+  }
+
+  // insert fetched blocks; a block inserted meanwhile by another reader wins
+  void insert(std::uint64_t file, const Fetch* misses, std::size_t count) {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+
+    for (std::size_t i = 0; i < count; i++) {
+
+      const Fetch& miss = misses[i];
+      LIRSBlockKey key { file, miss.block };
+      this->stats_.bytes_fetched += miss.length;
+
+      if (miss.length == 0 || this->cache_.contains(key)) {
+
+        this->pool_.release(miss.slot);
+        continue;
+      }
+      this->cache_.put(key, Block { miss.slot, miss.length });
+    }
+    this->slot_freed_.notify_all();
+    return;
+  }
+
+  void copy_out(void* buf, std::size_t len, off_t offset, std::uint64_t block,
+                const char* data, std::uint32_t length) const {
+
+    const std::size_t bs = this->pool_.block_size();
+    std::uint64_t start = block * bs;
+    std::uint64_t from = std::max<std::uint64_t>(start, static_cast<std::uint64_t>(offset));
+    std::uint64_t to = std::min<std::uint64_t>(start + length, static_cast<std::uint64_t>(offset) + len);
+
+    if (to > from) {
+
+      std::memcpy(static_cast<char*>(buf) + (from - static_cast<std::uint64_t>(offset)),
+                  data + (from - start), static_cast<std::size_t>(to - from));
+    }
+    return;
+  }
+
+  bool file_id(int fd, std::uint64_t& id, std::uint64_t* size = nullptr) {
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) return false;
+    if (size != nullptr) *size = static_cast<std::uint64_t>(st.st_size);
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    auto inserted = this->files_.emplace(FileKey { static_cast<std::uint64_t>(st.st_dev), static_cast<std::uint64_t>(st.st_ino) },
+                                         this->files_.size());
+    id = inserted.first->second;
+    return true;
+  }
+
+  struct FileKey {
+    std::uint64_t dev;
+    std::uint64_t ino;
+
+    bool operator==(const FileKey& other) const { return this->dev == other.dev && this->ino == other.ino; }
+  };
+
+  struct FileKeyHash {
+    std::size_t operator()(const FileKey& key) const { return std::hash<LIRSBlockKey> {}(LIRSBlockKey { key.dev, key.ino }); }
+  };
+
+  struct Stream {
+    std::uint64_t next = 0;     // block after the last read
+    std::uint64_t window = 0;   // current readahead window (blocks)
+    std::uint64_t ahead = 0;    // first block not yet prefetched
+  };
+
+  struct Prefetch {
+    int fd;                     // dup of the reader's descriptor
+    std::uint64_t file;
+    std::uint64_t first;
+    std::uint64_t count;
+  };
+
+  static constexpr std::uint64_t kInitialWindow = 4;
+
+  // caller holds mutex_: extend the file's stream and queue the next window
+  void readahead(int fd, std::uint64_t file, std::uint64_t file_size,
+                 std::uint64_t first, std::uint64_t last, bool missed) {
+
+    Stream& stream = this->streams_[file];
+    bool sequential = first == stream.next || first + 1 == stream.next;
+    stream.next = last + 1;
+
+    if (!sequential) {
+
+      stream.window = 0;
+      stream.ahead = 0;
+      return;
+    }
+
+    // refill once the reader is halfway into the prefetched range, doubling the window each time;
+    // a miss means the window fell behind or was evicted, so it restarts at the reader
+    if (stream.window == 0) stream.window = std::min<std::uint64_t>(this->readahead_, kInitialWindow);
+    if (missed) stream.ahead = std::min(stream.ahead, last + 1);
+    if (stream.ahead > last + 1 + stream.window / 2) return;
+
+    const std::size_t bs = this->pool_.block_size();
+    std::uint64_t begin = std::max(stream.ahead, last + 1);
+    std::uint64_t end = std::min(last + 1 + stream.window, (file_size + bs - 1) / bs);
+    stream.ahead = std::max(stream.ahead, end);
+    stream.window = std::min<std::uint64_t>(this->readahead_, stream.window * 2);
+    if (begin >= end) return;
+
+    int copy = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (copy < 0) return;
+
+    this->prefetch_queue_.push_back(Prefetch { copy, file, begin, end - begin });
+    this->prefetch_ready_.notify_one();
+    return;
+  }
+
+  void run_prefetcher() {
+
+    std::unique_lock<std::mutex> lock(this->mutex_);
+
+    while (true) {
+
+      this->prefetch_ready_.wait(lock, [&] { return this->stopping_ || !this->prefetch_queue_.empty(); });
+      if (this->stopping_) return;
+
+      Prefetch job = this->prefetch_queue_.front();
+      this->prefetch_queue_.pop_front();
+
+      // missing blocks only, into at most half of the free slots so demand reads keep going
+      std::vector<Fetch> blocks;
+      std::size_t budget = this->pool_.available() / 2;
+      std::uint64_t block = job.first;
+      for (; block < job.first + job.count && blocks.size() < budget; block++) {
+
+        if (this->cache_.contains(LIRSBlockKey { job.file, block })) continue;
+
+        blocks.push_back(Fetch { block, 0, 0 });
+        this->pool_.acquire(blocks.back().slot);
+      }
+
+      // out of slots: let the stream request the rest again
+      const std::uint64_t end = job.first + job.count;
+      if (block < end && this->streams_[job.file].ahead == end) this->streams_[job.file].ahead = block;
+      lock.unlock();
+
+      bool ok = this->read_slots(job.fd, blocks.data(), blocks.size());
+      ::close(job.fd);
+
+      lock.lock();
+      if (!ok) continue;
+
+      // make room for the window by evicting from Q, but never the unread part of an
+      // earlier window (it sits at the bottom too); insert only what fits
+      std::size_t wanted = 0;
+      for (const Fetch& fetched : blocks) {
+
+        if (fetched.length > 0 && !this->cache_.contains(LIRSBlockKey { job.file, fetched.block })) wanted++;
+      }
+      while (this->cache_.size() + wanted > this->cache_.capacity()) {
+
+        const LIRSBlockKey* victim = this->cache_.next_victim();
+        if (victim == nullptr || this->prefetched_.count(*victim) > 0) break;
+        this->cache_.evict_one();
+      }
+
+      std::size_t room = this->cache_.capacity() - std::min(this->cache_.size(), this->cache_.capacity());
+      std::uint64_t stopped = end;
+
+      // a block inserted meanwhile by a demand read wins
+      for (const Fetch& fetched : blocks) {
+
+        LIRSBlockKey key { job.file, fetched.block };
+        this->stats_.bytes_fetched += fetched.length;
+
+        if (room == 0 && stopped == end) stopped = fetched.block;
+        if (room == 0 || fetched.length == 0 || !this->cache_.put_cold(key, Block { fetched.slot, fetched.length })) {
+
+          this->pool_.release(fetched.slot);
+          continue;
+        }
+        this->prefetched_.insert(key);
+        this->stats_.prefetched++;
+        room--;
+      }
+
+      // blocks that did not fit are requested again by the stream's next read
+      Stream& stream = this->streams_[job.file];
+      if (stream.ahead == end && stopped < end) stream.ahead = stopped;
+      this->slot_freed_.notify_all();
+    }
+  }
+
+  mutable std::mutex mutex_;
+  std::condition_variable slot_freed_;
+  LIRSCache<LIRSBlockKey, Block> cache_;
+  LIRSBlockPool pool_;
+  std::unordered_map<FileKey, std::uint64_t, FileKeyHash> files_;
+  Stats stats_;
+  std::unique_ptr<LIRSBlockReader> reader_;
+
+  // readahead
+  std::size_t readahead_ = 0;
+  std::unordered_map<std::uint64_t, Stream> streams_;
+  std::unordered_set<LIRSBlockKey> prefetched_;
+  std::deque<Prefetch> prefetch_queue_;
+  std::condition_variable prefetch_ready_;
+  bool stopping_ = false;
+  std::thread prefetcher_;
+};
+
+#endif
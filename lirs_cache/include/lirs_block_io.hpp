@@ -0,0 +1,429 @@
+#ifndef LIRS_BLOCK_IO_HPP
+#define LIRS_BLOCK_IO_HPP
+
+/*
+ * Batched block readers for the LIRSBlockCache miss path
+ *
+ *    read_batch(requests) ──► LIRSUringReader      (Linux io_uring)
+ *                         └─► LIRSThreadPoolReader (pread on worker threads)
+ *
+ * LIRSUringReader combines submissions: the first caller to find the ring
+ * idle becomes the leader and submits every pending request, its own and
+ * those queued by concurrent callers, with one io_uring_enter(), then reaps
+ * completions until nothing is in flight.  The block pool is registered as
+ * fixed buffers so reads land in cache slots without extra copies
+ * (IORING_OP_READ_FIXED); if registration fails (e.g. RLIMIT_MEMLOCK) plain
+ * IORING_OP_READ is used instead.
+ *
+ * make_block_reader() picks io_uring when the kernel allows it and falls
+ * back to the thread pool otherwise.
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define LIRS_HAS_IO_URING 1
+#endif
+
+struct LIRSBlockRead {
+  int fd;
+  char* buf;
+  std::size_t len;
+  off_t offset;
+  ssize_t result;   // bytes read, or -errno
+};
+
+class LIRSBlockReader {
+public:
+  virtual ~LIRSBlockReader() = default;
+
+  // read every request; blocks until all results are set
+  virtual void read_batch(LIRSBlockRead* requests, std::size_t count) = 0;
+  virtual const char* name() const = 0;
+};
+
+class LIRSThreadPoolReader : public LIRSBlockReader {
+public:
+  explicit LIRSThreadPoolReader(std::size_t threads = 4) : stop_(false) {
+
+    if (threads == 0) threads = 1;
+    for (std::size_t i = 0; i < threads; i++) this->workers_.emplace_back([this] { this->run(); });
+    return;
+  }
+
+  ~LIRSThreadPoolReader() override {
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex_);
+      this->stop_ = true;
+    }
+    this->work_.notify_all();
+    for (std::thread& worker : this->workers_) worker.join();
+  }
+
+  void read_batch(LIRSBlockRead* requests, std::size_t count) override {
+
+    if (count == 0) return;
+
+    Batch batch;
+    batch.remaining = count;
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex_);
+      for (std::size_t i = 0; i < count; i++) this->queue_.push_back(Job { &requests[i], &batch });
+    }
+    this->work_.notify_all();
+
+    std::unique_lock<std::mutex> lock(this->mutex_);
+    batch.done.wait(lock, [&] { return batch.remaining == 0; });
+    return;
+  }
+
+  const char* name() const override { return "thread-pool"; }
+
+private:
+  struct Batch {
+    std::size_t remaining;
+    std::condition_variable done;
+  };
+
+  struct Job {
+    LIRSBlockRead* request;
+    Batch* batch;
+  };
+
+  void run() {
+
+    std::unique_lock<std::mutex> lock(this->mutex_);
+
+    while (true) {
+
+      this->work_.wait(lock, [&] { return this->stop_ || !this->queue_.empty(); });
+      if (this->queue_.empty()) return;
+
+      Job job = this->queue_.front();
+      this->queue_.pop_front();
+      lock.unlock();
+
+      LIRSBlockRead& r = *job.request;
+      ssize_t n;
+      do {
+        n = ::pread(r.fd, r.buf, r.len, r.offset);
+      } while (n < 0 && errno == EINTR);
+      r.result = n < 0 ? -errno : n;
+
+      lock.lock();
+      if (--job.batch->remaining == 0) job.batch->done.notify_all();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable work_;
+  std::deque<Job> queue_;
+  std::vector<std::thread> workers_;
+  bool stop_;
+};
+
+#if defined(LIRS_HAS_IO_URING)
+
+class LIRSUringReader : public LIRSBlockReader {
+public:
+  // throws std::system_error if io_uring is unavailable; [base, base + size) is registered when possible
+  LIRSUringReader(unsigned entries, char* base, std::size_t size)
+    : ring_fd_(-1), sq_ring_(nullptr), cq_ring_(nullptr), sqes_(nullptr)
+    , base_(base), registered_(false), leader_(false), in_flight_(0) {
+
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    this->ring_fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (this->ring_fd_ < 0) throw std::system_error(errno, std::generic_category(), "io_uring_setup");
+
+    try {
+
+      this->map_rings(params);
+    } catch (...) {
+
+      this->unmap_rings();
+      throw;
+    }
+
+    // register the pool as fixed buffers (one iovec per 1 GiB, the per-buffer limit)
+    if (base != nullptr && size > 0) {
+
+      std::vector<iovec> iov;
+      for (std::size_t offset = 0; offset < size; offset += kBufferChunk) {
+
+        iov.push_back(iovec { base + offset, std::min(kBufferChunk, size - offset) });
+      }
+      this->registered_ = ::syscall(__NR_io_uring_register, this->ring_fd_, IORING_REGISTER_BUFFERS,
+                                    iov.data(), static_cast<unsigned>(iov.size())) == 0;
+      this->size_ = size;
+    }
+    return;
+  }
+
+  ~LIRSUringReader() override { this->unmap_rings(); }
+
+  LIRSUringReader(const LIRSUringReader&) = delete;
+  LIRSUringReader& operator=(const LIRSUringReader&) = delete;
+
+  void read_batch(LIRSBlockRead* requests, std::size_t count) override {
+
+    if (count == 0) return;
+
+    Batch batch;
+    batch.remaining = count;
+
+    std::unique_lock<std::mutex> lock(this->mutex_);
+    for (std::size_t i = 0; i < count; i++) this->pending_.push_back(Job { &requests[i], &batch });
+
+    while (batch.remaining > 0) {
+
+      if (this->leader_) {
+
+        this->progress_.wait(lock);
+        continue;
+      }
+
+      // become the leader: submit everything pending, reap until idle
+      this->leader_ = true;
+      while (!this->pending_.empty() || this->in_flight_ > 0) {
+
+        std::vector<Job> jobs;
+        unsigned space = this->sq_entries_ - this->in_flight_;
+        while (!this->pending_.empty() && jobs.size() < space && jobs.size() < this->cq_entries_) {
+
+          jobs.push_back(this->pending_.front());
+          this->pending_.pop_front();
+        }
+        this->in_flight_ += static_cast<unsigned>(jobs.size());
+        lock.unlock();
+
+        this->submit_and_wait(jobs);
+
+        lock.lock();
+        this->progress_.notify_all();
+      }
+      this->leader_ = false;
+      this->progress_.notify_all();
+    }
+    return;
+  }
+
+  const char* name() const override { return this->registered_ ? "io_uring (fixed buffers)" : "io_uring"; }
+  bool registered_buffers() const { return this->registered_; }
+
+private:
+  static constexpr std::size_t kBufferChunk = std::size_t { 1 } << 30;
+
+  struct Batch {
+    std::size_t remaining;
+  };
+
+  struct Job {
+    LIRSBlockRead* request;
+    Batch* batch;
+  };
+
+  void map_rings(const io_uring_params& params) {
+
+    this->sq_entries_ = params.sq_entries;
+    this->cq_entries_ = params.cq_entries;
+
+    this->sq_size_ = params.sq_off.array + params.sq_entries * sizeof(std::uint32_t);
+    this->cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) this->sq_size_ = this->cq_size_ = std::max(this->sq_size_, this->cq_size_);
+
+    void* sq = ::mmap(nullptr, this->sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ring_fd_, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) throw std::system_error(errno, std::generic_category(), "mmap sq ring");
+    this->sq_ring_ = static_cast<char*>(sq);
+
+    if (single) {
+
+      this->cq_ring_ = this->sq_ring_;
+    } else {
+
+      void* cq = ::mmap(nullptr, this->cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ring_fd_, IORING_OFF_CQ_RING);
+      if (cq == MAP_FAILED) throw std::system_error(errno, std::generic_category(), "mmap cq ring");
+      this->cq_ring_ = static_cast<char*>(cq);
+    }
+
+    void* sqes = ::mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, this->ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) throw std::system_error(errno, std::generic_category(), "mmap sqes");
+    this->sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    this->sq_head_ = reinterpret_cast<std::uint32_t*>(this->sq_ring_ + params.sq_off.head);
+    this->sq_tail_ = reinterpret_cast<std::uint32_t*>(this->sq_ring_ + params.sq_off.tail);
+    this->sq_mask_ = *reinterpret_cast<std::uint32_t*>(this->sq_ring_ + params.sq_off.ring_mask);
+    this->sq_array_ = reinterpret_cast<std::uint32_t*>(this->sq_ring_ + params.sq_off.array);
+    this->cq_head_ = reinterpret_cast<std::uint32_t*>(this->cq_ring_ + params.cq_off.head);
+    this->cq_tail_ = reinterpret_cast<std::uint32_t*>(this->cq_ring_ + params.cq_off.tail);
+    this->cq_mask_ = *reinterpret_cast<std::uint32_t*>(this->cq_ring_ + params.cq_off.ring_mask);
+    this->cqes_ = reinterpret_cast<io_uring_cqe*>(this->cq_ring_ + params.cq_off.cqes);
+    return;
+  }
+
+  void unmap_rings() {
+
+    if (this->sqes_ != nullptr) ::munmap(this->sqes_, this->sq_entries_ * sizeof(io_uring_sqe));
+    if (this->cq_ring_ != nullptr && this->cq_ring_ != this->sq_ring_) ::munmap(this->cq_ring_, this->cq_size_);
+    if (this->sq_ring_ != nullptr) ::munmap(this->sq_ring_, this->sq_size_);
+    if (this->ring_fd_ >= 0) ::close(this->ring_fd_);
+    this->sqes_ = nullptr;
+    this->cq_ring_ = this->sq_ring_ = nullptr;
+    this->ring_fd_ = -1;
+    return;
+  }
+
+  // leader only: queue SQEs for jobs, enter once, reap whatever completed
+  void submit_and_wait(const std::vector<Job>& jobs) {
+
+    std::uint32_t tail = *this->sq_tail_;
+
+    for (const Job& job : jobs) {
+
+      LIRSBlockRead& r = *job.request;
+      std::uint32_t index = tail & this->sq_mask_;
+      io_uring_sqe& sqe = this->sqes_[index];
+      std::memset(&sqe, 0, sizeof(sqe));
+
+      bool fixed = this->registered_ && r.buf >= this->base_ && r.buf + r.len <= this->base_ + this->size_ &&
+                   (r.buf - this->base_) / kBufferChunk == (r.buf + r.len - 1 - this->base_) / kBufferChunk;
+      sqe.opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+      sqe.fd = r.fd;
+      sqe.off = static_cast<std::uint64_t>(r.offset);
+      sqe.addr = reinterpret_cast<std::uint64_t>(r.buf);
+      sqe.len = static_cast<std::uint32_t>(r.len);
+      if (fixed) sqe.buf_index = static_cast<std::uint16_t>((r.buf - this->base_) / kBufferChunk);
+      sqe.user_data = reinterpret_cast<std::uint64_t>(new Job(job));
+
+      this->sq_array_[index] = index;
+      tail++;
+    }
+    __atomic_store_n(this->sq_tail_, tail, __ATOMIC_RELEASE);
+
+    while (true) {
+
+      unsigned to_submit = tail - __atomic_load_n(this->sq_head_, __ATOMIC_ACQUIRE);
+      long ret = ::syscall(__NR_io_uring_enter, this->ring_fd_, to_submit, 1u, IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (ret >= 0) break;
+      if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+
+        // fail whatever the kernel did not consume
+        this->fail_unsubmitted(tail - __atomic_load_n(this->sq_head_, __ATOMIC_ACQUIRE), errno);
+        break;
+      }
+    }
+
+    this->reap();
+    return;
+  }
+
+  void fail_unsubmitted(unsigned count, int error) {
+
+    // unsubmitted SQEs are the last count entries before the tail
+    std::uint32_t tail = *this->sq_tail_;
+    for (unsigned i = 0; i < count; i++) {
+
+      io_uring_sqe& sqe = this->sqes_[(tail - count + i) & this->sq_mask_];
+      this->complete(sqe.user_data, -error);
+    }
+    __atomic_store_n(this->sq_tail_, tail - count, __ATOMIC_RELEASE);
+    return;
+  }
+
+  void reap() {
+
+    std::uint32_t head = *this->cq_head_;
+    std::uint32_t tail = __atomic_load_n(this->cq_tail_, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++) {
+
+      const io_uring_cqe& cqe = this->cqes_[head & this->cq_mask_];
+      this->complete(cqe.user_data, cqe.res);
+    }
+    __atomic_store_n(this->cq_head_, head, __ATOMIC_RELEASE);
+    return;
+  }
+
+  void complete(std::uint64_t user_data, int res) {
+
+    std::unique_ptr<Job> job(reinterpret_cast<Job*>(user_data));
+    job->request->result = res;
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->in_flight_--;
+    job->batch->remaining--;
+    return;
+  }
+
+  int ring_fd_;
+  char* sq_ring_;
+  char* cq_ring_;
+  io_uring_sqe* sqes_;
+  std::size_t sq_size_ = 0;
+  std::size_t cq_size_ = 0;
+  unsigned sq_entries_ = 0;
+  unsigned cq_entries_ = 0;
+  std::uint32_t* sq_head_ = nullptr;
+  std::uint32_t* sq_tail_ = nullptr;
+  std::uint32_t sq_mask_ = 0;
+  std::uint32_t* sq_array_ = nullptr;
+  std::uint32_t* cq_head_ = nullptr;
+  std::uint32_t* cq_tail_ = nullptr;
+  std::uint32_t cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+
+  char* base_;
+  std::size_t size_ = 0;
+  bool registered_;
+
+  std::mutex mutex_;
+  std::condition_variable progress_;
+  std::deque<Job> pending_;
+  bool leader_;
+  unsigned in_flight_;
+};
+
+#endif
+
+// io_uring over [base, base + size) when available, otherwise a pread thread pool
+inline std::unique_ptr<LIRSBlockReader> make_block_reader(char* base, std::size_t size,
+                                                          unsigned entries = 256, std::size_t threads = 4) {
+
+#if defined(LIRS_HAS_IO_URING)
+  try {
+
+    return std::make_unique<LIRSUringReader>(entries, base, size);
+  } catch (const std::system_error&) {
+    // fall through to the thread pool
+  }
+#else
+  (void)base;
+  (void)size;
+  (void)entries;
+#endif
+  return std::make_unique<LIRSThreadPoolReader>(threads);
+}
+
+#endif
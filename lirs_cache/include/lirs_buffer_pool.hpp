@@ -0,0 +1,547 @@
+#ifndef LIRS_BUFFER_POOL_HPP
+#define LIRS_BUFFER_POOL_HPP
+
+/*
+ * Page buffer pool managed by LIRS (POSIX)
+ *
+ *    fetch_page(id) ──► page table ──► frame (pin++)
+ *                          │ miss
+ *                          ├── free frame, or evict: lowest unpinned block in Q
+ *                          │       clean victim ──► free list
+ *                          │       dirty victim ──► flusher thread ──► LIRSPageFile::write ──► free list
+ *                          └── LIRSPageFile::read into the frame
+ *
+ *    unpin_page(id, dirty)   pin--, dirty pages are written back on eviction or flush
+ *
+ * A dirty victim whose write fails is not dropped: it goes back into the
+ * table at the bottom of Q, still dirty, and is skipped by eviction until a
+ * flush_page() / flush_all() writes it.  flush_all() reports the failure.
+ *
+ * Pinned frames stay resident: the cache's eviction filter skips them, so a
+ * table scan can only push out unpinned HIR pages while hot index pages keep
+ * their LIR status.  Each frame carries a reader/writer latch that callers
+ * take around page accesses; the pool itself only guards its metadata.
+ *
+ * Thread-safe: metadata is guarded by one mutex, page I/O runs outside it.
+ */
+
+#include "lirs_cache.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using LIRSPageId = std::uint64_t;
+
+// storage behind the pool; implementations must allow concurrent calls
+class LIRSPageFile {
+public:
+  virtual ~LIRSPageFile() = default;
+
+  virtual std::size_t page_size() const = 0;
+  virtual void read_page(LIRSPageId id, char* data) = 0;         // pages never written read as zeros
+  virtual void write_page(LIRSPageId id, const char* data) = 0;
+  virtual LIRSPageId allocate_page() = 0;
+};
+
+// pages stored back to back in one file
+class LIRSFilePageFile : public LIRSPageFile {
+public:
+  LIRSFilePageFile(const std::string& path, std::size_t page_size) : fd_(-1), page_size_(page_size), next_(0) {
+
+    if (page_size == 0) throw std::invalid_argument("Page size must be greater than 0");
+
+    this->fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (this->fd_ < 0) throw std::system_error(errno, std::generic_category(), "open " + path);
+
+    struct stat st;
+    if (::fstat(this->fd_, &st) != 0) {
+
+      int error = errno;
+      ::close(this->fd_);
+      throw std::system_error(error, std::generic_category(), "fstat " + path);
+    }
+    this->next_ = (static_cast<std::uint64_t>(st.st_size) + page_size - 1) / page_size;
+    return;
+  }
+
+  ~LIRSFilePageFile() override { ::close(this->fd_); }
+
+  LIRSFilePageFile(const LIRSFilePageFile&) = delete;
+  LIRSFilePageFile& operator=(const LIRSFilePageFile&) = delete;
+
+  std::size_t page_size() const override { return this->page_size_; }
+
+  void read_page(LIRSPageId id, char* data) override {
+
+    std::size_t got = 0;
+    while (got < this->page_size_) {
+
+      ssize_t n = ::pread(this->fd_, data + got, this->page_size_ - got, this->offset(id) + static_cast<off_t>(got));
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0) throw std::system_error(errno, std::generic_category(), "pread");
+      if (n == 0) break;
+      got += static_cast<std::size_t>(n);
+    }
+    std::memset(data + got, 0, this->page_size_ - got);
+    return;
+  }
+
+  void write_page(LIRSPageId id, const char* data) override {
+
+    std::size_t put = 0;
+    while (put < this->page_size_) {
+
+      ssize_t n = ::pwrite(this->fd_, data + put, this->page_size_ - put, this->offset(id) + static_cast<off_t>(put));
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0) throw std::system_error(errno, std::generic_category(), "pwrite");
+      put += static_cast<std::size_t>(n);
+    }
+    return;
+  }
+
+  LIRSPageId allocate_page() override {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->next_++;
+  }
+
+  // make written pages durable
+  void sync() {
+
+    if (::fdatasync(this->fd_) != 0) throw std::system_error(errno, std::generic_category(), "fdatasync");
+    return;
+  }
+
+private:
+  off_t offset(LIRSPageId id) const { return static_cast<off_t>(id * this->page_size_); }
+
+  int fd_;
+  std::size_t page_size_;
+  std::mutex mutex_;
+  LIRSPageId next_;
+};
+
+// a resident page; valid while pinned
+class LIRSPage {
+public:
+  LIRSPageId id() const { return this->id_; }
+  char* data() { return this->data_; }
+  const char* data() const { return this->data_; }
+
+  // reader/writer latch guarding data()
+  std::shared_mutex& latch() { return this->latch_; }
+
+private:
+  friend class LIRSBufferPool;
+
+  LIRSPageId id_ = 0;
+  char* data_ = nullptr;
+  std::shared_mutex latch_;
+  std::size_t pins_ = 0;
+  bool dirty_ = false;
+  bool loading_ = false;
+  bool write_failed_ = false;   // background write-back failed; kept until written
+};
+
+class LIRSBufferPool {
+public:
+  struct Stats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t writes = 0;        // pages written back
+    std::uint64_t flush_errors = 0;  // background writes that failed (the page stays resident)
+  };
+
+  LIRSBufferPool(std::size_t frames, LIRSPageFile& file, double hir_ratio = 0.01)
+    : file_(file), page_size_(file.page_size()), cache_(frames, hir_ratio)
+    , frames_(new LIRSPage[frames]), memory_(nullptr), frame_count_(frames), stopping_(false) {
+
+    std::size_t bytes = (frames * this->page_size_ + kAlignment - 1) / kAlignment * kAlignment;
+    this->memory_ = static_cast<char*>(std::aligned_alloc(kAlignment, bytes));
+    if (this->memory_ == nullptr) throw std::bad_alloc();
+
+    this->free_.reserve(frames);
+    for (std::size_t i = frames; i > 0; i--) {
+
+      this->frames_[i - 1].data_ = this->memory_ + (i - 1) * this->page_size_;
+      this->free_.push_back(static_cast<std::uint32_t>(i - 1));
+    }
+
+    this->cache_.set_eviction_filter([this](const LIRSPageId&, const std::uint32_t& frame) {
+
+      return this->evictable(this->frames_[frame]);
+    });
+    this->cache_.set_removal_listener([this](const LIRSPageId& id, std::uint32_t& frame) {
+
+      this->release_frame(id, frame);
+    });
+
+    this->flusher_ = std::thread([this] { this->run_flusher(); });
+    return;
+  }
+
+  ~LIRSBufferPool() {
+
+    try {
+
+      this->flush_all();
+    } catch (...) {
+      // nothing more to do for pages that cannot be written
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex_);
+      this->stopping_ = true;
+    }
+    this->changed_.notify_all();
+    this->flusher_.join();
+    std::free(this->memory_);
+  }
+
+  LIRSBufferPool(const LIRSBufferPool&) = delete;
+  LIRSBufferPool& operator=(const LIRSBufferPool&) = delete;
+
+  // pin a page, reading it on a miss; nullptr if every frame is pinned (or holds an unwritable page)
+  LIRSPage* fetch_page(LIRSPageId id) {
+
+    std::unique_lock<std::mutex> lock(this->mutex_);
+
+    while (true) {
+
+      auto iter = this->page_table_.find(id);
+      if (iter != this->page_table_.end()) {
+
+        LIRSPage& page = this->frames_[iter->second];
+
+        // another thread is reading it in
+        if (page.loading_) {
+
+          this->changed_.wait(lock);
+          continue;
+        }
+
+        page.pins_++;
+        this->cache_.get(id);
+        this->stats_.hits++;
+        return &page;
+      }
+
+      // an evicted copy is still being written back
+      if (this->flushing_.count(id) > 0) {
+
+        this->changed_.wait(lock);
+        continue;
+      }
+
+      // making room may wait, and another thread may load the page meanwhile
+      if (this->free_.empty()) {
+
+        if (!this->make_room(lock)) return nullptr;
+        continue;
+      }
+      break;
+    }
+
+    LIRSPage& page = this->install(id, this->take_frame());
+    page.loading_ = true;
+    this->stats_.misses++;
+    lock.unlock();
+
+    try {
+
+      this->file_.read_page(id, page.data_);
+    } catch (...) {
+
+      lock.lock();
+      page.loading_ = false;
+      page.pins_ = 0;
+      this->cache_.erase(id);
+      this->changed_.notify_all();
+      throw;
+    }
+
+    lock.lock();
+    page.loading_ = false;
+    this->changed_.notify_all();
+    return &page;
+  }
+
+  // allocate a zeroed page and pin it; nullptr if every frame is pinned (or holds an unwritable page)
+  LIRSPage* new_page(LIRSPageId& id) {
+
+    std::unique_lock<std::mutex> lock(this->mutex_);
+
+    while (this->free_.empty()) {
+
+      if (!this->make_room(lock)) return nullptr;
+    }
+
+    id = this->file_.allocate_page();
+
+    LIRSPage& page = this->install(id, this->take_frame());
+    std::memset(page.data_, 0, this->page_size_);
+    page.dirty_ = true;
+    return &page;
+  }
+
+  // drop one pin; dirty marks the page for write-back
+  bool unpin_page(LIRSPageId id, bool dirty) {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+
+    auto iter = this->page_table_.find(id);
+    if (iter == this->page_table_.end()) return false;
+
+    LIRSPage& page = this->frames_[iter->second];
+    if (page.pins_ == 0) return false;
+
+    page.pins_--;
+    page.dirty_ = page.dirty_ || dirty;
+    return true;
+  }
+
+  // write a resident page if dirty; false if it is not resident
+  bool flush_page(LIRSPageId id) {
+
+    std::unique_lock<std::mutex> lock(this->mutex_);
+
+    auto iter = this->page_table_.find(id);
+    if (iter == this->page_table_.end() || this->frames_[iter->second].loading_) return false;
+
+    this->write_back(lock, this->frames_[iter->second]);
+    return true;
+  }
+
+  // write every dirty page and wait for pending evictions; rethrows the first write error
+  void flush_all() {
+
+    std::unique_lock<std::mutex> lock(this->mutex_);
+
+    std::vector<LIRSPageId> resident;
+    for (const auto& item : this->page_table_) resident.push_back(item.first);
+
+    for (LIRSPageId id : resident) {
+
+      auto iter = this->page_table_.find(id);
+      if (iter != this->page_table_.end() && !this->frames_[iter->second].loading_) {
+
+        this->write_back(lock, this->frames_[iter->second]);
+      }
+    }
+
+    this->changed_.wait(lock, [&] { return this->flush_queue_.empty() && this->flushing_.empty(); });
+
+    if (this->flush_error_) {
+
+      std::error_code error = this->flush_error_;
+      this->flush_error_.clear();
+      throw std::system_error(error, "background page write");
+    }
+    return;
+  }
+
+  std::size_t pin_count(LIRSPageId id) const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    auto iter = this->page_table_.find(id);
+    return iter == this->page_table_.end() ? 0 : this->frames_[iter->second].pins_;
+  }
+
+  Stats stats() const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->stats_;
+  }
+
+  std::size_t size() const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->page_table_.size();
+  }
+
+  std::size_t frames() const { return this->frame_count_; }
+  std::size_t page_size() const { return this->page_size_; }
+
+private:
+  static constexpr std::size_t kAlignment = 4096;
+
+  // caller holds mutex_: evict a page, or wait for a write-back to free a frame;
+  // false if every frame is pinned
+  bool make_room(std::unique_lock<std::mutex>& lock) {
+
+    if (!this->flush_queue_.empty() || !this->flushing_.empty()) {
+
+      this->changed_.wait(lock);
+      return true;
+    }
+    if (this->cache_.evict_one()) return true;
+
+    // every page in Q is pinned: demote LIR pages into Q until an unpinned one can go
+    bool unpinned = false;
+    for (const auto& item : this->page_table_) unpinned = unpinned || this->evictable(this->frames_[item.second]);
+    if (!unpinned) return false;
+
+    while (this->cache_.demote_one()) {
+
+      if (this->cache_.evict_one()) return true;
+    }
+    return false;
+  }
+
+  bool evictable(const LIRSPage& page) const { return page.pins_ == 0 && !page.write_failed_; }
+
+  std::uint32_t take_frame() {
+
+    std::uint32_t frame = this->free_.back();
+    this->free_.pop_back();
+    return frame;
+  }
+
+  // caller holds mutex_: map id to frame, pinned once
+  LIRSPage& install(LIRSPageId id, std::uint32_t frame) {
+
+    LIRSPage& page = this->frames_[frame];
+    page.id_ = id;
+    page.pins_ = 1;
+    page.dirty_ = false;
+    page.write_failed_ = false;
+
+    this->page_table_[id] = frame;
+    this->cache_.put(id, frame);
+    return page;
+  }
+
+  // caller holds mutex_: removal listener for evicted or erased pages
+  void release_frame(LIRSPageId id, std::uint32_t frame) {
+
+    this->page_table_.erase(id);
+
+    if (this->frames_[frame].dirty_) {
+
+      this->flushing_.insert(id);
+      this->flush_queue_.push_back(frame);
+      this->changed_.notify_all();
+      return;
+    }
+
+    this->free_.push_back(frame);
+    this->changed_.notify_all();
+    return;
+  }
+
+  // caller holds mutex_: write a resident page under its shared latch, pinned meanwhile
+  void write_back(std::unique_lock<std::mutex>& lock, LIRSPage& page) {
+
+    if (!page.dirty_) return;
+
+    page.pins_++;
+    page.dirty_ = false;
+    lock.unlock();
+
+    try {
+
+      std::shared_lock<std::shared_mutex> latch(page.latch_);
+      this->file_.write_page(page.id_, page.data_);
+    } catch (...) {
+
+      lock.lock();
+      page.dirty_ = true;
+      page.pins_--;
+      throw;
+    }
+
+    lock.lock();
+    page.pins_--;
+    page.write_failed_ = false;
+    this->stats_.writes++;
+    return;
+  }
+
+  void run_flusher() {
+
+    std::unique_lock<std::mutex> lock(this->mutex_);
+
+    while (true) {
+
+      this->changed_.wait(lock, [&] { return this->stopping_ || !this->flush_queue_.empty(); });
+      if (this->flush_queue_.empty()) return;
+
+      std::uint32_t frame = this->flush_queue_.front();
+      this->flush_queue_.pop_front();
+      LIRSPage& page = this->frames_[frame];
+      lock.unlock();
+
+      // the frame left the page table: nobody else can reach it
+      std::error_code error;
+      try {
+
+        this->file_.write_page(page.id_, page.data_);
+      } catch (const std::system_error& e) {
+
+        error = e.code();
+      } catch (...) {
+
+        error = std::make_error_code(std::errc::io_error);
+      }
+
+      lock.lock();
+      this->flushing_.erase(page.id_);
+
+      if (error) {
+
+        // keep the only copy of the data: back into the table, dirty, until a flush writes it
+        this->flush_error_ = error;
+        this->stats_.flush_errors++;
+        page.write_failed_ = true;
+        this->page_table_[page.id_] = frame;
+        this->cache_.put_cold(page.id_, frame);
+        this->changed_.notify_all();
+        continue;
+      }
+
+      this->stats_.writes++;
+      page.dirty_ = false;
+      this->free_.push_back(frame);
+      this->changed_.notify_all();
+    }
+  }
+
+  LIRSPageFile& file_;
+  std::size_t page_size_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;   // page loaded, frame freed, write-back finished
+  LIRSCache<LIRSPageId, std::uint32_t> cache_;
+  std::unique_ptr<LIRSPage[]> frames_;
+  char* memory_;
+  std::size_t frame_count_;
+  std::vector<std::uint32_t> free_;
+  std::unordered_map<LIRSPageId, std::uint32_t> page_table_;
+
+  std::deque<std::uint32_t> flush_queue_;
+  std::unordered_set<LIRSPageId> flushing_;
+  std::error_code flush_error_;
+  Stats stats_;
+
+  bool stopping_;
+  std::thread flusher_;
+};
+
+#endif
@@ -23,14 +23,47 @@
  *   - LIR (Low IRR): Always resident, protected from eviction
  *   - HIR resident: In cache but can be evicted from Q's bottom
  *   - HIR non-resident: Ghost entry in S (metadata only)
+ *
+ * Snapshot format (save/load):
+ *
+ *    magic "LIRSSNAP" │ version u32 │ capacity │ lir_capacity │ hir_capacity │ lir_count
+ *    │ |S| │ |Q only| │ S records (top -> bottom) │ Q records (top -> bottom)
+ *
+ *    S record : key │ flags u8 (LIR, resident, in Q) │ value (resident only)
+ *    Q record : in S u8 │ key │ value (only when not in S)
+ *
+ * Counts are u64 little-endian; keys/values use the given codecs.  The
+ * capacity is the writer's at save time, which resize() may have changed:
+ * load() and load_delta() take it over (without evicting anything, the
+ * blocks are already those of the writer), so only the HIR ratio has to
+ * match.
+ *
+ * Delta format (save_delta/load_delta, requires track_changes(true)):
+ *
+ *    magic "LIRSDLTA" │ version u32 │ capacity │ lir_count
+ *    │ |erased| keys │ |records| records │ |S prefix| keys │ |Q prefix| keys
+ *
+ *    record   : key │ flags u8 (LIR, resident, in Q, in S, value) │ value (value flag only)
+ *    S prefix : blocks pushed onto S since the last checkpoint (top -> bottom);
+ *               every other block in S kept its relative order, same for Q
+ *               (after put_cold() the Q prefix is all of Q, after append() the S
+ *               and Q prefixes are all of S and Q)
  */
 
 #include <list>
+#include <vector>
 #include <unordered_map>
 #include <cstddef>
 #include <stdexcept>
 #include <optional>
+#include <functional>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <istream>
+#include <ostream>
+#include "lirs_codec.hpp"
 
 template <typename K, typename V>
 class LIRSCache {
@@ -49,6 +82,7 @@ protected:
     ListIter data_iter; // Position in cache data list
     KeyIter lirs_iter;  // Position in LIRS stack (S)
     KeyIter hir_iter;   // Position in HIR resident stack (Q)
+    std::uint8_t changes; // Changes since the last checkpoint (kChanged* bits)
   };
 
   using Map = std::unordered_map<K, Entry>;
@@ -57,17 +91,42 @@ protected:
   std::size_t hir_capacity_;
   std::size_t lir_capacity_;
   std::size_t lir_count_;
+  double hir_ratio_;
 
   List cache_;
   KeyList lirs_stack_;
   KeyList hir_stack_;
   Map map_;
 
+  // called for every resident block leaving the cache (eviction or erase)
+  std::function<void(const K&, V&)> on_remove_;
+
+  // blocks rejected by the filter (e.g. pinned) are skipped when choosing a victim
+  std::function<bool(const K&, const V&)> can_evict_;
+
+  // called when a resident block becomes HIR (demoted or inserted into Q) or LIR (promoted)
+  std::function<void(const K&, V&, bool)> on_state_;
+
+  // checkpoint tracking
+  bool tracking_ = false;
+  std::vector<K> changed_keys_;
+  std::vector<K> erased_keys_;
+  bool q_rewritten_ = false;   // put_cold() appended to Q since the last checkpoint
+  bool s_rewritten_ = false;   // append() appended to S since the last checkpoint
+
 public:
+  // block of another cache's S or Q, e.g. streamed by a warm handoff
+  struct Block {
+    K key;
+    std::optional<V> value;   // resident blocks only
+    bool is_lir;
+    bool in_s;                // false: only in Q
+  };
+
   explicit LIRSCache(std::size_t capacity, double hir_ratio = 0.01)
     : capacity_(capacity)
     , hir_capacity_(std::max<std::size_t>(1, static_cast<std::size_t>(capacity * hir_ratio)))
-    , lir_capacity_(capacity - this->hir_capacity_), lir_count_(0) {
+    , lir_capacity_(capacity - this->hir_capacity_), lir_count_(0), hir_ratio_(hir_ratio) {
 
     if (capacity == 0) throw std::invalid_argument("Capacity must be greater than 0");
     if (hir_ratio <= 0.0 || hir_ratio >= 1.0) throw std::invalid_argument("HIR ratio must be in range(0, 1)");
@@ -121,6 +180,7 @@ public:
     if (entry.is_LIR) {
 
       entry.data_iter->second = value;
+      this->mark(key, entry, kChangedValue);
       this->access_lir(key, entry, this->lirs_stack_, map);
       return;
     }
@@ -129,7 +189,9 @@ public:
     if (entry.is_resident) {
 
       entry.data_iter->second = value;
+      this->mark(key, entry, kChangedValue);
       this->access_hir_resident(key, entry, this->lirs_stack_, this->hir_stack_, map, this->lir_count_);
+      if (!entry.is_LIR) this->notify_state(key, entry, false);
       return;
     }
 
@@ -138,11 +200,713 @@ public:
     return;
   }
 
+  // insert a block that has not been referenced yet (e.g. prefetched) as a
+  // resident HIR block at the bottom of Q, without an S entry: it is the next
+  // eviction victim unless referenced, and never displaces LIR blocks.
+  // A ghost keeps its S position; resident keys are left untouched (false).
+  bool put_cold(const K& key, const V& value) {
+
+    auto iter = this->map_.find(key);
+    if (iter != this->map_.end() && iter->second.is_resident) return false;
+
+    // cold blocks use the room left by LIR blocks; only a full cache evicts (from Q)
+    if (this->cache_.size() >= this->capacity_) {
+
+      this->evict_hir_resident(this->cache_, this->hir_stack_, this->map_);
+      iter = this->map_.find(key);
+    }
+
+    if (iter == this->map_.end()) iter = this->map_.emplace(key, Entry { false, false, false, false, {}, {}, {}, 0 }).first;
+
+    struct Entry& entry = iter->second;
+
+    this->cache_.push_front({key, value});
+    entry.data_iter = this->cache_.begin();
+    entry.is_resident = true;
+
+    this->hir_stack_.push_back(key);
+    entry.hir_iter = std::prev(this->hir_stack_.end());
+    entry.in_hir_stack = true;
+
+    // Q no longer grows only at the top: the next delta rewrites all of it
+    this->mark(key, entry, kChangedValue | kMovedQ);
+    if (this->tracking_) this->q_rewritten_ = true;
+    this->notify_state(key, entry, false);
+    return true;
+  }
+
+  // key of the next eviction victim (lowest evictable block in Q), nullptr if there is none
+  const K* next_victim() const {
+
+    auto victim = this->find_victim(this->hir_stack_);
+    return victim == this->hir_stack_.end() ? nullptr : &*victim;
+  }
+
+  // evict the next victim; false if no resident HIR block can be evicted
+  bool evict_one() { return this->evict_hir_resident(this->cache_, this->hir_stack_, this->map_); }
+
+  // demote the bottom LIR block of S to the top of Q, e.g. when nothing in Q can be evicted
+  bool demote_one() {
+
+    if (this->lir_count_ == 0) return false;
+
+    this->demote_bottom_lir(this->lirs_stack_, this->hir_stack_, this->map_, this->lir_count_);
+    this->stack_pruning(this->lirs_stack_, this->map_);
+    return true;
+  }
+
+  // remove a key (resident or ghost); true if it was resident
+  bool erase(const K& key) {
+
+    auto iter = this->map_.find(key);
+    if (iter == this->map_.end()) return false;
+
+    struct Entry& entry = iter->second;
+    bool was_resident = entry.is_resident;
+    bool was_bottom = entry.in_lirs_stack && std::next(entry.lirs_iter) == this->lirs_stack_.end();
+
+    if (entry.is_LIR) this->lir_count_--;
+    if (entry.in_lirs_stack) this->lirs_stack_.erase(entry.lirs_iter);
+    if (entry.in_hir_stack) this->hir_stack_.erase(entry.hir_iter);
+
+    if (entry.is_resident) {
+
+      if (this->on_remove_) this->on_remove_(entry.data_iter->first, entry.data_iter->second);
+      this->cache_.erase(entry.data_iter);
+    }
+
+    this->map_.erase(iter);
+    this->mark_erased(key);
+
+    // keep an LIR block at the bottom of S
+    if (was_bottom) this->stack_pruning(this->lirs_stack_, this->map_);
+    return was_resident;
+  }
+
+  // resident lookup without updating recency
+  bool contains(const K& key) const {
+
+    auto iter = this->map_.find(key);
+    return iter != this->map_.end() && iter->second.is_resident;
+  }
+
+  // resident LIR block (protected from eviction), without updating recency
+  bool is_lir(const K& key) const {
+
+    auto iter = this->map_.find(key);
+    return iter != this->map_.end() && iter->second.is_LIR;
+  }
+
+  // resident value without updating recency, nullptr if not resident
+  const V* peek(const K& key) const {
+
+    auto iter = this->map_.find(key);
+    if (iter == this->map_.end() || !iter->second.is_resident) return nullptr;
+    return &iter->second.data_iter->second;
+  }
+
+  // change the capacity (same HIR ratio); shrinking demotes LIR blocks and evicts from Q
+  void resize(std::size_t capacity) {
+
+    if (capacity == 0) throw std::invalid_argument("Capacity must be greater than 0");
+
+    this->set_capacity(capacity);
+
+    while (this->lir_count_ > this->lir_capacity_) this->demote_one();
+    while (this->cache_.size() > this->capacity_) {
+
+      if (!this->evict_one() && !this->demote_one()) break;
+    }
+    return;
+  }
+
+  // callback for resident blocks leaving the cache, e.g. to release resources held by values
+  void set_removal_listener(std::function<void(const K&, V&)> listener) {
+
+    this->on_remove_ = std::move(listener);
+    return;
+  }
+
+  // callback for resident blocks changing state: is_lir false when a block enters Q
+  // (demoted from LIR, or inserted/replaced as HIR), true when it is promoted to LIR.
+  // The value may be rewritten in place, e.g. to keep cold values compressed
+  void set_state_listener(std::function<void(const K&, V&, bool is_lir)> listener) {
+
+    this->on_state_ = std::move(listener);
+    return;
+  }
+
+  // predicate for eviction candidates, e.g. to keep pinned blocks resident; the victim is
+  // the lowest block in Q it accepts, and nothing is evicted if it accepts none
+  void set_eviction_filter(std::function<bool(const K&, const V&)> evictable) {
+
+    this->can_evict_ = std::move(evictable);
+    return;
+  }
+
   std::size_t size() const { return this->cache_.size(); }
   std::size_t capacity() const { return this->capacity_; }
   bool empty() const { return this->cache_.empty(); }
 
+  // LIRS state, e.g. for monitoring
+  std::size_t lir_count() const { return this->lir_count_; }
+  std::size_t ghost_count() const { return this->map_.size() - this->cache_.size(); }
+  std::size_t lirs_stack_size() const { return this->lirs_stack_.size(); }
+  std::size_t hir_stack_size() const { return this->hir_stack_.size(); }
+
+  // visit every block as f(key, value or nullptr, is_lir, in_s): S top -> bottom,
+  // then the blocks only in Q, top -> bottom
+  template <typename F>
+  void for_each_block(F f) const {
+
+    for (const K& key : this->lirs_stack_) {
+
+      const struct Entry& entry = this->map_.at(key);
+      f(key, entry.is_resident ? &entry.data_iter->second : nullptr, entry.is_LIR, true);
+    }
+
+    for (const K& key : this->hir_stack_) {
+
+      const struct Entry& entry = this->map_.at(key);
+      if (!entry.in_lirs_stack) f(key, &entry.data_iter->second, false, false);
+    }
+    return;
+  }
+
+  // add the blocks of an older cache, in for_each_block() order, below every block
+  // already here: keys present here are newer and keep their state.  A LIR block
+  // stays LIR while the LIR set has room, and brings the HIR blocks above it into S;
+  // blocks that no longer fit are left out (residents beyond capacity, ghosts with
+  // no LIR block below).  Q keeps S order, then the Q-only blocks.
+  // Returns the number of blocks made resident.
+  std::size_t append(std::vector<Block> blocks) {
+
+    std::size_t added = 0;
+    std::vector<std::size_t> run;   // HIR blocks of S waiting for a LIR block below them
+
+    for (std::size_t i = 0; i < blocks.size(); i++) {
+
+      Block& block = blocks[i];
+      if (this->map_.count(block.key) != 0) continue;
+
+      if (!block.in_s) {
+
+        added += this->append_block(block, false, false, this->capacity_);
+        continue;
+      }
+
+      bool anchors = block.is_lir && block.value && this->lir_count_ < this->lir_capacity_ && this->cache_.size() < this->capacity_;
+      if (!anchors) {
+
+        run.push_back(i);
+        continue;
+      }
+
+      // keep room for the LIR block under the run
+      for (std::size_t index : run) added += this->append_block(blocks[index], false, true, this->capacity_ - 1);
+      run.clear();
+      added += this->append_block(block, true, true, this->capacity_);
+    }
+
+    // nothing to keep these in S: residents stay in Q, ghosts are dropped
+    for (std::size_t index : run) added += this->append_block(blocks[index], false, false, this->capacity_);
+    return added;
+  }
+
+  // serialize values, S/Q order and block states
+  template <typename KeyCodec = LIRSCodec<K>, typename ValueCodec = LIRSCodec<V>>
+  void save(std::ostream& os) const {
+
+    std::uint64_t q_only = 0;
+    for (const K& key : this->hir_stack_) {
+
+      if (!this->map_.at(key).in_lirs_stack) q_only++;
+    }
+
+    os.write(kSnapshotMagic, sizeof(kSnapshotMagic));
+    lirs_detail::write_le(os, kSnapshotVersion, 4);
+    lirs_detail::write_le(os, this->capacity_, 8);
+    lirs_detail::write_le(os, this->lir_capacity_, 8);
+    lirs_detail::write_le(os, this->hir_capacity_, 8);
+    lirs_detail::write_le(os, this->lir_count_, 8);
+    lirs_detail::write_le(os, this->lirs_stack_.size(), 8);
+    lirs_detail::write_le(os, q_only, 8);
+
+    // Stack S
+    for (const K& key : this->lirs_stack_) {
+
+      const struct Entry& entry = this->map_.at(key);
+      std::uint8_t flags = (entry.is_LIR ? kFlagLIR : 0) | (entry.is_resident ? kFlagResident : 0) |
+                           (entry.in_hir_stack ? kFlagInQ : 0);
+
+      KeyCodec::write(os, key);
+      lirs_detail::write_le(os, flags, 1);
+      if (entry.is_resident) ValueCodec::write(os, entry.data_iter->second);
+    }
+
+    // Stack Q
+    for (const K& key : this->hir_stack_) {
+
+      const struct Entry& entry = this->map_.at(key);
+
+      lirs_detail::write_le(os, entry.in_lirs_stack ? 1 : 0, 1);
+      KeyCodec::write(os, key);
+      if (!entry.in_lirs_stack) ValueCodec::write(os, entry.data_iter->second);
+    }
+
+    if (!os) throw std::runtime_error("Failed to write snapshot");
+    return;
+  }
+
+  // replace the cache state with a snapshot taken by save()
+  template <typename KeyCodec = LIRSCodec<K>, typename ValueCodec = LIRSCodec<V>>
+  void load(std::istream& is) {
+
+    char magic[sizeof(kSnapshotMagic)];
+    if (!is.read(magic, sizeof(magic)) || std::memcmp(magic, kSnapshotMagic, sizeof(magic)) != 0) {
+
+      throw std::runtime_error("Not a LIRS snapshot");
+    }
+    if (lirs_detail::read_le(is, 4) != kSnapshotVersion) throw std::runtime_error("Unsupported snapshot version");
+
+    std::uint64_t capacity = lirs_detail::read_le(is, 8);
+    std::uint64_t lir_capacity = lirs_detail::read_le(is, 8);
+    std::uint64_t hir_capacity = lirs_detail::read_le(is, 8);
+    std::uint64_t lir_count = lirs_detail::read_le(is, 8);
+    std::uint64_t s_size = lirs_detail::read_le(is, 8);
+    std::uint64_t q_only = lirs_detail::read_le(is, 8);
+
+    // taken after a resize() the capacity may differ, its LIR / HIR split may not
+    if (capacity == 0 || hir_capacity != this->hir_capacity_for(capacity) || lir_capacity + std::min(capacity, hir_capacity) != capacity) {
+
+      throw std::runtime_error("Snapshot HIR ratio does not match cache");
+    }
+
+    // rebuild into fresh structures, swap in on success
+    List cache;
+    KeyList lirs_stack;
+    KeyList hir_stack;
+    Map map;
+    map.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(s_size + q_only, 2 * capacity + s_size)));
+
+    std::uint64_t lirs = 0;
+    std::uint64_t q_in_s = 0;
+
+    for (std::uint64_t i = 0; i < s_size; i++) {
+
+      K key;
+      KeyCodec::read(is, key);
+      std::uint8_t flags = static_cast<std::uint8_t>(lirs_detail::read_le(is, 1));
+
+      Entry entry {};
+      entry.is_LIR = (flags & kFlagLIR) != 0;
+      entry.is_resident = (flags & kFlagResident) != 0;
+      entry.in_lirs_stack = true;
+      entry.in_hir_stack = false;
+
+      if (entry.is_LIR && !entry.is_resident) throw std::runtime_error("Corrupt snapshot: non-resident LIR block");
+      if ((flags & kFlagInQ) && (entry.is_LIR || !entry.is_resident)) throw std::runtime_error("Corrupt snapshot: invalid Q block");
+      if (flags & kFlagInQ) q_in_s++;
+      if (entry.is_LIR) lirs++;
+
+      if (entry.is_resident) {
+
+        V value;
+        ValueCodec::read(is, value);
+        cache.push_back({key, std::move(value)});
+        entry.data_iter = std::prev(cache.end());
+      }
+
+      lirs_stack.push_back(key);
+      entry.lirs_iter = std::prev(lirs_stack.end());
+
+      if (!map.emplace(key, entry).second) throw std::runtime_error("Corrupt snapshot: duplicate key");
+    }
+
+    for (std::uint64_t i = 0; i < q_in_s + q_only; i++) {
+
+      bool in_s = lirs_detail::read_le(is, 1) != 0;
+      K key;
+      KeyCodec::read(is, key);
+
+      hir_stack.push_back(key);
+
+      if (in_s) {
+
+        auto iter = map.find(key);
+        if (iter == map.end() || iter->second.in_hir_stack || iter->second.is_LIR || !iter->second.is_resident) {
+
+          throw std::runtime_error("Corrupt snapshot: invalid Q block");
+        }
+        iter->second.in_hir_stack = true;
+        iter->second.hir_iter = std::prev(hir_stack.end());
+        continue;
+      }
+
+      V value;
+      ValueCodec::read(is, value);
+      cache.push_back({key, std::move(value)});
+
+      Entry entry {};
+      entry.is_LIR = false;
+      entry.is_resident = true;
+      entry.in_lirs_stack = false;
+      entry.in_hir_stack = true;
+      entry.data_iter = std::prev(cache.end());
+      entry.hir_iter = std::prev(hir_stack.end());
+
+      if (!map.emplace(key, entry).second) throw std::runtime_error("Corrupt snapshot: duplicate key");
+    }
+
+    if (lirs != lir_count || lir_count > lir_capacity) throw std::runtime_error("Corrupt snapshot: LIR count mismatch");
+
+    this->set_capacity(static_cast<std::size_t>(capacity));
+    this->cache_.swap(cache);
+    this->lirs_stack_.swap(lirs_stack);
+    this->hir_stack_.swap(hir_stack);
+    this->map_.swap(map);
+    this->lir_count_ = static_cast<std::size_t>(lir_count);
+
+    this->tracking_ = false;
+    this->changed_keys_.clear();
+    this->erased_keys_.clear();
+    return;
+  }
+
+  // start (or stop) recording changes for save_delta(); clears pending changes
+  void track_changes(bool enabled) {
+
+    for (auto& item : this->map_) item.second.changes = 0;
+
+    this->tracking_ = enabled;
+    this->q_rewritten_ = false;
+    this->s_rewritten_ = false;
+    this->changed_keys_.clear();
+    this->erased_keys_.clear();
+    return;
+  }
+
+  bool tracking_changes() const { return this->tracking_; }
+
+  // blocks inserted, updated, evicted or moved since the last checkpoint
+  std::size_t pending_changes() const { return this->changed_keys_.size() + this->erased_keys_.size(); }
+
+  // write the changes since the last checkpoint and start a new checkpoint period
+  template <typename KeyCodec = LIRSCodec<K>, typename ValueCodec = LIRSCodec<V>>
+  void save_delta(std::ostream& os) {
+
+    if (!this->tracking_) throw std::logic_error("Change tracking is not enabled");
+
+    // blocks moved since the checkpoint form the top of S and Q
+    std::vector<K> s_prefix;
+    for (const K& key : this->lirs_stack_) {
+
+      if (!this->s_rewritten_ && (this->map_.at(key).changes & kMovedS) == 0) break;
+      s_prefix.push_back(key);
+    }
+
+    std::vector<K> q_prefix;
+    for (const K& key : this->hir_stack_) {
+
+      if (!this->q_rewritten_ && (this->map_.at(key).changes & kMovedQ) == 0) break;
+      q_prefix.push_back(key);
+    }
+
+    os.write(kDeltaMagic, sizeof(kDeltaMagic));
+    lirs_detail::write_le(os, kSnapshotVersion, 4);
+    lirs_detail::write_le(os, this->capacity_, 8);
+    lirs_detail::write_le(os, this->lir_count_, 8);
+
+    lirs_detail::write_le(os, this->erased_keys_.size(), 8);
+    for (const K& key : this->erased_keys_) KeyCodec::write(os, key);
+
+    // count live changed blocks (a key may be listed twice if it was erased and re-inserted)
+    std::uint64_t records = 0;
+    for (const K& key : this->changed_keys_) {
+
+      auto iter = this->map_.find(key);
+      if (iter != this->map_.end() && iter->second.changes != 0 && (iter->second.changes & kListed) == 0) {
+
+        iter->second.changes |= kListed;
+        records++;
+      }
+    }
+
+    lirs_detail::write_le(os, records, 8);
+    for (const K& key : this->changed_keys_) {
+
+      auto iter = this->map_.find(key);
+      if (iter == this->map_.end() || (iter->second.changes & kListed) == 0) continue;
+
+      struct Entry& entry = iter->second;
+      bool with_value = entry.is_resident && (entry.changes & kChangedValue);
+      std::uint8_t flags = (entry.is_LIR ? kFlagLIR : 0) | (entry.is_resident ? kFlagResident : 0) |
+                           (entry.in_hir_stack ? kFlagInQ : 0) | (entry.in_lirs_stack ? kFlagInS : 0) |
+                           (with_value ? kFlagValue : 0);
+
+      KeyCodec::write(os, key);
+      lirs_detail::write_le(os, flags, 1);
+      if (with_value) ValueCodec::write(os, entry.data_iter->second);
+
+      entry.changes = 0;
+    }
+
+    lirs_detail::write_le(os, s_prefix.size(), 8);
+    for (const K& key : s_prefix) KeyCodec::write(os, key);
+
+    lirs_detail::write_le(os, q_prefix.size(), 8);
+    for (const K& key : q_prefix) KeyCodec::write(os, key);
+
+    if (!os) throw std::runtime_error("Failed to write delta");
+
+    this->changed_keys_.clear();
+    this->erased_keys_.clear();
+    this->q_rewritten_ = false;
+    this->s_rewritten_ = false;
+    return;
+  }
+
+  // apply a delta written by save_delta() on top of the matching snapshot/deltas
+  template <typename KeyCodec = LIRSCodec<K>, typename ValueCodec = LIRSCodec<V>>
+  void load_delta(std::istream& is) {
+
+    char magic[sizeof(kDeltaMagic)];
+    if (!is.read(magic, sizeof(magic)) || std::memcmp(magic, kDeltaMagic, sizeof(magic)) != 0) {
+
+      throw std::runtime_error("Not a LIRS delta");
+    }
+    if (lirs_detail::read_le(is, 4) != kSnapshotVersion) throw std::runtime_error("Unsupported delta version");
+
+    // a resize() since the last checkpoint: its demotions and evictions are in the records
+    std::uint64_t capacity = lirs_detail::read_le(is, 8);
+    if (capacity == 0) throw std::runtime_error("Corrupt delta: zero capacity");
+    if (capacity != this->capacity_) this->set_capacity(static_cast<std::size_t>(capacity));
+
+    std::uint64_t lir_count = lirs_detail::read_le(is, 8);
+    std::size_t lirs = this->lir_count_;
+    std::size_t unplaced = 0;
+
+    // erased blocks
+    std::uint64_t erased = lirs_detail::read_le(is, 8);
+    for (std::uint64_t i = 0; i < erased; i++) {
+
+      K key;
+      KeyCodec::read(is, key);
+
+      auto iter = this->map_.find(key);
+      if (iter == this->map_.end()) continue;
+
+      if (iter->second.is_LIR) lirs--;
+      this->unlink(iter->second, true, true, true);
+      this->map_.erase(iter);
+    }
+
+    // changed blocks; blocks newly entering S or Q are linked by the prefixes below
+    std::uint64_t records = lirs_detail::read_le(is, 8);
+    for (std::uint64_t i = 0; i < records; i++) {
+
+      K key;
+      KeyCodec::read(is, key);
+      std::uint8_t flags = static_cast<std::uint8_t>(lirs_detail::read_le(is, 1));
+
+      bool is_LIR = (flags & kFlagLIR) != 0;
+      bool is_resident = (flags & kFlagResident) != 0;
+      bool in_s = (flags & kFlagInS) != 0;
+      bool in_q = (flags & kFlagInQ) != 0;
+
+      if ((is_LIR && (!is_resident || !in_s || in_q)) || (in_q && !is_resident) || (!is_resident && !in_s)) {
+
+        throw std::runtime_error("Corrupt delta: invalid block state");
+      }
+
+      auto iter = this->map_.try_emplace(key, Entry {}).first;
+      struct Entry& entry = iter->second;
+
+      this->unlink(entry, entry.in_lirs_stack && !in_s, entry.in_hir_stack && !in_q, entry.is_resident && !is_resident);
+
+      if (flags & kFlagValue) {
+
+        if (!is_resident) throw std::runtime_error("Corrupt delta: value for non-resident block");
+
+        V value;
+        ValueCodec::read(is, value);
+        if (entry.is_resident) {
+
+          entry.data_iter->second = std::move(value);
+        } else {
+
+          this->cache_.push_front({key, std::move(value)});
+          entry.data_iter = this->cache_.begin();
+        }
+      } else if (is_resident && !entry.is_resident) {
+
+        throw std::runtime_error("Corrupt delta: missing value");
+      }
+
+      if (entry.is_LIR != is_LIR) lirs = is_LIR ? lirs + 1 : lirs - 1;
+
+      entry.is_LIR = is_LIR;
+      entry.is_resident = is_resident;
+      entry.changes = (in_s && !entry.in_lirs_stack ? kMovedS : 0) | (in_q && !entry.in_hir_stack ? kMovedQ : 0);
+      unplaced += (entry.changes & kMovedS ? 1 : 0) + (entry.changes & kMovedQ ? 1 : 0);
+    }
+
+    // S and Q prefixes, relinked bottom -> top
+    for (int stack = 0; stack < 2; stack++) {
+
+      KeyList& list = stack == 0 ? this->lirs_stack_ : this->hir_stack_;
+      std::uint8_t moved = stack == 0 ? kMovedS : kMovedQ;
+
+      std::vector<K> prefix(static_cast<std::size_t>(lirs_detail::read_le(is, 8)));
+      for (K& key : prefix) KeyCodec::read(is, key);
+
+      for (auto key = prefix.rbegin(); key != prefix.rend(); ++key) {
+
+        auto iter = this->map_.find(*key);
+        if (iter == this->map_.end()) throw std::runtime_error("Corrupt delta: unknown block in prefix");
+
+        struct Entry& entry = iter->second;
+        bool& linked = stack == 0 ? entry.in_lirs_stack : entry.in_hir_stack;
+        KeyIter& position = stack == 0 ? entry.lirs_iter : entry.hir_iter;
+
+        if (linked) list.erase(position);
+        list.push_front(*key);
+        position = list.begin();
+        linked = true;
+
+        if (entry.changes & moved) unplaced--;
+        entry.changes &= static_cast<std::uint8_t>(~moved);
+      }
+    }
+
+    // every block that entered S or Q must have been placed by a prefix
+    if (unplaced != 0) throw std::runtime_error("Corrupt delta: block missing from prefix");
+    if (lirs != lir_count) throw std::runtime_error("Corrupt delta: LIR count mismatch");
+
+    this->lir_count_ = lirs;
+    return;
+  }
+
 private:
+  static constexpr char kSnapshotMagic[8] = { 'L', 'I', 'R', 'S', 'S', 'N', 'A', 'P' };
+  static constexpr std::uint32_t kSnapshotVersion = 1;
+  static constexpr std::uint8_t kFlagLIR = 1;
+  static constexpr std::uint8_t kFlagResident = 2;
+  static constexpr std::uint8_t kFlagInQ = 4;
+  static constexpr std::uint8_t kFlagInS = 8;
+  static constexpr std::uint8_t kFlagValue = 16;
+
+  static constexpr char kDeltaMagic[8] = { 'L', 'I', 'R', 'S', 'D', 'L', 'T', 'A' };
+  static constexpr std::uint8_t kChangedState = 1;
+  static constexpr std::uint8_t kChangedValue = 2;
+  static constexpr std::uint8_t kMovedS = 4;
+  static constexpr std::uint8_t kMovedQ = 8;
+  static constexpr std::uint8_t kListed = 16;
+
+  std::size_t hir_capacity_for(std::size_t capacity) const {
+
+    return std::max<std::size_t>(1, static_cast<std::size_t>(capacity * this->hir_ratio_));
+  }
+
+  // capacity and its LIR / HIR split; nothing is evicted
+  void set_capacity(std::size_t capacity) {
+
+    this->capacity_ = capacity;
+    this->hir_capacity_ = this->hir_capacity_for(capacity);
+    this->lir_capacity_ = capacity - std::min(capacity, this->hir_capacity_);
+    return;
+  }
+
+  // record a change for the next delta checkpoint
+  void mark(const K& key, Entry& entry, std::uint8_t change) {
+
+    if (!this->tracking_) return;
+
+    if (entry.changes == 0) this->changed_keys_.push_back(key);
+    entry.changes |= change | kChangedState;
+    return;
+  }
+
+  // a rewritten value is a value change for the next delta
+  void notify_state(const K& key, Entry& entry, bool is_lir) {
+
+    if (!this->on_state_) return;
+
+    this->on_state_(key, entry.data_iter->second, is_lir);
+    this->mark(key, entry, kChangedValue);
+    return;
+  }
+
+  // link a block at the bottom of S and/or Q (append); resident if it has a value and
+  // the cache holds fewer than room blocks.  Returns 1 if it became resident
+  std::size_t append_block(Block& block, bool is_lir, bool in_s, std::size_t room) {
+
+    bool resident = block.value && this->cache_.size() < room;
+    if (!resident && !in_s) return 0;
+
+    auto inserted = this->map_.emplace(block.key, Entry { is_lir, false, false, false, {}, {}, {}, 0 });
+    if (!inserted.second) return 0;
+
+    const K& key = inserted.first->first;
+    struct Entry& entry = inserted.first->second;
+
+    if (resident) {
+
+      this->cache_.push_back({key, std::move(*block.value)});
+      entry.data_iter = std::prev(this->cache_.end());
+      entry.is_resident = true;
+    }
+
+    if (in_s) {
+
+      this->lirs_stack_.push_back(key);
+      entry.lirs_iter = std::prev(this->lirs_stack_.end());
+      entry.in_lirs_stack = true;
+      if (this->tracking_) this->s_rewritten_ = true;
+    }
+
+    if (resident && !is_lir) {
+
+      this->hir_stack_.push_back(key);
+      entry.hir_iter = std::prev(this->hir_stack_.end());
+      entry.in_hir_stack = true;
+      if (this->tracking_) this->q_rewritten_ = true;
+    }
+
+    if (is_lir) this->lir_count_++;
+
+    this->mark(key, entry, (resident ? kChangedValue : 0) | (in_s ? kMovedS : 0) | (entry.in_hir_stack ? kMovedQ : 0));
+    if (entry.in_hir_stack) this->notify_state(key, entry, false);
+    return resident ? 1 : 0;
+  }
+
+  void mark_erased(const K& key) {
+
+    if (this->tracking_) this->erased_keys_.push_back(key);
+    return;
+  }
+
+  // remove a block from the selected structures (delta replay)
+  void unlink(Entry& entry, bool from_s, bool from_q, bool from_cache) {
+
+    if (from_s && entry.in_lirs_stack) {
+
+      this->lirs_stack_.erase(entry.lirs_iter);
+      entry.in_lirs_stack = false;
+    }
+    if (from_q && entry.in_hir_stack) {
+
+      this->hir_stack_.erase(entry.hir_iter);
+      entry.in_hir_stack = false;
+    }
+    if (from_cache && entry.is_resident) {
+
+      this->cache_.erase(entry.data_iter);
+      entry.is_resident = false;
+    }
+    return;
+  }
+
   void insert_new(const K& key, const V& value,
                     List& cache, KeyList& lirs_stack, KeyList& hir_stack,
                     Map& map, std::size_t& lir_count, std::size_t lir_capacity) {
@@ -150,38 +914,46 @@ private:
     // Initialization phase: fill the LIR set
     if (lir_count < lir_capacity) {
 
+      // only cold blocks (put_cold) can fill the cache this early
+      if (cache.size() >= this->capacity_) this->evict_hir_resident(cache, hir_stack, map);
+
       cache.push_front({key, value});
       lirs_stack.push_front(key);
 
-      map[key] = Entry {
+      struct Entry& entry = map[key] = Entry {
           true,           // is_LIR
           true,           // is_resident
           true,           // in_lirs_stack
           false,          // in_hir_stack
           cache.begin(),  // data_iter
           lirs_stack.begin(),  // lirs_iter
-          {}              // hir_iter (default)
+          {},             // hir_iter (default)
+          0               // changes
       };
+      this->mark(key, entry, kChangedValue | kMovedS);
       lir_count++;
       return;
     }
 
-    // normal phase: insert as HIR
-    this->evict_hir_resident(cache, hir_stack, map);
+    // normal phase: insert as HIR, evicting from Q once the cache is full
+    if (cache.size() >= this->capacity_) this->evict_hir_resident(cache, hir_stack, map);
 
     cache.push_front({key, value});
     lirs_stack.push_front(key);
     hir_stack.push_front(key);
 
-    map[key] = Entry {
+    struct Entry& entry = map[key] = Entry {
         false,                // is_LIR
         true,                 // is_resident
         true,                 // in_lirs_stack
         true,                 // in_hir_stack
         cache.begin(),        // data_iter
         lirs_stack.begin(),   // lirs_iter
-        hir_stack.begin()     // hir_iter
+        hir_stack.begin(),    // hir_iter
+        0                     // changes
     };
+    this->mark(key, entry, kChangedValue | kMovedS | kMovedQ);
+    this->notify_state(key, entry, false);
     return;
   }
 
@@ -193,6 +965,7 @@ private:
     lirs_stack.erase(entry.lirs_iter);
     lirs_stack.push_front(key);
     entry.lirs_iter = lirs_stack.begin();
+    this->mark(key, entry, kMovedS);
 
     if (was_bottom) this->stack_pruning(lirs_stack, map);
     return;
@@ -202,9 +975,10 @@ private:
                              KeyList& lirs_stack, KeyList& hir_stack,
                              Map& map, std::size_t& lir_count) {
 
-    if (entry.in_lirs_stack) {
+    // if in S, promote to LIR; so does any hit while the LIR set has room (cold blocks
+    // inserted by put_cold during warm-up, or after erase / resize)
+    if (entry.in_lirs_stack || lir_count < this->lir_capacity_) {
 
-      // if in S, promote to LIR
       this->promote_to_lir(key, entry, lirs_stack, hir_stack, map, lir_count);
       return;
     }
@@ -217,6 +991,7 @@ private:
     hir_stack.erase(entry.hir_iter);
     hir_stack.push_front(key);
     entry.hir_iter = hir_stack.begin();
+    this->mark(key, entry, kMovedS | kMovedQ);
     return;
   }
 
@@ -225,16 +1000,17 @@ private:
                                   Map& map, std::size_t& lir_count) {
 
     // Victim block replacement
-    this->evict_hir_resident(cache, hir_stack, map);
+    if (cache.size() >= this->capacity_) this->evict_hir_resident(cache, hir_stack, map);
 
     // load data
     cache.push_front({key, value});
     entry.data_iter = cache.begin();
     entry.is_resident = true;
+    this->mark(key, entry, kChangedValue);
 
-    if (entry.in_lirs_stack) {
+    // if in S (or the LIR set has room), promote to LIR
+    if (entry.in_lirs_stack || lir_count < this->lir_capacity_) {
 
-      // if in S, promote to LIR
       this->promote_to_lir(key, entry, lirs_stack, hir_stack, map, lir_count);
       return;
     }
@@ -247,6 +1023,8 @@ private:
     hir_stack.push_front(key);
     entry.hir_iter = hir_stack.begin();
     entry.in_hir_stack = true;
+    this->mark(key, entry, kMovedS | kMovedQ);
+    this->notify_state(key, entry, false);
     return;
   }
 
@@ -257,11 +1035,14 @@ private:
     // HIR -> LIR
     entry.is_LIR = true;
     lir_count++;
+    this->notify_state(key, entry, true);
 
-    // Remove from S and add to the top of Q
-    lirs_stack.erase(entry.lirs_iter);
+    // move to the top of S
+    if (entry.in_lirs_stack) lirs_stack.erase(entry.lirs_iter);
     lirs_stack.push_front(key);
     entry.lirs_iter = lirs_stack.begin();
+    entry.in_lirs_stack = true;
+    this->mark(key, entry, kMovedS);
 
     // remove from Q
     if (entry.in_hir_stack) {
@@ -270,8 +1051,8 @@ private:
       entry.in_hir_stack = false;
     }
 
-    // Demotion to bottom LIR + pruning
-    this->demote_bottom_lir(lirs_stack, hir_stack, map, lir_count);
+    // Demotion to bottom LIR + pruning; a promotion into a free LIR slot demotes nothing
+    if (lir_count > this->lir_capacity_) this->demote_bottom_lir(lirs_stack, hir_stack, map, lir_count);
     this->stack_pruning(lirs_stack, map);
     return;
   }
@@ -297,6 +1078,8 @@ private:
     hir_stack.push_front(bottom_key);
     entry.hir_iter = hir_stack.begin();
     entry.in_hir_stack = true;
+    this->mark(bottom_key, entry, kMovedQ);
+    this->notify_state(bottom_key, entry, false);
     return;
   }
 
@@ -312,26 +1095,53 @@ private:
       lirs_stack.pop_back();
       entry.in_lirs_stack = false;
 
-      if (!entry.is_resident) map.erase(bottom_key);
+      if (!entry.is_resident) {
+
+        map.erase(bottom_key);
+        this->mark_erased(bottom_key);
+        continue;
+      }
+      this->mark(bottom_key, entry, kChangedState);
     }
     return;
   }
 
-  void evict_hir_resident(List& cache, KeyList& hir_stack, Map& map) {
+  // bottom of Q, or the lowest block accepted by the eviction filter
+  typename KeyList::const_iterator find_victim(const KeyList& hir_stack) const {
 
-    if (hir_stack.empty()) return;
+    if (hir_stack.empty()) return hir_stack.end();
+    if (!this->can_evict_) return std::prev(hir_stack.end());
 
-    K victim_key = hir_stack.back();
-    hir_stack.pop_back();
+    for (auto victim = hir_stack.rbegin(); victim != hir_stack.rend(); ++victim) {
+
+      if (this->can_evict_(*victim, this->map_.at(*victim).data_iter->second)) return std::prev(victim.base());
+    }
+    return hir_stack.end();
+  }
+
+  bool evict_hir_resident(List& cache, KeyList& hir_stack, Map& map) {
+
+    auto victim = this->find_victim(hir_stack);
+    if (victim == hir_stack.end()) return false;
+
+    K victim_key = *victim;
+    hir_stack.erase(victim);
 
     struct Entry& entry = map[victim_key];
 
+    if (this->on_remove_) this->on_remove_(victim_key, entry.data_iter->second);
     cache.erase(entry.data_iter);
     entry.is_resident = false;
     entry.in_hir_stack = false;
 
-    if (!entry.in_lirs_stack) map.erase(victim_key);
-    return;
+    if (!entry.in_lirs_stack) {
+
+      map.erase(victim_key);
+      this->mark_erased(victim_key);
+      return true;
+    }
+    this->mark(victim_key, entry, kChangedState);
+    return true;
   }
 };
 
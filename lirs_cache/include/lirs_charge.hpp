@@ -0,0 +1,50 @@
+#ifndef LIRS_CHARGE_HPP
+#define LIRS_CHARGE_HPP
+
+/*
+ * Charge-weighted sizing of a block-count LIRS cache
+ *
+ *    blocks = limit * size / usage ──► resize (past 1/8 slack)
+ *    usage > limit ──► evict_one / demote_one ──► capacity = max(size, kMinChargeBlocks)
+ *
+ * LIRSCache counts blocks, the caches built on it count bytes.  The block
+ * capacity follows the average charge, and eviction runs until the charge
+ * fits.  When the charge forced evictions, the capacity is clamped to the
+ * blocks left: with mixed sizes the average can put it above the resident
+ * count, and a cache that never looks full takes every new block as LIR,
+ * which degrades LIRS to LRU.
+ */
+
+#include <cstddef>
+#include <algorithm>
+
+namespace lirs_detail {
+
+  constexpr std::size_t kMinChargeBlocks = 2;
+
+  // Cache: LIRSCache interface; usage(): current charge, updated by the cache's listeners
+  template <typename Cache, typename Usage>
+  void fit_charge(Cache& cache, std::size_t limit, Usage usage) {
+
+    std::size_t blocks = cache.size();
+    std::size_t used = usage();
+    if (blocks != 0 && used != 0) {
+
+      std::size_t target = std::max<std::size_t>(kMinChargeBlocks, static_cast<std::size_t>(
+          static_cast<double>(limit) * static_cast<double>(blocks) / static_cast<double>(used)));
+      std::size_t current = cache.capacity();
+
+      if (target > current + current / 8 || target + target / 8 < current) cache.resize(target);
+    }
+
+    bool evicted = false;
+    while (usage() > limit && (cache.evict_one() || cache.demote_one())) evicted = true;
+
+    std::size_t resident = std::max<std::size_t>(kMinChargeBlocks, cache.size());
+    if (evicted && cache.capacity() > resident) cache.resize(resident);
+    return;
+  }
+
+} // namespace lirs_detail
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef LIRS_CHECKPOINT_HPP
+#define LIRS_CHECKPOINT_HPP
+
+/*
+ * Incremental checkpoints of a LIRSCache
+ *
+ *    directory/
+ *      base.<gen>.snap   full snapshot (LIRSCache::save)
+ *      delta.<gen>.log   append-only log of deltas taken after that snapshot
+ *
+ *    log frame : payload bytes u64 │ crc32c u64 │ payload (LIRSCache::save_delta)
+ *
+ * checkpoint() appends the blocks inserted, updated, evicted or moved since
+ * the previous checkpoint.  Once the log holds too many deltas or grows past
+ * a fraction of the snapshot, it is compacted into a new generation: a fresh
+ * snapshot is written, then the previous generation is removed.
+ *
+ * restore() loads the newest snapshot and replays its log; a torn frame at
+ * the end (crash during append) is dropped and truncated away.
+ *
+ * Not thread-safe: callers serialize checkpoint() with cache access.
+ */
+
+#include "lirs_cache.hpp"
+#include "lirs_checksum.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+
+template <typename K, typename V, typename KeyCodec = LIRSCodec<K>, typename ValueCodec = LIRSCodec<V>>
+class LIRSCheckpointer {
+public:
+  struct Options {
+    std::size_t compact_after = 64;   // deltas per generation
+    double compact_ratio = 0.5;       // log size / snapshot size
+  };
+
+  LIRSCheckpointer(LIRSCache<K, V>& cache, std::filesystem::path directory)
+    : LIRSCheckpointer(cache, std::move(directory), Options {}) {}
+
+  LIRSCheckpointer(LIRSCache<K, V>& cache, std::filesystem::path directory, Options options)
+    : cache_(cache), dir_(std::move(directory)), options_(options)
+    , generation_(0), deltas_(0), base_bytes_(0), log_bytes_(0) {
+
+    std::filesystem::create_directories(this->dir_);
+    return;
+  }
+
+  LIRSCheckpointer(const LIRSCheckpointer&) = delete;
+  LIRSCheckpointer& operator=(const LIRSCheckpointer&) = delete;
+
+  // load the newest snapshot and its deltas; false if the directory holds none
+  bool restore() {
+
+    std::uint64_t newest = 0;
+    for (const auto& item : std::filesystem::directory_iterator(this->dir_)) {
+
+      std::uint64_t gen = 0;
+      if (parse_generation(item.path().filename().string(), "base.", ".snap", gen) && gen > newest) newest = gen;
+    }
+    if (newest == 0) return false;
+
+    std::ifstream base(this->base_path(newest), std::ios::binary);
+    if (!base) throw std::runtime_error("Cannot open checkpoint snapshot");
+    this->cache_.template load<KeyCodec, ValueCodec>(base);
+
+    this->generation_ = newest;
+    this->base_bytes_ = std::filesystem::file_size(this->base_path(newest));
+    this->deltas_ = 0;
+    this->log_bytes_ = 0;
+
+    std::ifstream log(this->log_path(newest), std::ios::binary);
+    std::uint64_t log_size = log ? std::filesystem::file_size(this->log_path(newest)) : 0;
+    std::string payload;
+
+    while (log) {
+
+      unsigned char header[kFrameHeader];
+      if (!log.read(reinterpret_cast<char*>(header), kFrameHeader)) break;
+
+      std::uint64_t size = fetch(header);
+      std::uint32_t crc = static_cast<std::uint32_t>(fetch(header + 8));
+
+      if (size > log_size - this->log_bytes_ - kFrameHeader) break;
+
+      payload.resize(static_cast<std::size_t>(size));
+      if (!log.read(&payload[0], static_cast<std::streamsize>(size))) break;
+      if (lirs_detail::crc32c(reinterpret_cast<const std::uint8_t*>(payload.data()), payload.size()) != crc) break;
+
+      std::istringstream delta(payload);
+      this->cache_.template load_delta<KeyCodec, ValueCodec>(delta);
+
+      this->deltas_++;
+      this->log_bytes_ += kFrameHeader + size;
+    }
+
+    // drop a torn tail so later appends follow the last good frame
+    if (log_size != this->log_bytes_) {
+
+      std::filesystem::resize_file(this->log_path(newest), this->log_bytes_);
+    }
+
+    this->cache_.track_changes(true);
+    return true;
+  }
+
+  // persist the changes since the last checkpoint (compacting when due)
+  void checkpoint() {
+
+    if (this->generation_ == 0 || !this->cache_.tracking_changes()) {
+
+      this->compact();
+      return;
+    }
+
+    std::ostringstream delta;
+    this->cache_.template save_delta<KeyCodec, ValueCodec>(delta);
+    const std::string payload = delta.str();
+
+    unsigned char header[kFrameHeader] = {};
+    store(header, payload.size());
+    store(header + 8, lirs_detail::crc32c(reinterpret_cast<const std::uint8_t*>(payload.data()), payload.size()));
+
+    std::ofstream log(this->log_path(this->generation_), std::ios::binary | std::ios::app);
+    log.write(reinterpret_cast<const char*>(header), kFrameHeader);
+    log.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    log.flush();
+    if (!log) throw std::runtime_error("Failed to append checkpoint delta");
+
+    this->deltas_++;
+    this->log_bytes_ += kFrameHeader + payload.size();
+
+    if (this->deltas_ >= this->options_.compact_after ||
+        static_cast<double>(this->log_bytes_) >= this->options_.compact_ratio * static_cast<double>(this->base_bytes_)) {
+
+      this->compact();
+    }
+    return;
+  }
+
+  // write a full snapshot as a new generation and drop the previous one
+  void compact() {
+
+    std::uint64_t next = this->generation_ + 1;
+    std::filesystem::path temp = this->base_path(next);
+    temp += ".tmp";
+
+    {
+      std::ofstream base(temp, std::ios::binary | std::ios::trunc);
+      this->cache_.template save<KeyCodec, ValueCodec>(base);
+      base.flush();
+      if (!base) throw std::runtime_error("Failed to write checkpoint snapshot");
+    }
+
+    std::filesystem::rename(temp, this->base_path(next));
+    std::ofstream(this->log_path(next), std::ios::binary | std::ios::trunc);
+    this->cache_.track_changes(true);
+
+    if (this->generation_ != 0) {
+
+      std::filesystem::remove(this->log_path(this->generation_));
+      std::filesystem::remove(this->base_path(this->generation_));
+    }
+
+    this->generation_ = next;
+    this->base_bytes_ = std::filesystem::file_size(this->base_path(next));
+    this->deltas_ = 0;
+    this->log_bytes_ = 0;
+    return;
+  }
+
+  std::uint64_t generation() const { return this->generation_; }
+  std::size_t deltas() const { return this->deltas_; }
+  std::uint64_t log_bytes() const { return this->log_bytes_; }
+
+private:
+  static constexpr std::size_t kFrameHeader = 16;
+
+  static void store(unsigned char* out, std::uint64_t value) {
+
+    for (int i = 0; i < 8; i++) out[i] = static_cast<unsigned char>(value >> (8 * i));
+    return;
+  }
+
+  static std::uint64_t fetch(const unsigned char* in) {
+
+    std::uint64_t value = 0;
+    for (int i = 0; i < 8; i++) value |= static_cast<std::uint64_t>(in[i]) << (8 * i);
+    return value;
+  }
+
+  static bool parse_generation(const std::string& name, const std::string& prefix,
+                               const std::string& suffix, std::uint64_t& gen) {
+
+    if (name.size() <= prefix.size() + suffix.size()) return false;
+    if (name.compare(0, prefix.size(), prefix) != 0) return false;
+    if (name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) return false;
+
+    gen = 0;
+    for (std::size_t i = prefix.size(); i < name.size() - suffix.size(); i++) {
+
+      if (name[i] < '0' || name[i] > '9') return false;
+      gen = gen * 10 + static_cast<std::uint64_t>(name[i] - '0');
+    }
+    return true;
+  }
+
+  std::filesystem::path base_path(std::uint64_t gen) const { return this->dir_ / ("base." + std::to_string(gen) + ".snap"); }
+  std::filesystem::path log_path(std::uint64_t gen) const { return this->dir_ / ("delta." + std::to_string(gen) + ".log"); }
+
+  LIRSCache<K, V>& cache_;
+  std::filesystem::path dir_;
+  Options options_;
+  std::uint64_t generation_;
+  std::size_t deltas_;
+  std::uint64_t base_bytes_;
+  std::uint64_t log_bytes_;
+};
+
+#endif
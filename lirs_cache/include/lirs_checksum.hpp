@@ -0,0 +1,76 @@
+#ifndef LIRS_CHECKSUM_HPP
+#define LIRS_CHECKSUM_HPP
+
+/*
+ * CRC-32C (Castagnoli) used by binary traces and checkpoint logs
+ *
+ * SSE4.2 crc32 instructions when compiled with them, slicing-by-8 otherwise;
+ * both produce the same value.
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+namespace lirs_detail {
+
+  inline const std::uint32_t* crc32c_table() {
+
+    static const std::vector<std::uint32_t> table = [] {
+
+      std::vector<std::uint32_t> t(8 * 256);
+      for (std::uint32_t i = 0; i < 256; i++) {
+
+        std::uint32_t crc = i;
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1u)));
+        t[i] = crc;
+      }
+      for (std::uint32_t i = 0; i < 256; i++) {
+
+        for (int k = 1; k < 8; k++) t[k * 256 + i] = (t[(k - 1) * 256 + i] >> 8) ^ t[t[(k - 1) * 256 + i] & 0xFF];
+      }
+      return t;
+    }();
+    return table.data();
+  }
+
+  // previous: the CRC of the bytes before data, to checksum a message in parts
+  inline std::uint32_t crc32c(const std::uint8_t* data, std::size_t len, std::uint32_t previous = 0) {
+
+    std::uint32_t crc = previous ^ 0xFFFFFFFFu;
+
+#if defined(__SSE4_2__)
+    std::uint64_t crc64 = crc;
+    for (; len >= 8; data += 8, len -= 8) {
+
+      std::uint64_t word;
+      std::memcpy(&word, data, 8);
+      crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = static_cast<std::uint32_t>(crc64);
+    for (; len > 0; data++, len--) crc = _mm_crc32_u8(crc, *data);
+#else
+    // slicing-by-8
+    const std::uint32_t* t = crc32c_table();
+    for (; len >= 8; data += 8, len -= 8) {
+
+      std::uint32_t lo = crc ^ (static_cast<std::uint32_t>(data[0]) | static_cast<std::uint32_t>(data[1]) << 8 |
+                                static_cast<std::uint32_t>(data[2]) << 16 | static_cast<std::uint32_t>(data[3]) << 24);
+      crc = t[7 * 256 + (lo & 0xFF)] ^ t[6 * 256 + ((lo >> 8) & 0xFF)] ^
+            t[5 * 256 + ((lo >> 16) & 0xFF)] ^ t[4 * 256 + (lo >> 24)] ^
+            t[3 * 256 + data[4]] ^ t[2 * 256 + data[5]] ^ t[1 * 256 + data[6]] ^ t[data[7]];
+    }
+    for (; len > 0; data++, len--) crc = (crc >> 8) ^ t[(crc ^ *data) & 0xFF];
+#endif
+
+    return crc ^ 0xFFFFFFFFu;
+  }
+
+} // namespace lirs_detail
+
+#endif
@@ -0,0 +1,660 @@
+#ifndef LIRS_CLIENT_HPP
+#define LIRS_CLIENT_HPP
+
+/*
+ * memcached protocol client for a fleet of lirs_server nodes (POSIX)
+ *
+ *    get_many(k1..kn)
+ *      │  LIRSHashRing: key -> live node with room under the load bound
+ *      ├──► node A  "get k1 k4 k7\r\n"   ┐ all requests are written first,
+ *      ├──► node B  "get k2 k3\r\n"      │ then the replies are read, so the
+ *      └──► node C  "get k5 k6\r\n"      ┘ nodes work in parallel
+ *      merged ◄── VALUE ... END per node
+ *
+ * Every node has a pool of idle connections (TCP_NODELAY, send/receive
+ * timeouts).  A connect error, timeout or malformed reply marks the node
+ * down for retry_after_ms and the affected keys are routed again: the ring
+ * probes past down nodes, so only the failed node's keys move.  With every
+ * node down, reads miss and writes report failure, as a cache should.
+ *
+ * Reads use the ring's load bound.  A node's load is the number of keys read
+ * from it recently (halved every load_period_ms): under a hot spot, reads
+ * beyond load_factor x the average spill to the next probe.  Writes always
+ * go to the first live node, so a key is only ever stored on its home node
+ * (or, while that is down, its stand-in): a spilled read that misses is
+ * asked again of that node, and only its answer counts as a miss.
+ *
+ * meta_get() asks one given node (mg) and hedges: when that node has not
+ * answered after hedge_ms, the same request goes to a second node, and a
+ * hit from either wins.  The slower connection is dropped, not pooled.
+ * Thread-safe; each call uses its own pooled connections.
+ */
+
+#include "lirs_hash_ring.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+class LIRSMemcacheClient {
+public:
+  struct Options {
+    std::vector<std::string> nodes;      // "host:port"
+    LIRSHashRing::Options ring;
+    std::size_t pool_size = 4;           // idle connections kept per node
+    int timeout_ms = 500;                // connect, send and receive
+    int retry_after_ms = 1000;           // a failed node is skipped this long
+    int load_period_ms = 100;            // half-life of the read load
+  };
+
+  // an mg reply: value, client flags and remaining ttl in seconds (-1: none)
+  struct MetaValue {
+    std::string data;
+    std::uint32_t flags = 0;
+    std::int64_t ttl = -1;
+  };
+
+  explicit LIRSMemcacheClient(Options options)
+    : ring_(options.nodes, options.ring), options_(options), load_epoch_(now_ms()), hedges_(0) {
+
+    for (const std::string& name : options.nodes) this->nodes_.push_back(std::make_unique<Node>(name));
+    return;
+  }
+
+  LIRSMemcacheClient(const LIRSMemcacheClient&) = delete;
+  LIRSMemcacheClient& operator=(const LIRSMemcacheClient&) = delete;
+
+  std::optional<std::string> get(const std::string& key) {
+
+    std::optional<std::string> value;
+    this->get_many(&key, 1, &value);
+    return value;
+  }
+
+  // values[i] = value of keys[i], or nullopt on a miss (or with no node reachable)
+  void get_many(const std::string* keys, std::size_t count, std::optional<std::string>* values) {
+
+    for (std::size_t i = 0; i < count; i++) {
+
+      check_key(keys[i]);
+      values[i].reset();
+    }
+
+    std::vector<std::size_t> pending(count);
+    for (std::size_t i = 0; i < count; i++) pending[i] = i;
+
+    // spilled[i]: keys[i] was read from a node other than the one writes go to
+    std::vector<bool> spilled(count, false);
+    std::vector<bool> strict(count, false);
+
+    // one extra round for the spilled misses
+    for (std::size_t round = 0; !pending.empty() && round <= this->nodes_.size() + 1; round++) {
+
+      // group by node
+      std::vector<std::vector<std::size_t>> groups(this->nodes_.size());
+      for (std::size_t index : pending) {
+
+        std::size_t node = this->locate(keys[index], !strict[index]);
+        if (node == LIRSHashRing::npos) continue;
+
+        spilled[index] = !strict[index] && node != this->home(keys[index]);
+        groups[node].push_back(index);
+        this->nodes_[node]->load.fetch_add(1, std::memory_order_relaxed);
+      }
+      pending.clear();
+
+      // write every request, then read every reply
+      std::vector<Lease> leases(this->nodes_.size());
+      for (std::size_t node = 0; node < groups.size(); node++) {
+
+        if (groups[node].empty()) continue;
+
+        std::string request = "get";
+        for (std::size_t index : groups[node]) {
+
+          request += ' ';
+          request += keys[index];
+        }
+        request += "\r\n";
+
+        leases[node] = this->lease(node);
+        if (!leases[node].valid() || !leases[node].connection->send_all(request, this->options_.timeout_ms)) {
+
+          this->fail(leases[node]);
+          pending.insert(pending.end(), groups[node].begin(), groups[node].end());
+        }
+      }
+
+      for (std::size_t node = 0; node < groups.size(); node++) {
+
+        if (groups[node].empty() || !leases[node].valid()) continue;
+
+        std::unordered_map<std::string_view, std::vector<std::size_t>> wanted;
+        for (std::size_t index : groups[node]) wanted[keys[index]].push_back(index);
+
+        if (!this->read_values(*leases[node].connection, wanted, values)) {
+
+          this->fail(leases[node]);
+          for (std::size_t index : groups[node]) values[index].reset();
+          pending.insert(pending.end(), groups[node].begin(), groups[node].end());
+          continue;
+        }
+        this->release(leases[node]);
+
+        // the spill node never got the write: ask the write node
+        for (std::size_t index : groups[node]) {
+
+          if (values[index] || !spilled[index]) continue;
+          strict[index] = true;
+          pending.push_back(index);
+        }
+      }
+    }
+    return;
+  }
+
+  std::vector<std::optional<std::string>> get_many(const std::vector<std::string>& keys) {
+
+    std::vector<std::optional<std::string>> values(keys.size());
+    this->get_many(keys.data(), keys.size(), values.data());
+    return values;
+  }
+
+  // true once a node stored the value
+  bool set(const std::string& key, std::string_view value, std::uint32_t flags = 0, std::int64_t exptime = 0) {
+
+    check_key(key);
+
+    std::string request = "set " + key + " " + std::to_string(flags) + " " + std::to_string(exptime) + " " + std::to_string(value.size()) + "\r\n";
+    request.append(value.data(), value.size());
+    request += "\r\n";
+
+    std::optional<std::string> reply = this->call(key, request);
+    return reply && *reply == "STORED";
+  }
+
+  // true if a node held the key
+  bool erase(const std::string& key) {
+
+    check_key(key);
+
+    std::optional<std::string> reply = this->call(key, "delete " + key + "\r\n");
+    return reply && *reply == "DELETED";
+  }
+
+  // "mg <key> v f t <flags>" on node; if it has not answered after hedge_ms, also on
+  // hedge (npos: none).  The first hit wins; nullopt on misses or when nothing
+  // answered within timeout_ms.  A node that fails or times out is marked down
+  std::optional<MetaValue> meta_get(const std::string& key, std::string_view flags, std::size_t node, std::size_t hedge,
+                                    int hedge_ms, int timeout_ms) {
+
+    check_key(key);
+
+    std::string request = "mg " + key + " v f t";
+    if (!flags.empty()) request.append(" ").append(flags.data(), flags.size());
+    request += "\r\n";
+
+    std::int64_t start = now_ms();
+    std::int64_t deadline = start + timeout_ms;
+    std::size_t targets[2] = { node, hedge };
+    Lease leases[2];
+    bool waiting[2] = { false, false };
+    bool hedged = hedge == LIRSHashRing::npos;
+    std::optional<MetaValue> result;
+
+    // connecting to the first node may take only until the hedge is due
+    auto send = [&](std::size_t i) {
+
+      leases[i] = this->lease(targets[i], i == 0 && !hedged ? hedge_ms : timeout_ms);
+      if (leases[i].valid() && leases[i].connection->send_all(request, timeout_ms)) waiting[i] = true;
+      else this->fail(leases[i]);
+    };
+    send(0);
+
+    while (!result) {
+
+      std::int64_t now = now_ms();
+      if (now >= deadline) break;
+
+      // hedge once the first node is late (or already failed)
+      if (!hedged && (!waiting[0] || now >= start + hedge_ms)) {
+
+        hedged = true;
+        this->hedges_.fetch_add(1, std::memory_order_relaxed);
+        send(1);
+        continue;
+      }
+      if (!waiting[0] && !waiting[1]) break;
+
+      std::int64_t until = hedged ? deadline : std::min(deadline, start + hedge_ms);
+      pollfd ready[2];
+      std::size_t index[2];
+      nfds_t count = 0;
+      for (std::size_t i = 0; i < 2; i++) {
+
+        if (!waiting[i]) continue;
+        ready[count] = { leases[i].connection->fd(), POLLIN, 0 };
+        index[count++] = i;
+      }
+
+      int polled = ::poll(ready, count, static_cast<int>(until - now));
+      if (polled < 0 && errno != EINTR) break;
+
+      for (nfds_t at = 0; polled > 0 && at < count; at++) {
+
+        if (ready[at].revents == 0) continue;
+
+        std::size_t i = index[at];
+        waiting[i] = false;
+
+        MetaValue value;
+        bool hit = false;
+        if (!this->read_meta(*leases[i].connection, value, hit, static_cast<int>(std::max<std::int64_t>(1, deadline - now_ms())))) {
+
+          this->fail(leases[i]);
+          continue;
+        }
+        this->release(leases[i]);
+        if (hit && !result) result = std::move(value);
+      }
+    }
+
+    // a reply may still arrive on these: drop them instead of pooling; no answer in time counts as a failure
+    for (std::size_t i = 0; i < 2; i++) {
+
+      if (!waiting[i]) continue;
+      if (result) leases[i].connection.reset();
+      else this->fail(leases[i]);
+    }
+    return result;
+  }
+
+  // node a key maps to right now (for a read: within the load bound), npos if none is alive
+  std::size_t locate(const std::string& key, bool read = false) {
+
+    std::int64_t now = now_ms();
+    if (read) {
+
+      // too little recent traffic for the bound to mean anything: place strictly
+      this->decay(now);
+      std::size_t total = 0;
+      for (auto& node : this->nodes_) total += node->load.load(std::memory_order_relaxed);
+      read = total >= kMinLoad * this->nodes_.size();
+    }
+    return this->ring_.locate(LIRSHashRing::hash(key),
+        [this, now](std::size_t node) { return this->nodes_[node]->down_until.load(std::memory_order_relaxed) <= now; },
+        [this, read](std::size_t node) { return read ? this->nodes_[node]->load.load(std::memory_order_relaxed) : 0; });
+  }
+
+  // node that writes of a key go to: its first live probe, whatever the load; npos if none is alive
+  std::size_t home(const std::string& key) { return this->locate(key, false); }
+
+  bool alive(std::size_t node) const { return this->nodes_.at(node)->down_until.load(std::memory_order_relaxed) <= now_ms(); }
+
+  const LIRSHashRing& ring() const { return this->ring_; }
+
+  // requests that failed on a node (connect, timeout, bad reply), by node
+  std::uint64_t failures(std::size_t node) const { return this->nodes_.at(node)->failures.load(std::memory_order_relaxed); }
+
+  // meta_get() requests sent to a second node
+  std::uint64_t hedges() const { return this->hedges_.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr std::size_t kReadChunk = 16 * 1024;
+  static constexpr std::size_t kKeyLimit = 250;
+  static constexpr std::size_t kMinLoad = 64;   // average recent reads per node before the bound applies
+
+  class Connection {
+  public:
+    explicit Connection(int fd) : fd_(fd), offset_(0) {}
+    ~Connection() { ::close(this->fd_); }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    bool send_all(std::string_view data, int timeout_ms) {
+
+      std::size_t offset = 0;
+      while (offset < data.size()) {
+
+        ssize_t written = ::send(this->fd_, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) continue;
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && this->wait(POLLOUT, timeout_ms)) continue;
+        if (written <= 0) return false;
+        offset += static_cast<std::size_t>(written);
+      }
+      return true;
+    }
+
+    // next line without "\r\n"; false on error or timeout
+    bool read_line(std::string& line, int timeout_ms) {
+
+      for (;;) {
+
+        std::size_t end = this->buffer_.find("\r\n", this->offset_);
+        if (end != std::string::npos) {
+
+          line.assign(this->buffer_, this->offset_, end - this->offset_);
+          this->offset_ = end + 2;
+          return true;
+        }
+        if (!this->fill(timeout_ms)) return false;
+      }
+    }
+
+    // exactly size bytes followed by "\r\n"
+    bool read_block(std::string& data, std::size_t size, int timeout_ms) {
+
+      while (this->buffer_.size() - this->offset_ < size + 2) {
+
+        if (!this->fill(timeout_ms)) return false;
+      }
+      if (this->buffer_.compare(this->offset_ + size, 2, "\r\n") != 0) return false;
+
+      data.assign(this->buffer_, this->offset_, size);
+      this->offset_ += size + 2;
+      return true;
+    }
+
+    // no unread reply bytes, i.e. safe to reuse
+    bool idle() const { return this->offset_ == this->buffer_.size(); }
+
+    int fd() const { return this->fd_; }
+
+  private:
+    bool wait(short events, int timeout_ms) {
+
+      pollfd ready { this->fd_, events, 0 };
+      int result;
+      do result = ::poll(&ready, 1, timeout_ms);
+      while (result < 0 && errno == EINTR);
+      return result > 0;
+    }
+
+    bool fill(int timeout_ms) {
+
+      if (this->offset_ == this->buffer_.size()) {
+
+        this->buffer_.clear();
+        this->offset_ = 0;
+      }
+
+      char chunk[kReadChunk];
+      for (;;) {
+
+        ssize_t received = ::recv(this->fd_, chunk, sizeof(chunk), 0);
+        if (received > 0) {
+
+          this->buffer_.append(chunk, static_cast<std::size_t>(received));
+          return true;
+        }
+        if (received < 0 && errno == EINTR) continue;
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && this->wait(POLLIN, timeout_ms)) continue;
+        return false;
+      }
+    }
+
+    int fd_;
+    std::string buffer_;
+    std::size_t offset_;
+  };
+
+  struct Node {
+    explicit Node(const std::string& name) : name(name), down_until(0), load(0), failures(0) {
+
+      std::size_t colon = name.rfind(':');
+      if (colon == std::string::npos || colon + 1 == name.size()) throw std::invalid_argument("Node must be host:port: " + name);
+      this->host = name.substr(0, colon);
+      this->port = name.substr(colon + 1);
+    }
+
+    std::string name;
+    std::string host;
+    std::string port;
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Connection>> idle;
+
+    std::atomic<std::int64_t> down_until;   // steady clock ms; skipped by the ring until then
+    std::atomic<std::size_t> load;          // keys read recently
+    std::atomic<std::uint64_t> failures;
+  };
+
+  // a pooled connection checked out for one request
+  struct Lease {
+    std::size_t node = LIRSHashRing::npos;
+    std::unique_ptr<Connection> connection;
+
+    bool valid() const { return this->connection != nullptr; }
+  };
+
+  static std::int64_t now_ms() {
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  static void check_key(const std::string& key) {
+
+    if (key.empty() || key.size() > kKeyLimit) throw std::invalid_argument("Key length must be 1-250 bytes");
+    for (unsigned char c : key) {
+
+      if (c <= ' ' || c == 0x7F) throw std::invalid_argument("Key must not contain spaces or control characters");
+    }
+    return;
+  }
+
+  // an idle pooled connection, or a new one (connect_timeout_ms < 0: timeout_ms)
+  Lease lease(std::size_t index, int connect_timeout_ms = -1) {
+
+    Node& node = *this->nodes_[index];
+    Lease lease;
+    lease.node = index;
+
+    {
+      std::lock_guard<std::mutex> lock(node.mutex);
+      if (!node.idle.empty()) {
+
+        lease.connection = std::move(node.idle.back());
+        node.idle.pop_back();
+        return lease;
+      }
+    }
+
+    int fd = this->connect(node, connect_timeout_ms < 0 ? this->options_.timeout_ms : connect_timeout_ms);
+    if (fd >= 0) lease.connection = std::make_unique<Connection>(fd);
+    return lease;
+  }
+
+  void release(Lease& lease) {
+
+    if (lease.node == LIRSHashRing::npos) return;
+
+    Node& node = *this->nodes_[lease.node];
+    if (lease.connection != nullptr && lease.connection->idle()) {
+
+      std::lock_guard<std::mutex> lock(node.mutex);
+      if (node.idle.size() < this->options_.pool_size) node.idle.push_back(std::move(lease.connection));
+    }
+    lease.connection.reset();
+    lease.node = LIRSHashRing::npos;
+    return;
+  }
+
+  // drop the connection and the node's idle pool, and skip the node for a while
+  void fail(Lease& lease) {
+
+    if (lease.node == LIRSHashRing::npos) return;
+
+    Node& node = *this->nodes_[lease.node];
+    node.down_until.store(now_ms() + this->options_.retry_after_ms, std::memory_order_relaxed);
+    node.failures.fetch_add(1, std::memory_order_relaxed);
+
+    std::vector<std::unique_ptr<Connection>> stale;
+    {
+      std::lock_guard<std::mutex> lock(node.mutex);
+      stale.swap(node.idle);
+    }
+
+    lease.connection.reset();
+    lease.node = LIRSHashRing::npos;
+    return;
+  }
+
+  // halve every node's read load once per load period (one caller wins the epoch)
+  void decay(std::int64_t now) {
+
+    std::int64_t epoch = this->load_epoch_.load(std::memory_order_relaxed);
+    if (now - epoch < this->options_.load_period_ms) return;
+    if (!this->load_epoch_.compare_exchange_strong(epoch, now, std::memory_order_relaxed)) return;
+
+    for (auto& node : this->nodes_) node->load.store(node->load.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+    return;
+  }
+
+  // non-blocking connect bounded by timeout_ms; -1 on failure
+  int connect(const Node& node, int timeout_ms) const {
+
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* addresses = nullptr;
+    if (::getaddrinfo(node.host.c_str(), node.port.c_str(), &hints, &addresses) != 0) return -1;
+
+    int fd = -1;
+    for (addrinfo* address = addresses; address != nullptr && fd < 0; address = address->ai_next) {
+
+      fd = ::socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK, address->ai_protocol);
+      if (fd < 0) continue;
+
+      bool connected = ::connect(fd, address->ai_addr, address->ai_addrlen) == 0;
+      if (!connected && errno == EINPROGRESS) {
+
+        pollfd ready { fd, POLLOUT, 0 };
+        int error = 0;
+        socklen_t length = sizeof(error);
+        connected = ::poll(&ready, 1, timeout_ms) > 0 &&
+                    ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0;
+      }
+
+      if (!connected) {
+
+        ::close(fd);
+        fd = -1;
+      }
+    }
+    ::freeaddrinfo(addresses);
+
+    if (fd >= 0) {
+
+      int one = 1;
+      ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+  }
+
+  // VALUE <key> <flags> <bytes> ... END, for the keys of one request
+  bool read_values(Connection& connection, const std::unordered_map<std::string_view, std::vector<std::size_t>>& wanted,
+                   std::optional<std::string>* values) {
+
+    std::string line;
+    std::string data;
+    for (;;) {
+
+      if (!connection.read_line(line, this->options_.timeout_ms)) return false;
+      if (line == "END") return true;
+      if (line.compare(0, 6, "VALUE ") != 0) return false;
+
+      std::size_t key_end = line.find(' ', 6);
+      std::size_t flags_end = key_end == std::string::npos ? key_end : line.find(' ', key_end + 1);
+      if (flags_end == std::string::npos) return false;
+
+      char* end = nullptr;
+      std::size_t size = std::strtoull(line.c_str() + flags_end + 1, &end, 10);
+      if (end == line.c_str() + flags_end + 1) return false;
+      if (!connection.read_block(data, size, this->options_.timeout_ms)) return false;
+
+      auto iter = wanted.find(std::string_view(line).substr(6, key_end - 6));
+      if (iter == wanted.end()) return false;
+      for (std::size_t index : iter->second) values[index] = data;
+    }
+  }
+
+  // VA <bytes> <flags>* + data, or EN
+  bool read_meta(Connection& connection, MetaValue& value, bool& hit, int timeout_ms) {
+
+    std::string line;
+    if (!connection.read_line(line, timeout_ms)) return false;
+
+    hit = false;
+    if (line == "EN") return true;
+    if (line.compare(0, 3, "VA ") != 0) return false;
+
+    char* end = nullptr;
+    std::size_t size = std::strtoull(line.c_str() + 3, &end, 10);
+    if (end == line.c_str() + 3) return false;
+
+    // returned flags: f<client flags> t<ttl>
+    for (std::size_t pos = line.find(' ', 3); pos != std::string::npos; pos = line.find(' ', pos + 1)) {
+
+      const char* flag = line.c_str() + pos + 1;
+      if (flag[0] == 'f') value.flags = static_cast<std::uint32_t>(std::strtoul(flag + 1, nullptr, 10));
+      else if (flag[0] == 't') value.ttl = std::strtoll(flag + 1, nullptr, 10);
+    }
+
+    if (!connection.read_block(value.data, size, timeout_ms)) return false;
+    hit = true;
+    return true;
+  }
+
+  // one request with a one-line reply, retried on the next node after a failure
+  std::optional<std::string> call(const std::string& key, const std::string& request) {
+
+    for (std::size_t attempt = 0; attempt <= this->nodes_.size(); attempt++) {
+
+      std::size_t node = this->home(key);
+      if (node == LIRSHashRing::npos) return std::nullopt;
+
+      Lease lease = this->lease(node);
+      std::string reply;
+      if (lease.valid() && lease.connection->send_all(request, this->options_.timeout_ms) &&
+          lease.connection->read_line(reply, this->options_.timeout_ms)) {
+
+        this->release(lease);
+        return reply;
+      }
+      this->fail(lease);
+    }
+    return std::nullopt;
+  }
+
+  LIRSHashRing ring_;
+  Options options_;
+  std::vector<std::unique_ptr<Node>> nodes_;
+  std::atomic<std::int64_t> load_epoch_;   // start of the current load period, steady ms
+  std::atomic<std::uint64_t> hedges_;
+};
+
+#endif
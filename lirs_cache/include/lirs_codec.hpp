@@ -0,0 +1,114 @@
+#ifndef LIRS_CODEC_HPP
+#define LIRS_CODEC_HPP
+
+/*
+ * Key/value codecs used by snapshot, checkpoint and replication streams
+ *
+ * A codec is any type with
+ *     static void write(std::ostream& os, const T& value);
+ *     static void read(std::istream& is, T& value);
+ *
+ * Built-in codecs:
+ *   - integral / enum types : fixed-width little-endian
+ *   - std::string           : u64 length + bytes
+ *   - other trivially copyable types : raw object bytes (host byte order)
+ *
+ * Pass a custom codec as a template argument to save()/load() for any
+ * other key or value type.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <stdexcept>
+
+namespace lirs_detail {
+
+  inline void write_le(std::ostream& os, std::uint64_t value, std::size_t bytes) {
+
+    char buffer[8];
+    for (std::size_t i = 0; i < bytes; i++) buffer[i] = static_cast<char>(value >> (8 * i));
+    os.write(buffer, static_cast<std::streamsize>(bytes));
+    return;
+  }
+
+  inline std::uint64_t read_le(std::istream& is, std::size_t bytes) {
+
+    unsigned char buffer[8];
+    if (!is.read(reinterpret_cast<char*>(buffer), static_cast<std::streamsize>(bytes))) {
+
+      throw std::runtime_error("Unexpected end of stream");
+    }
+
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < bytes; i++) value |= static_cast<std::uint64_t>(buffer[i]) << (8 * i);
+    return value;
+  }
+
+} // namespace lirs_detail
+
+template <typename T, typename Enable = void>
+struct LIRSCodec {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "No built-in codec for this type; pass a custom codec");
+
+  static void write(std::ostream& os, const T& value) {
+
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    return;
+  }
+
+  static void read(std::istream& is, T& value) {
+
+    if (!is.read(reinterpret_cast<char*>(&value), sizeof(T))) throw std::runtime_error("Unexpected end of stream");
+    return;
+  }
+};
+
+template <typename T>
+struct LIRSCodec<T, std::enable_if_t<std::is_integral<T>::value || std::is_enum<T>::value>> {
+  static void write(std::ostream& os, const T& value) {
+
+    lirs_detail::write_le(os, static_cast<std::uint64_t>(value), sizeof(T));
+    return;
+  }
+
+  static void read(std::istream& is, T& value) {
+
+    value = static_cast<T>(lirs_detail::read_le(is, sizeof(T)));
+    return;
+  }
+};
+
+template <>
+struct LIRSCodec<std::string> {
+  static void write(std::ostream& os, const std::string& value) {
+
+    lirs_detail::write_le(os, value.size(), 8);
+    os.write(value.data(), static_cast<std::streamsize>(value.size()));
+    return;
+  }
+
+  static void read(std::istream& is, std::string& value) {
+
+    std::uint64_t size = lirs_detail::read_le(is, 8);
+    value.clear();
+
+    // grow in bounded steps so a corrupt length cannot trigger a huge allocation
+    constexpr std::uint64_t kStep = 1 << 20;
+    while (value.size() < size) {
+
+      std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(kStep, size - value.size()));
+      std::size_t offset = value.size();
+      value.resize(offset + chunk);
+      if (!is.read(&value[offset], static_cast<std::streamsize>(chunk))) throw std::runtime_error("Unexpected end of stream");
+    }
+    return;
+  }
+};
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef LIRS_COMPRESS_HPP
+#define LIRS_COMPRESS_HPP
+
+/*
+ * Value codecs for LIRSCompressedCache
+ *
+ *    compress(raw)               ──► bytes
+ *    decompress(bytes, raw_size) ──► raw
+ *
+ * LIRSLZCodec is a byte-oriented LZ77 in the LZ4 block layout: speed over
+ * ratio, since it runs on every demotion and on every cold hit.
+ *
+ *    sequence : token u8 (literal len << 4 │ match len - 4) │ [len 255...]
+ *               │ literals │ offset u16 │ [match len 255...]
+ *
+ * The last sequence has literals only.  Lengths of 15 and more continue in
+ * extra bytes (255 means "add and read on").
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class LIRSCompressor {
+public:
+  virtual ~LIRSCompressor() = default;
+
+  virtual std::string compress(std::string_view raw) const = 0;
+
+  // throws std::runtime_error if data does not decode to exactly raw_size bytes
+  virtual std::string decompress(std::string_view data, std::size_t raw_size) const = 0;
+  virtual const char* name() const = 0;
+};
+
+class LIRSLZCodec : public LIRSCompressor {
+public:
+  std::string compress(std::string_view raw) const override {
+
+    const char* src = raw.data();
+    std::size_t size = raw.size();
+
+    std::string out;
+    out.reserve(size + size / 255 + 16);
+
+    std::vector<std::uint32_t> table(kHashSize, 0);   // position + 1 of the last 4-byte sequence per hash
+    std::size_t anchor = 0;
+
+    // matches stop kLastLiterals short of the end, so the stream always ends with literals
+    if (size >= kMinInput) {
+
+      std::size_t limit = size - kLastLiterals;
+      for (std::size_t pos = 0; pos + kMinMatch <= limit;) {
+
+        std::uint32_t word = read32(src + pos);
+        std::uint32_t& slot = table[hash(word)];
+        std::size_t candidate = slot;
+        slot = static_cast<std::uint32_t>(pos + 1);
+
+        if (candidate == 0 || pos + 1 - candidate > kMaxOffset || read32(src + candidate - 1) != word) {
+
+          pos++;
+          continue;
+        }
+        candidate--;
+
+        std::size_t length = kMinMatch;
+        while (pos + length < limit && src[candidate + length] == src[pos + length]) length++;
+
+        this->emit(out, src + anchor, pos - anchor, pos - candidate, length);
+        pos += length;
+        anchor = pos;
+      }
+    }
+
+    this->emit(out, src + anchor, size - anchor, 0, 0);
+    return out;
+  }
+
+  std::string decompress(std::string_view data, std::size_t raw_size) const override {
+
+    const auto* in = reinterpret_cast<const std::uint8_t*>(data.data());
+    const auto* end = in + data.size();
+
+    std::string out;
+    out.reserve(raw_size);
+
+    while (in < end) {
+
+      std::uint8_t token = *in++;
+
+      std::size_t literals = read_length(in, end, token >> 4);
+      if (static_cast<std::size_t>(end - in) < literals || out.size() + literals > raw_size) corrupt();
+      out.append(reinterpret_cast<const char*>(in), literals);
+      in += literals;
+
+      if (in == end) break;
+
+      if (end - in < 2) corrupt();
+      std::size_t offset = in[0] | static_cast<std::size_t>(in[1]) << 8;
+      in += 2;
+
+      std::size_t length = read_length(in, end, token & 0x0F) + kMinMatch;
+      if (offset == 0 || offset > out.size() || out.size() + length > raw_size) corrupt();
+
+      // byte by byte: a match may overlap the bytes it produces
+      std::size_t from = out.size() - offset;
+      for (std::size_t i = 0; i < length; i++) out.push_back(out[from + i]);
+    }
+
+    if (out.size() != raw_size) corrupt();
+    return out;
+  }
+
+  const char* name() const override { return "lz"; }
+
+private:
+  static constexpr std::size_t kMinMatch = 4;
+  static constexpr std::size_t kLastLiterals = 5;
+  static constexpr std::size_t kMinInput = 13;
+  static constexpr std::size_t kMaxOffset = 65535;
+  static constexpr unsigned kHashBits = 12;
+  static constexpr std::size_t kHashSize = std::size_t { 1 } << kHashBits;
+
+  static std::uint32_t read32(const char* p) {
+
+    std::uint32_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+  }
+
+  static std::uint32_t hash(std::uint32_t word) { return (word * 2654435761u) >> (32 - kHashBits); }
+
+  static void put_length(std::string& out, std::size_t length) {
+
+    for (; length >= 255; length -= 255) out.push_back(static_cast<char>(255));
+    out.push_back(static_cast<char>(length));
+    return;
+  }
+
+  static std::size_t read_length(const std::uint8_t*& in, const std::uint8_t* end, std::size_t length) {
+
+    if (length != 15) return length;
+
+    for (;;) {
+
+      if (in == end) corrupt();
+      std::uint8_t more = *in++;
+      length += more;
+      if (more != 255) return length;
+    }
+  }
+
+  [[noreturn]] static void corrupt() { throw std::runtime_error("Corrupt compressed value"); }
+
+  // one sequence; match_length 0 for the final literals-only sequence
+  void emit(std::string& out, const char* literals, std::size_t literal_length, std::size_t offset, std::size_t match_length) const {
+
+    std::size_t match_code = match_length == 0 ? 0 : match_length - kMinMatch;
+    out.push_back(static_cast<char>((std::min<std::size_t>(literal_length, 15) << 4) | std::min<std::size_t>(match_code, 15)));
+
+    if (literal_length >= 15) put_length(out, literal_length - 15);
+    out.append(literals, literal_length);
+
+    if (match_length == 0) return;
+
+    out.push_back(static_cast<char>(offset & 0xFF));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (match_code >= 15) put_length(out, match_code - 15);
+    return;
+  }
+};
+
+#endif
@@ -0,0 +1,214 @@
+#ifndef LIRS_COMPRESSED_CACHE_HPP
+#define LIRS_COMPRESSED_CACHE_HPP
+
+/*
+ * LIRS cache that keeps cold values compressed
+ *
+ *    LIR block           : raw bytes
+ *    HIR resident (in Q) : codec bytes  ◄── demoted from LIR / inserted as HIR
+ *                              │
+ *                              └──► raw again when promoted to LIR
+ *
+ * HIR residents are by definition rarely referenced, so they are compressed
+ * as they enter Q (through the core's state listener) and only decompressed
+ * on promotion, or into a copy when a cold hit leaves them in Q.  Values
+ * that are small or do not shrink by at least 1/8 stay raw.
+ *
+ * Capacity is in stored bytes, so compressed values leave room for more
+ * blocks: the block capacity of the underlying cache follows the average
+ * stored size, and the byte limit is enforced by evicting from Q (demoting,
+ * and so compressing, LIR blocks when Q is empty) after every put and after
+ * a get that promoted a block.
+ *
+ * Thread-safe: all operations take one mutex.
+ */
+
+#include "lirs_cache.hpp"
+#include "lirs_charge.hpp"
+#include "lirs_compress.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+template <typename K>
+class LIRSCompressedCache {
+public:
+  struct Stats {
+    std::uint64_t compressed;       // values compressed on entering Q
+    std::uint64_t incompressible;   // values left raw (too small or no gain)
+    std::uint64_t decompressed;     // promotions and cold hits
+  };
+
+  explicit LIRSCompressedCache(std::size_t capacity, double hir_ratio = 0.01,
+                               std::unique_ptr<LIRSCompressor> codec = std::make_unique<LIRSLZCodec>())
+    : capacity_(capacity), usage_(0), raw_bytes_(0), stats_ {}
+    , codec_(std::move(codec)), cache_(std::max<std::size_t>(lirs_detail::kMinChargeBlocks, capacity / kMinCompress), hir_ratio) {
+
+    if (capacity == 0) throw std::invalid_argument("Capacity must be greater than 0");
+    if (this->codec_ == nullptr) throw std::invalid_argument("Codec must not be null");
+
+    this->cache_.set_state_listener([this](const K&, Stored& stored, bool is_lir) {
+
+      if (is_lir) this->expand(stored);
+      else this->shrink(stored);
+    });
+    this->cache_.set_removal_listener([this](const K&, Stored& stored) {
+
+      this->usage_ -= stored.bytes.size();
+      this->raw_bytes_ -= stored.raw_size;
+    });
+    return;
+  }
+
+  LIRSCompressedCache(const LIRSCompressedCache&) = delete;
+  LIRSCompressedCache& operator=(const LIRSCompressedCache&) = delete;
+
+  void put(const K& key, std::string value) {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+
+    const Stored* previous = this->cache_.peek(key);
+    if (previous != nullptr) {
+
+      this->usage_ -= previous->bytes.size();
+      this->raw_bytes_ -= previous->raw_size;
+    }
+
+    this->usage_ += value.size();
+    this->raw_bytes_ += value.size();
+
+    std::size_t raw_size = value.size();
+    this->cache_.put(key, Stored { std::move(value), raw_size, false });
+
+    this->fit();
+    return;
+  }
+
+  std::optional<std::string> get(const K& key) {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+
+    std::optional<Stored> stored = this->cache_.get(key);
+    if (!stored) return std::nullopt;
+
+    // a promotion decompressed the block: the stored bytes may no longer fit
+    if (this->usage_ > this->capacity_) this->fit();
+    if (!stored->compressed) return std::move(stored->bytes);
+
+    // cold hit that stays in Q: hand out a raw copy
+    this->stats_.decompressed++;
+    return this->codec_->decompress(stored->bytes, stored->raw_size);
+  }
+
+  bool erase(const K& key) {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->cache_.erase(key);
+  }
+
+  // bytes held by values as stored (compressed or raw)
+  std::size_t total_charge() const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->usage_;
+  }
+
+  // bytes the same values would take uncompressed
+  std::size_t raw_bytes() const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->raw_bytes_;
+  }
+
+  Stats stats() const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->stats_;
+  }
+
+  std::size_t size() const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->cache_.size();
+  }
+
+  std::size_t capacity() const { return this->capacity_; }
+
+  // block capacity of the LIRS cache underneath, sized from the average stored size
+  std::size_t block_capacity() const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->cache_.capacity();
+  }
+
+private:
+  static constexpr std::size_t kMinCompress = 64;   // smaller values are not worth a codec call
+
+  struct Stored {
+    std::string bytes;
+    std::size_t raw_size;
+    bool compressed;
+  };
+
+  // state listener: the block entered Q
+  void shrink(Stored& stored) {
+
+    if (stored.compressed) return;
+
+    if (stored.bytes.size() < kMinCompress) {
+
+      this->stats_.incompressible++;
+      return;
+    }
+
+    std::string packed = this->codec_->compress(stored.bytes);
+    if (packed.size() + packed.size() / 8 >= stored.bytes.size()) {
+
+      this->stats_.incompressible++;
+      return;
+    }
+
+    packed.shrink_to_fit();
+    this->usage_ -= stored.bytes.size() - packed.size();
+    stored.bytes = std::move(packed);
+    stored.compressed = true;
+    this->stats_.compressed++;
+    return;
+  }
+
+  // state listener: the block was promoted to LIR
+  void expand(Stored& stored) {
+
+    if (!stored.compressed) return;
+
+    std::string raw = this->codec_->decompress(stored.bytes, stored.raw_size);
+    this->usage_ += raw.size() - stored.bytes.size();
+    stored.bytes = std::move(raw);
+    stored.compressed = false;
+    this->stats_.decompressed++;
+    return;
+  }
+
+  // size the block capacity to the average charge, evict until the charge fits
+  void fit() {
+
+    lirs_detail::fit_charge(this->cache_, this->capacity_, [this]() { return this->usage_; });
+    return;
+  }
+
+  mutable std::mutex mutex_;
+  std::size_t capacity_;
+  std::size_t usage_;
+  std::size_t raw_bytes_;
+  Stats stats_;
+  std::unique_ptr<LIRSCompressor> codec_;
+  LIRSCache<K, Stored> cache_;
+};
+
+#endif
@@ -0,0 +1,487 @@
+#ifndef LIRS_CORE_CACHE_HPP
+#define LIRS_CORE_CACHE_HPP
+
+/*
+ * Thread-per-core shared-nothing LIRS cache (Linux)
+ *
+ *    client thread ── Port ──┬─ lane 0: SPSC ring ──► core 0 (pinned) ──► LIRSCache 0
+ *                            ├─ lane 1: SPSC ring ──► core 1 (pinned) ──► LIRSCache 1
+ *                            └─ ...        ◄── done counter ──┘
+ *
+ * Every core thread owns one shard outright: it builds the cache after
+ * pinning itself (so its memory is local to the core's node) and is the
+ * only thread that ever reads or writes it.  No lock, and no atomic, is
+ * on the path of a cache operation; the only shared words are the ring
+ * indices and one completion counter per lane.
+ *
+ * A client thread talks to the cores through its own Port: one lane per
+ * core, each a single-producer single-consumer ring.  Requests are routed
+ * by key hash and published a batch at a time (one release store per lane
+ * per batch); a core drains whatever a lane holds in one pass and
+ * acknowledges the whole batch with one store of its done counter.
+ * get_many() writes the results straight into the caller's array.
+ *
+ * Per lane, requests run in order, so a port reads its own writes.  Ports
+ * are not thread-safe (one per client thread) and live as long as the
+ * cache; connect() fails after max_ports.  Idle cores spin, then yield,
+ * then sleep idle_sleep_us between polls.  If a core cannot build its
+ * shard, the constructor stops the others and rethrows that exception.
+ *
+ * Cache is any type with the LIRSCache interface (LIRSLRUCache for a
+ * baseline).
+ */
+
+#include "lirs_cache.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+
+// bounded single-producer single-consumer ring; the producer publishes a batch with one store
+template <typename T>
+class LIRSSpscRing {
+public:
+  explicit LIRSSpscRing(std::size_t capacity)
+    : mask_(round_up(capacity) - 1), slots_(new T[mask_ + 1]), head_(0), tail_(0), tail_local_(0), head_cached_(0), head_local_(0) {}
+
+  LIRSSpscRing(const LIRSSpscRing&) = delete;
+  LIRSSpscRing& operator=(const LIRSSpscRing&) = delete;
+
+  // producer: stage an item, false when the ring is full
+  bool push(T&& item) {
+
+    if (this->tail_local_ - this->head_cached_ > this->mask_) {
+
+      this->head_cached_ = this->head_.load(std::memory_order_acquire);
+      if (this->tail_local_ - this->head_cached_ > this->mask_) return false;
+    }
+    this->slots_[this->tail_local_ & this->mask_] = std::move(item);
+    this->tail_local_++;
+    return true;
+  }
+
+  // producer: make the staged items visible
+  void publish() {
+
+    this->tail_.store(this->tail_local_, std::memory_order_release);
+    return;
+  }
+
+  // producer: staged items not yet published
+  bool staged() const { return this->tail_local_ != this->tail_.load(std::memory_order_relaxed); }
+
+  // consumer: f(item) for everything published, then free the slots; returns the count
+  template <typename F>
+  std::size_t drain(F f) {
+
+    std::uint64_t tail = this->tail_.load(std::memory_order_acquire);
+    std::uint64_t head = this->head_local_;
+    if (head == tail) return 0;
+
+    for (std::uint64_t at = head; at != tail; at++) f(this->slots_[at & this->mask_]);
+
+    this->head_local_ = tail;
+    this->head_.store(tail, std::memory_order_release);
+    return static_cast<std::size_t>(tail - head);
+  }
+
+  std::size_t capacity() const { return this->mask_ + 1; }
+
+private:
+  static std::size_t round_up(std::size_t capacity) {
+
+    std::size_t size = 2;
+    while (size < capacity) size <<= 1;
+    return size;
+  }
+
+  const std::uint64_t mask_;
+  std::unique_ptr<T[]> slots_;
+
+  // consumer-written and producer-written indices on separate cache lines
+  alignas(64) std::atomic<std::uint64_t> head_;
+  alignas(64) std::atomic<std::uint64_t> tail_;
+  alignas(64) std::uint64_t tail_local_;    // producer only
+  std::uint64_t head_cached_;               // producer's last view of head_
+  alignas(64) std::uint64_t head_local_;    // consumer only
+};
+
+template <typename K, typename V, typename Cache = LIRSCache<K, V>, typename Hash = std::hash<K>>
+class LIRSCoreCache {
+public:
+  struct Options {
+    std::size_t capacity = 0;        // total blocks, 1/cores per core
+    std::size_t cores = 0;           // core threads, 0 = every CPU this process may run on
+    double hir_ratio = 0.01;
+    std::vector<int> cpus;           // CPU of each core thread, empty = the allowed CPUs in order
+    std::size_t ring_size = 1024;    // requests per lane
+    std::size_t max_ports = 256;
+    int idle_sleep_us = 50;          // sleep of an idle core after spinning and yielding
+  };
+
+  struct CoreStats {
+    std::uint64_t requests;
+    std::uint64_t batches;           // non-empty lane drains
+    std::uint64_t hits;
+    std::uint64_t misses;
+    std::size_t size;
+    int cpu;                         // -1 if pinning failed
+  };
+
+private:
+  static constexpr unsigned kSpinPolls = 256;
+  static constexpr unsigned kYieldPolls = 4096;
+
+  enum class Op : std::uint8_t { Get, Put, Erase };
+
+  struct Request {
+    Op op = Op::Get;
+    K key {};
+    V value {};
+    std::optional<V>* result = nullptr;   // Get: written by the core before done is bumped
+  };
+
+public:
+  class Port;
+
+  explicit LIRSCoreCache(Options options) : options_(std::move(options)), port_count_(0), stopping_(false), ready_(0) {
+
+    if (this->options_.capacity == 0) throw std::invalid_argument("Capacity must be greater than 0");
+    if (this->options_.ring_size == 0 || this->options_.max_ports == 0) throw std::invalid_argument("Ring size and port count must be greater than 0");
+
+    std::vector<int> allowed = allowed_cpus();
+    std::size_t count = this->options_.cores != 0 ? this->options_.cores : std::max<std::size_t>(1, allowed.size());
+    if (!this->options_.cpus.empty() && this->options_.cpus.size() < count) throw std::invalid_argument("Fewer CPUs than core threads");
+    count = std::min(count, this->options_.capacity);
+
+    this->ports_.reset(new std::atomic<Port*>[this->options_.max_ports]);
+    for (std::size_t i = 0; i < this->options_.max_ports; i++) this->ports_[i].store(nullptr, std::memory_order_relaxed);
+
+    for (std::size_t i = 0; i < count; i++) {
+
+      int cpu = !this->options_.cpus.empty() ? this->options_.cpus[i] : allowed.empty() ? -1 : allowed[i % allowed.size()];
+      this->cores_.push_back(std::make_unique<Core>(cpu));
+    }
+
+    for (std::size_t i = 0; i < count; i++) {
+
+      try {
+
+        this->cores_[i]->thread = std::thread([this, i] { this->run(i); });
+      } catch (...) {
+
+        this->stop();
+        throw;
+      }
+    }
+
+    // each core builds its shard on its own CPU first
+    while (this->ready_.load(std::memory_order_acquire) < count) std::this_thread::yield();
+
+    for (auto& core : this->cores_) {
+
+      if (!core->error) continue;
+      std::exception_ptr error = core->error;
+      this->stop();
+      std::rethrow_exception(error);
+    }
+    return;
+  }
+
+  LIRSCoreCache(const LIRSCoreCache&) = delete;
+  LIRSCoreCache& operator=(const LIRSCoreCache&) = delete;
+
+  ~LIRSCoreCache() {
+
+    this->stop();
+    return;
+  }
+
+  // a new client endpoint; keep it on one thread
+  Port& connect() {
+
+    std::lock_guard<std::mutex> lock(this->connect_mutex_);
+
+    std::size_t index = this->port_count_.load(std::memory_order_relaxed);
+    if (index == this->options_.max_ports) throw std::runtime_error("Core cache: too many ports");
+
+    this->owned_ports_.push_back(std::unique_ptr<Port>(new Port(*this)));
+    this->ports_[index].store(this->owned_ports_.back().get(), std::memory_order_release);
+    this->port_count_.store(index + 1, std::memory_order_release);
+    return *this->owned_ports_.back();
+  }
+
+  // finish queued requests and join the core threads; ports must be idle
+  void stop() {
+
+    this->stopping_.store(true, std::memory_order_release);
+    for (auto& core : this->cores_) {
+
+      if (core->thread.joinable()) core->thread.join();
+    }
+    return;
+  }
+
+  std::size_t core_of(const K& key) const {
+
+    // Fibonacci hashing, as in LIRSShardedCache
+    std::uint64_t hash = static_cast<std::uint64_t>(Hash {}(key)) * 0x9E3779B97F4A7C15ULL;
+    return static_cast<std::size_t>((hash >> 32) % this->cores_.size());
+  }
+
+  std::size_t core_count() const { return this->cores_.size(); }
+
+  // counters published by each core after every pass; approximate while running
+  std::vector<CoreStats> stats() const {
+
+    std::vector<CoreStats> stats;
+    for (const auto& core : this->cores_) {
+
+      CoreStats entry {};
+      entry.requests = core->requests.load(std::memory_order_relaxed);
+      entry.batches = core->batches.load(std::memory_order_relaxed);
+      entry.hits = core->hits.load(std::memory_order_relaxed);
+      entry.misses = core->misses.load(std::memory_order_relaxed);
+      entry.size = core->size.load(std::memory_order_relaxed);
+      entry.cpu = core->pinned.load(std::memory_order_relaxed) ? core->cpu : -1;
+      stats.push_back(entry);
+    }
+    return stats;
+  }
+
+  class Port {
+  public:
+    Port(const Port&) = delete;
+    Port& operator=(const Port&) = delete;
+
+    std::optional<V> get(const K& key) {
+
+      std::optional<V> value;
+      this->get_many(&key, 1, &value);
+      return value;
+    }
+
+    // values[i] = value of keys[i] (updates recency); one batch per core, waits for all
+    void get_many(const K* keys, std::size_t count, std::optional<V>* values) {
+
+      for (std::size_t i = 0; i < count; i++) {
+
+        values[i].reset();
+        this->submit(this->owner_.core_of(keys[i]), Request { Op::Get, keys[i], V(), &values[i] });
+      }
+      this->wait();
+      return;
+    }
+
+    // queued until the next get, flush() or a full lane
+    void put(const K& key, const V& value) {
+
+      this->submit(this->owner_.core_of(key), Request { Op::Put, key, value, nullptr });
+      return;
+    }
+
+    void erase(const K& key) {
+
+      this->submit(this->owner_.core_of(key), Request { Op::Erase, key, V(), nullptr });
+      return;
+    }
+
+    // publish queued requests without waiting for them
+    void flush() {
+
+      for (auto& lane : this->lanes_) {
+
+        if (lane->ring.staged()) lane->ring.publish();
+      }
+      return;
+    }
+
+    // publish, then wait until the cores have run everything this port sent
+    void wait() {
+
+      this->flush();
+      for (auto& lane : this->lanes_) {
+
+        for (unsigned spins = 0; lane->done.load(std::memory_order_acquire) != lane->issued; spins++) {
+
+          if (spins >= kSpinPolls) std::this_thread::yield();
+        }
+      }
+      return;
+    }
+
+  private:
+    friend class LIRSCoreCache;
+
+    struct Lane {
+      explicit Lane(std::size_t ring_size) : ring(ring_size), done(0), issued(0), completed(0) {}
+
+      LIRSSpscRing<Request> ring;
+      alignas(64) std::atomic<std::uint64_t> done;   // written by the core
+      alignas(64) std::uint64_t issued;              // port only
+      alignas(64) std::uint64_t completed;           // core only
+    };
+
+    explicit Port(LIRSCoreCache& owner) : owner_(owner) {
+
+      for (std::size_t i = 0; i < owner.cores_.size(); i++) this->lanes_.push_back(std::make_unique<Lane>(owner.options_.ring_size));
+      return;
+    }
+
+    void submit(std::size_t core, Request&& request) {
+
+      Lane& lane = *this->lanes_[core];
+      while (!lane.ring.push(std::move(request))) {
+
+        // full: hand the core what is there and let it catch up
+        lane.ring.publish();
+        std::this_thread::yield();
+      }
+      lane.issued++;
+      return;
+    }
+
+    LIRSCoreCache& owner_;
+    std::vector<std::unique_ptr<Lane>> lanes_;
+  };
+
+private:
+  struct Core {
+    explicit Core(int cpu) : cpu(cpu), pinned(false), requests(0), batches(0), hits(0), misses(0), size(0) {}
+
+    int cpu;
+    std::thread thread;
+    std::exception_ptr error;        // the shard could not be built; set before ready_ is bumped
+    std::atomic<bool> pinned;
+    // written by the core thread only
+    alignas(64) std::atomic<std::uint64_t> requests;
+    std::atomic<std::uint64_t> batches;
+    std::atomic<std::uint64_t> hits;
+    std::atomic<std::uint64_t> misses;
+    std::atomic<std::size_t> size;
+  };
+
+  static std::vector<int> allowed_cpus() {
+
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::sched_getaffinity(0, sizeof(set), &set) != 0) return cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+
+      if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+    }
+    return cpus;
+  }
+
+  static std::size_t share(std::size_t index, std::size_t count, std::size_t capacity) {
+
+    return capacity / count + (index < capacity % count ? 1 : 0);
+  }
+
+  void run(std::size_t index) {
+
+    Core& core = *this->cores_[index];
+    if (core.cpu >= 0) {
+
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(core.cpu, &set);
+      core.pinned.store(::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0, std::memory_order_relaxed);
+    }
+
+    // the shard lives on this thread's stack: nothing else can reach it
+    std::optional<Cache> shard;
+    try {
+
+      shard.emplace(share(index, this->cores_.size(), this->options_.capacity), this->options_.hir_ratio);
+    } catch (...) {
+
+      core.error = std::current_exception();
+    }
+    this->ready_.fetch_add(1, std::memory_order_release);
+    if (!shard) return;
+
+    Cache& cache = *shard;
+
+    std::uint64_t requests = 0, batches = 0, hits = 0, misses = 0;
+    unsigned idle = 0;
+    for (;;) {
+
+      bool stopping = this->stopping_.load(std::memory_order_acquire);
+      std::size_t ports = this->port_count_.load(std::memory_order_acquire);
+      std::size_t drained = 0;
+
+      for (std::size_t p = 0; p < ports; p++) {
+
+        typename Port::Lane& lane = *this->ports_[p].load(std::memory_order_acquire)->lanes_[index];
+        std::size_t count = lane.ring.drain([&](Request& request) {
+
+          if (request.op == Op::Get) {
+
+            *request.result = cache.get(request.key);
+            if (request.result->has_value()) hits++;
+            else misses++;
+          } else if (request.op == Op::Put) {
+
+            cache.put(request.key, std::move(request.value));
+          } else {
+
+            cache.erase(request.key);
+          }
+        });
+        if (count == 0) continue;
+
+        // one acknowledgement for the whole batch
+        lane.completed += count;
+        lane.done.store(lane.completed, std::memory_order_release);
+        drained += count;
+        batches++;
+      }
+
+      if (drained != 0) {
+
+        requests += drained;
+        core.requests.store(requests, std::memory_order_relaxed);
+        core.batches.store(batches, std::memory_order_relaxed);
+        core.hits.store(hits, std::memory_order_relaxed);
+        core.misses.store(misses, std::memory_order_relaxed);
+        core.size.store(cache.size(), std::memory_order_relaxed);
+        idle = 0;
+        continue;
+      }
+
+      // an empty pass after stop() was requested: everything sent before is done
+      if (stopping) break;
+
+      idle++;
+      if (idle < kSpinPolls) continue;
+      if (idle < kYieldPolls) std::this_thread::yield();
+      else std::this_thread::sleep_for(std::chrono::microseconds(this->options_.idle_sleep_us));
+    }
+    return;
+  }
+
+  Options options_;
+  std::vector<std::unique_ptr<Core>> cores_;
+  std::unique_ptr<std::atomic<Port*>[]> ports_;
+  std::atomic<std::size_t> port_count_;
+  std::mutex connect_mutex_;                     // connect() only; never taken by a core
+  std::vector<std::unique_ptr<Port>> owned_ports_;
+  std::atomic<bool> stopping_;
+  std::atomic<std::size_t> ready_;
+};
+
+#endif
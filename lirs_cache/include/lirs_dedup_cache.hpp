@@ -0,0 +1,179 @@
+#ifndef LIRS_DEDUP_CACHE_HPP
+#define LIRS_DEDUP_CACHE_HPP
+
+/*
+ * Content-addressed LIRS cache: identical values are stored once
+ *
+ *    key A ──┐
+ *    key B ──┼──► "{}"            refs 3    ◄── values_ (hash of content)
+ *    key C ──┘
+ *    key D ─────► "{\"eu\":1}"    refs 1
+ *
+ * put() hashes the value and links the key to the existing copy when the
+ * same bytes are already cached; the copy is freed with its last key.
+ *
+ * Capacity is a total charge in bytes: every distinct value once, plus a
+ * fixed entry_charge per key for its LIRS metadata (so thousands of keys
+ * sharing one empty value still count).  Evicting a key only frees value
+ * bytes when no other key shares them; the charge limit is enforced by
+ * evicting from Q until it holds.
+ *
+ * Thread-safe: all operations take one mutex.
+ */
+
+#include "lirs_cache.hpp"
+#include "lirs_charge.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+template <typename K>
+class LIRSDedupCache {
+public:
+  struct Stats {
+    std::size_t distinct;          // values stored
+    std::size_t logical_bytes;     // value bytes as seen by keys (shared values counted per key)
+    std::size_t stored_bytes;      // value bytes actually held
+    std::uint64_t shared_puts;     // puts that found their value already cached
+  };
+
+  explicit LIRSDedupCache(std::size_t capacity, double hir_ratio = 0.01, std::size_t entry_charge = 64)
+    : capacity_(capacity), entry_charge_(entry_charge), value_bytes_(0), logical_bytes_(0), shared_puts_(0)
+    , cache_(std::max<std::size_t>(lirs_detail::kMinChargeBlocks, capacity / std::max<std::size_t>(1, entry_charge)), hir_ratio) {
+
+    if (capacity == 0) throw std::invalid_argument("Capacity must be greater than 0");
+
+    this->cache_.set_removal_listener([this](const K&, Shared*& shared) { this->unref(shared); });
+    return;
+  }
+
+  ~LIRSDedupCache() {
+
+    for (auto& value : this->values_) delete value.second;
+  }
+
+  LIRSDedupCache(const LIRSDedupCache&) = delete;
+  LIRSDedupCache& operator=(const LIRSDedupCache&) = delete;
+
+  void put(const K& key, std::string_view value) {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+
+    // take the new reference first: replacing a value with itself keeps the copy
+    Shared* shared = this->intern(value);
+
+    Shared* const* previous = this->cache_.peek(key);
+    if (previous != nullptr) this->unref(*previous);
+
+    this->cache_.put(key, shared);
+
+    this->fit();
+    return;
+  }
+
+  std::optional<std::string> get(const K& key) {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+
+    std::optional<Shared*> shared = this->cache_.get(key);
+    if (!shared) return std::nullopt;
+    return (*shared)->bytes;
+  }
+
+  bool erase(const K& key) {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->cache_.erase(key);
+  }
+
+  // distinct value bytes plus entry_charge per resident key
+  std::size_t total_charge() const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->charge();
+  }
+
+  Stats stats() const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return Stats { this->values_.size(), this->logical_bytes_, this->value_bytes_, this->shared_puts_ };
+  }
+
+  std::size_t size() const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->cache_.size();
+  }
+
+  std::size_t capacity() const { return this->capacity_; }
+
+  // block capacity of the LIRS cache underneath, sized from the average charge per key
+  std::size_t block_capacity() const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->cache_.capacity();
+  }
+
+private:
+  struct Shared {
+    std::string bytes;
+    std::size_t refs;
+  };
+
+  // caller holds mutex_: a referenced copy of the value, shared if already cached
+  Shared* intern(std::string_view value) {
+
+    this->logical_bytes_ += value.size();
+
+    auto found = this->values_.find(value);
+    if (found != this->values_.end()) {
+
+      found->second->refs++;
+      this->shared_puts_++;
+      return found->second;
+    }
+
+    Shared* shared = new Shared { std::string(value), 1 };
+    this->values_.emplace(std::string_view(shared->bytes), shared);   // the view points into the copy
+    this->value_bytes_ += value.size();
+    return shared;
+  }
+
+  // caller holds mutex_: a key let go of its value
+  void unref(Shared* shared) {
+
+    this->logical_bytes_ -= shared->bytes.size();
+    if (--shared->refs > 0) return;
+
+    this->values_.erase(std::string_view(shared->bytes));
+    this->value_bytes_ -= shared->bytes.size();
+    delete shared;
+    return;
+  }
+
+  std::size_t charge() const { return this->value_bytes_ + this->cache_.size() * this->entry_charge_; }
+
+  // size the block capacity to the average charge per key, evict until the charge fits
+  void fit() {
+
+    lirs_detail::fit_charge(this->cache_, this->capacity_, [this]() { return this->charge(); });
+    return;
+  }
+
+  mutable std::mutex mutex_;
+  std::size_t capacity_;
+  std::size_t entry_charge_;
+  std::size_t value_bytes_;
+  std::size_t logical_bytes_;
+  std::uint64_t shared_puts_;
+  std::unordered_map<std::string_view, Shared*> values_;   // keyed by content
+  LIRSCache<K, Shared*> cache_;
+};
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef LIRS_HANDLE_CACHE_HPP
+#define LIRS_HANDLE_CACHE_HPP
+
+/*
+ * Handle-based, reference-counted LIRS cache (LevelDB/RocksDB Cache style)
+ *
+ *    insert(key, value, charge) ──► Handle*  (refs: cache + caller)
+ *    lookup(key)                ──► Handle*  or nullptr
+ *    release(handle)                drops the caller's reference
+ *
+ *    entry refs ──► 0 ──► value destroyed
+ *
+ * The cache holds one reference to every resident entry.  Eviction (or
+ * erase/replacement) only drops that reference, so a value stays alive
+ * for as long as some caller still holds a handle to it.
+ *
+ * Capacity is a total charge (e.g. bytes).  LIRS itself counts blocks, so
+ * the block capacity of the underlying cache follows the average charge of
+ * resident entries; the charge limit is enforced by evicting from Q
+ * (lirs_charge.hpp).
+ *
+ * Thread-safe: all operations take one mutex.  Every handle must be
+ * released before the cache is destroyed.
+ */
+
+#include "lirs_cache.hpp"
+#include "lirs_charge.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+template <typename K, typename V>
+class LIRSHandleCache {
+public:
+  class Handle {
+  public:
+    const K& key() const { return this->key_; }
+    V& value() { return this->value_; }
+    const V& value() const { return this->value_; }
+    std::size_t charge() const { return this->charge_; }
+
+  private:
+    friend class LIRSHandleCache;
+
+    Handle(const K& key, V value, std::size_t charge)
+      : key_(key), value_(std::move(value)), charge_(charge), refs_(1), in_cache_(true) {}
+
+    K key_;
+    V value_;
+    std::size_t charge_;
+    std::size_t refs_;
+    bool in_cache_;
+  };
+
+  explicit LIRSHandleCache(std::size_t capacity, double hir_ratio = 0.01)
+    : capacity_(capacity), usage_(0), cache_(std::max<std::size_t>(lirs_detail::kMinChargeBlocks, capacity), hir_ratio) {
+
+    if (capacity == 0) throw std::invalid_argument("Capacity must be greater than 0");
+
+    this->cache_.set_removal_listener([this](const K&, Handle*& handle) { this->detach(handle); });
+    return;
+  }
+
+  ~LIRSHandleCache() {
+
+    // drop the cache's references; outstanding handles would dangle
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    while (this->cache_.evict_one() || this->cache_.demote_one()) {}
+  }
+
+  LIRSHandleCache(const LIRSHandleCache&) = delete;
+  LIRSHandleCache& operator=(const LIRSHandleCache&) = delete;
+
+  // insert (or replace) and return a referenced handle; release() it when done
+  Handle* insert(const K& key, V value, std::size_t charge) {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+
+    Handle* handle = new Handle(key, std::move(value), charge);
+    handle->refs_++;   // caller's reference
+
+    // a replaced entry lives on for its current holders
+    Handle* const* previous = this->cache_.peek(key);
+    if (previous != nullptr) this->detach(*previous);
+
+    this->cache_.put(key, handle);
+    this->usage_ += charge;
+
+    this->fit();
+    return handle;
+  }
+
+  // referenced handle for a resident key, nullptr on a miss
+  Handle* lookup(const K& key) {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+
+    std::optional<Handle*> handle = this->cache_.get(key);
+    if (!handle) return nullptr;
+
+    (*handle)->refs_++;
+    return *handle;
+  }
+
+  void release(Handle* handle) {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->unref(handle);
+    return;
+  }
+
+  // remove a key from the cache; handles to it stay valid until released
+  void erase(const K& key) {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->cache_.erase(key);
+    return;
+  }
+
+  std::size_t total_charge() const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->usage_;
+  }
+
+  std::size_t size() const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->cache_.size();
+  }
+
+  std::size_t capacity() const { return this->capacity_; }
+
+  // block capacity of the LIRS cache underneath, sized from the average charge
+  std::size_t block_capacity() const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->cache_.capacity();
+  }
+
+private:
+  // caller holds mutex_: the cache lets go of an entry
+  void detach(Handle* handle) {
+
+    if (!handle->in_cache_) return;
+
+    handle->in_cache_ = false;
+    this->usage_ -= handle->charge_;
+    this->unref(handle);
+    return;
+  }
+
+  void unref(Handle* handle) {
+
+    if (--handle->refs_ == 0) delete handle;
+    return;
+  }
+
+  // size the block capacity to the average charge, evict until the charge fits
+  void fit() {
+
+    lirs_detail::fit_charge(this->cache_, this->capacity_, [this]() { return this->usage_; });
+    return;
+  }
+
+  mutable std::mutex mutex_;
+  std::size_t capacity_;
+  std::size_t usage_;
+  LIRSCache<K, Handle*> cache_;
+};
+
+#endif
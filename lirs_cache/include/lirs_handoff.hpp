@@ -0,0 +1,422 @@
+#ifndef LIRS_HANDOFF_HPP
+#define LIRS_HANDOFF_HPP
+
+/*
+ * Warm handoff of a LIRSCache to a new process over a Unix domain socket (POSIX)
+ *
+ *    old process                                   new process
+ *    LIRSHandoffSender(path)  ◄──── connect ────   LIRSHandoffReceiver(path)
+ *    accept(), stop serving                        serve; step() between requests
+ *    send(cache) ──── S top -> bottom, Q ────►     cache.append(batch)
+ *                ◄─────────── ack ────────────     done(): the old process may exit
+ *
+ *    stream : magic "LIRSHOFF" │ version u32 │ frames... │ end frame (0 bytes)
+ *    frame  : payload bytes u64 │ record count u64 │ records
+ *    record : key │ flags u8 (LIR, resident, in S) │ value (resident only)
+ *
+ * The old process listens on a well-known path for its whole lifetime.  A new
+ * process connects at startup (or starts cold if nobody listens) and takes
+ * traffic right away; the old one stops serving and streams its frozen
+ * cache.  Frames end on a LIR block of S, so every frame the receiver
+ * applies keeps the bottom of S a LIR block.
+ *
+ * Received blocks go below everything the new process already holds: keys it
+ * has touched since startup are newer and win.  Keys it writes or erases
+ * during the transfer must be passed to written() / erased(): once such a key
+ * has been evicted and left S, nothing else stops its older copy coming back.
+ */
+
+#include "lirs_cache.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace lirs_detail {
+
+  constexpr char kHandoffMagic[8] = { 'L', 'I', 'R', 'S', 'H', 'O', 'F', 'F' };
+  constexpr std::uint32_t kHandoffVersion = 1;
+  constexpr std::uint8_t kHandoffLIR = 1;
+  constexpr std::uint8_t kHandoffResident = 2;
+  constexpr std::uint8_t kHandoffInS = 4;
+  constexpr char kHandoffAck = 'K';
+
+  inline sockaddr_un handoff_address(const std::string& path) {
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) throw std::invalid_argument("Handoff socket path too long: " + path);
+    std::memcpy(address.sun_path, path.data(), path.size());
+    return address;
+  }
+
+} // namespace lirs_detail
+
+template <typename K, typename V, typename KeyCodec = LIRSCodec<K>, typename ValueCodec = LIRSCodec<V>>
+class LIRSHandoffSender {
+public:
+  struct Options {
+    std::size_t frame_records = 4096;   // records per frame, extended to the next LIR block
+  };
+
+  explicit LIRSHandoffSender(const std::string& path) : LIRSHandoffSender(path, Options {}) {}
+
+  // listen on path, replacing a socket left by a previous owner
+  LIRSHandoffSender(const std::string& path, Options options)
+    : path_(path), options_(options), listen_fd_(-1), peer_fd_(-1) {
+
+    sockaddr_un address = lirs_detail::handoff_address(path);
+
+    this->listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (this->listen_fd_ < 0) throw std::system_error(errno, std::generic_category(), "socket");
+
+    ::unlink(path.c_str());
+    if (::bind(this->listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(this->listen_fd_, 1) != 0) {
+
+      int error = errno;
+      ::close(this->listen_fd_);
+      throw std::system_error(error, std::generic_category(), "listen " + path);
+    }
+    return;
+  }
+
+  ~LIRSHandoffSender() {
+
+    if (this->peer_fd_ >= 0) ::close(this->peer_fd_);
+    if (this->listen_fd_ >= 0) {
+
+      ::close(this->listen_fd_);
+      ::unlink(this->path_.c_str());
+    }
+  }
+
+  LIRSHandoffSender(const LIRSHandoffSender&) = delete;
+  LIRSHandoffSender& operator=(const LIRSHandoffSender&) = delete;
+
+  // readable when a new process has connected, e.g. for the server's event loop
+  int fd() const { return this->listen_fd_; }
+
+  // wait for a new process (timeout_ms < 0: forever); false on timeout
+  bool accept(int timeout_ms = -1) {
+
+    pollfd ready { this->listen_fd_, POLLIN, 0 };
+    int result = ::poll(&ready, 1, timeout_ms);
+    if (result < 0 && errno != EINTR) throw std::system_error(errno, std::generic_category(), "poll");
+    if (result <= 0) return false;
+
+    int fd = ::accept4(this->listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), "accept " + this->path_);
+
+    if (this->peer_fd_ >= 0) ::close(this->peer_fd_);
+    this->peer_fd_ = fd;
+    return true;
+  }
+
+  // stream the whole cache, then wait for the receiver to confirm; the cache must
+  // not change meanwhile (this process has stopped serving).  Returns the blocks sent
+  std::size_t send(const LIRSCache<K, V>& cache) {
+
+    if (this->peer_fd_ < 0) throw std::logic_error("No handoff receiver connected");
+
+    std::ostringstream header;
+    header.write(lirs_detail::kHandoffMagic, sizeof(lirs_detail::kHandoffMagic));
+    lirs_detail::write_le(header, lirs_detail::kHandoffVersion, 4);
+    this->write_all(header.str());
+
+    std::ostringstream frame;
+    std::size_t records = 0;
+    std::size_t sent = 0;
+
+    cache.for_each_block([&](const K& key, const V* value, bool is_lir, bool in_s) {
+
+      std::uint8_t flags = (is_lir ? lirs_detail::kHandoffLIR : 0) | (value != nullptr ? lirs_detail::kHandoffResident : 0) |
+                           (in_s ? lirs_detail::kHandoffInS : 0);
+
+      KeyCodec::write(frame, key);
+      lirs_detail::write_le(frame, flags, 1);
+      if (value != nullptr) ValueCodec::write(frame, *value);
+      records++;
+      sent++;
+
+      // the receiver links HIR blocks of S only once the LIR block below them arrives
+      if (records >= this->options_.frame_records && (is_lir || !in_s)) this->flush(frame, records);
+    });
+
+    this->flush(frame, records);
+
+    // end frame, then the ack: from here on the new process owns the contents
+    std::ostringstream end;
+    lirs_detail::write_le(end, 0, 8);
+    lirs_detail::write_le(end, 0, 8);
+    this->write_all(end.str());
+
+    char ack = 0;
+    ssize_t received;
+    do received = ::recv(this->peer_fd_, &ack, 1, 0);
+    while (received < 0 && errno == EINTR);
+    if (received != 1 || ack != lirs_detail::kHandoffAck) throw std::runtime_error("Handoff not confirmed by receiver");
+
+    ::close(this->peer_fd_);
+    this->peer_fd_ = -1;
+    return sent;
+  }
+
+private:
+  void flush(std::ostringstream& frame, std::size_t& records) {
+
+    if (records == 0) return;
+
+    std::string payload = frame.str();
+    std::ostringstream prefix;
+    lirs_detail::write_le(prefix, payload.size(), 8);
+    lirs_detail::write_le(prefix, records, 8);
+
+    this->write_all(prefix.str());
+    this->write_all(payload);
+
+    frame.str(std::string());
+    records = 0;
+    return;
+  }
+
+  void write_all(const std::string& data) {
+
+    std::size_t offset = 0;
+    while (offset < data.size()) {
+
+      ssize_t written = ::send(this->peer_fd_, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+      if (written < 0) {
+
+        if (errno == EINTR) continue;
+        throw std::system_error(errno, std::generic_category(), "send handoff");
+      }
+      offset += static_cast<std::size_t>(written);
+    }
+    return;
+  }
+
+  std::string path_;
+  Options options_;
+  int listen_fd_;
+  int peer_fd_;
+};
+
+template <typename K, typename V, typename KeyCodec = LIRSCodec<K>, typename ValueCodec = LIRSCodec<V>>
+class LIRSHandoffReceiver {
+public:
+  using Block = typename LIRSCache<K, V>::Block;
+
+  // connect to the process listening on path; inactive (start cold) if there is none
+  explicit LIRSHandoffReceiver(const std::string& path)
+    : fd_(-1), active_(false), done_(false), header_(false), closed_(false), offset_(0), received_(0) {
+
+    sockaddr_un address = lirs_detail::handoff_address(path);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), "socket");
+
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+
+      int error = errno;
+      ::close(fd);
+      if (error == ENOENT || error == ECONNREFUSED) return;
+      throw std::system_error(error, std::generic_category(), "connect " + path);
+    }
+
+    // step() must never block the serving thread
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    this->fd_ = fd;
+    this->active_ = true;
+    return;
+  }
+
+  ~LIRSHandoffReceiver() {
+
+    if (this->fd_ >= 0) ::close(this->fd_);
+  }
+
+  LIRSHandoffReceiver(const LIRSHandoffReceiver&) = delete;
+  LIRSHandoffReceiver& operator=(const LIRSHandoffReceiver&) = delete;
+
+  // transfer in progress
+  bool active() const { return this->active_; }
+
+  // the whole cache arrived and was confirmed to the sender
+  bool done() const { return this->done_; }
+
+  // readable when step() has data to work on, -1 when inactive
+  int fd() const { return this->fd_; }
+
+  // blocks received so far
+  std::size_t received() const { return this->received_; }
+
+  // a key written here during the transfer; its older copy is not restored
+  void written(const K& key) {
+
+    if (this->active_) this->written_.insert(key);
+    return;
+  }
+
+  // a key erased here during the transfer; its older copy is not restored
+  void erased(const K& key) {
+
+    this->written(key);
+    return;
+  }
+
+  // read what has arrived without blocking and apply at most one frame to cache
+  // (call under the cache's lock, between requests); returns blocks made resident
+  std::size_t step(LIRSCache<K, V>& cache) {
+
+    if (!this->active_) return 0;
+
+    this->fill();
+
+    if (!this->header_) {
+
+      if (this->available() < sizeof(lirs_detail::kHandoffMagic) + 4) return this->starved();
+
+      std::istringstream header(this->buffer_.substr(this->offset_, sizeof(lirs_detail::kHandoffMagic) + 4));
+      char magic[sizeof(lirs_detail::kHandoffMagic)];
+      header.read(magic, sizeof(magic));
+      if (std::memcmp(magic, lirs_detail::kHandoffMagic, sizeof(magic)) != 0) this->fail("Not a LIRS handoff stream");
+      if (lirs_detail::read_le(header, 4) != lirs_detail::kHandoffVersion) this->fail("Unsupported handoff version");
+
+      this->offset_ += sizeof(magic) + 4;
+      this->header_ = true;
+    }
+
+    if (this->available() < 16) return this->starved();
+
+    std::istringstream prefix(this->buffer_.substr(this->offset_, 16));
+    std::uint64_t bytes = lirs_detail::read_le(prefix, 8);
+    std::uint64_t records = lirs_detail::read_le(prefix, 8);
+
+    // end of stream: confirm, so the old process can exit
+    if (bytes == 0) {
+
+      char ack = lirs_detail::kHandoffAck;
+      ssize_t written = ::send(this->fd_, &ack, 1, MSG_NOSIGNAL);
+      (void)written;
+      this->done_ = true;
+      this->finish();
+      return 0;
+    }
+
+    if (this->available() < 16 + bytes) return this->starved();
+
+    std::istringstream frame(this->buffer_.substr(this->offset_ + 16, static_cast<std::size_t>(bytes)));
+    this->offset_ += 16 + static_cast<std::size_t>(bytes);
+    this->compact();
+
+    std::vector<Block> blocks;
+    blocks.reserve(static_cast<std::size_t>(records));
+    for (std::uint64_t i = 0; i < records; i++) {
+
+      Block block { K {}, std::nullopt, false, false };
+      KeyCodec::read(frame, block.key);
+      std::uint8_t flags = static_cast<std::uint8_t>(lirs_detail::read_le(frame, 1));
+
+      if (flags & lirs_detail::kHandoffResident) {
+
+        V value;
+        ValueCodec::read(frame, value);
+        block.value = std::move(value);
+      } else if (!(flags & lirs_detail::kHandoffInS)) {
+
+        this->fail("Corrupt handoff: ghost outside S");
+      }
+
+      block.is_lir = (flags & lirs_detail::kHandoffLIR) != 0;
+      block.in_s = (flags & lirs_detail::kHandoffInS) != 0;
+      if (this->written_.count(block.key) == 0) blocks.push_back(std::move(block));
+    }
+
+    this->received_ += static_cast<std::size_t>(records);
+    return cache.append(std::move(blocks));
+  }
+
+private:
+  static constexpr std::size_t kReadChunk = 64 * 1024;
+
+  std::size_t available() const { return this->buffer_.size() - this->offset_; }
+
+  void fill() {
+
+    char chunk[kReadChunk];
+    while (!this->closed_) {
+
+      ssize_t received = ::recv(this->fd_, chunk, sizeof(chunk), 0);
+      if (received > 0) {
+
+        this->buffer_.append(chunk, static_cast<std::size_t>(received));
+        continue;
+      }
+      if (received < 0 && errno == EINTR) continue;
+      if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+
+      this->closed_ = true;
+      return;
+    }
+  }
+
+  // no complete frame buffered: if the old process went away mid-transfer, keep what was applied
+  std::size_t starved() {
+
+    if (this->closed_) this->finish();
+    return 0;
+  }
+
+  // drop consumed bytes once they dominate the buffer
+  void compact() {
+
+    if (this->offset_ > this->buffer_.size() / 2) {
+
+      this->buffer_.erase(0, this->offset_);
+      this->offset_ = 0;
+    }
+    return;
+  }
+
+  void finish() {
+
+    ::close(this->fd_);
+    this->fd_ = -1;
+    this->active_ = false;
+    this->buffer_.clear();
+    this->offset_ = 0;
+    this->written_.clear();
+    return;
+  }
+
+  [[noreturn]] void fail(const char* message) {
+
+    this->finish();
+    throw std::runtime_error(message);
+  }
+
+  int fd_;
+  bool active_;
+  bool done_;
+  bool header_;
+  bool closed_;   // the sender hung up; frames already buffered are still applied
+  std::string buffer_;
+  std::size_t offset_;
+  std::size_t received_;
+  std::unordered_set<K> written_;   // keys written or erased here since the transfer started
+};
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef LIRS_HASH_RING_HPP
+#define LIRS_HASH_RING_HPP
+
+/*
+ * Consistent hashing of keys onto cache nodes, with bounded load
+ *
+ *    key ──hash──► probe 0, 1, 2, ... ──► first node that is alive and below
+ *                                         load_factor x average load
+ *
+ *    Jump   : jump consistent hash of the (re-mixed) key over node_count
+ *    Maglev : lookup table of table_size slots filled from per-node
+ *             permutations; a probe reads one slot
+ *
+ * Both move only the keys of a node that is added, removed or skipped.
+ * Probe 0 is the key's home node; later probes are independent re-hashes,
+ * so the keys of a failed or overloaded node spread over all the others
+ * instead of piling onto one neighbour.
+ *
+ * Node names (e.g. "host:port") define the Maglev permutations, so every
+ * client with the same node list builds the same table.  Immutable after
+ * construction; thread-safe.
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class LIRSRingAlgorithm { Jump, Maglev };
+
+class LIRSHashRing {
+public:
+  struct Options {
+    LIRSRingAlgorithm algorithm = LIRSRingAlgorithm::Maglev;
+    std::size_t table_size = 65537;   // Maglev slots, a prime well above the node count
+    double load_factor = 1.25;        // max load / average load, 0 = unbounded
+  };
+
+  static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+  explicit LIRSHashRing(std::vector<std::string> nodes) : LIRSHashRing(std::move(nodes), Options {}) {}
+
+  LIRSHashRing(std::vector<std::string> nodes, Options options) : nodes_(std::move(nodes)), options_(options) {
+
+    if (this->nodes_.empty()) throw std::invalid_argument("Hash ring needs at least one node");
+    if (options.load_factor != 0.0 && options.load_factor < 1.0) throw std::invalid_argument("Load factor must be 0 or at least 1");
+
+    if (options.algorithm == LIRSRingAlgorithm::Maglev) {
+
+      if (options.table_size < this->nodes_.size() || !is_prime(options.table_size)) {
+
+        throw std::invalid_argument("Maglev table size must be a prime >= node count");
+      }
+      this->populate();
+    }
+    return;
+  }
+
+  // stable 64-bit key hash (FNV-1a, then a finalizer), identical in every process
+  static std::uint64_t hash(std::string_view key) {
+
+    std::uint64_t h = 0xCBF29CE484222325ULL;
+    for (unsigned char c : key) h = (h ^ c) * 0x100000001B3ULL;
+    return mix(h);
+  }
+
+  // node of the attempt-th probe for a key hash
+  std::size_t candidate(std::uint64_t hash, std::size_t attempt) const {
+
+    std::uint64_t h = attempt == 0 ? hash : mix(hash + attempt * 0x9E3779B97F4A7C15ULL);
+
+    if (this->options_.algorithm == LIRSRingAlgorithm::Jump) return jump(h, this->nodes_.size());
+    return this->table_[static_cast<std::size_t>(h % this->table_.size())];
+  }
+
+  // first probed node with alive(i) whose load(i) leaves room under the bound;
+  // the first live probe when all are loaded; npos when no node is alive
+  template <typename Alive, typename Load>
+  std::size_t locate(std::uint64_t hash, Alive alive, Load load) const {
+
+    std::size_t count = this->nodes_.size();
+    std::size_t live = 0;
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < count; i++) {
+
+      if (!alive(i)) continue;
+      live++;
+      total += load(i);
+    }
+    if (live == 0) return npos;
+
+    // each live node may carry ceil(load_factor x average), counting this request
+    double bound = std::ceil(this->options_.load_factor * static_cast<double>(total + 1) / static_cast<double>(live));
+    bool bounded = this->options_.load_factor != 0.0;
+
+    std::size_t fallback = npos;
+    std::size_t probes = kMinProbes + 2 * count;
+    for (std::size_t attempt = 0; attempt < probes; attempt++) {
+
+      std::size_t node = this->candidate(hash, attempt);
+      if (!alive(node)) continue;
+      if (!bounded || static_cast<double>(load(node) + 1) <= bound) return node;
+      if (fallback == npos) fallback = node;
+    }
+    if (fallback != npos) return fallback;
+
+    // unlucky probes: walk from the home node
+    std::size_t home = this->candidate(hash, 0);
+    for (std::size_t i = 0; i < count; i++) {
+
+      if (alive((home + i) % count)) return (home + i) % count;
+    }
+    return npos;
+  }
+
+  std::size_t node_count() const { return this->nodes_.size(); }
+  const std::string& node(std::size_t index) const { return this->nodes_.at(index); }
+  const std::vector<std::string>& nodes() const { return this->nodes_; }
+
+private:
+  static constexpr std::size_t kMinProbes = 8;
+
+  static std::uint64_t mix(std::uint64_t h) {
+
+    // splitmix64 finalizer
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h;
+  }
+
+  // Lamping & Veach, "A Fast, Minimal Memory, Consistent Hash Algorithm"
+  static std::size_t jump(std::uint64_t key, std::size_t buckets) {
+
+    std::int64_t b = -1;
+    std::int64_t j = 0;
+    while (j < static_cast<std::int64_t>(buckets)) {
+
+      b = j;
+      key = key * 2862933555777941757ULL + 1;
+      j = static_cast<std::int64_t>(static_cast<double>(b + 1) * (static_cast<double>(1LL << 31) / static_cast<double>((key >> 33) + 1)));
+    }
+    return static_cast<std::size_t>(b);
+  }
+
+  static bool is_prime(std::size_t n) {
+
+    if (n < 2) return false;
+    for (std::size_t d = 2; d * d <= n; d++) {
+
+      if (n % d == 0) return false;
+    }
+    return true;
+  }
+
+  // Maglev (Eisenbud et al.): nodes take turns claiming the next free slot of their permutation
+  void populate() {
+
+    std::size_t size = this->options_.table_size;
+    std::size_t count = this->nodes_.size();
+
+    std::vector<std::size_t> offset(count), skip(count), next(count, 0);
+    for (std::size_t i = 0; i < count; i++) {
+
+      std::uint64_t h = hash(this->nodes_[i]);
+      offset[i] = static_cast<std::size_t>(h % size);
+      skip[i] = static_cast<std::size_t>(mix(h ^ 0x5851F42D4C957F2DULL) % (size - 1)) + 1;
+    }
+
+    this->table_.assign(size, npos);
+    std::size_t filled = 0;
+    while (filled < size) {
+
+      for (std::size_t i = 0; i < count && filled < size; i++) {
+
+        std::size_t slot = (offset[i] + next[i] * skip[i]) % size;
+        while (this->table_[slot] != npos) {
+
+          next[i]++;
+          slot = (offset[i] + next[i] * skip[i]) % size;
+        }
+        this->table_[slot] = i;
+        next[i]++;
+        filled++;
+      }
+    }
+    return;
+  }
+
+  std::vector<std::string> nodes_;
+  Options options_;
+  std::vector<std::size_t> table_;   // Maglev slot -> node
+};
+
+#endif
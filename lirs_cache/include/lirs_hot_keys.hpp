@@ -0,0 +1,265 @@
+#ifndef LIRS_HOT_KEYS_HPP
+#define LIRS_HOT_KEYS_HPP
+
+/*
+ * Read replicas of hot keys, for LIRSShardedCache
+ *
+ *    get(key) ──► this thread's replica ── value ──────────────► hit, no shard lock
+ *                   │ not hot / not filled
+ *                   ▼
+ *                 key's shard (locked) ── hot: fill the replica
+ *
+ *    1 access in sample_every ──► counts ── every period samples ──► top keys
+ *                                   with >= share of the samples are replicated
+ *
+ * With hash sharding a single viral key sends all of its traffic through
+ * one shard lock.  Keys that take at least `share` of the sampled accesses
+ * (at most max_keys of them) get a read-only copy in each of `replicas`
+ * stripes; every thread reads from its own stripe, so the key's readers
+ * spread over `replicas` locks instead of one.
+ *
+ * Writes fan out: the owner calls invalidate() after changing a hot key,
+ * which empties the key in every stripe and bumps each stripe's generation.
+ * A reader refills its stripe from the shard, and the fill is dropped if
+ * the generation moved meanwhile, so a replica never outlives a write.
+ * Replica hits skip the shard, so only sampled accesses refresh the key's
+ * LIRS recency there.
+ *
+ * Lock order is sample, shard, stripe; a reader releases its stripe before
+ * it takes the shard lock.  Thread-safe.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace lirs_detail {
+
+  // small per-thread number, assigned on first use; picks a thread's replica
+  inline std::size_t thread_slot() {
+
+    static std::atomic<std::size_t> next { 0 };
+    thread_local std::size_t slot = next.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+  }
+
+} // namespace lirs_detail
+
+template <typename K, typename V, typename Hash = std::hash<K>>
+class LIRSHotKeys {
+public:
+  struct Options {
+    std::size_t replicas = 0;          // read stripes, e.g. one per core
+    std::size_t max_keys = 16;         // most keys replicated at once
+    std::size_t sample_every = 64;     // sample one access in this many
+    std::size_t period = 4096;         // samples per hot-set decision
+    double share = 0.01;               // share of the samples that makes a key hot
+  };
+
+  // what this thread's replica knows about a key
+  struct Probe {
+    std::optional<V> value;            // replicated value
+    bool hot = false;                  // replicated key, value not filled yet
+    std::uint64_t generation = 0;      // pass to fill()
+  };
+
+  struct Stats {
+    std::uint64_t replica_hits;
+    std::uint64_t promotions;
+    std::uint64_t demotions;
+    std::uint64_t invalidations;       // writes to hot keys
+    std::size_t hot_keys;
+  };
+
+  explicit LIRSHotKeys(Options options)
+    : options_(options), samples_(0), promotions_(0), demotions_(0), invalidations_(0) {
+
+    if (options.replicas == 0) throw std::invalid_argument("Hot keys need at least one replica");
+    if (options.sample_every == 0 || options.period == 0) throw std::invalid_argument("Sample rate and period must be greater than 0");
+
+    for (std::size_t i = 0; i < options.replicas; i++) this->stripes_.push_back(std::make_unique<Stripe>());
+    return;
+  }
+
+  LIRSHotKeys(const LIRSHotKeys&) = delete;
+  LIRSHotKeys& operator=(const LIRSHotKeys&) = delete;
+
+  Probe probe(const K& key) {
+
+    Probe probe;
+    Stripe& stripe = this->own();
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    if (stripe.entries.empty()) return probe;
+
+    auto found = stripe.entries.find(key);
+    if (found == stripe.entries.end()) return probe;
+
+    probe.hot = true;
+    probe.generation = stripe.generation;
+    probe.value = found->second;
+    if (probe.value) stripe.hits++;
+    return probe;
+  }
+
+  // value read from the shard after probe(); kept unless a write came in between
+  void fill(const K& key, const V& value, std::uint64_t generation) {
+
+    Stripe& stripe = this->own();
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    if (stripe.generation != generation) return;
+
+    auto found = stripe.entries.find(key);
+    if (found != stripe.entries.end()) found->second = value;
+    return;
+  }
+
+  // this access belongs to the sample; random, so periodic access patterns do not alias
+  bool sampled() const {
+
+    thread_local std::uint64_t state = 0x9E3779B97F4A7C15ULL * (lirs_detail::thread_slot() + 1);
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state % this->options_.sample_every == 0;
+  }
+
+  // count a sampled access; at the end of a period apply(promote, demote) gets the keys that
+  // became hot and those that cooled down, under the sample lock so periods apply in order
+  template <typename Apply>
+  void record(const K& key, Apply apply) {
+
+    std::lock_guard<std::mutex> lock(this->sample_mutex_);
+    this->counts_[key]++;
+    if (++this->samples_ < this->options_.period) return;
+
+    // keys over the threshold, hottest first
+    std::size_t threshold = std::max<std::size_t>(2, static_cast<std::size_t>(this->options_.share * static_cast<double>(this->samples_)));
+    std::vector<std::pair<std::size_t, K>> ranked;
+    for (const auto& entry : this->counts_) {
+
+      if (entry.second >= threshold) ranked.emplace_back(entry.second, entry.first);
+    }
+    std::sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    if (ranked.size() > this->options_.max_keys) ranked.resize(this->options_.max_keys);
+
+    std::unordered_set<K, Hash> next;
+    for (const auto& entry : ranked) next.insert(entry.second);
+
+    std::vector<K> promote;
+    std::vector<K> demote;
+    for (const K& hot : next) {
+
+      if (this->current_.count(hot) == 0) promote.push_back(hot);
+    }
+    for (const K& hot : this->current_) {
+
+      if (next.count(hot) == 0) demote.push_back(hot);
+    }
+
+    apply(promote, demote);
+
+    this->current_ = std::move(next);
+    this->counts_.clear();
+    this->samples_ = 0;
+    return;
+  }
+
+  // start replicating key (from apply, holding the key's shard lock)
+  void add(const K& key) {
+
+    for (auto& stripe : this->stripes_) {
+
+      std::lock_guard<std::mutex> lock(stripe->mutex);
+      stripe->entries.emplace(key, std::nullopt);
+      stripe->generation++;
+    }
+    this->promotions_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  // stop replicating key (from apply, holding the key's shard lock)
+  void drop(const K& key) {
+
+    for (auto& stripe : this->stripes_) {
+
+      std::lock_guard<std::mutex> lock(stripe->mutex);
+      stripe->entries.erase(key);
+      stripe->generation++;
+    }
+    this->demotions_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  // key was written (caller holds its shard lock): empty every replica, cancel pending fills
+  void invalidate(const K& key) {
+
+    for (auto& stripe : this->stripes_) {
+
+      std::lock_guard<std::mutex> lock(stripe->mutex);
+      auto found = stripe->entries.find(key);
+      if (found != stripe->entries.end()) found->second.reset();
+      stripe->generation++;
+    }
+    this->invalidations_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  std::vector<K> keys() const {
+
+    std::lock_guard<std::mutex> lock(this->sample_mutex_);
+    return std::vector<K>(this->current_.begin(), this->current_.end());
+  }
+
+  Stats stats() const {
+
+    Stats stats {};
+    for (const auto& stripe : this->stripes_) {
+
+      std::lock_guard<std::mutex> lock(stripe->mutex);
+      stats.replica_hits += stripe->hits;
+    }
+    stats.promotions = this->promotions_.load(std::memory_order_relaxed);
+    stats.demotions = this->demotions_.load(std::memory_order_relaxed);
+    stats.invalidations = this->invalidations_.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(this->sample_mutex_);
+    stats.hot_keys = this->current_.size();
+    return stats;
+  }
+
+  const Options& options() const { return this->options_; }
+
+private:
+  struct alignas(64) Stripe {
+    std::mutex mutex;
+    std::unordered_map<K, std::optional<V>, Hash> entries;
+    std::uint64_t generation = 0;
+    std::uint64_t hits = 0;
+  };
+
+  Stripe& own() { return *this->stripes_[lirs_detail::thread_slot() % this->stripes_.size()]; }
+
+  Options options_;
+  std::vector<std::unique_ptr<Stripe>> stripes_;
+
+  mutable std::mutex sample_mutex_;
+  std::unordered_map<K, std::size_t, Hash> counts_;
+  std::size_t samples_;
+  std::unordered_set<K, Hash> current_;
+
+  std::atomic<std::uint64_t> promotions_;
+  std::atomic<std::uint64_t> demotions_;
+  std::atomic<std::uint64_t> invalidations_;
+};
+
+#endif
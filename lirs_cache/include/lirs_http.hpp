@@ -0,0 +1,531 @@
+#ifndef LIRS_HTTP_HPP
+#define LIRS_HTTP_HPP
+
+/*
+ * HTTP/1.1 message heads, Cache-Control and a pooled origin client (POSIX)
+ *
+ *    "GET /a?b HTTP/1.1\r\nHost: x\r\n...\r\n\r\n"
+ *      └─ LIRSHttpHead::parse(): method / target / version / status and
+ *         header views into the caller's buffer (no copy)
+ *
+ *    LIRSHttpOrigin::get(target, host)
+ *      ──► "GET target HTTP/1.1" on a pooled keep-alive connection
+ *      ◄── status │ headers │ body (Content-Length, chunked or until close)
+ *
+ * Only what a caching reverse proxy needs: no request bodies, no trailers,
+ * no 1xx responses besides skipping them.  Header names compare case-
+ * insensitively; repeated headers are kept in order.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace lirs_detail {
+
+  inline bool http_equal(std::string_view a, std::string_view b) {
+
+    if (a.size() != b.size()) return false;
+    for (std::size_t i = 0; i < a.size(); i++) {
+
+      char x = a[i] >= 'A' && a[i] <= 'Z' ? static_cast<char>(a[i] - 'A' + 'a') : a[i];
+      char y = b[i] >= 'A' && b[i] <= 'Z' ? static_cast<char>(b[i] - 'A' + 'a') : b[i];
+      if (x != y) return false;
+    }
+    return true;
+  }
+
+  inline std::string_view http_trim(std::string_view text) {
+
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) text.remove_suffix(1);
+    return text;
+  }
+
+  // comma-separated list contains token (e.g. Connection: keep-alive, Upgrade)
+  inline bool http_has_token(std::string_view list, std::string_view token) {
+
+    while (!list.empty()) {
+
+      std::size_t comma = list.find(',');
+      if (http_equal(http_trim(list.substr(0, comma)), token)) return true;
+      if (comma == std::string_view::npos) break;
+      list.remove_prefix(comma + 1);
+    }
+    return false;
+  }
+
+} // namespace lirs_detail
+
+// request or response head; views point into the parsed buffer
+struct LIRSHttpHead {
+  static constexpr std::size_t kIncomplete = static_cast<std::size_t>(-1);
+  static constexpr std::size_t kInvalid = static_cast<std::size_t>(-2);
+
+  std::string_view method;     // requests
+  std::string_view target;
+  int status = 0;              // responses
+  std::string_view reason;
+  int minor = 1;               // HTTP/1.<minor>
+  std::vector<std::pair<std::string_view, std::string_view>> headers;
+
+  // parse a request (or, with response, a status line) head from data: bytes up to
+  // and including the blank line, kIncomplete, or kInvalid
+  std::size_t parse(const char* data, std::size_t size, std::size_t limit, bool response = false) {
+
+    std::string_view text(data, std::min(size, limit));
+    std::size_t end = text.find("\r\n\r\n");
+    if (end == std::string_view::npos) return size >= limit ? kInvalid : kIncomplete;
+
+    this->headers.clear();
+    std::string_view lines = text.substr(0, end + 2);
+    std::size_t eol = lines.find("\r\n");
+    std::string_view first = lines.substr(0, eol);
+    lines.remove_prefix(eol + 2);
+
+    if (!(response ? this->parse_status(first) : this->parse_request(first))) return kInvalid;
+
+    while (!lines.empty()) {
+
+      eol = lines.find("\r\n");
+      std::string_view line = lines.substr(0, eol);
+      lines.remove_prefix(eol + 2);
+
+      std::size_t colon = line.find(':');
+      if (colon == 0 || colon == std::string_view::npos || line[0] == ' ' || line[0] == '\t') return kInvalid;
+      this->headers.emplace_back(line.substr(0, colon), lirs_detail::http_trim(line.substr(colon + 1)));
+    }
+    return end + 4;
+  }
+
+  // first value of a header, empty if absent
+  std::string_view header(std::string_view name) const {
+
+    for (const auto& field : this->headers) {
+
+      if (lirs_detail::http_equal(field.first, name)) return field.second;
+    }
+    return std::string_view();
+  }
+
+  bool has(std::string_view name) const {
+
+    for (const auto& field : this->headers) {
+
+      if (lirs_detail::http_equal(field.first, name)) return true;
+    }
+    return false;
+  }
+
+  // the connection stays open after this message
+  bool keep_alive() const {
+
+    std::string_view connection = this->header("Connection");
+    if (lirs_detail::http_has_token(connection, "close")) return false;
+    return this->minor >= 1 || lirs_detail::http_has_token(connection, "keep-alive");
+  }
+
+private:
+  bool parse_version(std::string_view version) {
+
+    if (version.size() != 8 || version.substr(0, 7) != "HTTP/1." || version[7] < '0' || version[7] > '9') return false;
+    this->minor = version[7] - '0';
+    return true;
+  }
+
+  // METHOD SP target SP HTTP/1.x
+  bool parse_request(std::string_view line) {
+
+    std::size_t first = line.find(' ');
+    std::size_t second = first == std::string_view::npos ? first : line.find(' ', first + 1);
+    if (first == 0 || second == std::string_view::npos || second == first + 1) return false;
+
+    this->method = line.substr(0, first);
+    this->target = line.substr(first + 1, second - first - 1);
+    return this->parse_version(line.substr(second + 1));
+  }
+
+  // HTTP/1.x SP 3DIGIT [SP reason]
+  bool parse_status(std::string_view line) {
+
+    if (line.size() < 12 || line[8] != ' ' || !this->parse_version(line.substr(0, 8))) return false;
+
+    auto result = std::from_chars(line.data() + 9, line.data() + 12, this->status);
+    this->reason = line.size() > 13 ? line.substr(13) : std::string_view();
+    return result.ec == std::errc() && result.ptr == line.data() + 12 && this->status >= 100;
+  }
+};
+
+// the response directives that decide whether and how long a shared cache may keep it
+struct LIRSCacheControl {
+  bool no_store = false;
+  bool no_cache = false;
+  bool is_private = false;
+  std::int64_t max_age = -1;   // seconds, -1 = none; s-maxage wins over max-age
+
+  static LIRSCacheControl parse(std::string_view value) {
+
+    LIRSCacheControl control;
+    std::int64_t s_maxage = -1;
+
+    while (!value.empty()) {
+
+      std::size_t comma = value.find(',');
+      std::string_view directive = lirs_detail::http_trim(value.substr(0, comma));
+      value.remove_prefix(comma == std::string_view::npos ? value.size() : comma + 1);
+
+      std::size_t equals = directive.find('=');
+      std::string_view name = lirs_detail::http_trim(directive.substr(0, equals));
+      std::string_view argument = equals == std::string_view::npos ? std::string_view() : lirs_detail::http_trim(directive.substr(equals + 1));
+      if (argument.size() >= 2 && argument.front() == '"' && argument.back() == '"') argument = argument.substr(1, argument.size() - 2);
+
+      if (lirs_detail::http_equal(name, "no-store")) control.no_store = true;
+      else if (lirs_detail::http_equal(name, "no-cache")) control.no_cache = true;
+      else if (lirs_detail::http_equal(name, "private")) control.is_private = true;
+      else if (lirs_detail::http_equal(name, "max-age")) control.max_age = seconds(argument);
+      else if (lirs_detail::http_equal(name, "s-maxage")) s_maxage = seconds(argument);
+    }
+
+    if (s_maxage >= 0) control.max_age = s_maxage;
+    return control;
+  }
+
+  // seconds a shared cache may serve the response without asking the origin, 0 = not at all
+  std::int64_t lifetime() const {
+
+    if (this->no_store || this->no_cache || this->is_private || this->max_age < 0) return 0;
+    return this->max_age;
+  }
+
+private:
+  // delta-seconds; unparsable counts as 0 (stale)
+  static std::int64_t seconds(std::string_view argument) {
+
+    std::int64_t value = 0;
+    auto result = std::from_chars(argument.data(), argument.data() + argument.size(), value);
+    if (result.ec == std::errc::result_out_of_range) return INT32_MAX;
+    return result.ec == std::errc() && value >= 0 ? value : 0;
+  }
+};
+
+// blocking HTTP/1.1 client for one origin server, with a pool of keep-alive connections
+class LIRSHttpOrigin {
+public:
+  struct Options {
+    std::string host = "127.0.0.1";
+    std::string port = "80";
+    std::size_t pool_size = 16;               // idle connections kept
+    int timeout_ms = 5000;                    // connect, and each wait for the response
+    std::size_t head_limit = 64 * 1024;       // largest response head
+    std::size_t body_limit = std::size_t { 64 } << 20;
+  };
+
+  struct Response {
+    int status = 0;
+    std::string reason;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+
+    std::string_view header(std::string_view name) const {
+
+      for (const auto& field : this->headers) {
+
+        if (lirs_detail::http_equal(field.first, name)) return field.second;
+      }
+      return std::string_view();
+    }
+  };
+
+  explicit LIRSHttpOrigin(Options options) : options_(std::move(options)) {}
+
+  LIRSHttpOrigin(const LIRSHttpOrigin&) = delete;
+  LIRSHttpOrigin& operator=(const LIRSHttpOrigin&) = delete;
+
+  ~LIRSHttpOrigin() {
+
+    for (int fd : this->idle_) ::close(fd);
+  }
+
+  // GET target; nullopt when the origin cannot be reached or answers garbage.  A pooled
+  // connection the origin closed meanwhile is retried once on a new one
+  std::optional<Response> get(std::string_view target, std::string_view host) {
+
+    std::string request = "GET ";
+    request.append(target.data(), target.size());
+    request += " HTTP/1.1\r\nHost: ";
+    request.append(host.empty() ? this->options_.host : std::string(host));
+    request += "\r\nConnection: keep-alive\r\n\r\n";
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+
+      bool pooled = false;
+      int fd = this->take(pooled);
+      if (fd < 0) return std::nullopt;
+
+      Response response;
+      bool reusable = false;
+      if (this->send_all(fd, request) && this->receive(fd, response, reusable)) {
+
+        if (reusable) this->give_back(fd);
+        else ::close(fd);
+        return response;
+      }
+      ::close(fd);
+      if (!pooled) break;
+    }
+    return std::nullopt;
+  }
+
+  int timeout_ms() const { return this->options_.timeout_ms; }
+
+private:
+  static constexpr std::size_t kReadChunk = 64 * 1024;
+
+  int take(bool& pooled) {
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex_);
+      if (!this->idle_.empty()) {
+
+        int fd = this->idle_.back();
+        this->idle_.pop_back();
+        pooled = true;
+        return fd;
+      }
+    }
+    pooled = false;
+    return this->connect();
+  }
+
+  void give_back(int fd) {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    if (this->idle_.size() < this->options_.pool_size) this->idle_.push_back(fd);
+    else ::close(fd);
+    return;
+  }
+
+  // non-blocking connect bounded by timeout_ms; -1 on failure
+  int connect() const {
+
+    addrinfo hints {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* found = nullptr;
+    if (::getaddrinfo(this->options_.host.c_str(), this->options_.port.c_str(), &hints, &found) != 0) return -1;
+
+    int fd = -1;
+    for (addrinfo* address = found; address != nullptr && fd < 0; address = address->ai_next) {
+
+      fd = ::socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK, address->ai_protocol);
+      if (fd < 0) continue;
+
+      bool connected = ::connect(fd, address->ai_addr, address->ai_addrlen) == 0;
+      if (!connected && errno == EINPROGRESS) {
+
+        int error = 0;
+        socklen_t length = sizeof(error);
+        connected = this->wait(fd, POLLOUT) && ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0;
+      }
+      if (!connected) {
+
+        ::close(fd);
+        fd = -1;
+      }
+    }
+    ::freeaddrinfo(found);
+
+    if (fd >= 0) {
+
+      int one = 1;
+      ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+  }
+
+  bool wait(int fd, short events) const {
+
+    pollfd ready { fd, events, 0 };
+    int result;
+    do result = ::poll(&ready, 1, this->options_.timeout_ms);
+    while (result < 0 && errno == EINTR);
+    return result > 0;
+  }
+
+  bool send_all(int fd, const std::string& data) const {
+
+    std::size_t offset = 0;
+    while (offset < data.size()) {
+
+      ssize_t written = ::send(fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+      if (written < 0 && errno == EINTR) continue;
+      if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && this->wait(fd, POLLOUT)) continue;
+      if (written <= 0) return false;
+      offset += static_cast<std::size_t>(written);
+    }
+    return true;
+  }
+
+  // append what arrives to buffer; false on error, timeout or (unless eof is given) end of stream
+  bool fill(int fd, std::string& buffer, bool* eof = nullptr) const {
+
+    char chunk[kReadChunk];
+    for (;;) {
+
+      ssize_t received = ::recv(fd, chunk, sizeof(chunk), 0);
+      if (received > 0) {
+
+        buffer.append(chunk, static_cast<std::size_t>(received));
+        return true;
+      }
+      if (received == 0 && eof != nullptr) *eof = true;
+      if (received < 0 && errno == EINTR) continue;
+      if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && this->wait(fd, POLLIN)) continue;
+      return false;
+    }
+  }
+
+  bool receive(int fd, Response& response, bool& reusable) const {
+
+    std::string buffer;
+    LIRSHttpHead head;
+    std::size_t used;
+
+    // skip 1xx interim responses
+    for (;;) {
+
+      while ((used = head.parse(buffer.data(), buffer.size(), this->options_.head_limit, true)) == LIRSHttpHead::kIncomplete) {
+
+        if (!this->fill(fd, buffer)) return false;
+      }
+      if (used == LIRSHttpHead::kInvalid) return false;
+      if (head.status >= 200) break;
+      buffer.erase(0, used);
+    }
+
+    response.status = head.status;
+    response.reason = std::string(head.reason);
+    for (const auto& field : head.headers) response.headers.emplace_back(std::string(field.first), std::string(field.second));
+    reusable = head.keep_alive();
+    std::string rest = buffer.substr(used);
+
+    // no body: 204, 304
+    if (head.status == 204 || head.status == 304) {
+
+      if (!rest.empty()) reusable = false;
+      return true;
+    }
+
+    if (lirs_detail::http_has_token(head.header("Transfer-Encoding"), "chunked")) {
+
+      if (!this->read_chunked(fd, rest, response.body)) return false;
+      if (!rest.empty()) reusable = false;
+      return true;
+    }
+
+    std::string_view length_text = head.header("Content-Length");
+    if (!length_text.empty()) {
+
+      std::size_t length = 0;
+      auto result = std::from_chars(length_text.data(), length_text.data() + length_text.size(), length);
+      if (result.ec != std::errc() || result.ptr != length_text.data() + length_text.size() || length > this->options_.body_limit) return false;
+
+      while (rest.size() < length) {
+
+        if (!this->fill(fd, rest)) return false;
+      }
+      if (rest.size() > length) reusable = false;
+      rest.resize(length);
+      response.body = std::move(rest);
+      return true;
+    }
+
+    // delimited by the end of the connection
+    reusable = false;
+    bool eof = false;
+    while (!eof) {
+
+      if (rest.size() > this->options_.body_limit) return false;
+      if (!this->fill(fd, rest, &eof) && !eof) return false;
+    }
+    response.body = std::move(rest);
+    return true;
+  }
+
+  // chunk-size [ext] CRLF data CRLF ... 0 CRLF [trailers] CRLF; data holds what was already read
+  bool read_chunked(int fd, std::string& data, std::string& body) const {
+
+    std::size_t pos = 0;
+    for (;;) {
+
+      std::size_t eol;
+      while ((eol = data.find("\r\n", pos)) == std::string::npos) {
+
+        if (data.size() - pos > 1024 || !this->fill(fd, data)) return false;
+      }
+
+      std::size_t size = 0;
+      auto result = std::from_chars(data.data() + pos, data.data() + eol, size, 16);
+      if (result.ec != std::errc() || result.ptr == data.data() + pos || body.size() + size > this->options_.body_limit) return false;
+      pos = eol + 2;
+
+      if (size == 0) {
+
+        // trailers up to the blank line
+        for (;;) {
+
+          while ((eol = data.find("\r\n", pos)) == std::string::npos) {
+
+            if (data.size() - pos > this->options_.head_limit || !this->fill(fd, data)) return false;
+          }
+          bool blank = eol == pos;
+          pos = eol + 2;
+          if (blank) break;
+        }
+        data.erase(0, pos);
+        return true;
+      }
+
+      while (data.size() < pos + size + 2) {
+
+        if (!this->fill(fd, data)) return false;
+      }
+      if (data.compare(pos + size, 2, "\r\n") != 0) return false;
+
+      body.append(data, pos, size);
+      pos += size + 2;
+
+      // keep the buffer from growing with the whole body
+      if (pos > kReadChunk) {
+
+        data.erase(0, pos);
+        pos = 0;
+      }
+    }
+  }
+
+  Options options_;
+  std::mutex mutex_;
+  std::vector<int> idle_;
+};
+
+#endif
@@ -0,0 +1,469 @@
+#ifndef LIRS_HTTP_CACHE_HPP
+#define LIRS_HTTP_CACHE_HPP
+
+/*
+ * HTTP object cache for a caching reverse proxy
+ *
+ *    target ──► LIRSShardedCache ──► shared_ptr<const LIRSHttpObject>
+ *                                      status │ head │ body │ stored │ expires
+ *
+ *    get(target, fetch)
+ *      ├─ fresh object ─────────────────────────────────────► Hit
+ *      ├─ another thread is fetching it ── wait, share it ──► Coalesced
+ *      └─ fetch() from the origin ── storable? put ─────────► Miss
+ *
+ *    get_async(target, fetch, run, done)
+ *      ├─ fresh object ── returned ─────────────────────────► Hit
+ *      └─ nullptr; done(object, source) later, on the thread that fetched
+ *                  (nullptr and Timeout if that fetch threw LIRSHttpTimeout)
+ *
+ * Capacity is memory in bytes: an object is charged its key, head and body
+ * plus kObjectOverhead.  LIRS keeps the objects that are re-requested within
+ * a short reuse distance; a scan of one-hit objects (crawlers, long-tail
+ * assets) only cycles through the small HIR part instead of flushing them.
+ *
+ * Objects are immutable, so a hit is written to the socket straight from
+ * the cached body (LIRSReplyBuffer::reference) after the shard lock is
+ * released.  Freshness comes from Cache-Control max-age / s-maxage and Age
+ * only; stale objects read as misses and are fetched again in full.
+ *
+ * Concurrent misses of one target run a single fetch: the others wait and
+ * share its object if it is storable, and fetch on their own otherwise
+ * (the response may be private to the first client).  get() blocks the
+ * caller for that; get_async() never does: fetches go to run() (a worker
+ * pool) and waiters are callbacks on the fetch.  Thread-safe.
+ */
+
+#include "lirs_cache.hpp"
+#include "lirs_http.hpp"
+#include "lirs_sharded_cache.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct LIRSHttpObject {
+  LIRSHttpObject(int status, std::string head, std::string body, std::int64_t stored, std::int64_t expires)
+    : status(status), head(std::move(head)), body(std::move(body)), stored(stored), expires(expires) {}
+
+  int status;
+  std::string head;       // status line and end-to-end headers, each ending in CRLF; no Content-Length or Age
+  std::string body;
+  std::int64_t stored;    // unix time in ms the origin generated it (Age counts from here)
+  std::int64_t expires;   // unix time in ms, 0 = not storable
+
+  bool fresh(std::int64_t now) const { return this->expires > now; }
+
+  // seconds since the origin generated it
+  std::int64_t age(std::int64_t now) const { return now > this->stored ? (now - this->stored) / 1000 : 0; }
+};
+
+using LIRSHttpObjectRef = std::shared_ptr<const LIRSHttpObject>;
+
+enum class LIRSHttpSource { Hit, Miss, Coalesced, Timeout };   // Timeout: no object, the fetch ran out of time
+
+// thrown by a fetch that ran out of time, so get_async() can tell it from a failed one
+struct LIRSHttpTimeout : std::runtime_error {
+  LIRSHttpTimeout() : std::runtime_error("Origin timed out") {}
+};
+
+template <typename Cache = LIRSCache<std::string, LIRSHttpObjectRef>>
+class LIRSHttpCache {
+public:
+  static constexpr std::size_t kObjectOverhead = 128;
+
+  struct Options {
+    std::size_t memory = std::size_t { 256 } << 20;        // bytes
+    std::size_t shards = 16;
+    double hir_ratio = 0.01;
+    std::size_t object_limit = std::size_t { 8 } << 20;    // largest body stored
+  };
+
+  struct Stats {
+    std::size_t objects;
+    std::size_t bytes;            // charged bytes
+    std::size_t limit;
+    std::uint64_t hits;
+    std::uint64_t misses;
+    std::uint64_t coalesced;      // misses served by another request's fetch
+    std::uint64_t stored;
+    std::uint64_t uncacheable;    // fetched objects not stored
+    std::uint64_t expired;        // stale objects found by lookups
+    std::size_t lir_count;        // LIRS state summed over the shards
+    std::size_t ghost_count;
+  };
+
+  LIRSHttpCache() : LIRSHttpCache(Options {}) {}
+
+  explicit LIRSHttpCache(Options options)
+    : cache_(make_cache_options(options)), object_limit_(options.object_limit)
+    , hits_(0), misses_(0), coalesced_(0), stored_(0), uncacheable_(0), expired_(0) {}
+
+  LIRSHttpCache(const LIRSHttpCache&) = delete;
+  LIRSHttpCache& operator=(const LIRSHttpCache&) = delete;
+
+  static std::int64_t now() {
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  }
+
+  // cache entry for an origin response received at now: hop-by-hop headers dropped, and an
+  // expiry when a shared cache may store it (cacheable status, max-age, no Vary / Set-Cookie)
+  static LIRSHttpObjectRef object(const LIRSHttpOrigin::Response& response, std::int64_t now) {
+
+    std::string head = "HTTP/1.1 " + std::to_string(response.status) + " ";
+    head += response.reason.empty() ? "Unknown" : response.reason;
+    head += "\r\n";
+
+    std::string_view connection = response.header("Connection");
+    for (const auto& field : response.headers) {
+
+      if (hop_by_hop(field.first) || lirs_detail::http_has_token(connection, field.first)) continue;
+      head += field.first;
+      head += ": ";
+      head += field.second;
+      head += "\r\n";
+    }
+
+    // the origin's Age is part of the object's age
+    std::int64_t age = 0;
+    std::string_view age_text = response.header("Age");
+    std::from_chars(age_text.data(), age_text.data() + age_text.size(), age);
+    std::int64_t stored = now - std::max<std::int64_t>(age, 0) * 1000;
+
+    std::int64_t lifetime = LIRSCacheControl::parse(response.header("Cache-Control")).lifetime();
+    bool storable = lifetime > 0 && cacheable_status(response.status) && response.header("Vary").empty() && response.header("Set-Cookie").empty();
+    std::int64_t expires = storable ? stored + lifetime * 1000 : 0;
+
+    return std::make_shared<const LIRSHttpObject>(response.status, std::move(head), response.body, stored, expires);
+  }
+
+  // fresh object for key, else nullptr; a stale one is dropped
+  LIRSHttpObjectRef lookup(const std::string& key) {
+
+    std::optional<LIRSHttpObjectRef> found = this->cache_.get(key);
+    if (!found) return nullptr;
+
+    LIRSHttpObjectRef object = std::move(*found);
+    if (!object->fresh(now())) {
+
+      // only the stale version: a concurrent fetch may have replaced it
+      if (this->cache_.erase_if(key, [&](const LIRSHttpObjectRef& resident) { return resident == object; })) {
+
+        this->expired_.fetch_add(1, std::memory_order_relaxed);
+      }
+      return nullptr;
+    }
+    return object;
+  }
+
+  // the object for key: from the cache, from a concurrent fetch of the same key, or from
+  // fetch() (returning LIRSHttpObjectRef, nullptr when the origin failed), stored if it may be
+  template <typename Fetch>
+  LIRSHttpObjectRef get(const std::string& key, Fetch fetch, LIRSHttpSource& source) {
+
+    LIRSHttpObjectRef object = this->lookup(key);
+    if (object != nullptr) {
+
+      this->hits_.fetch_add(1, std::memory_order_relaxed);
+      source = LIRSHttpSource::Hit;
+      return object;
+    }
+
+    std::shared_ptr<Flight> flight;
+    bool leader = false;
+    {
+      std::lock_guard<std::mutex> lock(this->flights_mutex_);
+      auto found = this->flights_.find(key);
+      if (found != this->flights_.end()) {
+
+        flight = found->second;
+      } else {
+
+        flight = std::make_shared<Flight>();
+        this->flights_.emplace(key, flight);
+        leader = true;
+      }
+    }
+
+    if (!leader) {
+
+      std::unique_lock<std::mutex> lock(flight->mutex);
+      flight->done_cv.wait(lock, [&flight]() { return flight->done; });
+      if (flight->object != nullptr && this->storable(*flight->object)) {
+
+        this->coalesced_.fetch_add(1, std::memory_order_relaxed);
+        source = LIRSHttpSource::Coalesced;
+        return flight->object;
+      }
+      lock.unlock();
+
+      // nothing shareable: this request asks the origin itself
+      this->misses_.fetch_add(1, std::memory_order_relaxed);
+      source = LIRSHttpSource::Miss;
+      object = fetch();
+      this->store(key, object);
+      return object;
+    }
+
+    this->misses_.fetch_add(1, std::memory_order_relaxed);
+    source = LIRSHttpSource::Miss;
+    try {
+
+      object = fetch();
+      this->store(key, object);
+    } catch (...) {
+
+      this->land(key, *flight, nullptr);
+      throw;
+    }
+    this->land(key, *flight, object);
+    return object;
+  }
+
+  // get() that never blocks: a fresh object is returned; otherwise nullptr, and done(object,
+  // source) is called once it is known, on the thread that fetched it.  run(task) queues task,
+  // which calls fetch(), for another thread, so done is never called before this returns
+  template <typename Fetch, typename Run, typename Done>
+  LIRSHttpObjectRef get_async(const std::string& key, Fetch fetch, Run run, Done done) {
+
+    LIRSHttpObjectRef object = this->lookup(key);
+    if (object != nullptr) {
+
+      this->hits_.fetch_add(1, std::memory_order_relaxed);
+      return object;
+    }
+
+    std::shared_ptr<Flight> flight;
+    bool leader = false;
+    {
+      std::lock_guard<std::mutex> lock(this->flights_mutex_);
+      auto found = this->flights_.find(key);
+      if (found != this->flights_.end()) {
+
+        flight = found->second;
+      } else {
+
+        flight = std::make_shared<Flight>();
+        this->flights_.emplace(key, flight);
+        leader = true;
+      }
+    }
+
+    if (leader) {
+
+      this->misses_.fetch_add(1, std::memory_order_relaxed);
+      run([this, key, flight, fetch, done]() mutable {
+
+        LIRSHttpSource source = LIRSHttpSource::Miss;
+        LIRSHttpObjectRef fetched = this->fetch_and_store(key, fetch, source);
+        this->land(key, *flight, fetched);
+        done(std::move(fetched), source);
+      });
+      return nullptr;
+    }
+
+    // a waiter is called by land(), on the thread that fetched
+    auto waiter = [this, key, fetch, run, done](const LIRSHttpObjectRef& landed) mutable {
+
+      if (landed != nullptr && this->storable(*landed)) {
+
+        this->coalesced_.fetch_add(1, std::memory_order_relaxed);
+        done(landed, LIRSHttpSource::Coalesced);
+        return;
+      }
+
+      // nothing shareable: this request asks the origin itself
+      this->misses_.fetch_add(1, std::memory_order_relaxed);
+      run([this, key, fetch, done]() mutable {
+
+        LIRSHttpSource source = LIRSHttpSource::Miss;
+        LIRSHttpObjectRef fetched = this->fetch_and_store(key, fetch, source);
+        done(std::move(fetched), source);
+      });
+      return;
+    };
+
+    {
+      std::lock_guard<std::mutex> lock(flight->mutex);
+      if (!flight->done) {
+
+        flight->waiters.emplace_back(std::move(waiter));
+        return nullptr;
+      }
+      object = flight->object;
+    }
+
+    // landed meanwhile
+    if (object != nullptr && this->storable(*object)) {
+
+      this->coalesced_.fetch_add(1, std::memory_order_relaxed);
+      return object;
+    }
+    waiter(nullptr);
+    return nullptr;
+  }
+
+  bool erase(const std::string& key) { return this->cache_.erase(key); }
+
+  Stats stats() const {
+
+    Stats stats {};
+    stats.bytes = this->cache_.charge();
+    stats.limit = this->cache_.capacity();
+    stats.hits = this->hits_.load(std::memory_order_relaxed);
+    stats.misses = this->misses_.load(std::memory_order_relaxed);
+    stats.coalesced = this->coalesced_.load(std::memory_order_relaxed);
+    stats.stored = this->stored_.load(std::memory_order_relaxed);
+    stats.uncacheable = this->uncacheable_.load(std::memory_order_relaxed);
+    stats.expired = this->expired_.load(std::memory_order_relaxed);
+
+    for (std::size_t i = 0; i < this->cache_.shard_count(); i++) {
+
+      this->cache_.with_shard(i, [&stats](const Cache& cache) {
+
+        stats.objects += cache.size();
+        stats.lir_count += cache.lir_count();
+        stats.ghost_count += cache.ghost_count();
+      });
+    }
+    return stats;
+  }
+
+  std::size_t capacity() const { return this->cache_.capacity(); }
+
+  LIRSShardedCache<std::string, LIRSHttpObjectRef, Cache>& cache() { return this->cache_; }
+
+private:
+  // one fetch in progress; get() waiters block on it until done, get_async() ones are called
+  struct Flight {
+    std::mutex mutex;
+    std::condition_variable done_cv;
+    bool done = false;
+    LIRSHttpObjectRef object;
+    std::vector<std::function<void(const LIRSHttpObjectRef&)>> waiters;
+  };
+
+  static typename LIRSShardedCache<std::string, LIRSHttpObjectRef, Cache>::Options make_cache_options(const Options& options) {
+
+    typename LIRSShardedCache<std::string, LIRSHttpObjectRef, Cache>::Options cache_options;
+    cache_options.capacity = options.memory;
+    cache_options.shards = options.shards;
+    cache_options.hir_ratio = options.hir_ratio;
+    cache_options.weigher = [](const std::string& key, const LIRSHttpObjectRef& object) {
+
+      return key.size() + object->head.size() + object->body.size() + kObjectOverhead;
+    };
+    return cache_options;
+  }
+
+  // RFC 9110 15.1: heuristically cacheable status codes
+  static bool cacheable_status(int status) {
+
+    switch (status) {
+      case 200: case 203: case 204: case 206: case 300: case 301: case 308:
+      case 404: case 405: case 410: case 414: case 501:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  // headers for one connection only, plus the framing this proxy writes itself
+  static bool hop_by_hop(std::string_view name) {
+
+    static const char* const kNames[] = {
+      "Connection", "Keep-Alive", "Proxy-Connection", "Proxy-Authenticate", "Proxy-Authorization",
+      "TE", "Trailer", "Transfer-Encoding", "Upgrade", "Content-Length", "Age"
+    };
+    for (const char* hop : kNames) {
+
+      if (lirs_detail::http_equal(name, hop)) return true;
+    }
+    return false;
+  }
+
+  bool storable(const LIRSHttpObject& object) const {
+
+    return object.fresh(now()) && object.body.size() <= this->object_limit_;
+  }
+
+  void store(const std::string& key, const LIRSHttpObjectRef& object) {
+
+    if (object == nullptr) return;
+    if (!this->storable(*object)) {
+
+      this->uncacheable_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    this->cache_.put(key, object);
+    this->stored_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  // fetch() for get_async(): a throwing fetch counts as a failed one, and sets source to
+  // Timeout if it threw LIRSHttpTimeout; the outcome of this fetch only, not the leader's
+  template <typename Fetch>
+  LIRSHttpObjectRef fetch_and_store(const std::string& key, Fetch& fetch, LIRSHttpSource& source) {
+
+    LIRSHttpObjectRef object;
+    try {
+
+      object = fetch();
+    } catch (const LIRSHttpTimeout&) {
+
+      source = LIRSHttpSource::Timeout;
+      return nullptr;
+    } catch (...) {
+
+      return nullptr;
+    }
+    this->store(key, object);
+    return object;
+  }
+
+  // finish a fetch: later misses start their own, waiters wake up with its object
+  void land(const std::string& key, Flight& flight, LIRSHttpObjectRef object) {
+
+    {
+      std::lock_guard<std::mutex> lock(this->flights_mutex_);
+      this->flights_.erase(key);
+    }
+    std::vector<std::function<void(const LIRSHttpObjectRef&)>> waiters;
+    {
+      std::lock_guard<std::mutex> lock(flight.mutex);
+      flight.object = std::move(object);
+      flight.done = true;
+      waiters.swap(flight.waiters);
+    }
+    flight.done_cv.notify_all();
+    for (auto& waiter : waiters) waiter(flight.object);
+    return;
+  }
+
+  LIRSShardedCache<std::string, LIRSHttpObjectRef, Cache> cache_;
+  std::size_t object_limit_;
+  std::mutex flights_mutex_;
+  std::unordered_map<std::string, std::shared_ptr<Flight>> flights_;
+  std::atomic<std::uint64_t> hits_;
+  std::atomic<std::uint64_t> misses_;
+  std::atomic<std::uint64_t> coalesced_;
+  std::atomic<std::uint64_t> stored_;
+  std::atomic<std::uint64_t> uncacheable_;
+  std::atomic<std::uint64_t> expired_;
+};
+
+#endif
@@ -0,0 +1,317 @@
+#ifndef LIRS_HTTP_PROXY_HPP
+#define LIRS_HTTP_PROXY_HPP
+
+/*
+ * HTTP/1.1 caching reverse proxy session for LIRSServer
+ *
+ *    "GET /img/1.png HTTP/1.1" ──► LIRSHttpCache::get_async(target)
+ *                                    ├─ hit ─────────────────────────────┐
+ *                                    └─ miss ── LIRSHttpFetchPool        │
+ *                                               LIRSHttpOrigin::get()    │
+ *                                               (one fetch per target)   │
+ *                                               waker.wake() ── resume() ┤
+ *                                                                        ▼
+ *    head │ Content-Length │ Age │ X-Cache: HIT|MISS ◄── [ body ──► cached object ]
+ *
+ * GET and HEAD are served; other methods get 501.  The cache key is the
+ * request target, and only Host goes to the origin, so every client sees
+ * the same representation (responses with Vary are passed through but not
+ * stored).  Bodies are referenced from the cached object into the reply
+ * buffer and leave with the head in one gathered write.
+ *
+ * Hits are answered on the reactor thread.  A miss is fetched on a thread
+ * of the LIRSHttpFetchPool, bounded by the origin's timeout_ms, and the
+ * session waits for it without blocking the reactor: LIRSServer stops
+ * reading the connection and resumes it when the fetch wakes it up, so
+ * the other connections of the reactor are served meanwhile.  Pipelined
+ * requests are answered in order, since the requests behind a miss are
+ * only parsed once it is answered.  Size the pool (and the origin's
+ * connection pool) for the misses in flight.
+ *
+ * One session per connection; not thread-safe (the cache, origin and pool are).
+ */
+
+#include "lirs_http.hpp"
+#include "lirs_http_cache.hpp"
+#include "lirs_reply.hpp"
+#include "lirs_server.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <charconv>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// threads that run origin fetches for proxy sessions; queued fetches still run on destruction
+class LIRSHttpFetchPool {
+public:
+  explicit LIRSHttpFetchPool(std::size_t threads = 16) : stop_(false) {
+
+    if (threads == 0) threads = 1;
+    for (std::size_t i = 0; i < threads; i++) this->workers_.emplace_back([this] { this->work(); });
+    return;
+  }
+
+  ~LIRSHttpFetchPool() {
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex_);
+      this->stop_ = true;
+    }
+    this->ready_.notify_all();
+    for (std::thread& worker : this->workers_) worker.join();
+  }
+
+  LIRSHttpFetchPool(const LIRSHttpFetchPool&) = delete;
+  LIRSHttpFetchPool& operator=(const LIRSHttpFetchPool&) = delete;
+
+  void run(std::function<void()> task) {
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex_);
+      this->queue_.push_back(std::move(task));
+    }
+    this->ready_.notify_one();
+    return;
+  }
+
+  std::size_t threads() const { return this->workers_.size(); }
+
+private:
+  void work() {
+
+    std::unique_lock<std::mutex> lock(this->mutex_);
+
+    while (true) {
+
+      this->ready_.wait(lock, [&] { return this->stop_ || !this->queue_.empty(); });
+      if (this->queue_.empty()) return;
+
+      std::function<void()> task = std::move(this->queue_.front());
+      this->queue_.pop_front();
+      lock.unlock();
+
+      task();
+
+      lock.lock();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::deque<std::function<void()>> queue_;
+  std::vector<std::thread> workers_;
+  bool stop_;
+};
+
+template <typename Cache>
+class LIRSHttpProxySession {
+public:
+  struct Options {
+    std::size_t head_limit = 64 * 1024;   // largest request head
+  };
+
+  LIRSHttpProxySession(LIRSHttpCache<Cache>& cache, LIRSHttpOrigin& origin, LIRSHttpFetchPool& fetches)
+    : LIRSHttpProxySession(cache, origin, fetches, Options {}) {}
+
+  LIRSHttpProxySession(LIRSHttpCache<Cache>& cache, LIRSHttpOrigin& origin, LIRSHttpFetchPool& fetches, Options options)
+    : cache_(cache), origin_(origin), fetches_(fetches), options_(options), closing_(false) {}
+
+  // answer complete requests from data, appending the responses to out; returns bytes used.
+  // Stops after a miss: its response and the requests behind it wait for resume()
+  std::size_t feed(const char* data, std::size_t size, LIRSReplyBuffer& out) {
+
+    std::size_t pos = 0;
+    while (!this->closing_ && this->pending_ == nullptr && pos < size) {
+
+      std::size_t used = this->head_.parse(data + pos, size - pos, this->options_.head_limit);
+      if (used == LIRSHttpHead::kIncomplete) break;
+      if (used == LIRSHttpHead::kInvalid) {
+
+        this->error(400, "Bad Request", out);
+        pos = size;
+        break;
+      }
+
+      // request bodies are not forwarded: skip a sized one, refuse a chunked one
+      std::size_t length = 0;
+      if (this->head_.has("Transfer-Encoding")) {
+
+        this->error(501, "Not Implemented", out);
+        pos = size;
+        break;
+      }
+      std::string_view length_text = this->head_.header("Content-Length");
+      if (!length_text.empty()) {
+
+        auto result = std::from_chars(length_text.data(), length_text.data() + length_text.size(), length);
+        if (result.ec != std::errc() || result.ptr != length_text.data() + length_text.size()) {
+
+          this->error(400, "Bad Request", out);
+          pos = size;
+          break;
+        }
+      }
+      if (size - pos - used < length) break;
+
+      pos += used + length;
+      if (!this->head_.keep_alive()) this->closing_ = true;
+      this->request(out);
+    }
+    return pos;
+  }
+
+  // Connection: close, HTTP/1.0 or a malformed request: close after the responses are sent
+  bool closing() const { return this->closing_; }
+
+  // woken once a miss is fetched
+  void bind(LIRSServerWaker waker) {
+
+    this->waker_ = std::move(waker);
+    return;
+  }
+
+  // a miss is being fetched
+  bool waiting() const { return this->pending_ != nullptr; }
+
+  // append the response of the miss if it arrived
+  void resume(LIRSReplyBuffer& out) {
+
+    if (this->pending_ == nullptr) return;
+    {
+      std::lock_guard<std::mutex> lock(this->pending_->mutex);
+      if (!this->pending_->done) return;
+    }
+
+    std::shared_ptr<Pending> pending = std::move(this->pending_);
+    this->respond(pending->object, pending->source, pending->head_only, out);
+    return;
+  }
+
+private:
+  // a miss in flight, written by the fetching thread; outlives the session if the client goes away
+  struct Pending {
+    std::mutex mutex;
+    bool done = false;
+    LIRSHttpObjectRef object;
+    LIRSHttpSource source = LIRSHttpSource::Miss;
+    bool head_only = false;
+  };
+
+  void request(LIRSReplyBuffer& out) {
+
+    bool head_only = this->head_.method == "HEAD";
+    if (!head_only && this->head_.method != "GET") {
+
+      this->error(501, "Not Implemented", out);
+      return;
+    }
+
+    // the fetch runs after the head is gone: it gets copies
+    std::string key(this->head_.target);
+    std::string host(this->head_.header("Host"));
+    auto pending = std::make_shared<Pending>();
+    pending->head_only = head_only;
+
+    LIRSHttpOrigin& origin = this->origin_;
+    LIRSHttpFetchPool& fetches = this->fetches_;
+    LIRSServerWaker waker = this->waker_;
+    LIRSHttpObjectRef object = this->cache_.get_async(key,
+      [&origin, key, host]() -> LIRSHttpObjectRef {
+
+        std::int64_t start = LIRSHttpCache<Cache>::now();
+        std::optional<LIRSHttpOrigin::Response> response = origin.get(key, host);
+        std::int64_t now = LIRSHttpCache<Cache>::now();
+        if (!response) {
+
+          if (now - start >= origin.timeout_ms()) throw LIRSHttpTimeout();
+          return nullptr;
+        }
+        return LIRSHttpCache<Cache>::object(*response, now);
+      },
+      [&fetches](std::function<void()> task) { fetches.run(std::move(task)); },
+      [pending, waker](LIRSHttpObjectRef fetched, LIRSHttpSource source) {
+
+        {
+          std::lock_guard<std::mutex> lock(pending->mutex);
+          pending->object = std::move(fetched);
+          pending->source = source;
+          pending->done = true;
+        }
+        waker.wake();
+      });
+
+    if (object != nullptr) {
+
+      this->respond(object, LIRSHttpSource::Hit, head_only, out);
+      return;
+    }
+    this->pending_ = std::move(pending);
+    return;
+  }
+
+  void respond(const LIRSHttpObjectRef& object, LIRSHttpSource source, bool head_only, LIRSReplyBuffer& out) {
+
+    if (object == nullptr) {
+
+      if (source == LIRSHttpSource::Timeout) this->error(504, "Gateway Timeout", out);
+      else this->error(502, "Bad Gateway", out);
+      return;
+    }
+
+    out += object->head;
+    out += "Content-Length: ";
+    this->append_number(out, object->body.size());
+    out += "\r\nAge: ";
+    this->append_number(out, object->age(LIRSHttpCache<Cache>::now()));
+    out += source == LIRSHttpSource::Miss ? "\r\nX-Cache: MISS\r\n" : "\r\nX-Cache: HIT\r\n";
+    if (this->closing_) out += "Connection: close\r\n";
+    out += "\r\n";
+    if (!head_only) out.reference(object->body, object);
+    return;
+  }
+
+  // a response of the proxy itself; after 400 / 501 the rest of the stream is not trusted
+  void error(int status, std::string_view reason, LIRSReplyBuffer& out) {
+
+    if (status == 400 || status == 501) this->closing_ = true;
+
+    std::string body = std::to_string(status) + " " + std::string(reason) + "\n";
+    out += "HTTP/1.1 ";
+    out += body.substr(0, body.size() - 1);
+    out += "\r\nContent-Type: text/plain\r\nContent-Length: ";
+    this->append_number(out, body.size());
+    if (status == 501) out += "\r\nAllow: GET, HEAD";
+    out += this->closing_ ? "\r\nConnection: close\r\n\r\n" : "\r\n\r\n";
+    out += body;
+    return;
+  }
+
+  template <typename T>
+  static void append_number(LIRSReplyBuffer& out, T value) {
+
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, static_cast<std::size_t>(result.ptr - digits));
+    return;
+  }
+
+  LIRSHttpCache<Cache>& cache_;
+  LIRSHttpOrigin& origin_;
+  LIRSHttpFetchPool& fetches_;
+  Options options_;
+  LIRSHttpHead head_;
+  LIRSServerWaker waker_;
+  std::shared_ptr<Pending> pending_;
+  bool closing_;
+};
+
+#endif
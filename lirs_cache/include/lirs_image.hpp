@@ -0,0 +1,511 @@
+#ifndef LIRS_IMAGE_HPP
+#define LIRS_IMAGE_HPP
+
+/*
+ * LIRS cache image: the whole cache inside one flat memory region
+ *
+ *    ┌──────────┬───────────────────────────────┬──────────────────────┐
+ *    │ Header   │ Node[node_count]              │ u32 bucket[buckets]  │
+ *    │ lists,   │ key │ value │ S/Q/hash links │ hash chain heads     │
+ *    │ counters │ (u32 node indices, no pointers)                      │
+ *    └──────────┴───────────────────────────────┴──────────────────────┘
+ *
+ * Every link is a node index, so the region stays valid wherever it is
+ * mapped (file, shared memory, anonymous arena).  Keys and values must be
+ * trivially copyable and the hash must be stable across processes.
+ *
+ * Same replacement policy as LIRSCache.  Non-resident HIR blocks (ghosts)
+ * also sit on a FIFO threaded through the Q links; when no node is free
+ * the oldest ghost is dropped, which bounds metadata to node_count nodes.
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+template <typename K, typename V, typename Hash = std::hash<K>>
+class LIRSImage {
+  static_assert(std::is_trivially_copyable<K>::value, "LIRSImage keys must be trivially copyable");
+  static_assert(std::is_trivially_copyable<V>::value, "LIRSImage values must be trivially copyable");
+
+public:
+  static constexpr std::uint32_t kNil = UINT32_MAX;
+
+  // bytes needed for a cache of this capacity plus ghost_limit ghost entries
+  static std::size_t region_size(std::size_t capacity, std::size_t ghost_limit) {
+
+    std::size_t nodes = node_count_for(capacity, ghost_limit);
+    return sizeof(Header) + nodes * sizeof(Node) + bucket_count_for(nodes) * sizeof(std::uint32_t);
+  }
+
+  // initialize an empty cache in region
+  static LIRSImage format(void* region, std::size_t size, std::size_t capacity,
+                          double hir_ratio = 0.01, std::size_t ghost_limit = 0) {
+
+    if (capacity == 0) throw std::invalid_argument("Capacity must be greater than 0");
+    if (hir_ratio <= 0.0 || hir_ratio >= 1.0) throw std::invalid_argument("HIR ratio must be in range(0, 1)");
+    if (ghost_limit == 0) ghost_limit = capacity;
+    if (size < region_size(capacity, ghost_limit)) throw std::invalid_argument("Region too small for capacity");
+
+    std::size_t nodes = node_count_for(capacity, ghost_limit);
+    if (nodes >= kNil) throw std::invalid_argument("Capacity too large for 32-bit node links");
+
+    Header* header = static_cast<Header*>(region);
+    std::memset(static_cast<void*>(header), 0, sizeof(Header));
+    std::memcpy(header->magic, kMagic, sizeof(kMagic));
+    header->version = kVersion;
+    header->key_size = sizeof(K);
+    header->value_size = sizeof(V);
+    header->capacity = capacity;
+    header->hir_capacity = std::max<std::size_t>(1, static_cast<std::size_t>(capacity * hir_ratio));
+    header->lir_capacity = capacity - header->hir_capacity;
+    header->node_count = nodes;
+    header->bucket_count = bucket_count_for(nodes);
+
+    LIRSImage image(region);
+    image.clear();
+    return image;
+  }
+
+  // true if region holds an image built for these parameters
+  static bool compatible(const void* region, std::size_t size, std::size_t capacity,
+                         double hir_ratio = 0.01, std::size_t ghost_limit = 0) {
+
+    if (ghost_limit == 0) ghost_limit = capacity;
+    if (size < sizeof(Header)) return false;
+
+    const Header* header = static_cast<const Header*>(region);
+    std::size_t hir_capacity = std::max<std::size_t>(1, static_cast<std::size_t>(capacity * hir_ratio));
+
+    return std::memcmp(header->magic, kMagic, sizeof(kMagic)) == 0 && header->version == kVersion &&
+           header->key_size == sizeof(K) && header->value_size == sizeof(V) &&
+           header->capacity == capacity && header->hir_capacity == hir_capacity &&
+           header->node_count == node_count_for(capacity, ghost_limit) &&
+           size >= region_size(capacity, ghost_limit);
+  }
+
+  // attach to a formatted region
+  explicit LIRSImage(void* region)
+    : header_(static_cast<Header*>(region))
+    , nodes_(reinterpret_cast<Node*>(static_cast<char*>(region) + sizeof(Header)))
+    , buckets_(reinterpret_cast<std::uint32_t*>(this->nodes_ + this->header_->node_count)) {}
+
+  std::optional<V> get(const K& key) {
+
+    std::uint32_t index = this->find(key);
+
+    // key not found, or ghost entry
+    if (index == kNil) return std::nullopt;
+
+    Node& node = this->nodes_[index];
+    if (!(node.flags & kResident)) return std::nullopt;
+
+    if (node.flags & kLIR) this->access_lir(index);
+    else this->access_hir_resident(index);
+
+    return node.value;
+  }
+
+  void put(const K& key, const V& value) {
+
+    std::uint32_t index = this->find(key);
+
+    // new key
+    if (index == kNil) {
+
+      this->insert_new(key, value);
+      return;
+    }
+
+    Node& node = this->nodes_[index];
+
+    // LIR hit
+    if (node.flags & kLIR) {
+
+      node.value = value;
+      this->access_lir(index);
+      return;
+    }
+
+    // HIR resident hit
+    if (node.flags & kResident) {
+
+      node.value = value;
+      this->access_hir_resident(index);
+      return;
+    }
+
+    // HIR non-resident (ghost hit)
+    this->access_hir_non_resident(index, value);
+    return;
+  }
+
+  // drop every entry
+  void clear() {
+
+    Header* header = this->header_;
+    header->lir_count = 0;
+    header->resident_count = 0;
+    header->s = List {};
+    header->q = List {};
+    header->ghosts = List {};
+    header->s.head = header->s.tail = kNil;
+    header->q.head = header->q.tail = kNil;
+    header->ghosts.head = header->ghosts.tail = kNil;
+
+    std::fill(this->buckets_, this->buckets_ + header->bucket_count, kNil);
+
+    for (std::uint64_t i = 0; i < header->node_count; i++) {
+
+      this->nodes_[i].flags = 0;
+      this->nodes_[i].h_next = i + 1 < header->node_count ? static_cast<std::uint32_t>(i + 1) : kNil;
+    }
+    header->free_head = header->node_count > 0 ? 0 : kNil;
+    return;
+  }
+
+  std::size_t size() const { return this->header_->resident_count; }
+  std::size_t capacity() const { return this->header_->capacity; }
+  bool empty() const { return this->header_->resident_count == 0; }
+
+  std::size_t lir_count() const { return this->header_->lir_count; }
+  std::size_t ghost_count() const { return this->header_->ghosts.size; }
+  std::size_t lirs_stack_size() const { return this->header_->s.size; }
+  std::size_t hir_stack_size() const { return this->header_->q.size; }
+
+  // user-defined word kept in the header (e.g. a clean-shutdown marker)
+  std::uint64_t& user_word() { return this->header_->user; }
+
+private:
+  static constexpr char kMagic[8] = { 'L', 'I', 'R', 'S', 'I', 'M', 'G', '1' };
+  static constexpr std::uint32_t kVersion = 1;
+
+  static constexpr std::uint8_t kLIR = 1;
+  static constexpr std::uint8_t kResident = 2;
+  static constexpr std::uint8_t kInS = 4;
+  static constexpr std::uint8_t kInQ = 8;
+  static constexpr std::uint8_t kGhost = 16;
+
+  struct List {
+    std::uint32_t head;   // top
+    std::uint32_t tail;   // bottom
+    std::uint64_t size;
+  };
+
+  struct alignas(64) Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t key_size;
+    std::uint32_t value_size;
+    std::uint32_t free_head;
+    std::uint64_t capacity;
+    std::uint64_t hir_capacity;
+    std::uint64_t lir_capacity;
+    std::uint64_t node_count;
+    std::uint64_t bucket_count;
+    std::uint64_t lir_count;
+    std::uint64_t resident_count;
+    std::uint64_t user;
+    List s;       // Stack S
+    List q;       // Stack Q
+    List ghosts;  // non-resident blocks, oldest at the bottom
+  };
+
+  struct Node {
+    K key;
+    V value;
+    std::uint32_t s_prev, s_next;  // Stack S
+    std::uint32_t q_prev, q_next;  // Stack Q, or ghost FIFO for non-resident blocks
+    std::uint32_t h_next;          // hash chain / free list
+    std::uint8_t flags;
+  };
+
+  static std::size_t node_count_for(std::size_t capacity, std::size_t ghost_limit) {
+
+    // residents may exceed capacity by one HIR block during a miss
+    return capacity + 1 + ghost_limit;
+  }
+
+  static std::size_t bucket_count_for(std::size_t nodes) {
+
+    std::size_t buckets = 1;
+    while (buckets < nodes) buckets <<= 1;
+    return buckets;
+  }
+
+  // intrusive lists over node indices; S uses s_*, Q and ghosts use q_*
+  template <std::uint32_t Node::*Prev, std::uint32_t Node::*Next>
+  void push_front(List& list, std::uint32_t index) {
+
+    Node& node = this->nodes_[index];
+    node.*Prev = kNil;
+    node.*Next = list.head;
+
+    if (list.head != kNil) this->nodes_[list.head].*Prev = index;
+    else list.tail = index;
+
+    list.head = index;
+    list.size++;
+    return;
+  }
+
+  template <std::uint32_t Node::*Prev, std::uint32_t Node::*Next>
+  void unlink(List& list, std::uint32_t index) {
+
+    Node& node = this->nodes_[index];
+
+    if (node.*Prev != kNil) this->nodes_[node.*Prev].*Next = node.*Next;
+    else list.head = node.*Next;
+
+    if (node.*Next != kNil) this->nodes_[node.*Next].*Prev = node.*Prev;
+    else list.tail = node.*Prev;
+
+    list.size--;
+    return;
+  }
+
+  void s_push(std::uint32_t index) { this->push_front<&Node::s_prev, &Node::s_next>(this->header_->s, index); }
+  void s_unlink(std::uint32_t index) { this->unlink<&Node::s_prev, &Node::s_next>(this->header_->s, index); }
+  void q_push(std::uint32_t index) { this->push_front<&Node::q_prev, &Node::q_next>(this->header_->q, index); }
+  void q_unlink(std::uint32_t index) { this->unlink<&Node::q_prev, &Node::q_next>(this->header_->q, index); }
+  void ghost_push(std::uint32_t index) { this->push_front<&Node::q_prev, &Node::q_next>(this->header_->ghosts, index); }
+  void ghost_unlink(std::uint32_t index) { this->unlink<&Node::q_prev, &Node::q_next>(this->header_->ghosts, index); }
+
+  std::uint32_t& bucket(const K& key) {
+
+    return this->buckets_[Hash {}(key) & (this->header_->bucket_count - 1)];
+  }
+
+  std::uint32_t find(const K& key) {
+
+    for (std::uint32_t index = this->bucket(key); index != kNil; index = this->nodes_[index].h_next) {
+
+      if (this->nodes_[index].key == key) return index;
+    }
+    return kNil;
+  }
+
+  void hash_remove(std::uint32_t index) {
+
+    std::uint32_t* link = &this->bucket(this->nodes_[index].key);
+    while (*link != index) link = &this->nodes_[*link].h_next;
+    *link = this->nodes_[index].h_next;
+    return;
+  }
+
+  // take a free node, dropping the oldest ghost if none is left
+  std::uint32_t allocate(const K& key, const V& value) {
+
+    Header* header = this->header_;
+    std::uint32_t index = header->free_head;
+
+    if (index != kNil) {
+
+      header->free_head = this->nodes_[index].h_next;
+    } else {
+
+      index = header->ghosts.tail;
+      if (index == kNil) throw std::runtime_error("LIRS image out of nodes");
+
+      this->ghost_unlink(index);
+      this->s_unlink(index);
+      this->hash_remove(index);
+    }
+
+    Node& node = this->nodes_[index];
+    node.key = key;
+    node.value = value;
+    node.flags = 0;
+
+    std::uint32_t& head = this->bucket(key);
+    node.h_next = head;
+    head = index;
+    return index;
+  }
+
+  void release(std::uint32_t index) {
+
+    this->hash_remove(index);
+    this->nodes_[index].flags = 0;
+    this->nodes_[index].h_next = this->header_->free_head;
+    this->header_->free_head = index;
+    return;
+  }
+
+  void insert_new(const K& key, const V& value) {
+
+    Header* header = this->header_;
+
+    // Initialization phase: fill the LIR set
+    if (header->lir_count < header->lir_capacity) {
+
+      std::uint32_t index = this->allocate(key, value);
+      this->nodes_[index].flags = kLIR | kResident | kInS;
+      this->s_push(index);
+      header->lir_count++;
+      header->resident_count++;
+      return;
+    }
+
+    // normal phase: insert as HIR, evicting from Q once the cache is full
+    if (header->resident_count >= header->capacity) this->evict_hir_resident();
+
+    std::uint32_t index = this->allocate(key, value);
+    this->nodes_[index].flags = kResident | kInS | kInQ;
+    this->s_push(index);
+    this->q_push(index);
+    header->resident_count++;
+    return;
+  }
+
+  void access_lir(std::uint32_t index) {
+
+    bool was_bottom = this->header_->s.tail == index;
+
+    // remove from S and add of the top
+    this->s_unlink(index);
+    this->s_push(index);
+
+    if (was_bottom) this->stack_pruning();
+    return;
+  }
+
+  void access_hir_resident(std::uint32_t index) {
+
+    Node& node = this->nodes_[index];
+
+    // if in S, promote to LIR
+    if (node.flags & kInS) {
+
+      this->promote_to_lir(index);
+      return;
+    }
+
+    // if not in S, move to the top of both S and Q
+    this->s_push(index);
+    node.flags |= kInS;
+
+    this->q_unlink(index);
+    this->q_push(index);
+    return;
+  }
+
+  void access_hir_non_resident(std::uint32_t index, const V& value) {
+
+    // Victim block replacement
+    if (this->header_->resident_count >= this->header_->capacity) this->evict_hir_resident();
+
+    // load data
+    Node& node = this->nodes_[index];
+    node.value = value;
+    node.flags = static_cast<std::uint8_t>((node.flags | kResident) & ~kGhost);
+    this->ghost_unlink(index);
+    this->header_->resident_count++;
+
+    // if in S, promote to LIR
+    if (node.flags & kInS) {
+
+      this->promote_to_lir(index);
+      return;
+    }
+
+    // if not in S, keep as HIR and add to both S and Q
+    this->s_push(index);
+    this->q_push(index);
+    node.flags |= kInS | kInQ;
+    return;
+  }
+
+  void promote_to_lir(std::uint32_t index) {
+
+    Node& node = this->nodes_[index];
+
+    // HIR -> LIR
+    node.flags |= kLIR;
+    this->header_->lir_count++;
+
+    this->s_unlink(index);
+    this->s_push(index);
+
+    // remove from Q
+    if (node.flags & kInQ) {
+
+      this->q_unlink(index);
+      node.flags &= static_cast<std::uint8_t>(~kInQ);
+    }
+
+    // Demotion to bottom LIR + pruning
+    this->demote_bottom_lir();
+    this->stack_pruning();
+    return;
+  }
+
+  void demote_bottom_lir() {
+
+    std::uint32_t bottom = this->header_->s.tail;
+    if (bottom == kNil) return;
+
+    Node& node = this->nodes_[bottom];
+    if (!(node.flags & kLIR)) return;
+
+    // LIR -> HIR, remove from S, add to the top of Q
+    this->header_->lir_count--;
+    this->s_unlink(bottom);
+    this->q_push(bottom);
+    node.flags = static_cast<std::uint8_t>((node.flags & ~(kLIR | kInS)) | kInQ);
+    return;
+  }
+
+  void stack_pruning() {
+
+    while (this->header_->s.tail != kNil) {
+
+      std::uint32_t bottom = this->header_->s.tail;
+      Node& node = this->nodes_[bottom];
+
+      if (node.flags & kLIR) break;
+
+      this->s_unlink(bottom);
+      node.flags &= static_cast<std::uint8_t>(~kInS);
+
+      if (!(node.flags & kResident)) {
+
+        this->ghost_unlink(bottom);
+        this->release(bottom);
+      }
+    }
+    return;
+  }
+
+  void evict_hir_resident() {
+
+    std::uint32_t victim = this->header_->q.tail;
+    if (victim == kNil) return;
+
+    Node& node = this->nodes_[victim];
+    this->q_unlink(victim);
+    node.flags &= static_cast<std::uint8_t>(~(kResident | kInQ));
+    this->header_->resident_count--;
+
+    if (!(node.flags & kInS)) {
+
+      this->release(victim);
+      return;
+    }
+
+    node.flags |= kGhost;
+    this->ghost_push(victim);
+    return;
+  }
+
+  Header* header_;
+  Node* nodes_;
+  std::uint32_t* buckets_;
+};
+
+#endif
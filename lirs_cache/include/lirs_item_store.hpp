@@ -0,0 +1,299 @@
+#ifndef LIRS_ITEM_STORE_HPP
+#define LIRS_ITEM_STORE_HPP
+
+/*
+ * Key-value item store for cache servers (memcached semantics)
+ *
+ *    key ──► LIRSShardedCache ──► shared_ptr<const LIRSItem>
+ *                                   data │ flags │ cas │ expires
+ *
+ * Capacity is memory in bytes: an item is charged its key and data plus a
+ * fixed kItemOverhead for the cache metadata, hash entry and allocation.
+ *
+ * Items are immutable once stored (a set makes a new one with a new cas),
+ * so a lookup hands out a reference and releases the shard lock before the
+ * value is copied to a socket.  Only the expiry changes in place (touch).
+ * Expired items read as misses and are erased when seen.
+ *
+ * Cache selects the policy of every shard: LIRSCache (default) or
+ * LIRSLRUCache for comparison.  Thread-safe.
+ */
+
+#include "lirs_cache.hpp"
+#include "lirs_sharded_cache.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct LIRSItem {
+  LIRSItem(std::string data, std::uint32_t flags, std::uint64_t cas, std::int64_t expires)
+    : data(std::move(data)), flags(flags), cas(cas), expires(expires) {}
+
+  std::string data;
+  std::uint32_t flags;                       // opaque client flags
+  std::uint64_t cas;                         // unique per stored version
+  mutable std::atomic<std::int64_t> expires; // unix time in ms, 0 = never
+
+  bool expired(std::int64_t now) const {
+
+    std::int64_t at = this->expires.load(std::memory_order_relaxed);
+    return at != 0 && at <= now;
+  }
+};
+
+using LIRSItemRef = std::shared_ptr<const LIRSItem>;
+
+enum class LIRSStoreMode { Set, Add, Replace, Append, Prepend };
+enum class LIRSStoreResult { Stored, NotStored, Exists, NotFound };
+
+template <typename Cache = LIRSCache<std::string, LIRSItemRef>>
+class LIRSItemStore {
+public:
+  static constexpr std::size_t kItemOverhead = 96;
+
+  struct Options {
+    std::size_t memory = std::size_t { 64 } << 20;   // bytes
+    std::size_t shards = 16;
+    double hir_ratio = 0.01;
+    std::size_t hot_replicas = 0;   // read replicas of hot keys (LIRSHotKeys), 0 = off
+  };
+
+  struct Stats {
+    std::size_t items;
+    std::size_t bytes;            // charged bytes
+    std::size_t limit;
+    std::uint64_t get_hits;
+    std::uint64_t get_misses;
+    std::uint64_t sets;
+    std::uint64_t touches;
+    std::uint64_t expired;        // expired items found by lookups
+    std::size_t lir_count;        // LIRS state summed over the shards
+    std::size_t ghost_count;
+    std::size_t lirs_stack_size;
+    std::size_t hir_stack_size;
+    std::size_t hot_keys;         // keys with read replicas
+    std::uint64_t replica_hits;
+  };
+
+  LIRSItemStore() : LIRSItemStore(Options {}) {}
+
+  explicit LIRSItemStore(Options options)
+    : cache_(make_cache_options(options)), next_cas_(1), hits_(0), misses_(0), sets_(0), touches_(0), expired_(0) {}
+
+  LIRSItemStore(const LIRSItemStore&) = delete;
+  LIRSItemStore& operator=(const LIRSItemStore&) = delete;
+
+  static std::int64_t now() {
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  }
+
+  LIRSItemRef get(const std::string& key) {
+
+    LIRSItemRef item;
+    this->get_many(&key, 1, &item);
+    return item;
+  }
+
+  // live item without counting a lookup or updating recency (EXISTS, TTL)
+  LIRSItemRef peek(const std::string& key) const {
+
+    std::optional<LIRSItemRef> item = this->cache_.peek(key);
+    if (!item || (*item)->expired(now())) return nullptr;
+    return *item;
+  }
+
+  // live item that is LIR in its shard, without counting a lookup or updating recency:
+  // what a peer node may copy (mg ... P)
+  LIRSItemRef peek_lir(const std::string& key) const {
+
+    std::optional<LIRSItemRef> item = this->cache_.peek_lir(key);
+    if (!item || (*item)->expired(now())) return nullptr;
+    return *item;
+  }
+
+  // items[i] = live item of keys[i] or nullptr; each shard is locked once
+  void get_many(const std::string* keys, std::size_t count, LIRSItemRef* items) {
+
+    std::vector<std::optional<LIRSItemRef>> found(count);
+    this->cache_.get_many(keys, count, found.data());
+
+    std::int64_t time = now();
+    std::uint64_t hits = 0;
+    for (std::size_t i = 0; i < count; i++) {
+
+      items[i] = found[i] ? std::move(*found[i]) : nullptr;
+      if (items[i] != nullptr && items[i]->expired(time)) {
+
+        this->drop_expired(keys[i], items[i]);
+        items[i] = nullptr;
+      }
+      if (items[i] != nullptr) hits++;
+    }
+
+    this->hits_.fetch_add(hits, std::memory_order_relaxed);
+    this->misses_.fetch_add(count - hits, std::memory_order_relaxed);
+    return;
+  }
+
+  // cas != 0 stores only over the version with that cas; stored_cas receives the new cas
+  LIRSStoreResult store(LIRSStoreMode mode, const std::string& key, std::string_view data, std::uint32_t flags,
+                        std::int64_t expires, std::uint64_t cas = 0, std::uint64_t* stored_cas = nullptr) {
+
+    this->sets_.fetch_add(1, std::memory_order_relaxed);
+
+    std::int64_t time = now();
+    LIRSStoreResult result = LIRSStoreResult::Stored;
+
+    this->cache_.compute(key, [&](const LIRSItemRef* resident) -> std::optional<LIRSItemRef> {
+
+      const LIRSItem* current = resident != nullptr && !(*resident)->expired(time) ? resident->get() : nullptr;
+
+      if (cas != 0 && current == nullptr) result = LIRSStoreResult::NotFound;
+      else if (cas != 0 && current->cas != cas) result = LIRSStoreResult::Exists;
+      else if (mode == LIRSStoreMode::Add && current != nullptr) result = LIRSStoreResult::NotStored;
+      else if (mode != LIRSStoreMode::Set && mode != LIRSStoreMode::Add && current == nullptr) result = LIRSStoreResult::NotStored;
+      if (result != LIRSStoreResult::Stored) return std::nullopt;
+
+      std::uint64_t version = this->next_cas_.fetch_add(1, std::memory_order_relaxed);
+      if (stored_cas != nullptr) *stored_cas = version;
+
+      // append / prepend keep the flags and expiry of the item they extend
+      if (mode == LIRSStoreMode::Append || mode == LIRSStoreMode::Prepend) {
+
+        std::string joined = mode == LIRSStoreMode::Append ? current->data + std::string(data) : std::string(data) + current->data;
+        return std::make_shared<const LIRSItem>(std::move(joined), current->flags, version, current->expires.load(std::memory_order_relaxed));
+      }
+      return std::make_shared<const LIRSItem>(std::string(data), flags, version, expires);
+    });
+    return result;
+  }
+
+  // a value fetched from elsewhere (e.g. a peer), inserted as a cold HIR block unless the key
+  // is resident by now; returns the item the store holds, i.e. a newer resident one if any
+  LIRSItemRef store_cold(const std::string& key, std::string_view data, std::uint32_t flags, std::int64_t expires) {
+
+    this->sets_.fetch_add(1, std::memory_order_relaxed);
+
+    std::uint64_t version = this->next_cas_.fetch_add(1, std::memory_order_relaxed);
+    LIRSItemRef item = std::make_shared<const LIRSItem>(std::string(data), flags, version, expires);
+    if (this->cache_.put_cold(key, item)) return item;
+
+    // written locally meanwhile: that value wins over the fetched copy
+    LIRSItemRef resident = this->peek(key);
+    return resident != nullptr ? resident : item;
+  }
+
+  // cas != 0 deletes only the version with that cas: Stored (deleted), NotFound or Exists
+  LIRSStoreResult erase(const std::string& key, std::uint64_t cas = 0) {
+
+    std::int64_t time = now();
+    bool expired = false;
+    bool mismatch = false;
+
+    // an expired item is dropped either way but was not there for the caller
+    bool erased = this->cache_.erase_if(key, [&](const LIRSItemRef& item) {
+
+      expired = item->expired(time);
+      mismatch = !expired && cas != 0 && item->cas != cas;
+      return !mismatch;
+    });
+
+    if (mismatch) return LIRSStoreResult::Exists;
+    return erased && !expired ? LIRSStoreResult::Stored : LIRSStoreResult::NotFound;
+  }
+
+  // new expiry for a live item (counts as an access); false if there is none
+  bool touch(const std::string& key, std::int64_t expires) {
+
+    this->touches_.fetch_add(1, std::memory_order_relaxed);
+
+    std::optional<LIRSItemRef> item = this->cache_.get(key);
+    if (!item || (*item)->expired(now())) return false;
+
+    (*item)->expires.store(expires, std::memory_order_relaxed);
+    return true;
+  }
+
+  Stats stats() const {
+
+    Stats stats {};
+    stats.bytes = this->cache_.charge();
+    stats.limit = this->cache_.capacity();
+    stats.get_hits = this->hits_.load(std::memory_order_relaxed);
+    stats.get_misses = this->misses_.load(std::memory_order_relaxed);
+    stats.sets = this->sets_.load(std::memory_order_relaxed);
+    stats.touches = this->touches_.load(std::memory_order_relaxed);
+    stats.expired = this->expired_.load(std::memory_order_relaxed);
+    if (const auto* hot = this->cache_.hot_keys()) {
+
+      auto hot_stats = hot->stats();
+      stats.hot_keys = hot_stats.hot_keys;
+      stats.replica_hits = hot_stats.replica_hits;
+    }
+
+    for (std::size_t i = 0; i < this->cache_.shard_count(); i++) {
+
+      this->cache_.with_shard(i, [&stats](const Cache& cache) {
+
+        stats.items += cache.size();
+        stats.lir_count += cache.lir_count();
+        stats.ghost_count += cache.ghost_count();
+        stats.lirs_stack_size += cache.lirs_stack_size();
+        stats.hir_stack_size += cache.hir_stack_size();
+      });
+    }
+    return stats;
+  }
+
+  // new memory limit in bytes, e.g. from LIRSMemoryMonitor
+  void resize(std::size_t memory) {
+
+    this->cache_.resize(memory);
+    return;
+  }
+
+  std::size_t capacity() const { return this->cache_.capacity(); }
+
+  LIRSShardedCache<std::string, LIRSItemRef, Cache>& cache() { return this->cache_; }
+  const LIRSShardedCache<std::string, LIRSItemRef, Cache>& cache() const { return this->cache_; }
+
+private:
+  static typename LIRSShardedCache<std::string, LIRSItemRef, Cache>::Options make_cache_options(const Options& options) {
+
+    typename LIRSShardedCache<std::string, LIRSItemRef, Cache>::Options cache_options;
+    cache_options.capacity = options.memory;
+    cache_options.shards = options.shards;
+    cache_options.hir_ratio = options.hir_ratio;
+    cache_options.hot.replicas = options.hot_replicas;
+    cache_options.weigher = [](const std::string& key, const LIRSItemRef& item) { return key.size() + item->data.size() + kItemOverhead; };
+    return cache_options;
+  }
+
+  // erase the expired version only: a concurrent set may have replaced it already
+  void drop_expired(const std::string& key, const LIRSItemRef& item) {
+
+    if (this->cache_.erase_if(key, [&](const LIRSItemRef& resident) { return resident == item; })) {
+
+      this->expired_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return;
+  }
+
+  LIRSShardedCache<std::string, LIRSItemRef, Cache> cache_;
+  std::atomic<std::uint64_t> next_cas_;
+  std::atomic<std::uint64_t> hits_;
+  std::atomic<std::uint64_t> misses_;
+  std::atomic<std::uint64_t> sets_;
+  std::atomic<std::uint64_t> touches_;
+  std::atomic<std::uint64_t> expired_;
+};
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef LIRS_LRU_HPP
+#define LIRS_LRU_HPP
+
+/*
+ * Plain LRU with the LIRSCache interface, for comparisons
+ *
+ *    most recent ──► [ k7 ][ k3 ][ k9 ] ... [ k1 ] ──► evicted first
+ *
+ * Drop-in wherever a LIRSCache<K, V> is a template argument (e.g. the cache
+ * of each LIRSShardedCache shard), so a service can be measured with the
+ * same code under both policies.  hir_ratio is accepted and ignored, and
+ * there are no LIR blocks to demote.
+ */
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+template <typename K, typename V>
+class LIRSLRUCache {
+public:
+  explicit LIRSLRUCache(std::size_t capacity, double hir_ratio = 0.01) : capacity_(capacity) {
+
+    if (capacity == 0) throw std::invalid_argument("Capacity must be greater than 0");
+
+    (void)hir_ratio;
+    return;
+  }
+
+  LIRSLRUCache(const LIRSLRUCache&) = delete;
+  LIRSLRUCache& operator=(const LIRSLRUCache&) = delete;
+
+  std::optional<V> get(const K& key) {
+
+    auto iter = this->map_.find(key);
+    if (iter == this->map_.end()) return std::nullopt;
+
+    this->list_.splice(this->list_.begin(), this->list_, iter->second);
+    return iter->second->second;
+  }
+
+  void put(const K& key, const V& value) {
+
+    auto iter = this->map_.find(key);
+    if (iter != this->map_.end()) {
+
+      iter->second->second = value;
+      this->list_.splice(this->list_.begin(), this->list_, iter->second);
+      return;
+    }
+
+    if (this->list_.size() >= this->capacity_) this->evict_one();
+
+    this->list_.emplace_front(key, value);
+    this->map_.emplace(key, this->list_.begin());
+    return;
+  }
+
+  bool erase(const K& key) {
+
+    auto iter = this->map_.find(key);
+    if (iter == this->map_.end()) return false;
+
+    if (this->on_remove_) this->on_remove_(iter->second->first, iter->second->second);
+    this->list_.erase(iter->second);
+    this->map_.erase(iter);
+    return true;
+  }
+
+  // insert at the cold end (next victim) unless the key is resident; false if it was
+  bool put_cold(const K& key, const V& value) {
+
+    if (this->map_.count(key) != 0) return false;
+    if (this->list_.size() >= this->capacity_) this->evict_one();
+
+    this->list_.emplace_back(key, value);
+    this->map_.emplace(key, std::prev(this->list_.end()));
+    return true;
+  }
+
+  bool contains(const K& key) const { return this->map_.count(key) != 0; }
+
+  // no LIR/HIR split: every resident block qualifies (lir_count() still reports 0)
+  bool is_lir(const K& key) const { return this->contains(key); }
+
+  const V* peek(const K& key) const {
+
+    auto iter = this->map_.find(key);
+    return iter == this->map_.end() ? nullptr : &iter->second->second;
+  }
+
+  // evict the least recently used block; false if empty
+  bool evict_one() {
+
+    if (this->list_.empty()) return false;
+
+    auto& victim = this->list_.back();
+    if (this->on_remove_) this->on_remove_(victim.first, victim.second);
+    this->map_.erase(victim.first);
+    this->list_.pop_back();
+    return true;
+  }
+
+  // no LIR set to demote from
+  bool demote_one() { return false; }
+
+  void resize(std::size_t capacity) {
+
+    if (capacity == 0) throw std::invalid_argument("Capacity must be greater than 0");
+
+    this->capacity_ = capacity;
+    while (this->list_.size() > this->capacity_) this->evict_one();
+    return;
+  }
+
+  void set_removal_listener(std::function<void(const K&, V&)> listener) {
+
+    this->on_remove_ = std::move(listener);
+    return;
+  }
+
+  std::size_t size() const { return this->list_.size(); }
+  std::size_t capacity() const { return this->capacity_; }
+  bool empty() const { return this->list_.empty(); }
+
+  // LIRS state accessors for common monitoring code: no LIR set, ghosts or S, all of it is "Q"
+  std::size_t lir_count() const { return 0; }
+  std::size_t ghost_count() const { return 0; }
+  std::size_t lirs_stack_size() const { return 0; }
+  std::size_t hir_stack_size() const { return this->list_.size(); }
+
+private:
+  using List = std::list<std::pair<K, V>>;
+
+  std::size_t capacity_;
+  List list_;
+  std::unordered_map<K, typename List::iterator> map_;
+  std::function<void(const K&, V&)> on_remove_;
+};
+
+#endif
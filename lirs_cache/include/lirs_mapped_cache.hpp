@@ -0,0 +1,145 @@
+#ifndef LIRS_MAPPED_CACHE_HPP
+#define LIRS_MAPPED_CACHE_HPP
+
+/*
+ * Persistent LIRS cache backed by a memory-mapped file (POSIX)
+ *
+ *    open ──► file exists, matching parameters, clean shutdown?
+ *               yes: map it and serve immediately (pages fault in on demand)
+ *               no : size the file and format an empty image
+ *
+ * The image (lirs_image.hpp) links nodes by index, so a re-mapped file is
+ * usable as-is: no deserialization on restart.  The header records whether
+ * the last owner closed the file cleanly; an image left by a crash may be
+ * mid-update and is reformatted instead of trusted.
+ *
+ * Single-process, not thread-safe (like LIRSCache).
+ */
+
+#include "lirs_image.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <cerrno>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+template <typename K, typename V, typename Hash = std::hash<K>>
+class LIRSMappedCache {
+public:
+  using Image = LIRSImage<K, V, Hash>;
+
+  LIRSMappedCache(const std::string& path, std::size_t capacity, double hir_ratio = 0.01, std::size_t ghost_limit = 0)
+    : fd_(-1), region_(nullptr), size_(Image::region_size(capacity, ghost_limit == 0 ? capacity : ghost_limit))
+    , image_(std::nullopt), restored_(false) {
+
+    this->fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (this->fd_ < 0) throw std::system_error(errno, std::generic_category(), "open " + path);
+
+    try {
+
+      struct stat st;
+      if (::fstat(this->fd_, &st) != 0) throw std::system_error(errno, std::generic_category(), "fstat " + path);
+
+      bool reuse = static_cast<std::size_t>(st.st_size) == this->size_;
+
+      // start from an empty file of the right size unless the image can be reused
+      if (!reuse) {
+
+        if (::ftruncate(this->fd_, 0) != 0 || ::ftruncate(this->fd_, static_cast<off_t>(this->size_)) != 0) {
+
+          throw std::system_error(errno, std::generic_category(), "ftruncate " + path);
+        }
+      }
+
+      void* addr = ::mmap(nullptr, this->size_, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd_, 0);
+      if (addr == MAP_FAILED) throw std::system_error(errno, std::generic_category(), "mmap " + path);
+      this->region_ = addr;
+
+      if (reuse && Image::compatible(addr, this->size_, capacity, hir_ratio, ghost_limit)) {
+
+        this->image_ = Image(addr);
+        this->restored_ = this->image_->user_word() == kClean;
+      }
+
+      if (!this->restored_) this->image_ = Image::format(addr, this->size_, capacity, hir_ratio, ghost_limit);
+
+      // mark in use until close() / destruction
+      this->image_->user_word() = kInUse;
+      ::msync(addr, 4096, MS_SYNC);
+    } catch (...) {
+
+      this->unmap();
+      throw;
+    }
+    return;
+  }
+
+  ~LIRSMappedCache() { this->close(); }
+
+  LIRSMappedCache(const LIRSMappedCache&) = delete;
+  LIRSMappedCache& operator=(const LIRSMappedCache&) = delete;
+
+  std::optional<V> get(const K& key) { return this->image_->get(key); }
+  void put(const K& key, const V& value) { this->image_->put(key, value); }
+  void clear() { this->image_->clear(); }
+
+  std::size_t size() const { return this->image_->size(); }
+  std::size_t capacity() const { return this->image_->capacity(); }
+  bool empty() const { return this->image_->empty(); }
+
+  std::size_t lir_count() const { return this->image_->lir_count(); }
+  std::size_t ghost_count() const { return this->image_->ghost_count(); }
+
+  // true if the contents were inherited from a previous clean shutdown
+  bool restored() const { return this->restored_; }
+
+  // write dirty pages back to the file
+  void flush() {
+
+    if (this->region_ != nullptr && ::msync(this->region_, this->size_, MS_SYNC) != 0) {
+
+      throw std::system_error(errno, std::generic_category(), "msync");
+    }
+    return;
+  }
+
+  // flush, mark the image clean and unmap
+  void close() {
+
+    if (this->region_ == nullptr) return;
+
+    ::msync(this->region_, this->size_, MS_SYNC);
+    this->image_->user_word() = kClean;
+    ::msync(this->region_, this->size_, MS_SYNC);
+    this->unmap();
+    return;
+  }
+
+private:
+  static constexpr std::uint64_t kClean = 0x434C45414EULL;   // "CLEAN"
+  static constexpr std::uint64_t kInUse = 0x494E555345ULL;   // "INUSE"
+
+  void unmap() {
+
+    if (this->region_ != nullptr) ::munmap(this->region_, this->size_);
+    if (this->fd_ >= 0) ::close(this->fd_);
+    this->region_ = nullptr;
+    this->fd_ = -1;
+    this->image_.reset();
+    return;
+  }
+
+  int fd_;
+  void* region_;
+  std::size_t size_;
+  std::optional<Image> image_;
+  bool restored_;
+};
+
+#endif
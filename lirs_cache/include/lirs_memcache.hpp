@@ -0,0 +1,661 @@
+#ifndef LIRS_MEMCACHE_HPP
+#define LIRS_MEMCACHE_HPP
+
+/*
+ * memcached text and meta protocol over a LIRSItemStore
+ *
+ *    bytes in ──► feed() ──► complete commands ──► replies appended to out
+ *                                                   (values referenced, not copied)
+ *
+ *    text : get / gets <key>*          set / add / replace / append / prepend / cas
+ *           delete  touch  stats  version  verbosity  quit
+ *    meta : mg <key> <flags>*          ms <key> <datalen> <flags>*
+ *           md <key> <flags>*          mn
+ *
+ * Pipelining: consecutive retrievals (get, gets, mg) are collected into
+ * one batch and looked up together with LIRSItemStore::get_many(), which
+ * takes each shard's lock once; any other command flushes the batch first,
+ * so replies keep request order.  feed() returns how many bytes it used;
+ * an incomplete command stays in the caller's buffer for the next call.
+ *
+ * Meta flags: mg  v f c t s k O<opaque> q T<ttl> P
+ *             ms  F<flags> T<ttl> C<cas> M<mode: S E A P R> c k O q I
+ *             md  C<cas> k O q
+ *
+ * mg with P is a peer lookup (LIRSPeerCache): it hits only on items that
+ * are LIR here and leaves their recency alone, so peers copy what is
+ * settled and their reads do not promote blocks on this node.
+ *
+ * One session per connection; not thread-safe (the store is).
+ */
+
+#include "lirs_item_store.hpp"
+#include "lirs_reply.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <vector>
+
+template <typename Store>
+class LIRSMemcacheSession {
+public:
+  struct Options {
+    std::size_t item_limit = std::size_t { 1 } << 20;   // largest value accepted
+    std::size_t line_limit = 64 * 1024;                 // longest command line (multi-get)
+  };
+
+  static constexpr std::size_t kKeyLimit = 250;
+
+  explicit LIRSMemcacheSession(Store& store) : LIRSMemcacheSession(store, Options {}) {}
+
+  LIRSMemcacheSession(Store& store, Options options)
+    : store_(store), options_(options), closing_(false), swallow_(0), key_count_(0) {}
+
+  // consume complete commands from data and append their replies to out; returns bytes used
+  std::size_t feed(const char* data, std::size_t size, LIRSReplyBuffer& out) {
+
+    std::size_t pos = 0;
+    while (!this->closing_) {
+
+      // rest of a value that was refused
+      if (this->swallow_ > 0) {
+
+        std::size_t skip = std::min(this->swallow_, size - pos);
+        pos += skip;
+        this->swallow_ -= skip;
+        if (this->swallow_ > 0) break;
+        continue;
+      }
+
+      const char* newline = static_cast<const char*>(std::memchr(data + pos, '\n', size - pos));
+      if (newline == nullptr) {
+
+        if (size - pos > this->options_.line_limit) {
+
+          this->flush(out);
+          out += "CLIENT_ERROR line too long\r\n";
+          this->closing_ = true;
+          pos = size;
+        }
+        break;
+      }
+
+      std::size_t end = static_cast<std::size_t>(newline - data);
+      std::string_view line(data + pos, end - pos);
+      if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+      // storage commands also need their data block
+      std::size_t used = this->command(line, data + end + 1, size - end - 1, out);
+      if (used == kIncomplete) break;
+      pos = end + 1 + used;
+    }
+
+    this->flush(out);
+    return pos;
+  }
+
+  // quit was received or the stream is unusable: close after the replies are sent
+  bool closing() const { return this->closing_; }
+
+private:
+  static constexpr std::size_t kIncomplete = static_cast<std::size_t>(-1);
+  static constexpr std::int64_t kRelativeLimit = 60 * 60 * 24 * 30;   // larger exptimes are unix times
+
+  enum class Kind { Get, Gets, Meta };
+
+  // a retrieval command waiting in the batch
+  struct Retrieval {
+    Kind kind;
+    std::size_t first;         // its keys in keys_
+    std::size_t count;
+    std::string_view flags;    // mg flags, valid until the end of feed()
+  };
+
+  static bool is(std::string_view token, const char* name) { return token == name; }
+
+  template <typename T>
+  static bool number(std::string_view token, T& value) {
+
+    auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+    return result.ec == std::errc() && result.ptr == token.data() + token.size() && !token.empty();
+  }
+
+  static bool valid_key(std::string_view key) { return !key.empty() && key.size() <= kKeyLimit; }
+
+  template <typename T>
+  static void append_number(LIRSReplyBuffer& out, T value) {
+
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, static_cast<std::size_t>(result.ptr - buffer));
+    return;
+  }
+
+  // memcached exptime: 0 never, negative already expired, up to 30 days relative, else unix seconds
+  static std::int64_t expires_at(std::int64_t exptime) {
+
+    if (exptime == 0) return 0;
+    if (exptime < 0) return 1;
+    if (exptime <= kRelativeLimit) return Store::now() + exptime * 1000;
+    return exptime * 1000;
+  }
+
+  void split(std::string_view line) {
+
+    this->tokens_.clear();
+    std::size_t pos = 0;
+    while (pos < line.size()) {
+
+      while (pos < line.size() && line[pos] == ' ') pos++;
+      std::size_t start = pos;
+      while (pos < line.size() && line[pos] != ' ') pos++;
+      if (pos > start) this->tokens_.push_back(line.substr(start, pos - start));
+    }
+    return;
+  }
+
+  // one command line; returns the bytes used after it, or kIncomplete
+  std::size_t command(std::string_view line, const char* rest, std::size_t available, LIRSReplyBuffer& out) {
+
+    this->split(line);
+    if (this->tokens_.empty()) {
+
+      this->flush(out);
+      out += "ERROR\r\n";
+      return 0;
+    }
+
+    std::string_view name = this->tokens_[0];
+    if (is(name, "get") || is(name, "gets")) {
+
+      this->retrieval(is(name, "get") ? Kind::Get : Kind::Gets, out);
+      return 0;
+    }
+    if (is(name, "mg")) {
+
+      this->meta_get(line, out);
+      return 0;
+    }
+
+    this->flush(out);
+
+    if (is(name, "set")) return this->storage(LIRSStoreMode::Set, false, rest, available, out);
+    if (is(name, "add")) return this->storage(LIRSStoreMode::Add, false, rest, available, out);
+    if (is(name, "replace")) return this->storage(LIRSStoreMode::Replace, false, rest, available, out);
+    if (is(name, "append")) return this->storage(LIRSStoreMode::Append, false, rest, available, out);
+    if (is(name, "prepend")) return this->storage(LIRSStoreMode::Prepend, false, rest, available, out);
+    if (is(name, "cas")) return this->storage(LIRSStoreMode::Set, true, rest, available, out);
+    if (is(name, "ms")) return this->meta_set(rest, available, out);
+
+    if (is(name, "delete")) this->remove(out);
+    else if (is(name, "touch")) this->touch(out);
+    else if (is(name, "md")) this->meta_delete(out);
+    else if (is(name, "mn")) out += "MN\r\n";
+    else if (is(name, "stats") && this->tokens_.size() == 1) this->stats(out);
+    else if (is(name, "version")) out += "VERSION 1.6.0-lirs\r\n";
+    else if (is(name, "verbosity")) out += "OK\r\n";
+    else if (is(name, "quit")) this->closing_ = true;
+    else out += "ERROR\r\n";
+    return 0;
+  }
+
+  void add_key(std::string_view key) {
+
+    if (this->key_count_ == this->keys_.size()) this->keys_.emplace_back();
+    this->keys_[this->key_count_++].assign(key);
+    return;
+  }
+
+  // get / gets <key>*
+  void retrieval(Kind kind, LIRSReplyBuffer& out) {
+
+    if (this->tokens_.size() < 2) {
+
+      this->flush(out);
+      out += "ERROR\r\n";
+      return;
+    }
+    for (std::size_t i = 1; i < this->tokens_.size(); i++) {
+
+      if (valid_key(this->tokens_[i])) continue;
+
+      this->flush(out);
+      out += "CLIENT_ERROR bad command line format\r\n";
+      return;
+    }
+
+    Retrieval retrieval { kind, this->key_count_, this->tokens_.size() - 1, std::string_view() };
+    for (std::size_t i = 1; i < this->tokens_.size(); i++) this->add_key(this->tokens_[i]);
+    this->batch_.push_back(retrieval);
+    return;
+  }
+
+  // mg <key> <flags>*
+  void meta_get(std::string_view line, LIRSReplyBuffer& out) {
+
+    bool valid = this->tokens_.size() >= 2 && valid_key(this->tokens_[1]);
+    bool peer = false;
+    for (std::size_t i = 2; valid && i < this->tokens_.size(); i++) {
+
+      std::string_view flag = this->tokens_[i];
+      std::int64_t ttl;
+      if (flag == "P") peer = true;
+      else if (std::strchr("vfctskqO", flag[0]) != nullptr) valid = flag.size() == 1 || flag[0] == 'O';
+      else if (flag[0] == 'T') valid = number(flag.substr(1), ttl);
+      else valid = false;
+    }
+    if (!valid) {
+
+      this->flush(out);
+      out += "CLIENT_ERROR bad command line format\r\n";
+      return;
+    }
+
+    // flags start after the key; the views stay valid until feed() returns
+    std::string_view key = this->tokens_[1];
+    std::size_t flags_at = static_cast<std::size_t>(key.data() + key.size() - line.data());
+
+    // peer lookups bypass the batch: get_many() would update recency
+    if (peer) {
+
+      this->flush(out);
+      std::string name(key);
+      this->render_meta(name, this->store_.peek_lir(name), line.substr(flags_at), out);
+      return;
+    }
+    this->batch_.push_back(Retrieval { Kind::Meta, this->key_count_, 1, line.substr(flags_at) });
+    this->add_key(key);
+    return;
+  }
+
+  // look up every batched key at once, then reply in request order
+  void flush(LIRSReplyBuffer& out) {
+
+    if (this->batch_.empty()) return;
+
+    if (this->items_.size() < this->key_count_) this->items_.resize(this->key_count_);
+    this->store_.get_many(this->keys_.data(), this->key_count_, this->items_.data());
+
+    for (const Retrieval& retrieval : this->batch_) {
+
+      if (retrieval.kind == Kind::Meta) {
+
+        this->render_meta(this->keys_[retrieval.first], this->items_[retrieval.first], retrieval.flags, out);
+        continue;
+      }
+
+      for (std::size_t i = retrieval.first; i < retrieval.first + retrieval.count; i++) {
+
+        const LIRSItemRef& item = this->items_[i];
+        if (item == nullptr) continue;
+
+        out += "VALUE ";
+        out += this->keys_[i];
+        out += ' ';
+        append_number(out, item->flags);
+        out += ' ';
+        append_number(out, item->data.size());
+        if (retrieval.kind == Kind::Gets) {
+
+          out += ' ';
+          append_number(out, item->cas);
+        }
+        out += "\r\n";
+        out.reference(item->data, item);
+        out += "\r\n";
+      }
+      out += "END\r\n";
+    }
+
+    for (std::size_t i = 0; i < this->key_count_; i++) this->items_[i] = nullptr;
+    this->batch_.clear();
+    this->key_count_ = 0;
+    return;
+  }
+
+  void render_meta(const std::string& key, const LIRSItemRef& item, std::string_view flags, LIRSReplyBuffer& out) {
+
+    this->split_flags(flags);
+
+    bool value = false;
+    bool quiet = false;
+    for (std::string_view flag : this->flags_) {
+
+      if (flag[0] == 'v') value = true;
+      if (flag[0] == 'q') quiet = true;
+    }
+
+    if (item == nullptr) {
+
+      if (!quiet) out += "EN\r\n";
+      return;
+    }
+
+    for (std::string_view flag : this->flags_) {
+
+      std::int64_t ttl;
+      if (flag[0] == 'T' && number(flag.substr(1), ttl)) this->store_.touch(key, expires_at(ttl));
+    }
+
+    if (value) {
+
+      out += "VA ";
+      append_number(out, item->data.size());
+    } else {
+      out += "HD";
+    }
+
+    for (std::string_view flag : this->flags_) {
+
+      switch (flag[0]) {
+        case 'f': out += " f"; append_number(out, item->flags); break;
+        case 'c': out += " c"; append_number(out, item->cas); break;
+        case 's': out += " s"; append_number(out, item->data.size()); break;
+        case 'k': out += " k"; out += key; break;
+        case 'O': out += ' '; out += flag; break;
+        case 't': {
+          std::int64_t expires = item->expires.load(std::memory_order_relaxed);
+          out += " t";
+          if (expires == 0) out += "-1";
+          else append_number(out, std::max<std::int64_t>(0, (expires - Store::now() + 999) / 1000));
+          break;
+        }
+        default: break;
+      }
+    }
+    out += "\r\n";
+
+    if (value) {
+
+      out.reference(item->data, item);
+      out += "\r\n";
+    }
+    return;
+  }
+
+  void split_flags(std::string_view flags) {
+
+    this->flags_.clear();
+    std::size_t pos = 0;
+    while (pos < flags.size()) {
+
+      while (pos < flags.size() && flags[pos] == ' ') pos++;
+      std::size_t start = pos;
+      while (pos < flags.size() && flags[pos] != ' ') pos++;
+      if (pos > start) this->flags_.push_back(flags.substr(start, pos - start));
+    }
+    return;
+  }
+
+  // checks the data block after a storage command line: bytes + 2 used, or kIncomplete
+  std::size_t data_block(std::size_t bytes, const char* rest, std::size_t available, bool& bad) {
+
+    if (available < bytes + 2) return kIncomplete;
+
+    bad = rest[bytes] != '\r' || rest[bytes + 1] != '\n';
+    return bytes + 2;
+  }
+
+  // set / add / replace / append / prepend <key> <flags> <exptime> <bytes> [noreply]
+  // cas <key> <flags> <exptime> <bytes> <cas> [noreply]
+  std::size_t storage(LIRSStoreMode mode, bool with_cas, const char* rest, std::size_t available, LIRSReplyBuffer& out) {
+
+    std::size_t fields = with_cas ? 6 : 5;
+    std::uint32_t flags = 0;
+    std::int64_t exptime = 0;
+    std::size_t bytes = 0;
+    std::uint64_t cas = 0;
+
+    bool noreply = this->tokens_.size() == fields + 1 && is(this->tokens_[fields], "noreply");
+    bool valid = (this->tokens_.size() == fields || noreply) && valid_key(this->tokens_[1])
+        && number(this->tokens_[2], flags) && number(this->tokens_[3], exptime) && number(this->tokens_[4], bytes)
+        && (!with_cas || number(this->tokens_[5], cas));
+
+    if (!valid) {
+
+      out += "CLIENT_ERROR bad command line format\r\n";
+      return 0;
+    }
+    if (bytes > this->options_.item_limit) {
+
+      out += "SERVER_ERROR object too large for cache\r\n";
+      this->swallow_ = bytes + 2;
+      return 0;
+    }
+
+    bool bad = false;
+    std::size_t used = this->data_block(bytes, rest, available, bad);
+    if (used == kIncomplete) return kIncomplete;
+    if (bad) {
+
+      out += "CLIENT_ERROR bad data chunk\r\n";
+      return used;
+    }
+
+    // cas 0 is "no cas" to the store; no item ever has it
+    LIRSStoreResult result = with_cas && cas == 0 ? LIRSStoreResult::Exists
+        : this->store_.store(mode, std::string(this->tokens_[1]), std::string_view(rest, bytes), flags, expires_at(exptime), cas);
+    if (noreply) return used;
+
+    switch (result) {
+      case LIRSStoreResult::Stored: out += "STORED\r\n"; break;
+      case LIRSStoreResult::NotStored: out += "NOT_STORED\r\n"; break;
+      case LIRSStoreResult::Exists: out += "EXISTS\r\n"; break;
+      case LIRSStoreResult::NotFound: out += "NOT_FOUND\r\n"; break;
+    }
+    return used;
+  }
+
+  // ms <key> <datalen> <flags>*
+  std::size_t meta_set(const char* rest, std::size_t available, LIRSReplyBuffer& out) {
+
+    std::size_t bytes = 0;
+    if (this->tokens_.size() < 3 || !valid_key(this->tokens_[1]) || !number(this->tokens_[2], bytes)) {
+
+      out += "CLIENT_ERROR bad command line format\r\n";
+      return 0;
+    }
+
+    LIRSStoreMode mode = LIRSStoreMode::Set;
+    std::uint32_t flags = 0;
+    std::int64_t ttl = 0;
+    std::uint64_t cas = 0;
+    bool quiet = false;
+    bool valid = true;
+
+    for (std::size_t i = 3; valid && i < this->tokens_.size(); i++) {
+
+      std::string_view flag = this->tokens_[i];
+      std::string_view arg = flag.substr(1);
+      switch (flag[0]) {
+        case 'F': valid = number(arg, flags); break;
+        case 'T': valid = number(arg, ttl); break;
+        case 'C': valid = number(arg, cas); break;
+        case 'q': quiet = true; break;
+        case 'c': case 'k': case 'O': case 'I': break;
+        case 'M':
+          valid = arg.size() == 1;
+          if (!valid) break;
+          switch (arg[0]) {
+            case 'S': case 's': mode = LIRSStoreMode::Set; break;
+            case 'E': case 'e': mode = LIRSStoreMode::Add; break;
+            case 'A': case 'a': mode = LIRSStoreMode::Append; break;
+            case 'P': case 'p': mode = LIRSStoreMode::Prepend; break;
+            case 'R': case 'r': mode = LIRSStoreMode::Replace; break;
+            default: valid = false; break;
+          }
+          break;
+        default: valid = false; break;
+      }
+    }
+
+    if (!valid || bytes > this->options_.item_limit) {
+
+      out += valid ? "SERVER_ERROR object too large for cache\r\n" : "CLIENT_ERROR bad command line format\r\n";
+      this->swallow_ = bytes + 2;
+      return 0;
+    }
+
+    bool bad = false;
+    std::size_t used = this->data_block(bytes, rest, available, bad);
+    if (used == kIncomplete) return kIncomplete;
+    if (bad) {
+
+      out += "CLIENT_ERROR bad data chunk\r\n";
+      return used;
+    }
+
+    std::uint64_t stored_cas = 0;
+    LIRSStoreResult result = this->store_.store(mode, std::string(this->tokens_[1]), std::string_view(rest, bytes), flags,
+                                                expires_at(ttl), cas, &stored_cas);
+    if (quiet && result == LIRSStoreResult::Stored) return used;
+
+    switch (result) {
+      case LIRSStoreResult::Stored: out += "HD"; break;
+      case LIRSStoreResult::NotStored: out += "NS"; break;
+      case LIRSStoreResult::Exists: out += "EX"; break;
+      case LIRSStoreResult::NotFound: out += "NF"; break;
+    }
+    this->meta_return(3, stored_cas, out);
+    out += "\r\n";
+    return used;
+  }
+
+  // md <key> <flags>*
+  void meta_delete(LIRSReplyBuffer& out) {
+
+    std::uint64_t cas = 0;
+    bool quiet = false;
+    bool valid = this->tokens_.size() >= 2 && valid_key(this->tokens_[1]);
+
+    for (std::size_t i = 2; valid && i < this->tokens_.size(); i++) {
+
+      std::string_view flag = this->tokens_[i];
+      if (flag[0] == 'C') valid = number(flag.substr(1), cas);
+      else if (flag[0] == 'q') quiet = true;
+      else valid = flag[0] == 'k' || flag[0] == 'O';
+    }
+    if (!valid) {
+
+      out += "CLIENT_ERROR bad command line format\r\n";
+      return;
+    }
+
+    LIRSStoreResult result = this->store_.erase(std::string(this->tokens_[1]), cas);
+    if (quiet && result == LIRSStoreResult::Stored) return;
+
+    out += result == LIRSStoreResult::Stored ? "HD" : result == LIRSStoreResult::Exists ? "EX" : "NF";
+    this->meta_return(2, 0, out);
+    out += "\r\n";
+    return;
+  }
+
+  // echo k, O and c (cas of a stored item) from the flags starting at token first
+  void meta_return(std::size_t first, std::uint64_t cas, LIRSReplyBuffer& out) {
+
+    for (std::size_t i = first; i < this->tokens_.size(); i++) {
+
+      std::string_view flag = this->tokens_[i];
+      if (flag[0] == 'k') {
+
+        out += " k";
+        out += this->tokens_[1];
+      } else if (flag[0] == 'O') {
+
+        out += ' ';
+        out += flag;
+      } else if (flag[0] == 'c' && cas != 0) {
+
+        out += " c";
+        append_number(out, cas);
+      }
+    }
+    return;
+  }
+
+  // delete <key> [0] [noreply]
+  void remove(LIRSReplyBuffer& out) {
+
+    std::size_t size = this->tokens_.size();
+    bool noreply = size > 2 && is(this->tokens_[size - 1], "noreply");
+    std::size_t fields = size - (noreply ? 1 : 0);
+
+    if (fields < 2 || fields > 3 || !valid_key(this->tokens_[1]) || (fields == 3 && !is(this->tokens_[2], "0"))) {
+
+      out += "CLIENT_ERROR bad command line format\r\n";
+      return;
+    }
+
+    LIRSStoreResult result = this->store_.erase(std::string(this->tokens_[1]));
+    if (!noreply) out += result == LIRSStoreResult::Stored ? "DELETED\r\n" : "NOT_FOUND\r\n";
+    return;
+  }
+
+  // touch <key> <exptime> [noreply]
+  void touch(LIRSReplyBuffer& out) {
+
+    std::int64_t exptime = 0;
+    bool noreply = this->tokens_.size() == 4 && is(this->tokens_[3], "noreply");
+
+    if ((this->tokens_.size() != 3 && !noreply) || !valid_key(this->tokens_[1]) || !number(this->tokens_[2], exptime)) {
+
+      out += "CLIENT_ERROR bad command line format\r\n";
+      return;
+    }
+
+    bool touched = this->store_.touch(std::string(this->tokens_[1]), expires_at(exptime));
+    if (!noreply) out += touched ? "TOUCHED\r\n" : "NOT_FOUND\r\n";
+    return;
+  }
+
+  void stats(LIRSReplyBuffer& out) {
+
+    auto stats = this->store_.stats();
+    auto line = [&out](const char* name, std::uint64_t value) {
+
+      out += "STAT ";
+      out += name;
+      out += ' ';
+      append_number(out, value);
+      out += "\r\n";
+    };
+
+    line("curr_items", stats.items);
+    line("bytes", stats.bytes);
+    line("limit_maxbytes", stats.limit);
+    line("cmd_get", stats.get_hits + stats.get_misses);
+    line("get_hits", stats.get_hits);
+    line("get_misses", stats.get_misses);
+    line("get_expired", stats.expired);
+    line("cmd_set", stats.sets);
+    line("cmd_touch", stats.touches);
+    line("lir_count", stats.lir_count);
+    line("ghost_count", stats.ghost_count);
+    line("lirs_stack_size", stats.lirs_stack_size);
+    line("hir_stack_size", stats.hir_stack_size);
+    line("hot_keys", stats.hot_keys);
+    line("hot_replica_hits", stats.replica_hits);
+    out += "END\r\n";
+    return;
+  }
+
+  Store& store_;
+  Options options_;
+  bool closing_;
+  std::size_t swallow_;   // bytes of a refused value still to skip
+
+  std::vector<std::string_view> tokens_;
+  std::vector<std::string_view> flags_;
+
+  // pending retrieval batch
+  std::vector<Retrieval> batch_;
+  std::vector<std::string> keys_;   // reused; the first key_count_ are live
+  std::size_t key_count_;
+  std::vector<LIRSItemRef> items_;
+};
+
+#endif
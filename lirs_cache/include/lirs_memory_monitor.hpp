@@ -0,0 +1,294 @@
+#ifndef LIRS_MEMORY_MONITOR_HPP
+#define LIRS_MEMORY_MONITOR_HPP
+
+/*
+ * Memory-pressure driven cache sizing (Linux PSI / cgroup)
+ *
+ *    every interval:
+ *      PSI "some" avg10  > shrink_psi    ┐
+ *      or usage / limit  > shrink_usage  ┘──► capacity -= step (not below floor)
+ *
+ *      PSI "some" avg10  < grow_psi      ┐
+ *      and usage / limit < grow_usage    ┘──► capacity += step (up to full size)
+ *
+ *      otherwise hold (the gap between the two thresholds is the hysteresis)
+ *
+ * Sources: the cgroup of this process (v2 memory.current / memory.max /
+ * memory.pressure, or v1 memory.usage_in_bytes / memory.limit_in_bytes) and
+ * /proc/pressure/memory.  A source that cannot be read is ignored.
+ *
+ * Each registered cache shrinks through its own resize(), i.e. by evicting
+ * HIR blocks from Q and demoting LIR blocks, step by step, so the cache acts
+ * as an elastic consumer that gives memory back before the OOM killer has
+ * to.  After a shrink, free heap is returned to the OS (malloc_trim, glibc).
+ *
+ * poll() runs one step; start() runs it on a background thread.
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+struct LIRSMemoryPressure {
+  double psi_some = -1.0;      // PSI "some" avg10 in percent, -1 if unavailable
+  std::uint64_t usage = 0;     // cgroup bytes in use
+  std::uint64_t limit = 0;     // cgroup limit, 0 if none or unavailable
+
+  double usage_ratio() const { return this->limit == 0 ? -1.0 : static_cast<double>(this->usage) / static_cast<double>(this->limit); }
+};
+
+class LIRSMemoryMonitor {
+public:
+  struct Options {
+    double shrink_usage = 0.90;   // shrink above this cgroup usage / limit
+    double grow_usage = 0.80;     // grow again below this
+    double shrink_psi = 10.0;     // shrink above this PSI "some" avg10 (percent)
+    double grow_psi = 1.0;        // grow again below this
+    double step = 0.05;           // fraction of a cache's full capacity per step
+    std::chrono::milliseconds interval { 1000 };
+    std::string cgroup_path;      // cgroup directory, empty = this process's memory cgroup
+    std::string psi_path;         // PSI file, empty = cgroup memory.pressure, then /proc/pressure/memory
+  };
+
+  LIRSMemoryMonitor() : LIRSMemoryMonitor(Options {}) {}
+
+  explicit LIRSMemoryMonitor(Options options) : options_(std::move(options)), cgroup_v2_(false), running_(false) {
+
+    if (this->options_.cgroup_path.empty()) this->options_.cgroup_path = own_cgroup();
+    this->cgroup_v2_ = readable(this->options_.cgroup_path + "/memory.current");
+
+    if (this->options_.psi_path.empty()) {
+
+      std::string cgroup_psi = this->options_.cgroup_path + "/memory.pressure";
+      this->options_.psi_path = this->cgroup_v2_ && readable(cgroup_psi) ? cgroup_psi : "/proc/pressure/memory";
+    }
+    return;
+  }
+
+  ~LIRSMemoryMonitor() { this->stop(); }
+
+  LIRSMemoryMonitor(const LIRSMemoryMonitor&) = delete;
+  LIRSMemoryMonitor& operator=(const LIRSMemoryMonitor&) = delete;
+
+  // register an elastic consumer of up to full blocks; resize(capacity) must be safe
+  // to call from the monitor thread (take the cache's lock in it)
+  void add(std::size_t full, std::size_t floor, std::function<void(std::size_t)> resize) {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->consumers_.push_back(Consumer { full, std::min(std::max<std::size_t>(1, floor), full), full, std::move(resize) });
+    return;
+  }
+
+  // a cache with capacity()/resize() guarded by mutex, shrinking to no less than floor blocks
+  template <typename Cache, typename Mutex>
+  void add(Cache& cache, Mutex& mutex, std::size_t floor) {
+
+    std::size_t full;
+    {
+      std::lock_guard<Mutex> lock(mutex);
+      full = cache.capacity();
+    }
+
+    this->add(full, floor, [&cache, &mutex](std::size_t capacity) {
+
+      std::lock_guard<Mutex> lock(mutex);
+      cache.resize(capacity);
+    });
+    return;
+  }
+
+  LIRSMemoryPressure read() const {
+
+    LIRSMemoryPressure pressure;
+    pressure.psi_some = read_psi(this->options_.psi_path);
+
+    const std::string& dir = this->options_.cgroup_path;
+    if (this->cgroup_v2_) {
+
+      pressure.usage = read_bytes(dir + "/memory.current");
+      pressure.limit = read_bytes(dir + "/memory.max");
+    } else if (!dir.empty()) {
+
+      pressure.usage = read_bytes(dir + "/memory.usage_in_bytes");
+      pressure.limit = read_bytes(dir + "/memory.limit_in_bytes");
+    }
+    if (pressure.limit >= kNoLimit) pressure.limit = 0;
+    return pressure;
+  }
+
+  // one step: -1 shrank, 1 grew, 0 held
+  int poll() {
+
+    LIRSMemoryPressure pressure = this->read();
+    double psi = pressure.psi_some;
+    double ratio = pressure.usage_ratio();
+
+    bool pressured = (psi >= 0.0 && psi > this->options_.shrink_psi) || (ratio >= 0.0 && ratio > this->options_.shrink_usage);
+    bool relaxed = (psi < 0.0 || psi < this->options_.grow_psi) && (ratio < 0.0 || ratio < this->options_.grow_usage);
+    if (!pressured && !relaxed) return 0;
+
+    bool changed = false;
+    {
+      std::lock_guard<std::mutex> lock(this->mutex_);
+      for (Consumer& consumer : this->consumers_) {
+
+        std::size_t step = std::max<std::size_t>(1, static_cast<std::size_t>(consumer.full * this->options_.step));
+        std::size_t target = pressured ? std::max(consumer.floor, consumer.current > step ? consumer.current - step : 0)
+                                       : std::min(consumer.full, consumer.current + step);
+        if (target == consumer.current) continue;
+
+        consumer.resize(target);
+        consumer.current = target;
+        changed = true;
+      }
+    }
+    if (!changed) return 0;
+
+#if defined(__GLIBC__)
+    if (pressured) ::malloc_trim(0);
+#endif
+    return pressured ? -1 : 1;
+  }
+
+  // current capacity of each consumer, in registration order
+  std::vector<std::size_t> capacities() const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+
+    std::vector<std::size_t> capacities;
+    for (const Consumer& consumer : this->consumers_) capacities.push_back(consumer.current);
+    return capacities;
+  }
+
+  const std::string& cgroup_path() const { return this->options_.cgroup_path; }
+  const std::string& psi_path() const { return this->options_.psi_path; }
+
+  // poll every interval on a background thread
+  void start() {
+
+    std::lock_guard<std::mutex> lock(this->thread_mutex_);
+    if (this->running_) return;
+
+    this->running_ = true;
+    this->thread_ = std::thread([this] {
+
+      std::unique_lock<std::mutex> lock(this->thread_mutex_);
+      while (this->running_) {
+
+        lock.unlock();
+        this->poll();
+        lock.lock();
+        this->wake_.wait_for(lock, this->options_.interval, [this] { return !this->running_; });
+      }
+    });
+    return;
+  }
+
+  void stop() {
+
+    {
+      std::lock_guard<std::mutex> lock(this->thread_mutex_);
+      if (!this->running_) return;
+      this->running_ = false;
+    }
+    this->wake_.notify_all();
+    this->thread_.join();
+    return;
+  }
+
+private:
+  static constexpr std::uint64_t kNoLimit = std::uint64_t { 1 } << 62;   // cgroup v1 "unlimited"
+
+  struct Consumer {
+    std::size_t full;
+    std::size_t floor;
+    std::size_t current;
+    std::function<void(std::size_t)> resize;
+  };
+
+  static bool readable(const std::string& path) { return std::ifstream(path).good(); }
+
+  // "max" (v2 unlimited) and unreadable files read as 0
+  static std::uint64_t read_bytes(const std::string& path) {
+
+    std::ifstream in(path);
+    std::string text;
+    if (!(in >> text) || text == "max") return 0;
+    return std::strtoull(text.c_str(), nullptr, 10);
+  }
+
+  // "some avg10=1.23 avg60=... total=..."
+  static double read_psi(const std::string& path) {
+
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+
+      if (line.compare(0, 5, "some ") != 0) continue;
+
+      std::size_t at = line.find("avg10=");
+      if (at != std::string::npos) return std::strtod(line.c_str() + at + 6, nullptr);
+    }
+    return -1.0;
+  }
+
+  // memory cgroup directory of this process: v2 unified entry, else the v1 memory controller
+  static std::string own_cgroup() {
+
+    std::ifstream in("/proc/self/cgroup");
+    std::string line;
+    std::string v2;
+    std::string v1;
+
+    while (std::getline(in, line)) {
+
+      // hierarchy-id:controllers:path
+      std::size_t first = line.find(':');
+      std::size_t second = first == std::string::npos ? std::string::npos : line.find(':', first + 1);
+      if (second == std::string::npos) continue;
+
+      std::string controllers = line.substr(first + 1, second - first - 1);
+      std::string path = line.substr(second + 1);
+      if (path == "/") path.clear();
+
+      if (line.compare(0, first, "0") == 0 && controllers.empty()) v2 = "/sys/fs/cgroup" + path;
+
+      std::stringstream list(controllers);
+      for (std::string controller; std::getline(list, controller, ',');) {
+
+        if (controller == "memory") v1 = "/sys/fs/cgroup/memory" + path;
+      }
+    }
+
+    if (!v2.empty() && readable(v2 + "/memory.current")) return v2;
+    return v1;
+  }
+
+  Options options_;
+  bool cgroup_v2_;
+
+  mutable std::mutex mutex_;
+  std::vector<Consumer> consumers_;
+
+  std::mutex thread_mutex_;
+  std::condition_variable wake_;
+  bool running_;
+  std::thread thread_;
+};
+
+#endif
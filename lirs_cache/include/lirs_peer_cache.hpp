@@ -0,0 +1,205 @@
+#ifndef LIRS_PEER_CACHE_HPP
+#define LIRS_PEER_CACHE_HPP
+
+/*
+ * Cooperative caching: ask a peer node before going to the backend
+ *
+ *    get(key) ──► local LIRSItemStore ── hit ──► item
+ *                   │ miss (or ghost)
+ *                   ▼
+ *                 home node of key (LIRSHashRing over all nodes)
+ *                   ├─ this node ───────────────────────► nullptr: load from the backend
+ *                   └─ peer: "mg key v f t P" ── LIR there ──► store_cold() here ──► item
+ *                       │ no answer after hedge_after_ms
+ *                       └─► same request to the next live probe; first hit wins
+ *
+ * Every node runs a LIRSServer with LIRSMemcacheSession over its own store,
+ * so peers can read it, and a LIRSPeerCache over the same store for its own
+ * lookups.  All nodes list the group in the same order.
+ *
+ * A peer answers P lookups only from blocks that are LIR in its cache, and
+ * without touching their recency: a HIR copy is about to be evicted anyway,
+ * and remote reads must not promote blocks the peer's own clients do not
+ * use.  The fetched value comes in as a cold HIR block; after a ghost hit it
+ * keeps the ghost's place in S, so the next local reference makes it LIR.
+ *
+ * timeout_ms bounds every peer lookup; a miss after that is no worse than
+ * having no peers.  Thread-safe.
+ *
+ * LIRSPeerStore gives the store's interface with lookups going through the
+ * peer cache, so a LIRSMemcacheSession over it (lirs_server --peers) serves
+ * its clients' misses from peers.  Those lookups run on the reactor thread:
+ * keep timeout_ms to a few milliseconds.
+ */
+
+#include "lirs_client.hpp"
+#include "lirs_item_store.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+template <typename Store = LIRSItemStore<>>
+class LIRSPeerCache {
+public:
+  struct Options {
+    std::vector<std::string> nodes;   // the whole group, "host:port", in the same order on every node
+    std::size_t self = 0;             // index of this node in nodes
+    LIRSHashRing::Options ring;
+    int timeout_ms = 20;              // longest peer lookup
+    int hedge_after_ms = 2;           // ask a second peer when the first is this late, 0 = never
+    int retry_after_ms = 1000;        // skip a failed peer this long
+  };
+
+  struct Stats {
+    std::uint64_t local_hits;
+    std::uint64_t peer_hits;
+    std::uint64_t misses;         // neither here nor at a peer
+    std::uint64_t hedges;         // lookups that went to a second peer
+  };
+
+  LIRSPeerCache(Store& store, Options options)
+    : store_(store), options_(options), peers_(client_options(options))
+    , local_hits_(0), peer_hits_(0), misses_(0) {
+
+    if (options.self >= options.nodes.size()) throw std::invalid_argument("Peer cache: self is not in the node list");
+    return;
+  }
+
+  LIRSPeerCache(const LIRSPeerCache&) = delete;
+  LIRSPeerCache& operator=(const LIRSPeerCache&) = delete;
+
+  // the local item, else a peer's copy (now also local, as HIR); nullptr: load from the backend
+  LIRSItemRef get(const std::string& key) {
+
+    LIRSItemRef item;
+    this->get_many(&key, 1, &item);
+    return item;
+  }
+
+  // items[i] = get(keys[i]); the local lookups share one pass over the store
+  void get_many(const std::string* keys, std::size_t count, LIRSItemRef* items) {
+
+    this->store_.get_many(keys, count, items);
+
+    std::uint64_t hits = 0;
+    for (std::size_t i = 0; i < count; i++) {
+
+      if (items[i] != nullptr) hits++;
+      else items[i] = this->fetch(keys[i]);
+    }
+    this->local_hits_.fetch_add(hits, std::memory_order_relaxed);
+    return;
+  }
+
+  Stats stats() const {
+
+    Stats stats {};
+    stats.local_hits = this->local_hits_.load(std::memory_order_relaxed);
+    stats.peer_hits = this->peer_hits_.load(std::memory_order_relaxed);
+    stats.misses = this->misses_.load(std::memory_order_relaxed);
+    stats.hedges = this->peers_.hedges();
+    return stats;
+  }
+
+  Store& store() { return this->store_; }
+  LIRSMemcacheClient& peers() { return this->peers_; }
+
+private:
+  static LIRSMemcacheClient::Options client_options(const Options& options) {
+
+    LIRSMemcacheClient::Options client;
+    client.nodes = options.nodes;
+    client.ring = options.ring;
+    client.timeout_ms = options.timeout_ms;
+    client.retry_after_ms = options.retry_after_ms;
+    return client;
+  }
+
+  // a local miss: the home node's copy, stored here as HIR; nullptr if it has none
+  LIRSItemRef fetch(const std::string& key) {
+
+    // this node is the key's home: nobody else is expected to hold it.  The home is
+    // where writes go, not where the load bound would send a read
+    std::size_t home = this->peers_.home(key);
+    if (home == LIRSHashRing::npos || home == this->options_.self) {
+
+      this->misses_.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    std::size_t hedge = this->options_.hedge_after_ms > 0 ? this->backup(key, home) : LIRSHashRing::npos;
+    auto value = this->peers_.meta_get(key, "P", home, hedge, this->options_.hedge_after_ms, this->options_.timeout_ms);
+    if (!value || value->ttl == 0) {
+
+      this->misses_.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    std::int64_t expires = value->ttl < 0 ? 0 : Store::now() + value->ttl * 1000;
+    this->peer_hits_.fetch_add(1, std::memory_order_relaxed);
+    return this->store_.store_cold(key, value->data, value->flags, expires);
+  }
+
+  // next live probe of the key other than its home and this node, npos if none
+  std::size_t backup(const std::string& key, std::size_t home) {
+
+    std::uint64_t hash = LIRSHashRing::hash(key);
+    std::size_t probes = 2 * this->options_.nodes.size() + 8;
+    for (std::size_t attempt = 1; attempt < probes; attempt++) {
+
+      std::size_t node = this->peers_.ring().candidate(hash, attempt);
+      if (node != home && node != this->options_.self && this->peers_.alive(node)) return node;
+    }
+    return LIRSHashRing::npos;
+  }
+
+  Store& store_;
+  Options options_;
+  LIRSMemcacheClient peers_;
+  std::atomic<std::uint64_t> local_hits_;
+  std::atomic<std::uint64_t> peer_hits_;
+  std::atomic<std::uint64_t> misses_;
+};
+
+// the store interface of LIRSMemcacheSession / LIRSRespSession, with lookups through a peer cache;
+// peer requests (mg ... P) read the store itself
+template <typename Store = LIRSItemStore<>>
+class LIRSPeerStore {
+public:
+  using Stats = typename Store::Stats;
+
+  explicit LIRSPeerStore(LIRSPeerCache<Store>& peers) : peers_(peers), store_(peers.store()) {}
+
+  static std::int64_t now() { return Store::now(); }
+
+  LIRSItemRef get(const std::string& key) { return this->peers_.get(key); }
+
+  void get_many(const std::string* keys, std::size_t count, LIRSItemRef* items) {
+
+    this->peers_.get_many(keys, count, items);
+    return;
+  }
+
+  LIRSItemRef peek(const std::string& key) const { return this->store_.peek(key); }
+  LIRSItemRef peek_lir(const std::string& key) const { return this->store_.peek_lir(key); }
+
+  LIRSStoreResult store(LIRSStoreMode mode, const std::string& key, std::string_view data, std::uint32_t flags,
+                        std::int64_t expires, std::uint64_t cas = 0, std::uint64_t* stored_cas = nullptr) {
+
+    return this->store_.store(mode, key, data, flags, expires, cas, stored_cas);
+  }
+
+  LIRSStoreResult erase(const std::string& key, std::uint64_t cas = 0) { return this->store_.erase(key, cas); }
+  bool touch(const std::string& key, std::int64_t expires) { return this->store_.touch(key, expires); }
+  Stats stats() const { return this->store_.stats(); }
+
+private:
+  LIRSPeerCache<Store>& peers_;
+  Store& store_;
+};
+
+#endif
@@ -0,0 +1,605 @@
+#ifndef LIRS_REPLICATION_HPP
+#define LIRS_REPLICATION_HPP
+
+/*
+ * Replication of LIRSCache mutations to follower caches
+ *
+ *    leader                                             follower
+ *    LIRSReplicationLeader ─► cache                     LIRSReplicationFollower ─► cache
+ *       │ get hit / put / erase / ...                      ▲
+ *       └─ records ─► batch ─► transport ──── frames ──────┘ apply(frame)
+ *
+ *    frame    : kind u8 │ sequence u64 │ body
+ *    snapshot : LIRSCache::save stream (sent to a follower when it attaches)
+ *    batch    : record count u64 │ records
+ *    record   : op u8 │ key │ value (put, put_cold)
+ *               op u8 │ capacity u64 (resize)
+ *               op u8 (evict_one, demote_one)
+ *
+ * LIRSCache is deterministic: the same operations applied to the same state
+ * give the same S and Q, so a follower that replays the leader's log from its
+ * snapshot holds the same blocks with the same LIR/HIR classification and
+ * takes over warm.  get() hits are part of the log (access_events); without
+ * them followers get every value but classify by writes alone.  Followers
+ * need the leader's HIR ratio and no eviction filter of their own, and
+ * nothing else may touch their cache while they follow.
+ *
+ * Batches carry consecutive sequence numbers.  A follower skips batches it
+ * has already applied and stops with an error on a gap; it then needs a new
+ * snapshot (attach again).
+ *
+ * Transports: LIRSReplicationQueue (in-process) and LIRSReplicationStream /
+ * LIRSReplicationReceiver (Unix domain socket, POSIX).  The leader is not
+ * thread-safe: callers serialize it like the cache it wraps.
+ */
+
+#include "lirs_cache.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace lirs_detail {
+
+  constexpr std::uint8_t kReplicationSnapshot = 'S';
+  constexpr std::uint8_t kReplicationBatch = 'B';
+
+  enum class LIRSReplicationOp : std::uint8_t { Put = 1, PutCold, Erase, Access, Resize, EvictOne, DemoteOne };
+
+  inline sockaddr_un replication_address(const std::string& path) {
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) throw std::invalid_argument("Replication socket path too long: " + path);
+    std::memcpy(address.sun_path, path.data(), path.size());
+    return address;
+  }
+
+} // namespace lirs_detail
+
+// delivers frames to one follower; false once the follower is gone or too far behind
+class LIRSReplicationTransport {
+public:
+  virtual ~LIRSReplicationTransport() = default;
+
+  virtual bool publish(const std::string& frame) = 0;
+};
+
+template <typename K, typename V, typename KeyCodec = LIRSCodec<K>, typename ValueCodec = LIRSCodec<V>>
+class LIRSReplicationLeader {
+public:
+  struct Options {
+    std::size_t batch_records = 512;        // publish the open batch at this many records
+    std::size_t batch_bytes = 64 * 1024;    // ... or this many encoded bytes
+    bool access_events = true;              // replicate get() hits
+  };
+
+  explicit LIRSReplicationLeader(LIRSCache<K, V>& cache) : LIRSReplicationLeader(cache, Options {}) {}
+
+  LIRSReplicationLeader(LIRSCache<K, V>& cache, Options options)
+    : cache_(cache), options_(options), sequence_(0), records_(0) {}
+
+  LIRSReplicationLeader(const LIRSReplicationLeader&) = delete;
+  LIRSReplicationLeader& operator=(const LIRSReplicationLeader&) = delete;
+
+  std::optional<V> get(const K& key) {
+
+    std::optional<V> value = this->cache_.get(key);
+
+    // a miss leaves the cache untouched: nothing to replay
+    if (value && this->options_.access_events) this->record(lirs_detail::LIRSReplicationOp::Access, &key, nullptr);
+    return value;
+  }
+
+  void put(const K& key, const V& value) {
+
+    this->cache_.put(key, value);
+    this->record(lirs_detail::LIRSReplicationOp::Put, &key, &value);
+    return;
+  }
+
+  bool put_cold(const K& key, const V& value) {
+
+    if (!this->cache_.put_cold(key, value)) return false;
+    this->record(lirs_detail::LIRSReplicationOp::PutCold, &key, &value);
+    return true;
+  }
+
+  bool erase(const K& key) {
+
+    // also drops ghosts, so it is logged even when nothing resident went away
+    bool was_resident = this->cache_.erase(key);
+    this->record(lirs_detail::LIRSReplicationOp::Erase, &key, nullptr);
+    return was_resident;
+  }
+
+  void resize(std::size_t capacity) {
+
+    this->cache_.resize(capacity);
+    lirs_detail::write_le(this->batch_, static_cast<std::uint8_t>(lirs_detail::LIRSReplicationOp::Resize), 1);
+    lirs_detail::write_le(this->batch_, capacity, 8);
+    this->recorded();
+    return;
+  }
+
+  bool evict_one() {
+
+    if (!this->cache_.evict_one()) return false;
+    this->record(lirs_detail::LIRSReplicationOp::EvictOne, nullptr, nullptr);
+    return true;
+  }
+
+  bool demote_one() {
+
+    if (!this->cache_.demote_one()) return false;
+    this->record(lirs_detail::LIRSReplicationOp::DemoteOne, nullptr, nullptr);
+    return true;
+  }
+
+  // start replicating to a follower: it receives a snapshot, then every later batch
+  void attach(LIRSReplicationTransport& follower) {
+
+    this->flush();
+
+    std::ostringstream frame;
+    lirs_detail::write_le(frame, lirs_detail::kReplicationSnapshot, 1);
+    lirs_detail::write_le(frame, this->sequence_, 8);
+    this->cache_.template save<KeyCodec, ValueCodec>(frame);
+
+    if (follower.publish(frame.str())) this->followers_.push_back(&follower);
+    return;
+  }
+
+  void detach(LIRSReplicationTransport& follower) {
+
+    this->followers_.erase(std::remove(this->followers_.begin(), this->followers_.end(), &follower), this->followers_.end());
+    return;
+  }
+
+  // publish the open batch, e.g. once per event loop iteration; followers that refuse it are detached
+  void flush() {
+
+    if (this->records_ == 0) return;
+
+    std::ostringstream frame;
+    lirs_detail::write_le(frame, lirs_detail::kReplicationBatch, 1);
+    lirs_detail::write_le(frame, this->sequence_, 8);
+    lirs_detail::write_le(frame, this->records_, 8);
+    frame << this->batch_.str();
+    std::string bytes = frame.str();
+
+    this->batch_.str(std::string());
+    this->records_ = 0;
+    this->sequence_++;
+
+    auto refused = std::remove_if(this->followers_.begin(), this->followers_.end(),
+                                  [&bytes](LIRSReplicationTransport* follower) { return !follower->publish(bytes); });
+    this->followers_.erase(refused, this->followers_.end());
+    return;
+  }
+
+  // batches published so far
+  std::uint64_t sequence() const { return this->sequence_; }
+
+  std::size_t followers() const { return this->followers_.size(); }
+
+  const LIRSCache<K, V>& cache() const { return this->cache_; }
+
+private:
+  void record(lirs_detail::LIRSReplicationOp op, const K* key, const V* value) {
+
+    lirs_detail::write_le(this->batch_, static_cast<std::uint8_t>(op), 1);
+    if (key != nullptr) KeyCodec::write(this->batch_, *key);
+    if (value != nullptr) ValueCodec::write(this->batch_, *value);
+    this->recorded();
+    return;
+  }
+
+  void recorded() {
+
+    this->records_++;
+    if (this->records_ >= this->options_.batch_records || static_cast<std::size_t>(this->batch_.tellp()) >= this->options_.batch_bytes) {
+
+      this->flush();
+    }
+    return;
+  }
+
+  LIRSCache<K, V>& cache_;
+  Options options_;
+  std::vector<LIRSReplicationTransport*> followers_;
+  std::ostringstream batch_;
+  std::uint64_t sequence_;   // of the open batch
+  std::uint64_t records_;    // in the open batch
+};
+
+template <typename K, typename V, typename KeyCodec = LIRSCodec<K>, typename ValueCodec = LIRSCodec<V>>
+class LIRSReplicationFollower {
+public:
+  explicit LIRSReplicationFollower(LIRSCache<K, V>& cache) : cache_(cache), synced_(false), sequence_(0) {}
+
+  LIRSReplicationFollower(const LIRSReplicationFollower&) = delete;
+  LIRSReplicationFollower& operator=(const LIRSReplicationFollower&) = delete;
+
+  // apply one frame; returns the records applied.  Batches before the first
+  // snapshot and batches already applied are skipped; a gap throws and
+  // leaves the follower unsynced until the next snapshot
+  std::size_t apply(const std::string& frame) {
+
+    std::istringstream is(frame);
+    std::uint8_t kind = static_cast<std::uint8_t>(lirs_detail::read_le(is, 1));
+    std::uint64_t sequence = lirs_detail::read_le(is, 8);
+
+    if (kind == lirs_detail::kReplicationSnapshot) {
+
+      this->synced_ = false;
+
+      // take the leader's capacity (it may have resized) before loading: magic (8 bytes) │ version u32 │ capacity
+      std::streampos start = is.tellg();
+      is.seekg(12, std::ios::cur);
+      std::size_t capacity = static_cast<std::size_t>(lirs_detail::read_le(is, 8));
+      is.seekg(start);
+      if (capacity != this->cache_.capacity()) this->cache_.resize(capacity);
+
+      this->cache_.template load<KeyCodec, ValueCodec>(is);
+      this->synced_ = true;
+      this->sequence_ = sequence;
+      return 0;
+    }
+    if (kind != lirs_detail::kReplicationBatch) throw std::runtime_error("Not a LIRS replication frame");
+
+    if (!this->synced_ || sequence < this->sequence_) return 0;
+    if (sequence > this->sequence_) {
+
+      this->synced_ = false;
+      throw std::runtime_error("Replication gap: follower needs a new snapshot");
+    }
+
+    // a corrupt batch leaves the cache half-applied: unsynced until the next snapshot
+    this->synced_ = false;
+    std::uint64_t records = lirs_detail::read_le(is, 8);
+    for (std::uint64_t i = 0; i < records; i++) this->replay(is);
+
+    this->synced_ = true;
+    this->sequence_++;
+    return static_cast<std::size_t>(records);
+  }
+
+  // a snapshot was applied and every batch since
+  bool synced() const { return this->synced_; }
+
+  // sequence of the next batch expected
+  std::uint64_t sequence() const { return this->sequence_; }
+
+private:
+  void replay(std::istream& is) {
+
+    using Op = lirs_detail::LIRSReplicationOp;
+    Op op = static_cast<Op>(lirs_detail::read_le(is, 1));
+
+    switch (op) {
+
+      case Op::Put:
+      case Op::PutCold: {
+
+        K key;
+        V value;
+        KeyCodec::read(is, key);
+        ValueCodec::read(is, value);
+        if (op == Op::Put) this->cache_.put(key, value);
+        else this->cache_.put_cold(key, value);
+        return;
+      }
+      case Op::Erase:
+      case Op::Access: {
+
+        K key;
+        KeyCodec::read(is, key);
+        if (op == Op::Erase) this->cache_.erase(key);
+        else this->cache_.get(key);
+        return;
+      }
+      case Op::Resize:
+        this->cache_.resize(static_cast<std::size_t>(lirs_detail::read_le(is, 8)));
+        return;
+      case Op::EvictOne:
+        this->cache_.evict_one();
+        return;
+      case Op::DemoteOne:
+        this->cache_.demote_one();
+        return;
+    }
+    throw std::runtime_error("Corrupt replication batch: unknown op");
+  }
+
+  LIRSCache<K, V>& cache_;
+  bool synced_;
+  std::uint64_t sequence_;
+};
+
+// in-process transport: the leader publishes, a follower thread pops.  A follower
+// more than max_frames behind is cut off: the queue closes and pop() drains it
+class LIRSReplicationQueue : public LIRSReplicationTransport {
+public:
+  explicit LIRSReplicationQueue(std::size_t max_frames = 4096) : max_frames_(max_frames), closed_(false) {}
+
+  bool publish(const std::string& frame) override {
+
+    bool accepted;
+    {
+      std::lock_guard<std::mutex> lock(this->mutex_);
+      if (this->closed_) return false;
+
+      accepted = this->frames_.size() < this->max_frames_;
+      if (accepted) this->frames_.push_back(frame);
+      else this->closed_ = true;
+    }
+    this->ready_.notify_one();
+    return accepted;
+  }
+
+  // next frame, waiting up to timeout_ms (< 0: forever); false on timeout or once closed and drained
+  bool pop(std::string& frame, int timeout_ms = -1) {
+
+    std::unique_lock<std::mutex> lock(this->mutex_);
+    auto ready = [this] { return !this->frames_.empty() || this->closed_; };
+
+    if (timeout_ms < 0) this->ready_.wait(lock, ready);
+    else if (!this->ready_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready)) return false;
+    if (this->frames_.empty()) return false;
+
+    frame = std::move(this->frames_.front());
+    this->frames_.pop_front();
+    return true;
+  }
+
+  void close() {
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex_);
+      this->closed_ = true;
+    }
+    this->ready_.notify_all();
+    return;
+  }
+
+  bool closed() const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->closed_;
+  }
+
+  std::size_t size() const {
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->frames_.size();
+  }
+
+private:
+  std::size_t max_frames_;
+  mutable std::mutex mutex_;
+  std::condition_variable ready_;
+  std::deque<std::string> frames_;
+  bool closed_;
+};
+
+// socket transport, leader side: one connected follower (from LIRSReplicationListener::accept).
+// A follower that stops reading for send_timeout_ms is disconnected
+class LIRSReplicationStream : public LIRSReplicationTransport {
+public:
+  explicit LIRSReplicationStream(int fd) : fd_(fd) {}
+
+  ~LIRSReplicationStream() override {
+
+    if (this->fd_ >= 0) ::close(this->fd_);
+  }
+
+  LIRSReplicationStream(const LIRSReplicationStream&) = delete;
+  LIRSReplicationStream& operator=(const LIRSReplicationStream&) = delete;
+
+  // stream frame : bytes u64 │ frame
+  bool publish(const std::string& frame) override {
+
+    if (this->fd_ < 0) return false;
+
+    std::ostringstream prefix;
+    lirs_detail::write_le(prefix, frame.size(), 8);
+    if (this->write_all(prefix.str()) && this->write_all(frame)) return true;
+
+    ::close(this->fd_);
+    this->fd_ = -1;
+    return false;
+  }
+
+  bool connected() const { return this->fd_ >= 0; }
+
+private:
+  bool write_all(const std::string& data) {
+
+    std::size_t offset = 0;
+    while (offset < data.size()) {
+
+      ssize_t written = ::send(this->fd_, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+      if (written < 0 && errno == EINTR) continue;
+      if (written < 0) return false;
+      offset += static_cast<std::size_t>(written);
+    }
+    return true;
+  }
+
+  int fd_;
+};
+
+// socket transport, leader side: accepts followers on a Unix domain socket path
+class LIRSReplicationListener {
+public:
+  struct Options {
+    int send_timeout_ms = 1000;   // a follower blocked longer than this is dropped
+  };
+
+  explicit LIRSReplicationListener(const std::string& path) : LIRSReplicationListener(path, Options {}) {}
+
+  // listen on path, replacing a socket left by a previous leader
+  LIRSReplicationListener(const std::string& path, Options options) : path_(path), options_(options), fd_(-1) {
+
+    sockaddr_un address = lirs_detail::replication_address(path);
+
+    this->fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (this->fd_ < 0) throw std::system_error(errno, std::generic_category(), "socket");
+
+    ::unlink(path.c_str());
+    if (::bind(this->fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(this->fd_, 16) != 0) {
+
+      int error = errno;
+      ::close(this->fd_);
+      throw std::system_error(error, std::generic_category(), "listen " + path);
+    }
+    return;
+  }
+
+  ~LIRSReplicationListener() {
+
+    ::close(this->fd_);
+    ::unlink(this->path_.c_str());
+  }
+
+  LIRSReplicationListener(const LIRSReplicationListener&) = delete;
+  LIRSReplicationListener& operator=(const LIRSReplicationListener&) = delete;
+
+  // readable when a follower is waiting to be accepted
+  int fd() const { return this->fd_; }
+
+  // next follower, waiting up to timeout_ms (< 0: forever); nullptr on timeout.
+  // Pass it to LIRSReplicationLeader::attach() and keep it alive while attached
+  std::unique_ptr<LIRSReplicationStream> accept(int timeout_ms = 0) {
+
+    pollfd ready { this->fd_, POLLIN, 0 };
+    int result = ::poll(&ready, 1, timeout_ms);
+    if (result < 0 && errno != EINTR) throw std::system_error(errno, std::generic_category(), "poll");
+    if (result <= 0) return nullptr;
+
+    int fd = ::accept4(this->fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), "accept " + this->path_);
+
+    timeval timeout { this->options_.send_timeout_ms / 1000, (this->options_.send_timeout_ms % 1000) * 1000 };
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    return std::make_unique<LIRSReplicationStream>(fd);
+  }
+
+private:
+  std::string path_;
+  Options options_;
+  int fd_;
+};
+
+// socket transport, follower side
+class LIRSReplicationReceiver {
+public:
+  // connect to the leader listening on path
+  explicit LIRSReplicationReceiver(const std::string& path) : fd_(-1), closed_(false), offset_(0) {
+
+    sockaddr_un address = lirs_detail::replication_address(path);
+
+    this->fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (this->fd_ < 0) throw std::system_error(errno, std::generic_category(), "socket");
+
+    if (::connect(this->fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+
+      int error = errno;
+      ::close(this->fd_);
+      throw std::system_error(error, std::generic_category(), "connect " + path);
+    }
+    return;
+  }
+
+  ~LIRSReplicationReceiver() {
+
+    ::close(this->fd_);
+  }
+
+  LIRSReplicationReceiver(const LIRSReplicationReceiver&) = delete;
+  LIRSReplicationReceiver& operator=(const LIRSReplicationReceiver&) = delete;
+
+  int fd() const { return this->fd_; }
+
+  // next frame, waiting up to timeout_ms (< 0: forever) for more data; false on
+  // timeout or once the leader hung up and every buffered frame was returned
+  bool receive(std::string& frame, int timeout_ms = -1) {
+
+    while (!this->next(frame)) {
+
+      if (this->closed_) return false;
+
+      pollfd ready { this->fd_, POLLIN, 0 };
+      int result = ::poll(&ready, 1, timeout_ms);
+      if (result < 0 && errno != EINTR) throw std::system_error(errno, std::generic_category(), "poll");
+      if (result == 0) return false;
+      if (result > 0) this->fill();
+    }
+    return true;
+  }
+
+  // the leader hung up (or dropped this follower)
+  bool closed() const { return this->closed_; }
+
+private:
+  static constexpr std::size_t kReadChunk = 64 * 1024;
+
+  bool next(std::string& frame) {
+
+    std::size_t available = this->buffer_.size() - this->offset_;
+    if (available < 8) return false;
+
+    std::istringstream prefix(this->buffer_.substr(this->offset_, 8));
+    std::uint64_t bytes = lirs_detail::read_le(prefix, 8);
+    if (available - 8 < bytes) return false;
+
+    frame.assign(this->buffer_, this->offset_ + 8, static_cast<std::size_t>(bytes));
+    this->offset_ += 8 + static_cast<std::size_t>(bytes);
+
+    // drop consumed bytes once they dominate the buffer
+    if (this->offset_ > this->buffer_.size() / 2) {
+
+      this->buffer_.erase(0, this->offset_);
+      this->offset_ = 0;
+    }
+    return true;
+  }
+
+  void fill() {
+
+    char chunk[kReadChunk];
+    ssize_t received;
+    do received = ::recv(this->fd_, chunk, sizeof(chunk), 0);
+    while (received < 0 && errno == EINTR);
+
+    if (received > 0) this->buffer_.append(chunk, static_cast<std::size_t>(received));
+    else this->closed_ = true;
+    return;
+  }
+
+  int fd_;
+  bool closed_;
+  std::string buffer_;
+  std::size_t offset_;
+};
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef LIRS_REPLY_HPP
+#define LIRS_REPLY_HPP
+
+/*
+ * Scatter-gather reply buffer for protocol sessions
+ *
+ *    [ "VALUE k 0 5\r\n" ][ item data ──► shared item ][ "\r\nEND\r\n" ]
+ *       copied bytes        referenced, not copied         copied bytes
+ *
+ * Protocol text is appended (copied) into owned segments; values of at
+ * least kReferenceMin bytes are referenced in place and kept alive by their
+ * owner until sent, so a large hit goes from the cache to the socket
+ * without a copy.  gather() fills an iovec array for writev(); consume()
+ * drops what was sent.
+ */
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+class LIRSReplyBuffer {
+public:
+  static constexpr std::size_t kReferenceMin = 512;   // smaller values are cheaper to copy
+
+  LIRSReplyBuffer() : size_(0), offset_(0) {}
+
+  void append(const char* data, std::size_t size) {
+
+    if (size == 0) return;
+
+    if (this->segments_.empty() || this->segments_.back().owner != nullptr) this->segments_.emplace_back();
+    this->segments_.back().bytes.append(data, size);
+    this->size_ += size;
+    return;
+  }
+
+  LIRSReplyBuffer& operator+=(std::string_view text) {
+
+    this->append(text.data(), text.size());
+    return *this;
+  }
+
+  LIRSReplyBuffer& operator+=(char c) {
+
+    this->append(&c, 1);
+    return *this;
+  }
+
+  // bytes that stay valid while owner lives; copied when small
+  void reference(std::string_view data, std::shared_ptr<const void> owner) {
+
+    if (data.size() < kReferenceMin || owner == nullptr) {
+
+      this->append(data.data(), data.size());
+      return;
+    }
+
+    Segment segment;
+    segment.view = data;
+    segment.owner = std::move(owner);
+    this->segments_.push_back(std::move(segment));
+    this->size_ += data.size();
+    return;
+  }
+
+  // unsent bytes
+  std::size_t size() const { return this->size_; }
+  bool empty() const { return this->size_ == 0; }
+
+  // up to max unsent segments as iovecs (iov_base / iov_len); returns the count
+  template <typename IoVec>
+  std::size_t gather(IoVec* vectors, std::size_t max) const {
+
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < this->segments_.size() && count < max; i++) {
+
+      std::string_view data = this->segments_[i].data();
+      if (i == 0) data.remove_prefix(this->offset_);
+
+      vectors[count].iov_base = const_cast<char*>(data.data());
+      vectors[count].iov_len = data.size();
+      count++;
+    }
+    return count;
+  }
+
+  // drop bytes from the front once they are sent
+  void consume(std::size_t bytes) {
+
+    this->size_ -= bytes;
+    while (bytes > 0) {
+
+      std::size_t left = this->segments_.front().data().size() - this->offset_;
+      if (bytes < left) {
+
+        this->offset_ += bytes;
+        return;
+      }
+
+      bytes -= left;
+      this->segments_.pop_front();
+      this->offset_ = 0;
+    }
+    return;
+  }
+
+  // everything as one string (tests, non-socket consumers)
+  std::string str() const {
+
+    std::string text;
+    for (std::size_t i = 0; i < this->segments_.size(); i++) {
+
+      std::string_view data = this->segments_[i].data();
+      text.append(i == 0 ? data.substr(this->offset_) : data);
+    }
+    return text;
+  }
+
+  void clear() {
+
+    this->segments_.clear();
+    this->size_ = 0;
+    this->offset_ = 0;
+    return;
+  }
+
+private:
+  struct Segment {
+    std::string bytes;                   // owned copy, when owner is null
+    std::string_view view;               // referenced bytes, when owner is set
+    std::shared_ptr<const void> owner;
+
+    std::string_view data() const { return this->owner != nullptr ? this->view : std::string_view(this->bytes); }
+  };
+
+  std::deque<Segment> segments_;
+  std::size_t size_;     // unsent bytes
+  std::size_t offset_;   // sent bytes of the front segment
+};
+
+#endif
@@ -0,0 +1,551 @@
+#ifndef LIRS_RESP_HPP
+#define LIRS_RESP_HPP
+
+/*
+ * Redis protocol (RESP2 / RESP3) subset over a LIRSItemStore
+ *
+ *    *3\r\n$3\r\nSET\r\n$1\r\nk\r\n$1\r\nv\r\n
+ *        └─ arguments are views into the caller's buffer (no copy while parsing)
+ *
+ *    GET  MGET  SET [EX s | PX ms] [NX | XX]  MSET  DEL  EXISTS  TTL  PTTL
+ *    EXPIRE  INFO  DBSIZE  PING  HELLO [2|3]  SELECT 0  COMMAND  CLIENT  QUIT
+ *
+ * Pipelining: consecutive GET / MGET commands are collected into one batch
+ * and looked up with LIRSItemStore::get_many() (each shard locked once);
+ * any other command flushes the batch first, so replies keep request order.
+ * Values are referenced from the items into the reply buffer and go out
+ * with the rest of the replies in one gathered write.
+ *
+ * HELLO 3 switches the connection to RESP3 (null as "_", maps, verbatim
+ * INFO).  INFO has a "# LIRS" section: LIR count, ghost count and the
+ * lengths of S and Q over all shards.
+ *
+ * One session per connection; not thread-safe (the store is).
+ */
+
+#include "lirs_item_store.hpp"
+#include "lirs_reply.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <vector>
+
+template <typename Store>
+class LIRSRespSession {
+public:
+  struct Options {
+    std::size_t bulk_limit = std::size_t { 1 } << 20;   // largest argument (value)
+    std::size_t arg_limit = 1024 * 1024;                // most arguments per command
+    std::size_t inline_limit = 64 * 1024;               // longest inline command / header line
+  };
+
+  explicit LIRSRespSession(Store& store) : LIRSRespSession(store, Options {}) {}
+
+  LIRSRespSession(Store& store, Options options)
+    : store_(store), options_(options), protocol_(2), closing_(false), error_(""), key_count_(0) {}
+
+  // consume complete commands from data and append their replies to out; returns bytes used
+  std::size_t feed(const char* data, std::size_t size, LIRSReplyBuffer& out) {
+
+    std::size_t pos = 0;
+    while (!this->closing_ && pos < size) {
+
+      std::size_t used = this->parse(data + pos, size - pos);
+      if (used == kIncomplete) break;
+      if (used == kInvalid) {
+
+        this->flush(out);
+        out += "-ERR Protocol error: ";
+        out += this->error_;
+        out += "\r\n";
+        this->closing_ = true;
+        pos = size;
+        break;
+      }
+
+      pos += used;
+      if (!this->args_.empty()) this->command(out);
+    }
+
+    this->flush(out);
+    return pos;
+  }
+
+  // QUIT or a protocol error: close after the replies are sent
+  bool closing() const { return this->closing_; }
+
+private:
+  static constexpr std::size_t kIncomplete = static_cast<std::size_t>(-1);
+  static constexpr std::size_t kInvalid = static_cast<std::size_t>(-2);
+
+  enum class Kind { Get, MGet };
+
+  // a GET / MGET waiting in the batch
+  struct Retrieval {
+    Kind kind;
+    std::size_t first;   // its keys in keys_
+    std::size_t count;
+  };
+
+  static bool is(std::string_view arg, const char* name) {
+
+    std::size_t length = std::strlen(name);
+    if (arg.size() != length) return false;
+    for (std::size_t i = 0; i < length; i++) {
+
+      char c = arg[i];
+      if (c >= 'a' && c <= 'z') c = static_cast<char>(c - 'a' + 'A');
+      if (c != name[i]) return false;
+    }
+    return true;
+  }
+
+  template <typename T>
+  static bool number(std::string_view token, T& value) {
+
+    auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+    return result.ec == std::errc() && result.ptr == token.data() + token.size() && !token.empty();
+  }
+
+  // "<prefix><number>\r\n"
+  template <typename T>
+  static void header(LIRSReplyBuffer& out, char prefix, T value) {
+
+    char buffer[24];
+    buffer[0] = prefix;
+    auto result = std::to_chars(buffer + 1, buffer + sizeof(buffer) - 2, value);
+    result.ptr[0] = '\r';
+    result.ptr[1] = '\n';
+    out.append(buffer, static_cast<std::size_t>(result.ptr + 2 - buffer));
+    return;
+  }
+
+  // one command from data into args_: bytes used, kIncomplete or kInvalid (error_ set)
+  std::size_t parse(const char* data, std::size_t size) {
+
+    this->args_.clear();
+
+    const char* end = static_cast<const char*>(std::memchr(data, '\n', std::min(size, this->options_.inline_limit)));
+    if (end == nullptr) return this->fail_if(size >= this->options_.inline_limit, "too big inline request");
+
+    std::size_t line = static_cast<std::size_t>(end - data);
+    if (data[0] != '*') return this->parse_inline(data, line);
+
+    // *<count>\r\n then <count> times $<length>\r\n<bytes>\r\n
+    std::size_t count = 0;
+    if (line < 2 || data[line - 1] != '\r' || !number(std::string_view(data + 1, line - 2), count) || count > this->options_.arg_limit) {
+
+      return this->fail_if(true, "invalid multibulk length");
+    }
+
+    std::size_t pos = line + 1;
+    for (std::size_t i = 0; i < count; i++) {
+
+      if (pos >= size) return kIncomplete;
+      if (data[pos] != '$') return this->fail_if(true, "expected '$'");
+
+      const char* newline = static_cast<const char*>(std::memchr(data + pos, '\n', size - pos));
+      if (newline == nullptr) return this->fail_if(size - pos > 32, "invalid bulk length");
+
+      std::size_t stop = static_cast<std::size_t>(newline - data);
+      std::size_t length = 0;
+      if (stop - pos < 2 || data[stop - 1] != '\r' || !number(std::string_view(data + pos + 1, stop - pos - 2), length)
+          || length > this->options_.bulk_limit) {
+
+        return this->fail_if(true, "invalid bulk length");
+      }
+
+      pos = stop + 1;
+      if (size - pos < length + 2) return kIncomplete;
+      if (data[pos + length] != '\r' || data[pos + length + 1] != '\n') return this->fail_if(true, "expected CRLF after bulk");
+
+      this->args_.emplace_back(data + pos, length);
+      pos += length + 2;
+    }
+    return pos;
+  }
+
+  // PING\r\n style: space separated words on one line
+  std::size_t parse_inline(const char* data, std::size_t line) {
+
+    std::string_view text(data, line);
+    if (!text.empty() && text.back() == '\r') text.remove_suffix(1);
+
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+
+      while (pos < text.size() && text[pos] == ' ') pos++;
+      std::size_t start = pos;
+      while (pos < text.size() && text[pos] != ' ') pos++;
+      if (pos > start) this->args_.push_back(text.substr(start, pos - start));
+    }
+    return line + 1;
+  }
+
+  std::size_t fail_if(bool failed, const char* error) {
+
+    if (!failed) return kIncomplete;
+
+    this->error_ = error;
+    return kInvalid;
+  }
+
+  void command(LIRSReplyBuffer& out) {
+
+    std::string_view name = this->args_[0];
+    std::size_t argc = this->args_.size();
+
+    if (is(name, "GET") && argc == 2) {
+
+      this->batch(Kind::Get);
+      return;
+    }
+    if (is(name, "MGET") && argc >= 2) {
+
+      this->batch(Kind::MGet);
+      return;
+    }
+
+    this->flush(out);
+
+    if (is(name, "GET") || is(name, "MGET")) this->arity_error(out);
+    else if (is(name, "SET")) this->set(out);
+    else if (is(name, "MSET")) this->mset(out);
+    else if (is(name, "DEL") || is(name, "UNLINK")) this->del(out);
+    else if (is(name, "EXISTS")) this->exists(out);
+    else if (is(name, "TTL") || is(name, "PTTL")) this->ttl(is(name, "PTTL"), out);
+    else if (is(name, "EXPIRE")) this->expire(out);
+    else if (is(name, "INFO")) this->info(out);
+    else if (is(name, "DBSIZE")) header(out, ':', this->store_.stats().items);
+    else if (is(name, "PING")) this->ping(out);
+    else if (is(name, "HELLO")) this->hello(out);
+    else if (is(name, "SELECT")) out += argc == 2 && this->args_[1] == "0" ? "+OK\r\n" : "-ERR DB index is out of range\r\n";
+    else if (is(name, "COMMAND")) out += "*0\r\n";
+    else if (is(name, "CLIENT")) out += "+OK\r\n";
+    else if (is(name, "QUIT")) {
+
+      out += "+OK\r\n";
+      this->closing_ = true;
+    } else {
+
+      out += "-ERR unknown command '";
+      out += name.substr(0, 64);
+      out += "'\r\n";
+    }
+    return;
+  }
+
+  void arity_error(LIRSReplyBuffer& out) {
+
+    out += "-ERR wrong number of arguments for '";
+    out += this->args_[0].substr(0, 64);
+    out += "' command\r\n";
+    return;
+  }
+
+  void add_key(std::string_view key) {
+
+    if (this->key_count_ == this->keys_.size()) this->keys_.emplace_back();
+    this->keys_[this->key_count_++].assign(key);
+    return;
+  }
+
+  void batch(Kind kind) {
+
+    this->batch_.push_back(Retrieval { kind, this->key_count_, this->args_.size() - 1 });
+    for (std::size_t i = 1; i < this->args_.size(); i++) this->add_key(this->args_[i]);
+    return;
+  }
+
+  void null(LIRSReplyBuffer& out) const {
+
+    out += this->protocol_ == 3 ? "_\r\n" : "$-1\r\n";
+    return;
+  }
+
+  void bulk(const LIRSItemRef& item, LIRSReplyBuffer& out) const {
+
+    if (item == nullptr) {
+
+      this->null(out);
+      return;
+    }
+    header(out, '$', item->data.size());
+    out.reference(item->data, item);
+    out += "\r\n";
+    return;
+  }
+
+  void bulk(std::string_view text, LIRSReplyBuffer& out) const {
+
+    header(out, '$', text.size());
+    out += text;
+    out += "\r\n";
+    return;
+  }
+
+  // look up every batched key at once, then reply in request order
+  void flush(LIRSReplyBuffer& out) {
+
+    if (this->batch_.empty()) return;
+
+    if (this->items_.size() < this->key_count_) this->items_.resize(this->key_count_);
+    this->store_.get_many(this->keys_.data(), this->key_count_, this->items_.data());
+
+    for (const Retrieval& retrieval : this->batch_) {
+
+      if (retrieval.kind == Kind::MGet) header(out, '*', retrieval.count);
+      for (std::size_t i = retrieval.first; i < retrieval.first + retrieval.count; i++) this->bulk(this->items_[i], out);
+    }
+
+    for (std::size_t i = 0; i < this->key_count_; i++) this->items_[i] = nullptr;
+    this->batch_.clear();
+    this->key_count_ = 0;
+    return;
+  }
+
+  // SET key value [EX seconds | PX milliseconds] [NX | XX]
+  void set(LIRSReplyBuffer& out) {
+
+    if (this->args_.size() < 3) {
+
+      this->arity_error(out);
+      return;
+    }
+
+    LIRSStoreMode mode = LIRSStoreMode::Set;
+    std::int64_t expires = 0;
+    for (std::size_t i = 3; i < this->args_.size(); i++) {
+
+      std::string_view option = this->args_[i];
+      std::int64_t amount = 0;
+      bool seconds = is(option, "EX");
+
+      if ((seconds || is(option, "PX")) && i + 1 < this->args_.size() && expires == 0) {
+
+        if (!number(this->args_[++i], amount) || amount <= 0) {
+
+          out += "-ERR invalid expire time in 'set' command\r\n";
+          return;
+        }
+        expires = Store::now() + (seconds ? amount * 1000 : amount);
+      } else if (is(option, "NX") && mode == LIRSStoreMode::Set) {
+
+        mode = LIRSStoreMode::Add;
+      } else if (is(option, "XX") && mode == LIRSStoreMode::Set) {
+
+        mode = LIRSStoreMode::Replace;
+      } else {
+
+        out += "-ERR syntax error\r\n";
+        return;
+      }
+    }
+
+    LIRSStoreResult result = this->store_.store(mode, std::string(this->args_[1]), this->args_[2], 0, expires);
+    if (result == LIRSStoreResult::Stored) out += "+OK\r\n";
+    else this->null(out);
+    return;
+  }
+
+  // MSET key value [key value ...]
+  void mset(LIRSReplyBuffer& out) {
+
+    if (this->args_.size() < 3 || this->args_.size() % 2 == 0) {
+
+      this->arity_error(out);
+      return;
+    }
+    for (std::size_t i = 1; i < this->args_.size(); i += 2) {
+
+      this->store_.store(LIRSStoreMode::Set, std::string(this->args_[i]), this->args_[i + 1], 0, 0);
+    }
+    out += "+OK\r\n";
+    return;
+  }
+
+  void del(LIRSReplyBuffer& out) {
+
+    if (this->args_.size() < 2) {
+
+      this->arity_error(out);
+      return;
+    }
+
+    std::size_t removed = 0;
+    for (std::size_t i = 1; i < this->args_.size(); i++) {
+
+      if (this->store_.erase(std::string(this->args_[i])) == LIRSStoreResult::Stored) removed++;
+    }
+    header(out, ':', removed);
+    return;
+  }
+
+  // a key given twice counts twice, as in Redis; does not count as an access
+  void exists(LIRSReplyBuffer& out) {
+
+    if (this->args_.size() < 2) {
+
+      this->arity_error(out);
+      return;
+    }
+
+    std::size_t found = 0;
+    for (std::size_t i = 1; i < this->args_.size(); i++) {
+
+      if (this->store_.peek(std::string(this->args_[i])) != nullptr) found++;
+    }
+    header(out, ':', found);
+    return;
+  }
+
+  // -2 missing, -1 no expiry, else time left (rounded up)
+  void ttl(bool milliseconds, LIRSReplyBuffer& out) {
+
+    if (this->args_.size() != 2) {
+
+      this->arity_error(out);
+      return;
+    }
+
+    LIRSItemRef item = this->store_.peek(std::string(this->args_[1]));
+    std::int64_t expires = item == nullptr ? 0 : item->expires.load(std::memory_order_relaxed);
+
+    if (item == nullptr) header(out, ':', -2);
+    else if (expires == 0) header(out, ':', -1);
+    else {
+
+      std::int64_t left = std::max<std::int64_t>(0, expires - Store::now());
+      header(out, ':', milliseconds ? left : (left + 999) / 1000);
+    }
+    return;
+  }
+
+  // EXPIRE key seconds: 1 if the key exists
+  void expire(LIRSReplyBuffer& out) {
+
+    std::int64_t seconds = 0;
+    if (this->args_.size() != 3) {
+
+      this->arity_error(out);
+      return;
+    }
+    if (!number(this->args_[2], seconds)) {
+
+      out += "-ERR value is not an integer or out of range\r\n";
+      return;
+    }
+
+    std::string key(this->args_[1]);
+    bool touched = seconds > 0 ? this->store_.touch(key, Store::now() + seconds * 1000)
+                               : this->store_.erase(key) == LIRSStoreResult::Stored;
+    header(out, ':', touched ? 1 : 0);
+    return;
+  }
+
+  void ping(LIRSReplyBuffer& out) {
+
+    if (this->args_.size() == 1) out += "+PONG\r\n";
+    else if (this->args_.size() == 2) this->bulk(this->args_[1], out);
+    else this->arity_error(out);
+    return;
+  }
+
+  // HELLO [protover ...]: the server properties as a map (RESP3) or flat array (RESP2)
+  void hello(LIRSReplyBuffer& out) {
+
+    if (this->args_.size() >= 2) {
+
+      int version = 0;
+      if (!number(this->args_[1], version) || (version != 2 && version != 3)) {
+
+        out += "-NOPROTO unsupported protocol version\r\n";
+        return;
+      }
+      this->protocol_ = version;
+    }
+
+    header(out, this->protocol_ == 3 ? '%' : '*', this->protocol_ == 3 ? 5 : 10);
+    this->bulk("server", out);
+    this->bulk("lirs", out);
+    this->bulk("version", out);
+    this->bulk("7.0.0", out);
+    this->bulk("proto", out);
+    header(out, ':', this->protocol_);
+    this->bulk("mode", out);
+    this->bulk("standalone", out);
+    this->bulk("role", out);
+    this->bulk("master", out);
+    return;
+  }
+
+  void info(LIRSReplyBuffer& out) {
+
+    auto stats = this->store_.stats();
+    std::string text;
+    auto field = [&text](const char* name, std::uint64_t value) {
+
+      text += name;
+      text += ':';
+      text += std::to_string(value);
+      text += "\r\n";
+    };
+
+    text += "# Server\r\nredis_version:7.0.0\r\nredis_mode:standalone\r\n\r\n";
+
+    text += "# Memory\r\n";
+    field("used_memory", stats.bytes);
+    field("maxmemory", stats.limit);
+    text += "\r\n";
+
+    text += "# Stats\r\n";
+    field("keyspace_hits", stats.get_hits);
+    field("keyspace_misses", stats.get_misses);
+    field("expired_keys", stats.expired);
+    text += "\r\n";
+
+    text += "# LIRS\r\n";
+    field("lir_count", stats.lir_count);
+    field("ghost_count", stats.ghost_count);
+    field("lirs_stack_size", stats.lirs_stack_size);
+    field("hir_stack_size", stats.hir_stack_size);
+    field("hot_keys", stats.hot_keys);
+    field("hot_replica_hits", stats.replica_hits);
+    text += "\r\n";
+
+    text += "# Keyspace\r\ndb0:keys=" + std::to_string(stats.items) + "\r\n";
+
+    // RESP3: verbatim string with a "txt:" format prefix
+    if (this->protocol_ == 3) {
+
+      header(out, '=', text.size() + 4);
+      out += "txt:";
+    } else {
+
+      header(out, '$', text.size());
+    }
+    out += text;
+    out += "\r\n";
+    return;
+  }
+
+  Store& store_;
+  Options options_;
+  int protocol_;
+  bool closing_;
+  const char* error_;
+
+  std::vector<std::string_view> args_;   // views into the buffer given to feed()
+
+  // pending GET / MGET batch
+  std::vector<Retrieval> batch_;
+  std::vector<std::string> keys_;   // reused; the first key_count_ are live
+  std::size_t key_count_;
+  std::vector<LIRSItemRef> items_;
+};
+
+#endif
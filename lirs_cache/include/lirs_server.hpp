@@ -0,0 +1,492 @@
+#ifndef LIRS_SERVER_HPP
+#define LIRS_SERVER_HPP
+
+/*
+ * Multi-reactor TCP server (Linux epoll)
+ *
+ *                  ┌──► reactor 0 [ epoll │ connections ]
+ *    listen fd ──────┼──► reactor 1 [ epoll │ connections ]
+ *   (EPOLLEXCLUSIVE) └──►    ...     one reactor woken per accept
+ *
+ *    readable ──► read all ──► session.feed(input, out) ──► sendmsg(iovecs)
+ *                               (whole pipeline at once)   (gathered replies)
+ *
+ * The reactors share one listening socket, bound without SO_REUSEPORT so
+ * a port already in use fails start() instead of splitting connections
+ * with another server.  Each reactor thread owns its epoll instance and
+ * the connections it accepted, so connections never move between threads
+ * and need no locks; only the store behind the sessions is shared.
+ *
+ * Session is the protocol state of one connection:
+ *
+ *    std::size_t feed(const char* data, std::size_t size, LIRSReplyBuffer& out);
+ *    bool closing() const;
+ *
+ * feed() consumes complete requests and appends their replies; unused
+ * bytes stay buffered until more arrive.  Replies are written as soon as
+ * a read is processed; a connection whose unsent replies exceed
+ * output_limit stops being read until the client catches up.
+ *
+ * A session that answers a request later (e.g. after a fetch on another
+ * thread) also has
+ *
+ *    void bind(LIRSServerWaker waker);      once, before the first feed()
+ *    bool waiting() const;                  a reply is outstanding
+ *    void resume(LIRSReplyBuffer& out);     append the reply if it is ready
+ *
+ * While it is waiting the connection is not read and feed() is not called;
+ * waker.wake(), from any thread, makes the reactor call resume(), send the
+ * reply and feed() the requests buffered behind it.  The connection stays
+ * open until the reply is sent, even if the client already hung up.
+ */
+
+#include "lirs_reply.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cerrno>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace lirs_detail {
+
+  // a reactor's list of connections to resume, and the eventfd that wakes it
+  struct ServerMailbox {
+    std::mutex mutex;
+    std::vector<std::uint64_t> ready;
+    int fd = -1;
+    bool open = true;
+  };
+
+  template <typename Session, typename = void>
+  struct server_resumable : std::false_type {};
+
+  template <typename Session>
+  struct server_resumable<Session, std::void_t<decltype(std::declval<Session&>().resume(std::declval<LIRSReplyBuffer&>()))>>
+    : std::true_type {};
+
+} // namespace lirs_detail
+
+// handle of one connection for a session that finishes replies off the reactor thread
+class LIRSServerWaker {
+public:
+  LIRSServerWaker() : id_(0) {}
+  LIRSServerWaker(std::shared_ptr<lirs_detail::ServerMailbox> mailbox, std::uint64_t id) : mailbox_(std::move(mailbox)), id_(id) {}
+
+  // have the reactor call resume(); a no-op once the server stopped
+  void wake() const {
+
+    if (this->mailbox_ == nullptr) return;
+
+    std::lock_guard<std::mutex> lock(this->mailbox_->mutex);
+    if (!this->mailbox_->open) return;
+
+    this->mailbox_->ready.push_back(this->id_);
+    std::uint64_t one = 1;
+    ssize_t written = ::write(this->mailbox_->fd, &one, sizeof(one));
+    (void)written;
+    return;
+  }
+
+private:
+  std::shared_ptr<lirs_detail::ServerMailbox> mailbox_;
+  std::uint64_t id_;
+};
+
+template <typename Session>
+class LIRSServer {
+public:
+  struct Options {
+    std::string host = "127.0.0.1";
+    std::uint16_t port = 11211;                           // 0 = any free port, see port()
+    std::size_t threads = 4;                              // reactors
+    int backlog = 1024;
+    std::size_t output_limit = std::size_t { 4 } << 20;  // unsent bytes before reading pauses
+  };
+
+  using SessionFactory = std::function<std::unique_ptr<Session>()>;
+
+  LIRSServer(Options options, SessionFactory make_session)
+    : options_(std::move(options)), make_session_(std::move(make_session)), port_(0), running_(false) {
+
+    if (this->options_.threads == 0) throw std::invalid_argument("Thread count must be greater than 0");
+    return;
+  }
+
+  ~LIRSServer() { this->stop(); }
+
+  LIRSServer(const LIRSServer&) = delete;
+  LIRSServer& operator=(const LIRSServer&) = delete;
+
+  // bind the socket and start the threads; throws if the port is in use
+  void start() {
+
+    if (this->running_) return;
+
+    this->stop();
+    this->listen_fd_ = open_listener(this->options_.host, this->options_.port, this->options_.backlog);
+    for (std::size_t i = 0; i < this->options_.threads; i++) {
+
+      auto reactor = std::make_unique<Reactor>();
+      reactor->epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+      reactor->wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if (reactor->epoll_fd < 0 || reactor->wake_fd < 0) throw std::system_error(errno, std::generic_category(), "epoll");
+      reactor->mailbox->fd = reactor->wake_fd;
+
+      watch(reactor->epoll_fd, EPOLL_CTL_ADD, this->listen_fd_, EPOLLIN | EPOLLEXCLUSIVE, nullptr);
+      watch(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->wake_fd, EPOLLIN, reactor.get());
+      this->reactors_.push_back(std::move(reactor));
+    }
+    this->port_ = bound_port(this->listen_fd_);
+
+    this->running_ = true;
+    for (auto& reactor : this->reactors_) {
+
+      Reactor* self = reactor.get();
+      self->thread = std::thread([this, self] { this->run(*self); });
+    }
+    return;
+  }
+
+  // stop the reactors and close every connection
+  void stop() {
+
+    if (!this->running_) {
+
+      this->reactors_.clear();
+      this->close_listener();
+      return;
+    }
+
+    this->running_ = false;
+    for (auto& reactor : this->reactors_) {
+
+      std::uint64_t one = 1;
+      ssize_t woken = ::write(reactor->wake_fd, &one, sizeof(one));
+      (void)woken;
+    }
+    for (auto& reactor : this->reactors_) reactor->thread.join();
+    this->reactors_.clear();
+    this->close_listener();
+    return;
+  }
+
+  // the port actually bound (useful with port 0)
+  std::uint16_t port() const { return this->port_; }
+
+  std::size_t connections() const {
+
+    std::size_t total = 0;
+    for (const auto& reactor : this->reactors_) total += reactor->open.load(std::memory_order_relaxed);
+    return total;
+  }
+
+private:
+  static constexpr std::size_t kReadChunk = 64 * 1024;
+  static constexpr int kEvents = 256;
+  static constexpr std::size_t kWriteSegments = 64;
+  static constexpr int kAcceptBatch = 32;   // per wakeup, so a burst spreads over the reactors
+  static constexpr bool kResumable = lirs_detail::server_resumable<Session>::value;
+
+  struct Connection {
+    int fd;
+    std::uint64_t id;
+    std::unique_ptr<Session> session;
+    std::string input;
+    LIRSReplyBuffer output;
+    std::uint32_t events = EPOLLIN | EPOLLRDHUP;   // registered with epoll
+    bool eof = false;                              // the client hung up while a reply was outstanding
+  };
+
+  struct Reactor {
+    int epoll_fd = -1;
+    int wake_fd = -1;
+    std::thread thread;
+    std::unordered_map<std::uint64_t, std::unique_ptr<Connection>> connections;
+    std::uint64_t next_id = 1;
+    std::shared_ptr<lirs_detail::ServerMailbox> mailbox = std::make_shared<lirs_detail::ServerMailbox>();
+    std::atomic<std::size_t> open { 0 };
+
+    ~Reactor() {
+
+      // wakers may outlive the reactor
+      {
+        std::lock_guard<std::mutex> lock(this->mailbox->mutex);
+        this->mailbox->open = false;
+      }
+      for (auto& connection : this->connections) ::close(connection.second->fd);
+      if (this->epoll_fd >= 0) ::close(this->epoll_fd);
+      if (this->wake_fd >= 0) ::close(this->wake_fd);
+    }
+  };
+
+  static void watch(int epoll_fd, int op, int fd, std::uint32_t events, void* tag) {
+
+    epoll_event event {};
+    event.events = events;
+    event.data.ptr = tag;
+    if (::epoll_ctl(epoll_fd, op, fd, &event) < 0) throw std::system_error(errno, std::generic_category(), "epoll_ctl");
+    return;
+  }
+
+  static int open_listener(const std::string& host, std::uint16_t port, int backlog) {
+
+    addrinfo hints {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    addrinfo* found = nullptr;
+    std::string service = std::to_string(port);
+    int status = ::getaddrinfo(host.empty() ? nullptr : host.c_str(), service.c_str(), &hints, &found);
+    if (status != 0) throw std::runtime_error("Cannot resolve " + host + ": " + ::gai_strerror(status));
+
+    std::unique_ptr<addrinfo, void (*)(addrinfo*)> guard(found, ::freeaddrinfo);
+
+    int fd = ::socket(found->ai_family, found->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, found->ai_protocol);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), "socket");
+
+    // SO_REUSEADDR only: a port another server listens on is refused
+    int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    if (::bind(fd, found->ai_addr, found->ai_addrlen) < 0 || ::listen(fd, backlog) < 0) {
+
+      int error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), "bind " + host + ":" + service);
+    }
+    return fd;
+  }
+
+  void close_listener() {
+
+    if (this->listen_fd_ >= 0) ::close(this->listen_fd_);
+    this->listen_fd_ = -1;
+    return;
+  }
+
+  static std::uint16_t bound_port(int fd) {
+
+    sockaddr_storage address {};
+    socklen_t length = sizeof(address);
+    if (::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) < 0) throw std::system_error(errno, std::generic_category(), "getsockname");
+
+    if (address.ss_family == AF_INET6) return ntohs(reinterpret_cast<sockaddr_in6*>(&address)->sin6_port);
+    return ntohs(reinterpret_cast<sockaddr_in*>(&address)->sin_port);
+  }
+
+  void run(Reactor& reactor) {
+
+    epoll_event events[kEvents];
+    while (this->running_) {
+
+      int ready = ::epoll_wait(reactor.epoll_fd, events, kEvents, -1);
+      if (ready < 0 && errno != EINTR) break;
+
+      for (int i = 0; i < ready; i++) {
+
+        void* tag = events[i].data.ptr;
+        if (tag == &reactor) {
+
+          // woken by stop() or by a session with a reply ready
+          this->resume_all(reactor);
+          continue;
+        }
+        if (tag == nullptr) {
+
+          this->accept_all(reactor);
+          continue;
+        }
+
+        Connection& connection = *static_cast<Connection*>(tag);
+        bool open = true;
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) open = false;
+        if (open && (events[i].events & EPOLLOUT)) open = this->on_writable(reactor, connection);
+        if (open && (events[i].events & EPOLLIN)) open = this->on_readable(reactor, connection);
+        if (!open) this->close(reactor, connection);
+      }
+    }
+    return;
+  }
+
+  // level-triggered: what is left after a batch wakes a reactor again
+  void accept_all(Reactor& reactor) {
+
+    for (int i = 0; i < kAcceptBatch; i++) {
+
+      int fd = ::accept4(this->listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd < 0) return;   // EAGAIN, or a connection that went away meanwhile
+
+      int one = 1;
+      ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+      auto connection = std::make_unique<Connection>();
+      connection->fd = fd;
+      connection->id = reactor.next_id++;
+      connection->session = this->make_session_();
+      if constexpr (kResumable) connection->session->bind(LIRSServerWaker(reactor.mailbox, connection->id));
+
+      watch(reactor.epoll_fd, EPOLL_CTL_ADD, fd, EPOLLIN | EPOLLRDHUP, connection.get());
+      reactor.connections.emplace(connection->id, std::move(connection));
+      reactor.open.fetch_add(1, std::memory_order_relaxed);
+    }
+    return;
+  }
+
+  // false: the connection is done
+  bool on_readable(Reactor& reactor, Connection& connection) {
+
+    char buffer[kReadChunk];
+    bool eof = false;
+    for (;;) {
+
+      ssize_t got = ::read(connection.fd, buffer, sizeof(buffer));
+      if (got > 0) {
+
+        connection.input.append(buffer, static_cast<std::size_t>(got));
+        if (static_cast<std::size_t>(got) < sizeof(buffer)) break;
+        continue;
+      }
+      if (got == 0) eof = true;
+      else if (errno == EINTR) continue;
+      else if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+      break;
+    }
+
+    connection.eof = eof;
+    return this->serve(reactor, connection);
+  }
+
+  // feed the buffered requests, then send; false: the connection is done
+  bool serve(Reactor& reactor, Connection& connection) {
+
+    // the whole pipeline read so far in one call
+    if (!waiting(connection)) {
+
+      std::size_t used = connection.session->feed(connection.input.data(), connection.input.size(), connection.output);
+      connection.input.erase(0, used);
+    }
+
+    if ((connection.eof || connection.session->closing()) && !waiting(connection)) {
+
+      write_out(connection);
+      return false;
+    }
+    return this->flush(reactor, connection);
+  }
+
+  static bool waiting(const Connection& connection) {
+
+    if constexpr (kResumable) return connection.session->waiting();
+    return false;
+  }
+
+  // connections whose session has a reply ready
+  void resume_all(Reactor& reactor) {
+
+    std::uint64_t count = 0;
+    ssize_t got = ::read(reactor.wake_fd, &count, sizeof(count));
+    (void)got;
+
+    std::vector<std::uint64_t> ready;
+    {
+      std::lock_guard<std::mutex> lock(reactor.mailbox->mutex);
+      ready.swap(reactor.mailbox->ready);
+    }
+
+    if constexpr (kResumable) {
+
+      for (std::uint64_t id : ready) {
+
+        // closed meanwhile (error or hangup reported by epoll)
+        auto found = reactor.connections.find(id);
+        if (found == reactor.connections.end()) continue;
+
+        Connection& connection = *found->second;
+        connection.session->resume(connection.output);
+        if (!this->serve(reactor, connection)) this->close(reactor, connection);
+      }
+    }
+    return;
+  }
+
+  bool on_writable(Reactor& reactor, Connection& connection) { return this->flush(reactor, connection); }
+
+  // write what the socket takes, gathering up to kWriteSegments segments per call;
+  // false on a broken connection
+  static bool write_out(Connection& connection) {
+
+    iovec vectors[kWriteSegments];
+    while (!connection.output.empty()) {
+
+      msghdr message {};
+      message.msg_iov = vectors;
+      message.msg_iovlen = connection.output.gather(vectors, kWriteSegments);
+
+      ssize_t sent = ::sendmsg(connection.fd, &message, MSG_NOSIGNAL);
+      if (sent > 0) {
+
+        connection.output.consume(static_cast<std::size_t>(sent));
+        continue;
+      }
+      if (sent < 0 && errno == EINTR) continue;
+      return sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+    return true;
+  }
+
+  // send, then wait for writability while output is pending and pause reading past the limit
+  bool flush(Reactor& reactor, Connection& connection) {
+
+    if (!write_out(connection)) return false;
+
+    // nothing is read while a reply is outstanding
+    std::size_t pending = connection.output.size();
+    std::uint32_t events = 0;
+    if (pending <= this->options_.output_limit && !waiting(connection) && !connection.eof) events |= EPOLLIN | EPOLLRDHUP;
+    if (pending > 0) events |= EPOLLOUT;
+    if (events != connection.events) {
+
+      watch(reactor.epoll_fd, EPOLL_CTL_MOD, connection.fd, events, &connection);
+      connection.events = events;
+    }
+    return true;
+  }
+
+  void close(Reactor& reactor, Connection& connection) {
+
+    int fd = connection.fd;
+    ::epoll_ctl(reactor.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    reactor.connections.erase(connection.id);
+    reactor.open.fetch_sub(1, std::memory_order_relaxed);
+    return;
+  }
+
+  Options options_;
+  SessionFactory make_session_;
+  std::uint16_t port_;
+  std::atomic<bool> running_;
+  int listen_fd_ = -1;   // shared by the reactors
+  std::vector<std::unique_ptr<Reactor>> reactors_;
+};
+
+#endif
@@ -0,0 +1,399 @@
+#ifndef LIRS_SHARDED_CACHE_HPP
+#define LIRS_SHARDED_CACHE_HPP
+
+/*
+ * Sharded LIRS cache for concurrent access
+ *
+ *    key ──hash──► shard i ──► [ mutex │ LIRSCache │ limit │ usage ]
+ *
+ *    get_many(k1..kn):  keys grouped by shard, each shard locked once
+ *
+ * Every shard is an independent LIRS cache with 1/n of the capacity, so
+ * threads working on different shards never contend.  LIRS decisions are
+ * per shard, which the hash spreads evenly enough for large key sets.
+ *
+ * With a weigher, capacity is a total charge (e.g. bytes) rather than a
+ * block count: each shard tracks the charge of its resident blocks, sizes
+ * its block capacity to limit / average charge, and evicts from Q while it
+ * is over its limit (lirs_charge.hpp).
+ *
+ * With hot.replicas set, sampled accesses find keys hot enough to saturate
+ * their shard, and those keys are also read from per-thread replicas
+ * (LIRSHotKeys); writes to them invalidate every replica.
+ *
+ * Cache is any type with the LIRSCache interface (LIRSLRUCache for a
+ * baseline).  Thread-safe.
+ */
+
+#include "lirs_cache.hpp"
+#include "lirs_charge.hpp"
+#include "lirs_hot_keys.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+template <typename K, typename V, typename Cache = LIRSCache<K, V>, typename Hash = std::hash<K>>
+class LIRSShardedCache {
+public:
+  struct Options {
+    std::size_t capacity = 0;   // total blocks, or total charge with a weigher
+    std::size_t shards = 16;    // reduced to capacity if larger
+    double hir_ratio = 0.01;
+    std::function<std::size_t(const K&, const V&)> weigher;   // charge of a block, empty = block count
+    typename LIRSHotKeys<K, V, Hash>::Options hot;               // replicas != 0: replicate hot keys
+  };
+
+  explicit LIRSShardedCache(Options options) : capacity_(options.capacity), weigher_(std::move(options.weigher)) {
+
+    if (options.capacity == 0) throw std::invalid_argument("Capacity must be greater than 0");
+    if (options.shards == 0) throw std::invalid_argument("Shard count must be greater than 0");
+    if (options.hot.replicas != 0) this->hot_ = std::make_unique<LIRSHotKeys<K, V, Hash>>(options.hot);
+
+    std::size_t count = std::min(options.shards, options.capacity);
+    for (std::size_t i = 0; i < count; i++) {
+
+      std::size_t limit = share(i, count, options.capacity);
+      std::size_t blocks = this->weigher_ ? std::max<std::size_t>(lirs_detail::kMinChargeBlocks, limit / kInitialCharge) : limit;
+
+      this->shards_.push_back(std::make_unique<Shard>(blocks, options.hir_ratio, limit));
+      Shard* shard = this->shards_.back().get();
+
+      if (this->weigher_) {
+
+        shard->cache.set_removal_listener([this, shard](const K& key, V& value) { shard->usage -= this->weigher_(key, value); });
+      }
+    }
+    return;
+  }
+
+  LIRSShardedCache(const LIRSShardedCache&) = delete;
+  LIRSShardedCache& operator=(const LIRSShardedCache&) = delete;
+
+  std::optional<V> get(const K& key) {
+
+    typename LIRSHotKeys<K, V, Hash>::Probe probe;
+    bool sampled = false;
+    if (this->hot_) {
+
+      probe = this->hot_->probe(key);
+      sampled = this->hot_->sampled();
+      if (probe.value && !sampled) return probe.value;
+    }
+
+    std::optional<V> value;
+    {
+      Shard& shard = *this->shards_[this->shard_of(key)];
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      value = shard.cache.get(key);
+    }
+
+    if (this->hot_) this->settle(key, probe, sampled, value);
+    return value;
+  }
+
+  // resident value without updating recency
+  std::optional<V> peek(const K& key) const {
+
+    const Shard& shard = *this->shards_[this->shard_of(key)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    const V* value = shard.cache.peek(key);
+    if (value == nullptr) return std::nullopt;
+    return *value;
+  }
+
+  // resident value that is LIR in its shard, without updating recency
+  std::optional<V> peek_lir(const K& key) const {
+
+    const Shard& shard = *this->shards_[this->shard_of(key)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    if (!shard.cache.is_lir(key)) return std::nullopt;
+    return *shard.cache.peek(key);
+  }
+
+  // values[i] = get(keys[i]), taking each shard's lock once for all of its keys
+  void get_many(const K* keys, std::size_t count, std::optional<V>* values) {
+
+    if (!this->hot_) {
+
+      this->lookup(keys, nullptr, count, values);
+      return;
+    }
+
+    // replica hits skip the shards, except sampled ones, which also keep the key's recency
+    std::vector<typename LIRSHotKeys<K, V, Hash>::Probe> probes(count);
+    std::vector<bool> sampled(count);
+    std::vector<std::size_t> pending;
+    for (std::size_t i = 0; i < count; i++) {
+
+      probes[i] = this->hot_->probe(keys[i]);
+      sampled[i] = this->hot_->sampled();
+      if (probes[i].value && !sampled[i]) values[i] = std::move(probes[i].value);
+      else pending.push_back(i);
+    }
+    this->lookup(keys, pending.data(), pending.size(), values);
+
+    for (std::size_t i : pending) this->settle(keys[i], probes[i], sampled[i], values[i]);
+    return;
+  }
+
+  void put(const K& key, const V& value) {
+
+    Shard& shard = *this->shards_[this->shard_of(key)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    this->store(shard, key, value);
+    return;
+  }
+
+  // insert an unreferenced block as HIR at the bottom of Q (LIRSCache::put_cold); false if resident
+  bool put_cold(const K& key, const V& value) {
+
+    Shard& shard = *this->shards_[this->shard_of(key)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    if (!shard.cache.put_cold(key, value)) return false;
+    this->invalidate(shard, key);
+    if (this->weigher_) {
+
+      shard.usage += this->weigher_(key, value);
+      this->fit(shard);
+    }
+    return true;
+  }
+
+  // atomic read-modify-write: f(const V* resident or nullptr) returns the value to store,
+  // or nullopt to leave the key alone; true if a value was stored
+  template <typename F>
+  bool compute(const K& key, F f) {
+
+    Shard& shard = *this->shards_[this->shard_of(key)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    std::optional<V> value = f(shard.cache.peek(key));
+    if (!value) return false;
+
+    this->store(shard, key, *value);
+    return true;
+  }
+
+  bool erase(const K& key) {
+
+    Shard& shard = *this->shards_[this->shard_of(key)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    this->invalidate(shard, key);
+    return shard.cache.erase(key);
+  }
+
+  // erase a resident key only if pred(value) holds, atomically; true if erased
+  template <typename F>
+  bool erase_if(const K& key, F pred) {
+
+    Shard& shard = *this->shards_[this->shard_of(key)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    const V* value = shard.cache.peek(key);
+    if (value == nullptr || !pred(*value)) return false;
+
+    this->invalidate(shard, key);
+    return shard.cache.erase(key);
+  }
+
+  // new total capacity (blocks or charge), split evenly over the shards
+  void resize(std::size_t capacity) {
+
+    if (capacity < this->shards_.size()) throw std::invalid_argument("Capacity must be at least the shard count");
+
+    for (std::size_t i = 0; i < this->shards_.size(); i++) {
+
+      Shard& shard = *this->shards_[i];
+      std::lock_guard<std::mutex> lock(shard.mutex);
+
+      shard.limit = share(i, this->shards_.size(), capacity);
+      if (this->weigher_) this->fit(shard);
+      else shard.cache.resize(shard.limit);
+    }
+
+    std::lock_guard<std::mutex> lock(this->capacity_mutex_);
+    this->capacity_ = capacity;
+    return;
+  }
+
+  // read-only access to one shard's cache under its lock, e.g. for statistics
+  template <typename F>
+  auto with_shard(std::size_t index, F f) const {
+
+    const Shard& shard = *this->shards_.at(index);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return f(static_cast<const Cache&>(shard.cache));
+  }
+
+  std::size_t size() const {
+
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < this->shards_.size(); i++) total += this->with_shard(i, [](const Cache& cache) { return cache.size(); });
+    return total;
+  }
+
+  // total charge of resident blocks (block count without a weigher)
+  std::size_t charge() const {
+
+    if (!this->weigher_) return this->size();
+
+    std::size_t total = 0;
+    for (const auto& shard : this->shards_) {
+
+      std::lock_guard<std::mutex> lock(shard->mutex);
+      total += shard->usage;
+    }
+    return total;
+  }
+
+  std::size_t capacity() const {
+
+    std::lock_guard<std::mutex> lock(this->capacity_mutex_);
+    return this->capacity_;
+  }
+
+  std::size_t shard_count() const { return this->shards_.size(); }
+
+  // hot-key replication state, nullptr when off
+  const LIRSHotKeys<K, V, Hash>* hot_keys() const { return this->hot_.get(); }
+
+  std::size_t shard_of(const K& key) const {
+
+    // Fibonacci hashing: spreads weak hashes (e.g. identity for integers) over the shards
+    std::uint64_t hash = static_cast<std::uint64_t>(Hash {}(key)) * 0x9E3779B97F4A7C15ULL;
+    return static_cast<std::size_t>((hash >> 32) % this->shards_.size());
+  }
+
+private:
+  static constexpr std::size_t kInitialCharge = 64;   // assumed charge per block before any is known
+
+  struct Shard {
+    Shard(std::size_t blocks, double hir_ratio, std::size_t limit) : cache(blocks, hir_ratio), limit(limit), usage(0) {}
+
+    mutable std::mutex mutex;
+    Cache cache;
+    std::size_t limit;   // blocks, or charge with a weigher
+    std::size_t usage;   // charge of resident blocks (weigher only)
+    std::unordered_set<K, Hash> hot;   // keys with replicas
+  };
+
+  static std::size_t share(std::size_t index, std::size_t count, std::size_t capacity) {
+
+    return capacity / count + (index < capacity % count ? 1 : 0);
+  }
+
+  // values[i] for count key indices (all keys when indices is null), each shard locked once
+  void lookup(const K* keys, const std::size_t* indices, std::size_t count, std::optional<V>* values) {
+
+    std::size_t shards = this->shards_.size();
+
+    // counting sort of key indices by shard
+    std::vector<std::size_t> index(count);
+    std::vector<std::size_t> start(shards + 1, 0);
+    for (std::size_t j = 0; j < count; j++) start[this->shard_of(keys[indices ? indices[j] : j]) + 1]++;
+    for (std::size_t s = 0; s < shards; s++) start[s + 1] += start[s];
+
+    std::vector<std::size_t> next(start.begin(), start.end() - 1);
+    for (std::size_t j = 0; j < count; j++) {
+
+      std::size_t i = indices ? indices[j] : j;
+      index[next[this->shard_of(keys[i])]++] = i;
+    }
+
+    for (std::size_t s = 0; s < shards; s++) {
+
+      if (start[s] == start[s + 1]) continue;
+
+      Shard& shard = *this->shards_[s];
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      for (std::size_t at = start[s]; at < start[s + 1]; at++) values[index[at]] = shard.cache.get(keys[index[at]]);
+    }
+    return;
+  }
+
+  // after a shard lookup of key: fill this thread's replica, count the sample
+  void settle(const K& key, const typename LIRSHotKeys<K, V, Hash>::Probe& probe, bool sampled, const std::optional<V>& value) {
+
+    if (probe.hot && !probe.value && value) this->hot_->fill(key, *value, probe.generation);
+    if (sampled) this->sample(key);
+    return;
+  }
+
+  // count a sampled access; at the end of a period, move replicas to the new hot set
+  void sample(const K& key) {
+
+    this->hot_->record(key, [this](const std::vector<K>& promote, const std::vector<K>& demote) {
+
+      for (const K& cold : demote) {
+
+        Shard& shard = *this->shards_[this->shard_of(cold)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.hot.erase(cold) != 0) this->hot_->drop(cold);
+      }
+      for (const K& hot : promote) {
+
+        Shard& shard = *this->shards_[this->shard_of(hot)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.hot.insert(hot).second) this->hot_->add(hot);
+      }
+    });
+    return;
+  }
+
+  // caller holds shard.mutex and has just changed key
+  void invalidate(Shard& shard, const K& key) {
+
+    if (!shard.hot.empty() && shard.hot.count(key) != 0) this->hot_->invalidate(key);
+    return;
+  }
+
+  // caller holds shard.mutex
+  void store(Shard& shard, const K& key, const V& value) {
+
+    if (!this->weigher_) {
+
+      shard.cache.put(key, value);
+      this->invalidate(shard, key);
+      return;
+    }
+
+    // a replaced value leaves without the removal listener
+    const V* previous = shard.cache.peek(key);
+    if (previous != nullptr) shard.usage -= this->weigher_(key, *previous);
+
+    shard.cache.put(key, value);
+    shard.usage += this->weigher_(key, value);
+    this->invalidate(shard, key);
+
+    this->fit(shard);
+    return;
+  }
+
+  // caller holds shard.mutex: size the block capacity to limit / average charge, then
+  // evict until the charge fits
+  void fit(Shard& shard) {
+
+    lirs_detail::fit_charge(shard.cache, shard.limit, [&shard]() { return shard.usage; });
+    return;
+  }
+
+  mutable std::mutex capacity_mutex_;
+  std::size_t capacity_;
+  std::function<std::size_t(const K&, const V&)> weigher_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::unique_ptr<LIRSHotKeys<K, V, Hash>> hot_;
+};
+
+#endif
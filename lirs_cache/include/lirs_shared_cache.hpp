@@ -0,0 +1,406 @@
+#ifndef LIRS_SHARED_CACHE_HPP
+#define LIRS_SHARED_CACHE_HPP
+
+/*
+ * LIRS cache shared by the processes of one host (POSIX shared memory)
+ *
+ *    /dev/shm/<name>
+ *    ┌──────────┬────────────────────────────┬────────────────────────────┬───
+ *    │ Segment  │ shard 0                    │ shard 1                    │ ...
+ *    │ params,  │ robust mutex │ LIRSImage   │ robust mutex │ LIRSImage   │
+ *    │ ready    │ recoveries   │ (u32 links) │ recoveries   │ (u32 links) │
+ *    └──────────┴────────────────────────────┴────────────────────────────┴───
+ *
+ * The first process to open a name creates and formats the segment; the
+ * others map it once it is marked ready.  The creator holds an flock() on the
+ * segment while it formats: an opener that times out waiting for ready and
+ * can take that lock knows the creator died, unlinks the name and starts
+ * over, so a crash during creation does not block the name forever.  Each shard is an LIRSImage, whose
+ * nodes (key, value, S/Q/hash links) refer to each other by index, so every
+ * process may map the segment at a different address.  Values live inline
+ * in the node arena: keys and values must be trivially copyable and the
+ * hash must be stable across processes.
+ *
+ * Shards are guarded by robust, process-shared mutexes.  If a process dies
+ * holding one, the next locker gets EOWNERDEAD; the shard may be mid-update,
+ * so it is cleared (as a crashed LIRSMappedCache image is reformatted) and
+ * the mutex marked consistent.  Only that shard's contents are lost.
+ *
+ * The segment outlives its users; remove() unlinks the name.  Thread-safe.
+ */
+
+#include "lirs_image.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+template <typename K, typename V, typename Hash = std::hash<K>>
+class LIRSSharedCache {
+public:
+  using Image = LIRSImage<K, V, Hash>;
+
+  struct Options {
+    std::size_t capacity = 0;             // total blocks over all shards
+    std::size_t shards = 16;              // reduced to capacity if larger
+    double hir_ratio = 0.01;
+    std::size_t ghost_limit = 0;          // total ghost entries, 0 = capacity
+    unsigned attach_timeout_ms = 5000;    // wait for the creator to finish formatting
+  };
+
+  // open or create the segment called name (as for shm_open, e.g. "/app-cache")
+  LIRSSharedCache(const std::string& name, Options options)
+    : name_(name), fd_(-1), region_(nullptr), size_(0), created_(false) {
+
+    if (options.capacity == 0) throw std::invalid_argument("Capacity must be greater than 0");
+    if (options.shards == 0) throw std::invalid_argument("Shard count must be greater than 0");
+    if (options.hir_ratio <= 0.0 || options.hir_ratio >= 1.0) throw std::invalid_argument("HIR ratio must be in range(0, 1)");
+
+    this->shard_count_ = std::min(options.shards, options.capacity);
+    this->ghost_limit_ = options.ghost_limit == 0 ? options.capacity : options.ghost_limit;
+    this->ghost_limit_ = std::max(this->ghost_limit_, this->shard_count_);
+
+    // every shard gets the stride of the largest one
+    std::size_t largest = Image::region_size(share(0, this->shard_count_, options.capacity),
+                                             share(0, this->shard_count_, this->ghost_limit_));
+    this->stride_ = round_up(sizeof(Shard) + largest, kAlignment);
+    this->size_ = sizeof(Segment) + this->shard_count_ * this->stride_;
+
+    while (true) {
+
+      this->fd_ = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+      if (this->fd_ >= 0) this->created_ = true;
+      else if (errno == EEXIST) this->fd_ = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0600);
+      if (this->fd_ < 0 && errno == ENOENT) continue;   // unlinked in between
+      if (this->fd_ < 0) throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+
+      try {
+
+        if (this->created_) {
+
+          this->create(options);
+          return;
+        }
+        if (this->attach(options)) return;
+      } catch (...) {
+
+        // a half-formatted segment would block every later opener
+        if (this->created_) ::shm_unlink(name.c_str());
+        this->unmap();
+        throw;
+      }
+
+      // the creator died before the segment was ready and its name was removed: start over
+      this->unmap();
+    }
+  }
+
+  ~LIRSSharedCache() { this->unmap(); }
+
+  LIRSSharedCache(const LIRSSharedCache&) = delete;
+  LIRSSharedCache& operator=(const LIRSSharedCache&) = delete;
+
+  // unlink a segment name; processes that have it mapped keep using it
+  static bool remove(const std::string& name) {
+
+    if (::shm_unlink(name.c_str()) == 0) return true;
+    if (errno == ENOENT) return false;
+    throw std::system_error(errno, std::generic_category(), "shm_unlink " + name);
+  }
+
+  std::optional<V> get(const K& key) {
+
+    std::size_t index = this->shard_of(key);
+    Lock lock(*this, index);
+    return this->images_[index].get(key);
+  }
+
+  void put(const K& key, const V& value) {
+
+    std::size_t index = this->shard_of(key);
+    Lock lock(*this, index);
+    this->images_[index].put(key, value);
+    return;
+  }
+
+  // drop every entry, in every process
+  void clear() {
+
+    for (std::size_t i = 0; i < this->shard_count_; i++) {
+
+      Lock lock(*this, i);
+      this->images_[i].clear();
+    }
+    return;
+  }
+
+  std::size_t size() const { return this->sum([](const Image& image) { return image.size(); }); }
+  std::size_t capacity() const { return this->segment()->capacity; }
+  bool empty() const { return this->size() == 0; }
+
+  std::size_t lir_count() const { return this->sum([](const Image& image) { return image.lir_count(); }); }
+  std::size_t ghost_count() const { return this->sum([](const Image& image) { return image.ghost_count(); }); }
+
+  std::size_t shard_count() const { return this->shard_count_; }
+
+  std::size_t shard_of(const K& key) const {
+
+    std::uint64_t hash = static_cast<std::uint64_t>(Hash {}(key)) * 0x9E3779B97F4A7C15ULL;
+    return static_cast<std::size_t>((hash >> 32) % this->shard_count_);
+  }
+
+  // true if this process created (and formatted) the segment
+  bool created() const { return this->created_; }
+
+  // shards cleared after their lock holder died, over the segment's lifetime
+  std::uint64_t recoveries() const {
+
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < this->shard_count_; i++) total += this->shard(i)->recoveries.load(std::memory_order_relaxed);
+    return total;
+  }
+
+  const std::string& name() const { return this->name_; }
+
+private:
+  static constexpr char kMagic[8] = { 'L', 'I', 'R', 'S', 'S', 'H', 'M', '1' };
+  static constexpr std::uint32_t kVersion = 1;
+  static constexpr std::size_t kAlignment = 64;
+  static constexpr unsigned kAttachPollMs = 1;
+
+  static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "Shared segments need lock-free 32-bit atomics");
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "Shared segments need lock-free 64-bit atomics");
+
+  struct alignas(64) Segment {
+    char magic[8];
+    std::uint32_t version;
+    std::atomic<std::uint32_t> ready;   // set by the creator once every shard is formatted
+    std::uint64_t capacity;
+    std::uint64_t shard_count;
+    std::uint64_t ghost_limit;
+    std::uint64_t stride;               // bytes per shard, header included
+    double hir_ratio;
+  };
+
+  struct alignas(64) Shard {
+    pthread_mutex_t mutex;              // robust, process-shared
+    std::atomic<std::uint64_t> recoveries;
+  };
+
+  // shard lock that repairs the shard when its previous holder died
+  class Lock {
+  public:
+    Lock(const LIRSSharedCache& cache, std::size_t index) : mutex_(&cache.shard(index)->mutex) {
+
+      int result = pthread_mutex_lock(this->mutex_);
+      if (result == EOWNERDEAD) {
+
+        // the dead holder may have left the lists half-linked: start the shard over
+        cache.images_[index].clear();
+        cache.shard(index)->recoveries.fetch_add(1, std::memory_order_relaxed);
+        result = pthread_mutex_consistent(this->mutex_);
+      }
+      if (result != 0) throw std::system_error(result, std::generic_category(), "lock shared shard");
+    }
+
+    ~Lock() { pthread_mutex_unlock(this->mutex_); }
+
+    Lock(const Lock&) = delete;
+    Lock& operator=(const Lock&) = delete;
+
+  private:
+    pthread_mutex_t* mutex_;
+  };
+
+  static std::size_t share(std::size_t index, std::size_t count, std::size_t total) {
+
+    return total / count + (index < total % count ? 1 : 0);
+  }
+
+  static std::size_t round_up(std::size_t value, std::size_t unit) { return (value + unit - 1) / unit * unit; }
+
+  Segment* segment() const { return static_cast<Segment*>(this->region_); }
+
+  Shard* shard(std::size_t index) const {
+
+    return reinterpret_cast<Shard*>(static_cast<char*>(this->region_) + sizeof(Segment) + index * this->stride_);
+  }
+
+  void* image_region(std::size_t index) const { return reinterpret_cast<char*>(this->shard(index)) + sizeof(Shard); }
+
+  void map() {
+
+    void* addr = ::mmap(nullptr, this->size_, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd_, 0);
+    if (addr == MAP_FAILED) throw std::system_error(errno, std::generic_category(), "mmap " + this->name_);
+    this->region_ = addr;
+    return;
+  }
+
+  void create(const Options& options) {
+
+    // held until ready is set; an opener that can take it knows this process died
+    if (::flock(this->fd_, LOCK_EX) != 0) throw std::system_error(errno, std::generic_category(), "flock " + this->name_);
+
+    if (::ftruncate(this->fd_, static_cast<off_t>(this->size_)) != 0) {
+
+      throw std::system_error(errno, std::generic_category(), "ftruncate " + this->name_);
+    }
+    this->map();
+
+    // the new segment is zero-filled; ready stays 0 until the shards are usable
+    Segment* segment = this->segment();
+    std::memcpy(segment->magic, kMagic, sizeof(kMagic));
+    segment->version = kVersion;
+    segment->capacity = options.capacity;
+    segment->shard_count = this->shard_count_;
+    segment->ghost_limit = this->ghost_limit_;
+    segment->stride = this->stride_;
+    segment->hir_ratio = options.hir_ratio;
+
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+
+    for (std::size_t i = 0; i < this->shard_count_; i++) {
+
+      int result = pthread_mutex_init(&this->shard(i)->mutex, &attributes);
+      if (result != 0) {
+
+        pthread_mutexattr_destroy(&attributes);
+        throw std::system_error(result, std::generic_category(), "pthread_mutex_init");
+      }
+
+      std::size_t limit = this->stride_ - sizeof(Shard);
+      this->images_.push_back(Image::format(this->image_region(i), limit, share(i, this->shard_count_, options.capacity),
+                                            options.hir_ratio, share(i, this->shard_count_, this->ghost_limit_)));
+    }
+    pthread_mutexattr_destroy(&attributes);
+
+    segment->ready.store(1, std::memory_order_release);
+    ::flock(this->fd_, LOCK_UN);
+    return;
+  }
+
+  // false if the segment was abandoned by its creator and unlinked
+  bool attach(const Options& options) {
+
+    // the creator may still be sizing and formatting the segment
+    for (unsigned waited = 0; !this->ready(); waited += kAttachPollMs) {
+
+      if (waited >= options.attach_timeout_ms) {
+
+        if (this->reclaim()) return false;
+        if (!this->ready()) throw std::runtime_error("Shared segment " + this->name_ + " was never initialized");
+        break;
+      }
+      ::usleep(kAttachPollMs * 1000);
+    }
+
+    Segment* segment = this->segment();
+    bool matches = std::memcmp(segment->magic, kMagic, sizeof(kMagic)) == 0 && segment->version == kVersion &&
+                   segment->capacity == options.capacity && segment->shard_count == this->shard_count_ &&
+                   segment->ghost_limit == this->ghost_limit_ && segment->stride == this->stride_ &&
+                   segment->hir_ratio == options.hir_ratio;
+
+    for (std::size_t i = 0; matches && i < this->shard_count_; i++) {
+
+      matches = Image::compatible(this->image_region(i), this->stride_ - sizeof(Shard), share(i, this->shard_count_, options.capacity),
+                                  options.hir_ratio, share(i, this->shard_count_, this->ghost_limit_));
+    }
+    if (!matches) throw std::invalid_argument("Shared segment " + this->name_ + " was created with different parameters");
+
+    for (std::size_t i = 0; i < this->shard_count_; i++) this->images_.emplace_back(this->image_region(i));
+    return true;
+  }
+
+  // sized, mapped and marked ready by the creator
+  bool ready() {
+
+    struct stat st;
+    if (::fstat(this->fd_, &st) != 0) throw std::system_error(errno, std::generic_category(), "fstat " + this->name_);
+    if (static_cast<std::size_t>(st.st_size) < sizeof(Segment)) return false;
+
+    if (static_cast<std::size_t>(st.st_size) != this->size_) {
+
+      throw std::invalid_argument("Shared segment " + this->name_ + " was created with different parameters");
+    }
+    if (this->region_ == nullptr) this->map();
+    return this->segment()->ready.load(std::memory_order_acquire) != 0;
+  }
+
+  // never ready and the creator's lock is free: it died mid-creation.  Unlink the name
+  // if it still refers to this segment (another opener may have done so already);
+  // false if the creator is still alive or the segment became ready meanwhile
+  bool reclaim() {
+
+    if (::flock(this->fd_, LOCK_EX | LOCK_NB) != 0) return false;
+
+    bool stale = !this->ready();
+    if (stale) {
+
+      struct stat mine;
+      struct stat named;
+      int fd = ::shm_open(this->name_.c_str(), O_RDWR | O_CLOEXEC, 0600);
+      if (fd >= 0) {
+
+        if (::fstat(fd, &named) == 0 && ::fstat(this->fd_, &mine) == 0 && named.st_dev == mine.st_dev && named.st_ino == mine.st_ino) {
+
+          ::shm_unlink(this->name_.c_str());
+        }
+        ::close(fd);
+      }
+    }
+
+    ::flock(this->fd_, LOCK_UN);
+    return stale;
+  }
+
+  template <typename F>
+  std::size_t sum(F f) const {
+
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < this->shard_count_; i++) {
+
+      Lock lock(*this, i);
+      total += f(this->images_[i]);
+    }
+    return total;
+  }
+
+  void unmap() {
+
+    if (this->region_ != nullptr) ::munmap(this->region_, this->size_);
+    if (this->fd_ >= 0) ::close(this->fd_);
+    this->region_ = nullptr;
+    this->fd_ = -1;
+    this->images_.clear();
+    return;
+  }
+
+  std::string name_;
+  int fd_;
+  void* region_;
+  std::size_t size_;
+  std::size_t shard_count_;
+  std::size_t ghost_limit_;
+  std::size_t stride_;
+  bool created_;
+  mutable std::vector<Image> images_;   // per-process views of the shards, repaired under const locks
+};
+
+#endif
@@ -0,0 +1,503 @@
+#ifndef LIRS_SLAB_CACHE_HPP
+#define LIRS_SLAB_CACHE_HPP
+
+/*
+ * Slab-allocated value store (memcached style) under LIRS
+ *
+ *    arena ──► pages (page_size each) ──► assigned to a size class on demand
+ *
+ *    class 0 :   64 B chunks  ┌──┬──┬──┬──┬──┬──┐
+ *    class 1 :   80 B chunks  ├───┬───┬───┬───┬─┤   chunk: owner u32 │ length u32 │ value bytes
+ *    ...       x growth       └───────────────┘
+ *
+ * Each class runs its own LIRS over exactly the chunks its pages hold (like
+ * memcached's per-class LRU), so set() takes a chunk from the value's class:
+ * free list, then an unassigned page, then that class's LIRS victim.  Freed
+ * chunks go back to their class, so varying value sizes never fragment the
+ * heap: memory is the arena plus the per-key index.
+ *
+ * Classes take unassigned pages as they fill.  Once none are left, the
+ * rebalancer moves one page per call from the class with the least eviction
+ * pressure to the class with the most (evictions and failed sets since the
+ * last call).  It can run automatically every rebalance_after evictions.
+ *
+ * Not thread-safe (like LIRSCache).  Values returned by get() stay valid
+ * until the next set/erase.
+ */
+
+#include "lirs_arena.hpp"
+#include "lirs_cache.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// pages carved into size-class chunks
+class LIRSSlabArena {
+public:
+  struct Options {
+    std::size_t memory = std::size_t { 64 } << 20;    // arena bytes
+    std::size_t page_size = std::size_t { 1 } << 20;  // unit moved between classes
+    std::size_t min_chunk = 64;                       // smallest chunk, header included
+    double growth = 1.25;                             // chunk size factor between classes
+    LIRSHugePages huge_pages = LIRSHugePages::None;   // arena page backing (lirs_arena.hpp)
+    bool prefault = false;                            // fault the arena in at construction
+  };
+
+  struct ChunkHeader {
+    std::uint32_t owner;    // user index, kFree when unused
+    std::uint32_t length;   // value bytes
+  };
+
+  static constexpr std::uint32_t kFree = UINT32_MAX;
+  static constexpr std::uint32_t kNoClass = UINT32_MAX;
+
+  explicit LIRSSlabArena(Options options)
+    : options_(options), region_(arena_bytes(options), LIRSArena::Options { options.huge_pages, options.prefault })
+    , memory_(static_cast<char*>(this->region_.data())) {
+
+    std::size_t pages = options.memory / options.page_size;
+    this->pages_.assign(pages, Page { kNoClass, 0 });
+    for (std::size_t i = pages; i > 0; i--) this->free_pages_.push_back(static_cast<std::uint32_t>(i - 1));
+
+    // chunk sizes grow geometrically (8-byte aligned) up to one page
+    for (double size = static_cast<double>(options.min_chunk);;) {
+
+      std::size_t chunk = (static_cast<std::size_t>(size) + 7) & ~std::size_t { 7 };
+      if (chunk >= options.page_size) break;
+      if (this->classes_.empty() || chunk > this->classes_.back().chunk) this->classes_.push_back(Class { chunk, {}, 0, 0 });
+      size *= options.growth;
+    }
+    this->classes_.push_back(Class { options.page_size, {}, 0, 0 });
+    return;
+  }
+
+  LIRSSlabArena(const LIRSSlabArena&) = delete;
+  LIRSSlabArena& operator=(const LIRSSlabArena&) = delete;
+
+  // smallest class holding length value bytes, kNoClass if larger than a page
+  std::uint32_t class_for(std::size_t length) const {
+
+    std::size_t need = length + sizeof(ChunkHeader);
+    auto iter = std::lower_bound(this->classes_.begin(), this->classes_.end(), need,
+                                 [](const Class& cls, std::size_t size) { return cls.chunk < size; });
+    return iter == this->classes_.end() ? kNoClass : static_cast<std::uint32_t>(iter - this->classes_.begin());
+  }
+
+  std::uint32_t class_of(const char* chunk) const { return this->pages_[this->page_of(chunk)].cls; }
+
+  // a free chunk of the class (assigning a fresh page if needed), nullptr if none
+  char* allocate(std::uint32_t cls) {
+
+    Class& slab = this->classes_[cls];
+    if (slab.free.empty() && !this->assign_page(cls)) return nullptr;
+
+    char* chunk = slab.free.back();
+    slab.free.pop_back();
+    slab.used++;
+    this->pages_[this->page_of(chunk)].used++;
+    return chunk;
+  }
+
+  // give an unassigned page to the class; false if there is none
+  bool assign_page(std::uint32_t cls) {
+
+    if (this->free_pages_.empty()) return false;
+
+    std::uint32_t page = this->free_pages_.back();
+    this->free_pages_.pop_back();
+    this->pages_[page] = Page { cls, 0 };
+
+    Class& slab = this->classes_[cls];
+    slab.pages++;
+
+    // push in reverse so chunks are handed out in address order
+    std::vector<char*> chunks;
+    this->for_each_chunk(page, [&](char* chunk) {
+
+      header(chunk).owner = kFree;
+      chunks.push_back(chunk);
+    });
+    slab.free.insert(slab.free.end(), chunks.rbegin(), chunks.rend());
+    return true;
+  }
+
+  void release(char* chunk) {
+
+    header(chunk).owner = kFree;
+
+    Class& slab = this->classes_[this->class_of(chunk)];
+    slab.free.push_back(chunk);
+    slab.used--;
+    this->pages_[this->page_of(chunk)].used--;
+    return;
+  }
+
+  // least used page of a class (for the rebalancer), or UINT32_MAX
+  std::uint32_t emptiest_page(std::uint32_t cls) const {
+
+    std::uint32_t best = UINT32_MAX;
+    for (std::uint32_t page = 0; page < this->pages_.size(); page++) {
+
+      if (this->pages_[page].cls != cls) continue;
+      if (best == UINT32_MAX || this->pages_[page].used < this->pages_[best].used) best = page;
+    }
+    return best;
+  }
+
+  // chunks of a page (used or free)
+  template <typename Visit>
+  void for_each_chunk(std::uint32_t page, Visit visit) {
+
+    std::size_t chunk = this->classes_[this->pages_[page].cls].chunk;
+    char* base = this->memory_ + static_cast<std::size_t>(page) * this->options_.page_size;
+    for (std::size_t offset = 0; offset + chunk <= this->options_.page_size; offset += chunk) visit(base + offset);
+    return;
+  }
+
+  // return an emptied page (no used chunks) to the unassigned pool
+  void unassign_page(std::uint32_t page) {
+
+    Class& slab = this->classes_[this->pages_[page].cls];
+    char* begin = this->memory_ + static_cast<std::size_t>(page) * this->options_.page_size;
+    char* end = begin + this->options_.page_size;
+
+    slab.free.erase(std::remove_if(slab.free.begin(), slab.free.end(),
+                                   [&](char* chunk) { return chunk >= begin && chunk < end; }),
+                    slab.free.end());
+    slab.pages--;
+
+    this->pages_[page] = Page { kNoClass, 0 };
+    this->free_pages_.push_back(page);
+    return;
+  }
+
+  static ChunkHeader& header(char* chunk) { return *reinterpret_cast<ChunkHeader*>(chunk); }
+  static char* payload(char* chunk) { return chunk + sizeof(ChunkHeader); }
+
+  std::size_t class_count() const { return this->classes_.size(); }
+  std::size_t chunk_size(std::uint32_t cls) const { return this->classes_[cls].chunk; }
+  std::size_t class_pages(std::uint32_t cls) const { return this->classes_[cls].pages; }
+  std::size_t class_used(std::uint32_t cls) const { return this->classes_[cls].used; }
+  std::size_t class_free(std::uint32_t cls) const { return this->classes_[cls].free.size(); }
+  std::size_t free_pages() const { return this->free_pages_.size(); }
+  std::size_t page_size() const { return this->options_.page_size; }
+  std::size_t memory() const { return this->pages_.size() * this->options_.page_size; }
+  const char* backing_name() const { return this->region_.backing_name(); }
+
+private:
+  struct Page {
+    std::uint32_t cls;    // owning class, kNoClass if unassigned
+    std::uint32_t used;   // chunks in use
+  };
+
+  struct Class {
+    std::size_t chunk;         // chunk bytes, header included
+    std::vector<char*> free;   // free chunks
+    std::size_t pages;
+    std::size_t used;
+  };
+
+  // validated arena size: whole pages only
+  static std::size_t arena_bytes(const Options& options) {
+
+    if (options.page_size < options.min_chunk || options.min_chunk < sizeof(ChunkHeader) + 8 || options.growth <= 1.0) {
+
+      throw std::invalid_argument("Invalid slab options");
+    }
+
+    std::size_t pages = options.memory / options.page_size;
+    if (pages == 0) throw std::invalid_argument("Slab memory must hold at least one page");
+    return pages * options.page_size;
+  }
+
+  std::uint32_t page_of(const char* chunk) const {
+
+    return static_cast<std::uint32_t>(static_cast<std::size_t>(chunk - this->memory_) / this->options_.page_size);
+  }
+
+  Options options_;
+  LIRSArena region_;
+  char* memory_;
+  std::vector<Page> pages_;
+  std::vector<std::uint32_t> free_pages_;
+  std::vector<Class> classes_;
+};
+
+template <typename K>
+class LIRSSlabCache {
+public:
+  struct Options {
+    LIRSSlabArena::Options arena;
+    double hir_ratio = 0.01;
+    std::size_t rebalance_after = 0;   // evictions/failures between automatic rebalances, 0 = manual only
+  };
+
+  struct ClassStats {
+    std::size_t chunk_size;
+    std::size_t pages;
+    std::size_t used;        // chunks holding values
+    std::size_t free;        // chunks ready for reuse
+    std::uint64_t evictions; // values of this class evicted
+    std::uint64_t failures;  // sets that found no chunk
+    std::uint64_t moved_in;  // pages gained from rebalancing
+    std::uint64_t moved_out; // pages given away
+  };
+
+  LIRSSlabCache() : LIRSSlabCache(Options {}) {}
+
+  explicit LIRSSlabCache(Options options)
+    : options_(options), arena_(options.arena), caches_(this->arena_.class_count())
+    , stats_(this->arena_.class_count(), ClassStats {}), pressure_(this->arena_.class_count(), 0)
+    , failed_(this->arena_.class_count(), 0)
+    , erasing_(false), since_rebalance_(0) {
+
+    if (options.hir_ratio <= 0.0 || options.hir_ratio >= 1.0) throw std::invalid_argument("HIR ratio must be in range(0, 1)");
+
+    for (std::uint32_t cls = 0; cls < this->arena_.class_count(); cls++) this->stats_[cls].chunk_size = this->arena_.chunk_size(cls);
+    return;
+  }
+
+  LIRSSlabCache(const LIRSSlabCache&) = delete;
+  LIRSSlabCache& operator=(const LIRSSlabCache&) = delete;
+
+  // store a copy of the value; false (and the key dropped) if it is larger than a page or its class has no room
+  bool set(const K& key, std::string_view value) {
+
+    std::uint32_t cls = this->arena_.class_for(value.size());
+
+    // a value changing class leaves its old chunk behind
+    auto found = this->index_.find(key);
+    if (found != this->index_.end() && found->second != cls) this->erase(key);
+
+    char* chunk = cls == LIRSSlabArena::kNoClass ? nullptr : this->allocate(cls);
+    if (chunk == nullptr) {
+
+      this->erase(key);
+      if (cls == LIRSSlabArena::kNoClass) return false;
+
+      this->stats_[cls].failures++;
+      this->pressure_[cls]++;
+      this->failed_[cls]++;
+      this->since_rebalance_++;
+      this->maybe_rebalance();
+      return false;
+    }
+
+    // keep the owner slot of a replaced value
+    LIRSCache<K, char*>& cache = *this->caches_[cls];
+    std::uint32_t owner;
+    char* const* previous = cache.peek(key);
+    if (previous != nullptr) {
+
+      owner = LIRSSlabArena::header(*previous).owner;
+      this->arena_.release(*previous);
+    } else {
+
+      owner = this->new_owner(key);
+    }
+
+    LIRSSlabArena::header(chunk) = LIRSSlabArena::ChunkHeader { owner, static_cast<std::uint32_t>(value.size()) };
+    std::memcpy(LIRSSlabArena::payload(chunk), value.data(), value.size());
+
+    cache.put(key, chunk);
+    this->index_[key] = cls;
+    this->maybe_rebalance();
+    return true;
+  }
+
+  // view of the cached value, valid until the next set/erase
+  std::optional<std::string_view> get(const K& key) {
+
+    auto found = this->index_.find(key);
+    if (found == this->index_.end()) return std::nullopt;
+
+    std::optional<char*> chunk = this->caches_[found->second]->get(key);
+    if (!chunk) return std::nullopt;
+
+    return std::string_view(LIRSSlabArena::payload(*chunk), LIRSSlabArena::header(*chunk).length);
+  }
+
+  bool erase(const K& key) {
+
+    auto found = this->index_.find(key);
+    if (found == this->index_.end()) return false;
+
+    this->erasing_ = true;
+    this->caches_[found->second]->erase(key);
+    this->erasing_ = false;
+    return true;
+  }
+
+  // move one page toward the class under the most eviction pressure; false if
+  // nothing moved (or unassigned pages are left)
+  bool rebalance() {
+
+    this->since_rebalance_ = 0;
+
+    // dest: most failed sets (they could not be stored at all), then most evictions
+    std::uint32_t dest = LIRSSlabArena::kNoClass;
+    for (std::uint32_t cls = 0; cls < this->pressure_.size(); cls++) {
+
+      if (this->pressure_[cls] == 0) continue;
+      if (dest == LIRSSlabArena::kNoClass || this->failed_[cls] > this->failed_[dest] ||
+          (this->failed_[cls] == this->failed_[dest] && this->pressure_[cls] > this->pressure_[dest])) {
+
+        dest = cls;
+      }
+    }
+
+    // source: least pressure, then most free chunks; it must keep at least one page
+    std::uint32_t source = LIRSSlabArena::kNoClass;
+    for (std::uint32_t cls = 0; dest != LIRSSlabArena::kNoClass && cls < this->pressure_.size(); cls++) {
+
+      if (cls == dest || this->arena_.class_pages(cls) < 2) continue;
+      if (source == LIRSSlabArena::kNoClass || this->pressure_[cls] < this->pressure_[source] ||
+          (this->pressure_[cls] == this->pressure_[source] && this->arena_.class_free(cls) > this->arena_.class_free(source))) {
+
+        source = cls;
+      }
+    }
+
+    // classes under similar pressure would just trade pages back and forth
+    bool move = source != LIRSSlabArena::kNoClass && this->arena_.free_pages() == 0 &&
+                ((this->failed_[dest] > 0 && this->failed_[source] == 0) || this->pressure_[source] * 2 < this->pressure_[dest]);
+    std::fill(this->pressure_.begin(), this->pressure_.end(), 0);
+    std::fill(this->failed_.begin(), this->failed_.end(), 0);
+    if (!move) return false;
+
+    // drop what still lives on the source's emptiest page, then hand it over
+    std::uint32_t page = this->arena_.emptiest_page(source);
+    std::vector<std::uint32_t> owners;
+    this->arena_.for_each_chunk(page, [&](char* chunk) {
+
+      std::uint32_t owner = LIRSSlabArena::header(chunk).owner;
+      if (owner != LIRSSlabArena::kFree) owners.push_back(owner);
+    });
+
+    this->erasing_ = true;
+    for (std::uint32_t owner : owners) {
+
+      K key = this->owners_[owner];
+      this->caches_[source]->erase(key);
+    }
+    this->arena_.unassign_page(page);
+    this->fit_class(source);
+    this->erasing_ = false;
+
+    this->arena_.assign_page(dest);
+    this->fit_class(dest);
+
+    this->stats_[source].moved_out++;
+    this->stats_[dest].moved_in++;
+    return true;
+  }
+
+  std::vector<ClassStats> class_stats() const {
+
+    std::vector<ClassStats> stats = this->stats_;
+    for (std::uint32_t cls = 0; cls < stats.size(); cls++) {
+
+      stats[cls].pages = this->arena_.class_pages(cls);
+      stats[cls].used = this->arena_.class_used(cls);
+      stats[cls].free = this->arena_.class_free(cls);
+    }
+    return stats;
+  }
+
+  std::size_t size() const { return this->index_.size(); }
+  std::size_t memory() const { return this->arena_.memory(); }
+  const char* backing_name() const { return this->arena_.backing_name(); }
+  std::size_t free_pages() const { return this->arena_.free_pages(); }
+
+private:
+  // a chunk of the class: free list, fresh page, then the class's own LIRS victim
+  char* allocate(std::uint32_t cls) {
+
+    char* chunk = this->arena_.allocate(cls);
+    if (chunk != nullptr) {
+
+      this->fit_class(cls);
+      return chunk;
+    }
+    if (this->caches_[cls] == nullptr) return nullptr;
+
+    LIRSCache<K, char*>& cache = *this->caches_[cls];
+    if (!cache.evict_one() && !(cache.demote_one() && cache.evict_one())) return nullptr;
+    return this->arena_.allocate(cls);
+  }
+
+  // each class runs its own LIRS over exactly the chunks its pages hold
+  void fit_class(std::uint32_t cls) {
+
+    std::size_t chunks = this->arena_.class_pages(cls) * (this->arena_.page_size() / this->arena_.chunk_size(cls));
+    std::unique_ptr<LIRSCache<K, char*>>& cache = this->caches_[cls];
+
+    if (cache == nullptr) {
+
+      cache = std::make_unique<LIRSCache<K, char*>>(chunks, this->options_.hir_ratio);
+      cache->set_removal_listener([this](const K& key, char*& chunk) { this->free_chunk(key, chunk); });
+    } else if (cache->capacity() != chunks) {
+
+      cache->resize(chunks);
+    }
+    return;
+  }
+
+  // removal listener: eviction or erase
+  void free_chunk(const K& key, char* chunk) {
+
+    std::uint32_t cls = this->arena_.class_of(chunk);
+    if (!this->erasing_) {
+
+      this->stats_[cls].evictions++;
+      this->pressure_[cls]++;
+      this->since_rebalance_++;
+    }
+
+    this->index_.erase(key);
+    this->free_owners_.push_back(LIRSSlabArena::header(chunk).owner);
+    this->arena_.release(chunk);
+    return;
+  }
+
+  std::uint32_t new_owner(const K& key) {
+
+    if (this->free_owners_.empty()) {
+
+      this->owners_.push_back(key);
+      return static_cast<std::uint32_t>(this->owners_.size() - 1);
+    }
+
+    std::uint32_t owner = this->free_owners_.back();
+    this->free_owners_.pop_back();
+    this->owners_[owner] = key;
+    return owner;
+  }
+
+  void maybe_rebalance() {
+
+    if (this->options_.rebalance_after > 0 && this->since_rebalance_ >= this->options_.rebalance_after) this->rebalance();
+    return;
+  }
+
+  Options options_;
+  LIRSSlabArena arena_;
+  std::vector<std::unique_ptr<LIRSCache<K, char*>>> caches_;   // per class, created with its first page
+  std::unordered_map<K, std::uint32_t> index_;                 // resident key -> class
+  std::vector<ClassStats> stats_;
+  std::vector<std::uint64_t> pressure_;   // evictions + failures since the last rebalance
+  std::vector<std::uint64_t> failed_;     // failures since the last rebalance
+  std::vector<K> owners_;                 // key of each used chunk (chunk header owner)
+  std::vector<std::uint32_t> free_owners_;
+  bool erasing_;
+  std::size_t since_rebalance_;
+};
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef LIRS_TRACE_HPP
+#define LIRS_TRACE_HPP
+
+/*
+ * Access trace records and text trace readers
+ *
+ * Supported text formats:
+ *   - plain : one key per line
+ *               42
+ *   - csv   : key[,op[,size]] per line (extra columns are ignored)
+ *               42,get,128
+ *
+ * Keys that are not decimal integers are hashed (FNV-1a, 64-bit), so
+ * string-keyed traces map onto the same 64-bit key space.
+ * Empty lines and lines starting with '#' are skipped.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <stdexcept>
+
+enum class LIRSTraceOp : std::uint8_t {
+  Get = 0,
+  Set = 1,
+  Delete = 2,
+};
+
+enum class LIRSTraceFormat {
+  Plain,
+  Csv,
+};
+
+struct LIRSTraceRecord {
+  std::uint64_t key = 0;
+  LIRSTraceOp op = LIRSTraceOp::Get;
+  std::uint32_t size = 0; // value size in bytes (0 = unknown)
+};
+
+inline LIRSTraceFormat lirs_parse_trace_format(const std::string& name) {
+
+  if (name == "plain") return LIRSTraceFormat::Plain;
+  if (name == "csv") return LIRSTraceFormat::Csv;
+  throw std::invalid_argument("Unknown trace format: " + name);
+}
+
+inline std::uint64_t lirs_hash_key(const char* data, std::size_t len) {
+
+  // FNV-1a
+  std::uint64_t hash = 14695981039346656037ULL;
+  for (std::size_t i = 0; i < len; i++) {
+
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+class LIRSTextTraceReader {
+public:
+  LIRSTextTraceReader(std::istream& in, LIRSTraceFormat format)
+    : in_(in), format_(format), line_no_(0) {}
+
+  // read next record, false at end of input
+  bool next(LIRSTraceRecord& record) {
+
+    while (std::getline(this->in_, this->line_)) {
+
+      this->line_no_++;
+
+      std::size_t begin = this->line_.find_first_not_of(" \t\r");
+      if (begin == std::string::npos || this->line_[begin] == '#') continue;
+
+      std::size_t end = this->line_.find_last_not_of(" \t\r") + 1;
+      const char* text = this->line_.data() + begin;
+      std::size_t len = end - begin;
+
+      if (this->format_ == LIRSTraceFormat::Plain) {
+
+        record = LIRSTraceRecord {};
+        record.key = parse_key(text, len);
+        return true;
+      }
+
+      this->parse_csv(text, len, record);
+      return true;
+    }
+    return false;
+  }
+
+  std::size_t line_number() const { return this->line_no_; }
+
+private:
+  static std::uint64_t parse_key(const char* text, std::size_t len) {
+
+    if (len == 0 || len > 19) return lirs_hash_key(text, len);
+
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < len; i++) {
+
+      if (text[i] < '0' || text[i] > '9') return lirs_hash_key(text, len);
+      value = value * 10 + static_cast<std::uint64_t>(text[i] - '0');
+    }
+    return value;
+  }
+
+  static LIRSTraceOp parse_op(const char* text, std::size_t len) {
+
+    if (len == 0) return LIRSTraceOp::Get;
+
+    switch (text[0]) {
+      case 's': case 'S': case 'w': case 'W': case 'a': case 'A':
+        return LIRSTraceOp::Set;
+      case 'd': case 'D':
+        return LIRSTraceOp::Delete;
+      default:
+        return LIRSTraceOp::Get;
+    }
+  }
+
+  void parse_csv(const char* text, std::size_t len, LIRSTraceRecord& record) {
+
+    record = LIRSTraceRecord {};
+
+    // split the first three columns
+    const char* field[3] = { text, nullptr, nullptr };
+    std::size_t field_len[3] = { 0, 0, 0 };
+    std::size_t count = 0;
+    std::size_t start = 0;
+
+    for (std::size_t i = 0; i <= len && count < 3; i++) {
+
+      if (i < len && text[i] != ',') continue;
+
+      field[count] = text + start;
+      field_len[count] = i - start;
+      count++;
+      start = i + 1;
+    }
+
+    record.key = parse_key(field[0], field_len[0]);
+    if (count > 1) record.op = parse_op(field[1], field_len[1]);
+
+    if (count > 2) {
+
+      std::uint64_t size = 0;
+      for (std::size_t i = 0; i < field_len[2]; i++) {
+
+        char c = field[2][i];
+        if (c < '0' || c > '9') throw std::runtime_error("Invalid size at trace line " + std::to_string(this->line_no_));
+        size = size * 10 + static_cast<std::uint64_t>(c - '0');
+      }
+      record.size = static_cast<std::uint32_t>(std::min<std::uint64_t>(size, UINT32_MAX));
+    }
+    return;
+  }
+
+  std::istream& in_;
+  LIRSTraceFormat format_;
+  std::size_t line_no_;
+  std::string line_;
+};
+
+#endif
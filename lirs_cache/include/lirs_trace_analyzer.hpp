@@ -0,0 +1,301 @@
+#ifndef LIRS_TRACE_ANALYZER_HPP
+#define LIRS_TRACE_ANALYZER_HPP
+
+/*
+ * Offline trace analyzer
+ *
+ *    access(key) ──► Fenwick tree over last-access slots ──► reuse distance
+ *                │                                           (exact, O(log n))
+ *                ├──► per-key last IRR            ──► IRR distribution
+ *                ├──► per-window distinct keys    ──► working-set profile
+ *                └──► LIRSCache / LRU per capacity ──► predicted hit ratios
+ *
+ * Reuse distance of an access = number of distinct other keys referenced
+ * since the previous access to the same key (the IRR of that reference).
+ * The Fenwick tree marks, for every key, the slot of its last access; the
+ * distance is the number of marks after that slot.  Slots are renumbered
+ * when the tree is full, so memory is O(distinct keys), not O(trace length).
+ *
+ * LRU hit ratio at capacity C is exact (Mattson stack property: hit iff
+ * reuse distance < C).  LIRS hit ratio is obtained by replaying the trace
+ * through LIRSCache itself.
+ */
+
+#include "lirs_cache.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+
+class LIRSTraceAnalyzer {
+public:
+  static constexpr std::size_t kBuckets = 64;
+
+  struct Options {
+    std::size_t window = 1000000;          // accesses per working-set window
+    std::vector<std::size_t> capacities;   // cache sizes to predict (LRU and LIRS)
+    double hir_ratio = 0.01;               // HIR ratio used for LIRS replay
+  };
+
+  struct WindowStats {
+    std::uint64_t accesses = 0;
+    std::uint64_t distinct = 0;   // working-set size
+    std::uint64_t cold = 0;       // first-ever references
+    std::uint64_t dominant = 0;   // reuses in the most populated distance bucket
+    const char* pattern = "";
+  };
+
+  struct Prediction {
+    std::size_t capacity = 0;
+    double lru_hit_ratio = 0.0;
+    double lirs_hit_ratio = 0.0;
+  };
+
+  struct Report {
+    std::uint64_t accesses = 0;
+    std::uint64_t distinct_keys = 0;
+    std::uint64_t cold_accesses = 0;
+    std::vector<std::uint64_t> reuse_histogram; // log2 buckets, per access
+    std::vector<std::uint64_t> irr_histogram;   // log2 buckets, per key (last IRR)
+    std::vector<WindowStats> windows;
+    const char* pattern = "";
+    std::vector<Prediction> predictions;
+  };
+
+  LIRSTraceAnalyzer() : LIRSTraceAnalyzer(Options {}) {}
+
+  explicit LIRSTraceAnalyzer(Options options)
+    : options_(std::move(options)), now_(0), live_(0), accesses_(0), cold_(0)
+    , reuse_hist_(kBuckets, 0), window_hist_(kBuckets, 0) {
+
+    if (this->options_.window == 0) throw std::invalid_argument("Window must be greater than 0");
+
+    for (std::size_t capacity : this->options_.capacities) {
+
+      Sim sim;
+      sim.capacity = capacity;
+      sim.lirs = std::make_unique<LIRSCache<std::uint64_t, char>>(capacity, this->options_.hir_ratio);
+      this->sims_.push_back(std::move(sim));
+    }
+
+    this->tree_.assign(kInitialSlots + 1, 0);
+    return;
+  }
+
+  void access(std::uint64_t key) {
+
+    if (this->now_ == this->tree_.size() - 1) this->compact();
+
+    std::uint64_t slot = this->now_++;
+    auto iter = this->keys_.find(key);
+
+    // first reference
+    if (iter == this->keys_.end()) {
+
+      this->keys_.emplace(key, KeyState { slot, kNoIrr, this->window_id() });
+      this->add(slot, 1);
+      this->live_++;
+      this->cold_++;
+      this->window_.cold++;
+      this->window_.distinct++;
+      this->account(key, nullptr);
+      return;
+    }
+
+    KeyState& state = iter->second;
+
+    // distinct keys whose last access is after ours
+    std::uint64_t distance = this->live_ - this->prefix(state.slot + 1);
+
+    this->add(state.slot, -1);
+    this->add(slot, 1);
+    state.slot = slot;
+    state.last_irr = static_cast<std::uint32_t>(std::min<std::uint64_t>(distance, kNoIrr - 1));
+
+    if (state.window != this->window_id()) {
+
+      state.window = this->window_id();
+      this->window_.distinct++;
+    }
+
+    std::size_t bucket = bucket_of(distance);
+    this->reuse_hist_[bucket]++;
+    this->window_hist_[bucket]++;
+    this->account(key, &distance);
+    return;
+  }
+
+  Report report() const {
+
+    Report report;
+    report.accesses = this->accesses_;
+    report.distinct_keys = this->keys_.size();
+    report.cold_accesses = this->cold_;
+    report.reuse_histogram = this->reuse_hist_;
+    report.irr_histogram.assign(kBuckets, 0);
+
+    for (const auto& item : this->keys_) {
+
+      if (item.second.last_irr != kNoIrr) report.irr_histogram[bucket_of(item.second.last_irr)]++;
+    }
+
+    report.windows = this->windows_;
+    if (this->window_.accesses > 0) report.windows.push_back(this->close(this->window_, this->window_hist_));
+
+    std::uint64_t reuses = this->accesses_ - this->cold_;
+    std::uint64_t dominant = *std::max_element(this->reuse_hist_.begin(), this->reuse_hist_.end());
+    report.pattern = classify(this->accesses_, this->cold_, reuses, dominant);
+
+    for (const Sim& sim : this->sims_) {
+
+      Prediction prediction;
+      prediction.capacity = sim.capacity;
+      if (this->accesses_ > 0) {
+
+        prediction.lru_hit_ratio = static_cast<double>(sim.lru_hits) / static_cast<double>(this->accesses_);
+        prediction.lirs_hit_ratio = static_cast<double>(sim.lirs_hits) / static_cast<double>(this->accesses_);
+      }
+      report.predictions.push_back(prediction);
+    }
+    return report;
+  }
+
+  // lower bound of a histogram bucket (bucket 0 = distance 0)
+  static std::uint64_t bucket_floor(std::size_t bucket) {
+
+    return bucket == 0 ? 0 : (std::uint64_t { 1 } << (bucket - 1));
+  }
+
+private:
+  static constexpr std::uint32_t kNoIrr = UINT32_MAX;
+  static constexpr std::size_t kInitialSlots = 1 << 16;
+
+  struct KeyState {
+    std::uint64_t slot;      // slot of last access
+    std::uint32_t last_irr;  // IRR of the last reference (kNoIrr if referenced once)
+    std::uint64_t window;    // last window the key was seen in
+  };
+
+  struct Sim {
+    std::size_t capacity = 0;
+    std::unique_ptr<LIRSCache<std::uint64_t, char>> lirs;
+    std::uint64_t lru_hits = 0;
+    std::uint64_t lirs_hits = 0;
+  };
+
+  static std::size_t bucket_of(std::uint64_t distance) {
+
+    std::size_t bucket = 0;
+    while (distance != 0) {
+
+      distance >>= 1;
+      bucket++;
+    }
+    return std::min(bucket, kBuckets - 1);
+  }
+
+  static const char* classify(std::uint64_t accesses, std::uint64_t cold,
+                              std::uint64_t reuses, std::uint64_t dominant) {
+
+    if (accesses == 0) return "empty";
+    if (cold * 2 > accesses) return "scan";
+    if (reuses > 0 && dominant * 4 >= reuses * 3) return "loop";
+    return "mixed";
+  }
+
+  std::uint64_t window_id() const { return this->accesses_ / this->options_.window; }
+
+  WindowStats close(WindowStats stats, const std::vector<std::uint64_t>& hist) const {
+
+    std::uint64_t reuses = stats.accesses - stats.cold;
+    stats.dominant = *std::max_element(hist.begin(), hist.end());
+    stats.pattern = classify(stats.accesses, stats.cold, reuses, stats.dominant);
+    return stats;
+  }
+
+  // per-access bookkeeping shared by cold and warm references
+  void account(std::uint64_t key, const std::uint64_t* distance) {
+
+    for (Sim& sim : this->sims_) {
+
+      if (distance != nullptr && *distance < sim.capacity) sim.lru_hits++;
+
+      if (sim.lirs->get(key)) sim.lirs_hits++;
+      else sim.lirs->put(key, 0);
+    }
+
+    this->accesses_++;
+    this->window_.accesses++;
+
+    if (this->accesses_ % this->options_.window == 0) {
+
+      this->windows_.push_back(this->close(this->window_, this->window_hist_));
+      this->window_ = WindowStats {};
+      std::fill(this->window_hist_.begin(), this->window_hist_.end(), 0);
+    }
+    return;
+  }
+
+  // renumber last-access slots densely and rebuild the tree
+  void compact() {
+
+    std::vector<std::pair<std::uint64_t, KeyState*>> order;
+    order.reserve(this->keys_.size());
+    for (auto& item : this->keys_) order.emplace_back(item.second.slot, &item.second);
+
+    std::sort(order.begin(), order.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::size_t slots = std::max<std::size_t>(kInitialSlots, order.size() * 2);
+    this->tree_.assign(slots + 1, 0);
+
+    for (std::size_t i = 0; i < order.size(); i++) {
+
+      order[i].second->slot = i;
+      this->tree_[i + 1] = 1;
+    }
+
+    // linear-time Fenwick build
+    for (std::size_t i = 1; i <= slots; i++) {
+
+      std::size_t parent = i + (i & (~i + 1));
+      if (parent <= slots) this->tree_[parent] += this->tree_[i];
+    }
+
+    this->now_ = order.size();
+    return;
+  }
+
+  void add(std::uint64_t slot, std::int64_t delta) {
+
+    for (std::size_t i = slot + 1; i < this->tree_.size(); i += i & (~i + 1)) this->tree_[i] += delta;
+    return;
+  }
+
+  // number of marks in slots [0, count)
+  std::uint64_t prefix(std::uint64_t count) const {
+
+    std::int64_t sum = 0;
+    for (std::size_t i = count; i > 0; i -= i & (~i + 1)) sum += this->tree_[i];
+    return static_cast<std::uint64_t>(sum);
+  }
+
+  Options options_;
+  std::vector<std::int64_t> tree_;
+  std::unordered_map<std::uint64_t, KeyState> keys_;
+  std::uint64_t now_;
+  std::uint64_t live_;
+  std::uint64_t accesses_;
+  std::uint64_t cold_;
+  std::vector<std::uint64_t> reuse_hist_;
+  std::vector<std::uint64_t> window_hist_;
+  WindowStats window_;
+  std::vector<WindowStats> windows_;
+  std::vector<Sim> sims_;
+};
+
+#endif
@@ -0,0 +1,456 @@
+#ifndef LIRS_TRACE_BINARY_HPP
+#define LIRS_TRACE_BINARY_HPP
+
+/*
+ * Compact binary trace format
+ *
+ *    ┌──────────────────────────── File header (32 bytes) ─────────────────────────────┐
+ *    │ magic "LIRSTRC1" │ version u16 │ flags u16 │ block_records u32 │ records u64 │ 0 │
+ *    └──────────────────────────────────────────────────────────────────────────────────┘
+ *    ┌───── Block header (16 bytes) ─────┐┌──────────────── Block payload ────────────────┐
+ *    │ records │ key_bytes │ bytes │ crc ││ keys: varint(zigzag(key - prev_key))          │
+ *    └───────────────────────────────────┘│ ops : 1 byte per record       (flag HasOp)    │
+ *                 ...                     │ size: varint per record       (flag HasSize)  │
+ *                                         └───────────────────────────────────────────────┘
+ *
+ * All integers are little-endian.  Columns are stored separately inside a
+ * block so the key column is a dense run of varints; the delta base resets
+ * at every block, so blocks decode independently.  crc is CRC-32C of the
+ * first 12 header bytes and the payload (version 1 files: the payload
+ * only, still readable).  records in the file header is 0 when the writer
+ * could not seek back to patch it (e.g. a pipe); readers then rely on the
+ * blocks alone.
+ *
+ * The reader memory-maps the file (POSIX) and decodes one block at a time;
+ * runs of single-byte varints are decoded 8 at a time (SWAR), on hosts of
+ * either byte order.  A block header is checked before anything is sized
+ * from it: every record takes at least one key byte.
+ */
+
+#include "lirs_trace.hpp"
+#include "lirs_checksum.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LIRS_TRACE_HAS_MMAP 1
+#endif
+
+namespace lirs_detail {
+
+  inline void put_varint(std::vector<std::uint8_t>& out, std::uint64_t value) {
+
+    while (value >= 0x80) {
+
+      out.push_back(static_cast<std::uint8_t>(value | 0x80));
+      value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+    return;
+  }
+
+  // returns nullptr on truncated or overlong input
+  inline const std::uint8_t* get_varint(const std::uint8_t* p, const std::uint8_t* end, std::uint64_t& value) {
+
+    std::uint64_t result = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+
+      std::uint64_t byte = *p++;
+      result |= (byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+
+        value = result;
+        return p;
+      }
+    }
+    return nullptr;
+  }
+
+  inline std::uint64_t zigzag(std::int64_t value) {
+
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+  }
+
+  inline std::int64_t unzigzag(std::uint64_t value) {
+
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+  }
+
+  template <typename T>
+  inline void put_le(std::uint8_t* out, T value) {
+
+    for (std::size_t i = 0; i < sizeof(T); i++) out[i] = static_cast<std::uint8_t>(static_cast<std::uint64_t>(value) >> (8 * i));
+    return;
+  }
+
+  template <typename T>
+  inline T get_le(const std::uint8_t* in) {
+
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < sizeof(T); i++) value |= static_cast<std::uint64_t>(in[i]) << (8 * i);
+    return static_cast<T>(value);
+  }
+
+  // get_le<std::uint64_t> in one load: byte 0 is the low byte on any host
+  inline std::uint64_t load_le64(const std::uint8_t* in) {
+
+    std::uint64_t value;
+    std::memcpy(&value, in, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+  }
+
+  // block checksum: header fields (not the crc itself) and payload; version 1 covered the payload only
+  inline std::uint32_t trace_block_crc(std::uint16_t version, const std::uint8_t* header, const std::uint8_t* payload, std::size_t bytes) {
+
+    std::uint32_t crc = version >= 2 ? crc32c(header, 12) : 0;
+    return crc32c(payload, bytes, crc);
+  }
+
+} // namespace lirs_detail
+
+struct LIRSBinaryTraceFormat {
+  static constexpr char kMagic[8] = { 'L', 'I', 'R', 'S', 'T', 'R', 'C', '1' };
+  static constexpr std::uint16_t kVersion = 2;
+  static constexpr std::uint16_t kMinVersion = 1;   // oldest version still read
+  static constexpr std::size_t kFileHeaderSize = 32;
+  static constexpr std::size_t kBlockHeaderSize = 16;
+
+  static constexpr std::uint16_t kHasOp = 1;
+  static constexpr std::uint16_t kHasSize = 2;
+
+  // true if the first bytes of a file look like a binary trace
+  static bool probe(const std::string& path) {
+
+    std::ifstream in(path, std::ios::binary);
+    char magic[8] = {};
+    return in.read(magic, 8) && std::memcmp(magic, kMagic, 8) == 0;
+  }
+};
+
+class LIRSBinaryTraceWriter {
+public:
+  LIRSBinaryTraceWriter(std::ostream& out, std::uint16_t flags, std::uint32_t block_records = 65536)
+    : out_(out), flags_(flags), block_records_(block_records), records_(0), in_block_(0), prev_key_(0) {
+
+    if (block_records == 0) throw std::invalid_argument("Block size must be greater than 0");
+
+    this->header_pos_ = this->out_.tellp();
+
+    std::uint8_t header[LIRSBinaryTraceFormat::kFileHeaderSize] = {};
+    std::memcpy(header, LIRSBinaryTraceFormat::kMagic, 8);
+    lirs_detail::put_le<std::uint16_t>(header + 8, LIRSBinaryTraceFormat::kVersion);
+    lirs_detail::put_le<std::uint16_t>(header + 10, flags);
+    lirs_detail::put_le<std::uint32_t>(header + 12, block_records);
+    this->out_.write(reinterpret_cast<const char*>(header), sizeof(header));
+    return;
+  }
+
+  LIRSBinaryTraceWriter(const LIRSBinaryTraceWriter&) = delete;
+  LIRSBinaryTraceWriter& operator=(const LIRSBinaryTraceWriter&) = delete;
+
+  void append(const LIRSTraceRecord& record) {
+
+    lirs_detail::put_varint(this->keys_, lirs_detail::zigzag(static_cast<std::int64_t>(record.key - this->prev_key_)));
+    this->prev_key_ = record.key;
+
+    if (this->flags_ & LIRSBinaryTraceFormat::kHasOp) this->ops_.push_back(static_cast<std::uint8_t>(record.op));
+    if (this->flags_ & LIRSBinaryTraceFormat::kHasSize) lirs_detail::put_varint(this->sizes_, record.size);
+
+    this->records_++;
+    if (++this->in_block_ == this->block_records_) this->flush_block();
+    return;
+  }
+
+  // flush the last block and patch the record count (when seekable)
+  void finish() {
+
+    this->flush_block();
+
+    if (this->header_pos_ != std::streampos(-1)) {
+
+      std::streampos end = this->out_.tellp();
+      std::uint8_t count[8];
+      lirs_detail::put_le<std::uint64_t>(count, this->records_);
+
+      this->out_.seekp(this->header_pos_ + std::streamoff(16));
+      this->out_.write(reinterpret_cast<const char*>(count), 8);
+      this->out_.seekp(end);
+    }
+
+    this->out_.flush();
+    if (!this->out_) throw std::runtime_error("Failed to write binary trace");
+    return;
+  }
+
+  std::uint64_t records() const { return this->records_; }
+
+private:
+  void flush_block() {
+
+    if (this->in_block_ == 0) return;
+
+    std::vector<std::uint8_t>& payload = this->keys_;
+    std::uint32_t key_bytes = static_cast<std::uint32_t>(payload.size());
+    payload.insert(payload.end(), this->ops_.begin(), this->ops_.end());
+    payload.insert(payload.end(), this->sizes_.begin(), this->sizes_.end());
+
+    std::uint8_t header[LIRSBinaryTraceFormat::kBlockHeaderSize];
+    lirs_detail::put_le<std::uint32_t>(header, static_cast<std::uint32_t>(this->in_block_));
+    lirs_detail::put_le<std::uint32_t>(header + 4, key_bytes);
+    lirs_detail::put_le<std::uint32_t>(header + 8, static_cast<std::uint32_t>(payload.size()));
+    lirs_detail::put_le<std::uint32_t>(header + 12, lirs_detail::trace_block_crc(LIRSBinaryTraceFormat::kVersion, header, payload.data(), payload.size()));
+
+    this->out_.write(reinterpret_cast<const char*>(header), sizeof(header));
+    this->out_.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+
+    this->keys_.clear();
+    this->ops_.clear();
+    this->sizes_.clear();
+    this->in_block_ = 0;
+    this->prev_key_ = 0;
+    return;
+  }
+
+  std::ostream& out_;
+  std::streampos header_pos_;
+  std::uint16_t flags_;
+  std::uint32_t block_records_;
+  std::uint64_t records_;
+  std::uint32_t in_block_;
+  std::uint64_t prev_key_;
+  std::vector<std::uint8_t> keys_;
+  std::vector<std::uint8_t> ops_;
+  std::vector<std::uint8_t> sizes_;
+};
+
+class LIRSBinaryTraceReader {
+public:
+  explicit LIRSBinaryTraceReader(const std::string& path, bool verify_checksums = true)
+    : data_(nullptr), size_(0), mapped_(false), verify_(verify_checksums), pos_(0), next_(0) {
+
+#if defined(LIRS_TRACE_HAS_MMAP)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Cannot open trace: " + path);
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+
+      ::close(fd);
+      throw std::runtime_error("Cannot stat trace: " + path);
+    }
+
+    this->size_ = static_cast<std::size_t>(st.st_size);
+    if (this->size_ > 0) {
+
+      void* addr = ::mmap(nullptr, this->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED) {
+
+        ::close(fd);
+        throw std::runtime_error("Cannot map trace: " + path);
+      }
+      ::madvise(addr, this->size_, MADV_SEQUENTIAL);
+      this->data_ = static_cast<const std::uint8_t*>(addr);
+      this->mapped_ = true;
+    }
+    ::close(fd);
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Cannot open trace: " + path);
+    this->buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    this->data_ = this->buffer_.data();
+    this->size_ = this->buffer_.size();
+#endif
+
+    try {
+
+      this->parse_header();
+    } catch (...) {
+
+      this->release();
+      throw;
+    }
+    return;
+  }
+
+  ~LIRSBinaryTraceReader() { this->release(); }
+
+  LIRSBinaryTraceReader(const LIRSBinaryTraceReader&) = delete;
+  LIRSBinaryTraceReader& operator=(const LIRSBinaryTraceReader&) = delete;
+
+  std::uint16_t flags() const { return this->flags_; }
+  std::uint64_t record_count() const { return this->record_count_; }
+
+  // read next record, false at end of trace
+  bool next(LIRSTraceRecord& record) {
+
+    if (this->next_ == this->block_.size()) {
+
+      if (!this->decode_block(this->block_)) return false;
+      this->next_ = 0;
+    }
+
+    record = this->block_[this->next_++];
+    return true;
+  }
+
+  // decode the next block into records (cleared first), false at end of trace
+  bool decode_block(std::vector<LIRSTraceRecord>& records) {
+
+    records.clear();
+    if (this->pos_ == this->size_) return false;
+    if (this->size_ - this->pos_ < LIRSBinaryTraceFormat::kBlockHeaderSize) throw std::runtime_error("Truncated block header");
+
+    const std::uint8_t* header = this->data_ + this->pos_;
+    std::uint32_t count = lirs_detail::get_le<std::uint32_t>(header);
+    std::uint32_t key_bytes = lirs_detail::get_le<std::uint32_t>(header + 4);
+    std::uint32_t bytes = lirs_detail::get_le<std::uint32_t>(header + 8);
+    std::uint32_t crc = lirs_detail::get_le<std::uint32_t>(header + 12);
+
+    this->pos_ += LIRSBinaryTraceFormat::kBlockHeaderSize;
+    if (this->size_ - this->pos_ < bytes || key_bytes > bytes) throw std::runtime_error("Truncated block payload");
+
+    // each key varint takes at least a byte: bounds count before records are sized from it
+    if (count == 0 || count > key_bytes) throw std::runtime_error("Corrupt block header");
+
+    const std::uint8_t* payload = this->data_ + this->pos_;
+    this->pos_ += bytes;
+
+    if (this->verify_ && lirs_detail::trace_block_crc(this->version_, header, payload, bytes) != crc) {
+
+      throw std::runtime_error("Block checksum mismatch");
+    }
+
+    records.resize(count);
+
+    // keys
+    const std::uint8_t* p = payload;
+    const std::uint8_t* end = payload + key_bytes;
+    std::uint64_t key = 0;
+    std::size_t i = 0;
+
+    while (i < count) {
+
+      // fast path: 8 single-byte varints in a row
+      if (end - p >= 8 && count - i >= 8) {
+
+        std::uint64_t word = lirs_detail::load_le64(p);
+        if ((word & 0x8080808080808080ULL) == 0) {
+
+          for (int k = 0; k < 8; k++) {
+
+            key += static_cast<std::uint64_t>(lirs_detail::unzigzag((word >> (8 * k)) & 0xFF));
+            records[i++].key = key;
+          }
+          p += 8;
+          continue;
+        }
+      }
+
+      std::uint64_t delta;
+      p = lirs_detail::get_varint(p, end, delta);
+      if (p == nullptr) throw std::runtime_error("Corrupt key column");
+
+      key += static_cast<std::uint64_t>(lirs_detail::unzigzag(delta));
+      records[i++].key = key;
+    }
+    if (p != end) throw std::runtime_error("Corrupt key column");
+
+    // ops
+    end = payload + bytes;
+    if (this->flags_ & LIRSBinaryTraceFormat::kHasOp) {
+
+      if (static_cast<std::size_t>(end - p) < count) throw std::runtime_error("Corrupt op column");
+      for (i = 0; i < count; i++) {
+
+        if (p[i] > static_cast<std::uint8_t>(LIRSTraceOp::Delete)) throw std::runtime_error("Corrupt op column");
+        records[i].op = static_cast<LIRSTraceOp>(p[i]);
+      }
+      p += count;
+    }
+
+    // sizes
+    if (this->flags_ & LIRSBinaryTraceFormat::kHasSize) {
+
+      for (i = 0; i < count; i++) {
+
+        std::uint64_t size;
+        p = lirs_detail::get_varint(p, end, size);
+        if (p == nullptr || size > UINT32_MAX) throw std::runtime_error("Corrupt size column");
+        records[i].size = static_cast<std::uint32_t>(size);
+      }
+    }
+    if (p != end) throw std::runtime_error("Corrupt block payload");
+
+    return true;
+  }
+
+  // restart from the first block
+  void rewind() {
+
+    this->pos_ = LIRSBinaryTraceFormat::kFileHeaderSize;
+    this->block_.clear();
+    this->next_ = 0;
+    return;
+  }
+
+private:
+  void parse_header() {
+
+    if (this->size_ < LIRSBinaryTraceFormat::kFileHeaderSize ||
+        std::memcmp(this->data_, LIRSBinaryTraceFormat::kMagic, 8) != 0) {
+
+      throw std::runtime_error("Not a binary LIRS trace");
+    }
+
+    this->version_ = lirs_detail::get_le<std::uint16_t>(this->data_ + 8);
+    if (this->version_ < LIRSBinaryTraceFormat::kMinVersion || this->version_ > LIRSBinaryTraceFormat::kVersion) {
+
+      throw std::runtime_error("Unsupported binary trace version");
+    }
+
+    this->flags_ = lirs_detail::get_le<std::uint16_t>(this->data_ + 10);
+    this->record_count_ = lirs_detail::get_le<std::uint64_t>(this->data_ + 16);
+    this->pos_ = LIRSBinaryTraceFormat::kFileHeaderSize;
+    return;
+  }
+
+  void release() {
+
+#if defined(LIRS_TRACE_HAS_MMAP)
+    if (this->mapped_) ::munmap(const_cast<std::uint8_t*>(this->data_), this->size_);
+#endif
+    this->mapped_ = false;
+    this->data_ = nullptr;
+    return;
+  }
+
+  const std::uint8_t* data_;
+  std::size_t size_;
+  bool mapped_;
+  bool verify_;
+  std::uint16_t version_ = 0;
+  std::uint16_t flags_ = 0;
+  std::uint64_t record_count_ = 0;
+  std::size_t pos_;
+  std::vector<LIRSTraceRecord> block_;
+  std::size_t next_;
+#if !defined(LIRS_TRACE_HAS_MMAP)
+  std::vector<std::uint8_t> buffer_;
+#endif
+};
+
+#endif
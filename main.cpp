@@ -1,4 +1,5 @@
 #include <iostream>
+#include <sstream>
 #include "lirs_cache/include/lirs_cache_extension.hpp"
 
 void print_section(const std::string& title) {
@@ -175,6 +176,19 @@ int main() {
     std::cout << "  get(2) = " << (val ? *val : "MISS") << "\n";
     loop_cache.Display();
 
+    //----------------------------------------------------------
+    // Phase 11: Snapshot and restore (warm restart)
+    //----------------------------------------------------------
+    print_section("Phase 11: Snapshot and Restore");
+
+    print_action("save() the cache from Phase 1-9, load() into a new cache");
+    std::stringstream snapshot;
+    cache.save(snapshot);
+
+    LIRSCacheExtension<int, std::string> restored(5, 0.2);
+    restored.load(snapshot);
+    restored.Display();
+
     //----------------------------------------------------------
     // Summary
     //----------------------------------------------------------
@@ -189,6 +203,7 @@ int main() {
     std::cout << "  [v] Stack pruning\n";
     std::cout << "  [v] LIR demotion\n";
     std::cout << "  [v] HIR eviction\n";
+    std::cout << "  [v] Snapshot / restore\n";
     std::cout << "\n";
 
     return 0;
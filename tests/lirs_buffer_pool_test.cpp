@@ -0,0 +1,154 @@
+// Buffer pool write-back: a dirty victim whose background write fails stays
+// resident and dirty, flush_all() reports the failure, and the page reaches
+// the file once writes succeed again.
+
+#include "lirs_test.hpp"
+#include "../lirs_cache/include/lirs_buffer_pool.hpp"
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <system_error>
+
+constexpr std::size_t kPageSize = 64;
+
+// in-memory pages; writes throw while failing is set
+class MemoryPageFile : public LIRSPageFile {
+public:
+    std::atomic<bool> failing{false};
+
+    std::size_t page_size() const override { return kPageSize; }
+
+    void read_page(LIRSPageId id, char* data) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto iter = pages_.find(id);
+        if (iter == pages_.end()) std::memset(data, 0, kPageSize);
+        else std::memcpy(data, iter->second.data(), kPageSize);
+    }
+
+    void write_page(LIRSPageId id, const char* data) override {
+        if (failing) throw std::system_error(std::make_error_code(std::errc::no_space_on_device), "write");
+        std::lock_guard<std::mutex> lock(mutex_);
+        pages_[id].assign(data, kPageSize);
+    }
+
+    LIRSPageId allocate_page() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return next_++;
+    }
+
+    std::string stored(LIRSPageId id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto iter = pages_.find(id);
+        return iter == pages_.end() ? std::string() : std::string(iter->second.c_str());
+    }
+
+private:
+    std::mutex mutex_;
+    std::map<LIRSPageId, std::string> pages_;
+    LIRSPageId next_ = 0;
+};
+
+static std::string text(LIRSPage* page) { return std::string(page->data()); }
+
+static void failed_write_keeps_the_page() {
+    MemoryPageFile file;
+    LIRSBufferPool pool(4, file, 0.25);
+
+    // three LIR pages, then one dirty HIR page, then writes start failing
+    for (LIRSPageId id = 50; id < 53; id++) {
+        LIRSPage* lir = pool.fetch_page(id);
+        LIRS_CHECK(lir != nullptr);
+        if (lir != nullptr) pool.unpin_page(id, false);
+    }
+    LIRSPageId dirty = 0;
+    LIRSPage* page = pool.new_page(dirty);
+    std::strcpy(page->data(), "only copy");
+    pool.unpin_page(dirty, true);
+    file.failing = true;
+
+    // push it out with clean pages
+    for (int i = 0; i < 12; i++) {
+        LIRSPage* other = pool.fetch_page(100 + static_cast<LIRSPageId>(i));
+        LIRS_CHECK(other != nullptr);
+        if (other != nullptr) pool.unpin_page(other->id(), false);
+    }
+    LIRS_CHECK(pool.stats().flush_errors >= 1);
+
+    // the data is still there, and nothing was written
+    page = pool.fetch_page(dirty);
+    LIRS_CHECK(page != nullptr);
+    if (page != nullptr) {
+        LIRS_CHECK(text(page) == "only copy");
+        pool.unpin_page(dirty, false);
+    }
+    LIRS_CHECK(file.stored(dirty).empty());
+
+    bool threw = false;
+    try {
+        pool.flush_all();
+    } catch (const std::system_error&) {
+        threw = true;
+    }
+    LIRS_CHECK(threw);
+
+    // once the file accepts writes the page gets there; the background failure is reported once
+    file.failing = false;
+    threw = false;
+    try {
+        pool.flush_all();
+    } catch (const std::system_error&) {
+        threw = true;
+    }
+    LIRS_CHECK(threw);
+    pool.flush_all();
+    LIRS_CHECK(file.stored(dirty) == "only copy");
+}
+
+// with every frame holding an unwritable page, fetch_page gives up instead of dropping one
+static void unwritable_frames_are_not_reused() {
+    MemoryPageFile file;
+    LIRSBufferPool pool(2, file, 0.5);
+    file.failing = true;
+
+    LIRSPageId ids[2] = {0, 0};
+    for (LIRSPageId& id : ids) {
+        LIRSPage* page = pool.new_page(id);
+        LIRS_CHECK(page != nullptr);
+        if (page == nullptr) return;
+        std::strcpy(page->data(), ("page " + std::to_string(id)).c_str());
+        pool.unpin_page(id, true);
+    }
+
+    // each miss pushes out a dirty page that cannot be written, and it comes back
+    for (int i = 0; i < 4; i++) {
+        LIRSPage* page = pool.fetch_page(100 + static_cast<LIRSPageId>(i));
+        if (page != nullptr) pool.unpin_page(page->id(), false);
+    }
+    LIRS_CHECK(pool.fetch_page(200) == nullptr);
+
+    for (LIRSPageId id : ids) {
+        LIRSPage* page = pool.fetch_page(id);
+        LIRS_CHECK(page != nullptr);
+        if (page == nullptr) continue;
+        LIRS_CHECK(text(page) == "page " + std::to_string(id));
+        pool.unpin_page(id, false);
+    }
+
+    file.failing = false;
+    bool threw = false;
+    try {
+        pool.flush_all();
+    } catch (const std::system_error&) {
+        threw = true;
+    }
+    LIRS_CHECK(threw);
+    for (LIRSPageId id : ids) LIRS_CHECK(file.stored(id) == "page " + std::to_string(id));
+}
+
+int main() {
+    failed_write_keeps_the_page();
+    unwritable_frames_are_not_reused();
+    return lirs_test_result();
+}
@@ -0,0 +1,75 @@
+// Core replacement rules of LIRSCache and the image-based caches: a miss
+// evicts from Q only once the cache is full, so Q holds its hir_ratio share
+// of the capacity and a miss into spare room evicts nothing; a promotion
+// into a LIR set with room demotes nothing.
+
+#include "lirs_test.hpp"
+#include "../lirs_cache/include/lirs_arena_cache.hpp"
+#include "../lirs_cache/include/lirs_cache.hpp"
+#include <cstddef>
+#include <cstdint>
+
+constexpr std::size_t kCapacity = 100;
+constexpr double kHirRatio = 0.2;    // 80 LIR, 20 HIR blocks
+
+template <typename Cache>
+static void fills_to_capacity(Cache& cache) {
+    // LIR set, then a first HIR block
+    for (std::uint64_t key = 0; key < 81; key++) cache.put(key, key);
+    LIRS_CHECK(cache.lir_count() == 80);
+    LIRS_CHECK(cache.size() == 81);
+
+    // misses into spare room evict nothing, not even the oldest HIR block
+    cache.put(1000, 1000);
+    for (std::uint64_t key = 81; key < 90; key++) cache.put(key, key);
+    LIRS_CHECK(cache.size() == 91);
+    LIRS_CHECK(cache.get(80).has_value());
+
+    // Q fills up to the capacity, after which every miss evicts exactly one block
+    for (std::uint64_t key = 90; key < 500; key++) {
+        cache.put(key, key);
+        LIRS_CHECK(cache.size() == std::min<std::size_t>(kCapacity, 92 + (key - 90)));
+    }
+    LIRS_CHECK(cache.size() == kCapacity);
+    LIRS_CHECK(cache.lir_count() == 80);
+    LIRS_CHECK(cache.size() - cache.lir_count() == kCapacity - 80);
+}
+
+// after fills_to_capacity: an erased LIR block leaves a slot that the next promotion takes
+static void promotes_into_free_slot(LIRSCache<std::uint64_t, std::uint64_t>& cache) {
+    LIRS_CHECK(cache.erase(1));
+    LIRS_CHECK(cache.lir_count() == 79);
+
+    // 499 is an HIR resident near the top of S: its hit promotes it
+    LIRS_CHECK(cache.get(499).has_value());
+    LIRS_CHECK(cache.lir_count() == 80);
+}
+
+// cold blocks (e.g. readahead) before the LIR set is full are promoted without demoting anything
+static void warms_up_after_put_cold() {
+    LIRSCache<std::uint64_t, std::uint64_t> cache(10, 0.2);   // 8 LIR, 2 HIR blocks
+    for (std::uint64_t key = 0; key < 5; key++) LIRS_CHECK(cache.put_cold(key, key));
+
+    for (int round = 0; round < 4; round++) {
+        for (std::uint64_t key = 0; key < 5; key++) LIRS_CHECK(cache.get(key).has_value());
+    }
+    LIRS_CHECK(cache.lir_count() == 5);
+
+    // the rest of the warm-up still fills the LIR set
+    for (std::uint64_t key = 5; key < 8; key++) cache.put(key, key);
+    LIRS_CHECK(cache.lir_count() == 8);
+    LIRS_CHECK(cache.size() == 8);
+}
+
+int main() {
+    LIRSCache<std::uint64_t, std::uint64_t> cache(kCapacity, kHirRatio);
+    fills_to_capacity(cache);
+    promotes_into_free_slot(cache);
+
+    LIRSArenaCache<std::uint64_t, std::uint64_t> arena(kCapacity, kHirRatio);
+    fills_to_capacity(arena);
+
+    warms_up_after_put_cold();
+
+    return lirs_test_result();
+}
@@ -0,0 +1,188 @@
+// Charge-weighted caches keep LIRS behaviour with mixed value sizes: once
+// the charge forces evictions the block capacity follows the resident
+// count, a hot set survives a one-hit scan that flushes LRU, and the charge
+// stays within capacity.
+
+#include "lirs_test.hpp"
+#include "../lirs_cache/include/lirs_compressed_cache.hpp"
+#include "../lirs_cache/include/lirs_dedup_cache.hpp"
+#include "../lirs_cache/include/lirs_handle_cache.hpp"
+#include "../lirs_cache/include/lirs_lru.hpp"
+#include "../lirs_cache/include/lirs_sharded_cache.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+
+constexpr std::size_t kCapacity = 600 * 1024;
+constexpr std::uint64_t kHotKeys = 250;
+constexpr std::uint64_t kScanStart = 1000000;
+constexpr std::uint64_t kFill = 2000;             // first scan, several times the capacity
+
+static std::size_t value_size(std::uint64_t key) {
+    return 100 + static_cast<std::size_t>((key * 2654435761ULL) % 3900);
+}
+
+// random bytes repeated once: compresses to about half
+static std::string make_value(std::uint64_t key) {
+    std::string value(value_size(key), '\0');
+    std::uint64_t state = key * 0x9E3779B97F4A7C15ULL + 1;
+    std::size_t half = value.size() / 2;
+    for (std::size_t i = 0; i < half; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        value[i] = value[half + i] = static_cast<char>(state);
+    }
+    return value;
+}
+
+struct Outcome {
+    double hot_hit_ratio = 0;
+    std::uint64_t ops = 0;
+    std::uint64_t drifted = 0;     // ops after the first scan with the block capacity above size + 1
+    bool over = false;             // charge above capacity after some op
+};
+
+// a scan fills the cache, then hot keys (~500 KB) are interleaved with more of the scan
+template <typename Get, typename Put, typename Check>
+static void workload(Outcome& outcome, Get get, Put put, Check check) {
+    std::uint64_t scan = kScanStart;
+    std::uint64_t hot_hits = 0;
+    std::uint64_t hot_accesses = 0;
+
+    auto access = [&](std::uint64_t key) {
+        bool hit = get(key);
+        if (!hit) put(key, make_value(key));
+        check();
+        return hit;
+    };
+
+    for (; scan < kScanStart + kFill; scan++) access(scan);
+
+    for (int round = 0; round < 100; round++) {
+        for (std::uint64_t key = 0; key < kHotKeys; key++) {
+            bool hit = access(key);
+            if (round >= 20) {
+                hot_accesses++;
+                if (hit) hot_hits++;
+            }
+            if (key % 4 == 0) access(scan++);
+        }
+    }
+    outcome.hot_hit_ratio = static_cast<double>(hot_hits) / static_cast<double>(hot_accesses);
+}
+
+template <typename Shard>
+static Outcome sharded() {
+    using Cache = LIRSShardedCache<std::uint64_t, std::string, Shard>;
+    typename Cache::Options options;
+    options.capacity = kCapacity;
+    options.shards = 1;
+    options.hir_ratio = 0.05;
+    options.weigher = [](const std::uint64_t&, const std::string& value) { return value.size(); };
+    Cache cache(options);
+
+    Outcome outcome;
+    workload(outcome,
+        [&](std::uint64_t key) { return cache.get(key).has_value(); },
+        [&](std::uint64_t key, std::string value) { cache.put(key, value); },
+        [&]() {
+            if (++outcome.ops > kFill && cache.with_shard(0, [](const Shard& shard) { return shard.capacity() > shard.size() + 1; })) outcome.drifted++;
+            outcome.over = outcome.over || cache.charge() > kCapacity;
+        });
+    return outcome;
+}
+
+static Outcome handle() {
+    LIRSHandleCache<std::uint64_t, std::string> cache(kCapacity, 0.05);
+
+    Outcome outcome;
+    workload(outcome,
+        [&](std::uint64_t key) {
+            auto* found = cache.lookup(key);
+            if (found == nullptr) return false;
+            cache.release(found);
+            return true;
+        },
+        [&](std::uint64_t key, std::string value) {
+            std::size_t charge = value.size();
+            cache.release(cache.insert(key, std::move(value), charge));
+        },
+        [&]() {
+            if (++outcome.ops > kFill && cache.block_capacity() > cache.size() + 1) outcome.drifted++;
+            outcome.over = outcome.over || cache.total_charge() > kCapacity;
+        });
+    return outcome;
+}
+
+static Outcome compressed() {
+    LIRSCompressedCache<std::uint64_t> cache(kCapacity, 0.05);
+
+    Outcome outcome;
+    workload(outcome,
+        [&](std::uint64_t key) { return cache.get(key).has_value(); },
+        [&](std::uint64_t key, std::string value) { cache.put(key, std::move(value)); },
+        [&]() {
+            if (++outcome.ops > kFill && cache.block_capacity() > cache.size() + 1) outcome.drifted++;
+            outcome.over = outcome.over || cache.total_charge() > kCapacity;
+        });
+    return outcome;
+}
+
+static Outcome dedup() {
+    LIRSDedupCache<std::uint64_t> cache(kCapacity, 0.05);
+
+    Outcome outcome;
+    workload(outcome,
+        [&](std::uint64_t key) { return cache.get(key).has_value(); },
+        [&](std::uint64_t key, std::string value) { cache.put(key, value); },
+        [&]() {
+            if (++outcome.ops > kFill && cache.block_capacity() > cache.size() + 1) outcome.drifted++;
+            outcome.over = outcome.over || cache.total_charge() > kCapacity;
+        });
+    return outcome;
+}
+
+// random puts, gets and erases: promotions on get() decompress values, and the charge must still fit
+static void compressed_fuzz() {
+    std::uint64_t over = 0;
+    for (std::uint64_t seed = 1; seed <= 20; seed++) {
+        LIRSCompressedCache<std::uint64_t> cache(64 * 1024, 0.2);
+        std::mt19937_64 rng(seed);
+        for (int i = 0; i < 20000; i++) {
+            std::uint64_t key = rng() % 400;
+            switch (rng() % 8) {
+                case 0: cache.erase(key); break;
+                case 1: case 2: cache.put(key, make_value(key + seed * 1000)); break;
+                default: cache.get(key); break;
+            }
+            if (cache.total_charge() > cache.capacity()) over++;
+        }
+    }
+    std::printf("%-10s charge above capacity after %llu ops\n", "fuzz", static_cast<unsigned long long>(over));
+    LIRS_CHECK(over == 0);
+}
+
+static void check(const char* name, const Outcome& outcome) {
+    std::printf("%-10s hot hits %.3f, capacity above size + 1 after %llu of %llu ops\n", name, outcome.hot_hit_ratio,
+                static_cast<unsigned long long>(outcome.drifted), static_cast<unsigned long long>(outcome.ops));
+    LIRS_CHECK(!outcome.over);
+    LIRS_CHECK(outcome.drifted * 100 < outcome.ops);
+    LIRS_CHECK(outcome.hot_hit_ratio > 0.8);
+}
+
+int main() {
+    check("sharded", sharded<LIRSCache<std::uint64_t, std::string>>());
+    check("handle", handle());
+    check("compressed", compressed());
+    check("dedup", dedup());
+    compressed_fuzz();
+
+    Outcome lru = sharded<LIRSLRUCache<std::uint64_t, std::string>>();
+    std::printf("%-10s hot hits %.3f\n", "lru", lru.hot_hit_ratio);
+    LIRS_CHECK(lru.hot_hit_ratio < 0.2);
+
+    return lirs_test_result();
+}
@@ -0,0 +1,138 @@
+// Snapshots and delta chains restore the exact LIRS state, also when the
+// cache was resized between checkpoints (as the memory monitor and the
+// charge caches do): loading takes over the writer's capacity.
+
+#include "lirs_test.hpp"
+#include "../lirs_cache/include/lirs_checkpoint.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using Cache = LIRSCache<std::uint64_t, std::string>;
+
+static std::string state(const Cache& cache) {
+    std::ostringstream os;
+    cache.save(os);
+    return os.str();
+}
+
+static void workload(Cache& cache, std::mt19937_64& rng, int ops, bool resizes) {
+    for (int i = 0; i < ops; i++) {
+        std::uint64_t key = rng() % 200;
+        switch (rng() % 16) {
+            case 0: cache.erase(key); break;
+            case 1: cache.put_cold(key, "cold" + std::to_string(key)); break;
+            case 2: if (resizes && i % 20 == 0) cache.resize(16 + rng() % 96); break;
+            case 3: case 4: case 5: cache.put(key, "v" + std::to_string(i)); break;
+            default: cache.get(key % 80); break;
+        }
+    }
+}
+
+// snapshot, then a delta per round; a fresh cache of the starting capacity replays them
+static bool delta_chain_restores(std::uint64_t seed, bool resizes) {
+    Cache cache(64, 0.1);
+    std::mt19937_64 rng(seed);
+
+    workload(cache, rng, 300, resizes);
+    std::ostringstream snapshot;
+    cache.save(snapshot);
+    cache.track_changes(true);
+
+    std::vector<std::string> deltas;
+    for (int round = 0; round < 8; round++) {
+        workload(cache, rng, 200, resizes);
+        std::ostringstream delta;
+        cache.save_delta(delta);
+        deltas.push_back(delta.str());
+    }
+
+    Cache restored(64, 0.1);
+    try {
+        std::istringstream in(snapshot.str());
+        restored.load(in);
+        for (const std::string& delta : deltas) {
+            std::istringstream delta_in(delta);
+            restored.load_delta(delta_in);
+        }
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+    return restored.capacity() == cache.capacity() && state(restored) == state(cache);
+}
+
+static void delta_chains() {
+    int failed = 0;
+    int failed_resizing = 0;
+    for (std::uint64_t seed = 1; seed <= 100; seed++) {
+        if (!delta_chain_restores(seed, false)) failed++;
+        if (!delta_chain_restores(seed, true)) failed_resizing++;
+    }
+    std::printf("delta chains failed: %d of 100, %d of 100 with resizes\n", failed, failed_resizing);
+    LIRS_CHECK(failed == 0);
+    LIRS_CHECK(failed_resizing == 0);
+}
+
+// a different HIR ratio is still refused
+static void hir_ratio_must_match() {
+    Cache cache(64, 0.1);
+    for (std::uint64_t key = 0; key < 100; key++) cache.put(key, "v");
+    std::istringstream in(state(cache));
+
+    Cache other(64, 0.3);
+    bool threw = false;
+    try {
+        other.load(in);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    LIRS_CHECK(threw);
+}
+
+static void checkpointer_restores_after_resize() {
+    std::filesystem::path dir = "/tmp/lirs_checkpoint_test." + std::to_string(::getpid());
+    std::filesystem::remove_all(dir);
+    std::mt19937_64 rng(7);
+
+    Cache cache(64, 0.1);
+    std::string expected;
+    {
+        // no compaction: the resizes stay in the log
+        LIRSCheckpointer<std::uint64_t, std::string>::Options options;
+        options.compact_ratio = 1000;
+        LIRSCheckpointer<std::uint64_t, std::string> checkpoints(cache, dir, options);
+        checkpoints.checkpoint();
+        for (int round = 0; round < 6; round++) {
+            workload(cache, rng, 200, false);
+            cache.resize(round % 2 == 0 ? 40 : 90);
+            checkpoints.checkpoint();
+        }
+        LIRS_CHECK(checkpoints.deltas() == 6);
+        expected = state(cache);
+    }
+
+    Cache restored(64, 0.1);
+    LIRSCheckpointer<std::uint64_t, std::string> checkpoints(restored, dir);
+    bool loaded = false;
+    try {
+        loaded = checkpoints.restore();
+    } catch (const std::runtime_error&) {
+    }
+    LIRS_CHECK(loaded);
+    LIRS_CHECK(restored.capacity() == 90);
+    LIRS_CHECK(state(restored) == expected);
+    std::filesystem::remove_all(dir);
+}
+
+int main() {
+    delta_chains();
+    hir_ratio_must_match();
+    checkpointer_restores_after_resize();
+    return lirs_test_result();
+}
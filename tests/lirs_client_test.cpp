@@ -0,0 +1,119 @@
+// Cluster client against lirs_server-style nodes on loopback: skewed reads
+// that spill past the load bound still find every stored key, and a node
+// that goes away only takes its own keys with it.
+
+#include "lirs_test.hpp"
+#include "../lirs_cache/include/lirs_client.hpp"
+#include "../lirs_cache/include/lirs_item_store.hpp"
+#include "../lirs_cache/include/lirs_memcache.hpp"
+#include "../lirs_cache/include/lirs_server.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using Store = LIRSItemStore<>;
+using Session = LIRSMemcacheSession<Store>;
+
+constexpr std::size_t kNodes = 3;
+constexpr std::size_t kKeys = 1000;
+
+struct Node {
+    Store store;
+    LIRSServer<Session> server;
+
+    Node() : server(options(), [this] { return std::make_unique<Session>(store); }) { server.start(); }
+
+    static LIRSServer<Session>::Options options() {
+        LIRSServer<Session>::Options options;
+        options.port = 0;
+        options.threads = 1;
+        return options;
+    }
+
+    std::uint64_t misses() { return store.stats().get_misses; }
+};
+
+static std::string key_name(std::size_t i) { return "key:" + std::to_string(i); }
+
+static LIRSMemcacheClient::Options client_options(std::vector<std::unique_ptr<Node>>& nodes) {
+    LIRSMemcacheClient::Options options;
+    for (auto& node : nodes) options.nodes.push_back("127.0.0.1:" + std::to_string(node->server.port()));
+    options.timeout_ms = 200;
+    options.retry_after_ms = 60000;
+    options.load_period_ms = 60000;   // keep the load from decaying during the test
+    return options;
+}
+
+// a few hot keys take most reads: their home nodes spill to others, which never got the write
+static void skewed_reads_hit(LIRSMemcacheClient& client, std::vector<std::unique_ptr<Node>>& nodes) {
+    std::mt19937_64 rng(1);
+    std::uint64_t misses_before = 0;
+    for (auto& node : nodes) misses_before += node->misses();
+
+    // node names carry the ports, so placement differs per run: pick hot keys that share a home
+    std::vector<std::string> hot;
+    for (std::size_t i = 0; hot.size() < 5; i++) {
+        if (client.locate(key_name(i)) == 0) hot.push_back(key_name(i));
+    }
+
+    std::size_t reads = 0;
+    std::size_t hits = 0;
+    for (int batch = 0; batch < 50; batch++) {
+        std::vector<std::string> keys;
+        for (int i = 0; i < 100; i++) keys.push_back(rng() % 10 < 8 ? hot[rng() % hot.size()] : key_name(rng() % kKeys));
+
+        std::vector<std::optional<std::string>> values = client.get_many(keys);
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            reads++;
+            if (values[i] && *values[i] == "value of " + keys[i]) hits++;
+        }
+    }
+
+    std::uint64_t misses_after = 0;
+    for (auto& node : nodes) misses_after += node->misses();
+    std::printf("skewed reads: %zu of %zu hit, %llu spilled misses on the nodes\n", hits, reads,
+                static_cast<unsigned long long>(misses_after - misses_before));
+    LIRS_CHECK(hits == reads);
+    LIRS_CHECK(misses_after > misses_before);   // the bound did spill some reads
+}
+
+static void node_failure_moves_only_its_keys(LIRSMemcacheClient& client, std::vector<std::unique_ptr<Node>>& nodes) {
+    std::vector<std::size_t> home(kKeys);
+    for (std::size_t i = 0; i < kKeys; i++) home[i] = client.locate(key_name(i));
+
+    nodes[0]->server.stop();
+
+    std::size_t lost = 0;
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < kKeys; i++) {
+        std::optional<std::string> value = client.get(key_name(i));
+        if (home[i] == 0) lost += value ? 0 : 1;
+        else kept += value ? 1 : 0;
+    }
+    std::size_t on_failed = static_cast<std::size_t>(std::count(home.begin(), home.end(), 0));
+    LIRS_CHECK(!client.alive(0));
+    LIRS_CHECK(lost == on_failed);
+    LIRS_CHECK(kept == kKeys - on_failed);
+
+    // the stand-ins take the failed node's writes
+    for (std::size_t i = 0; i < kKeys; i++) {
+        if (home[i] != 0) continue;
+        LIRS_CHECK(client.set(key_name(i), "again"));
+        LIRS_CHECK(client.get(key_name(i)) == std::optional<std::string>("again"));
+    }
+}
+
+int main() {
+    std::vector<std::unique_ptr<Node>> nodes;
+    for (std::size_t i = 0; i < kNodes; i++) nodes.push_back(std::make_unique<Node>());
+
+    LIRSMemcacheClient client(client_options(nodes));
+    for (std::size_t i = 0; i < kKeys; i++) LIRS_CHECK(client.set(key_name(i), "value of " + key_name(i)));
+
+    skewed_reads_hit(client, nodes);
+    node_failure_moves_only_its_keys(client, nodes);
+    return lirs_test_result();
+}
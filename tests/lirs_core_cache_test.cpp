@@ -0,0 +1,59 @@
+// Thread-per-core cache: a port reads its own writes across cores, and a
+// shard that cannot be built fails the constructor instead of the process.
+
+#include "lirs_test.hpp"
+#include "../lirs_cache/include/lirs_core_cache.hpp"
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+
+using Cache = LIRSCoreCache<std::uint64_t, std::uint64_t>;
+
+static Cache::Options options() {
+    Cache::Options options;
+    options.capacity = 1000;
+    options.cores = 3;
+    options.hir_ratio = 0.1;
+    options.idle_sleep_us = 10;
+    return options;
+}
+
+static void port_reads_its_writes() {
+    Cache cache(options());
+    Cache::Port& port = cache.connect();
+
+    for (std::uint64_t key = 0; key < 300; key++) port.put(key, key * 2);
+
+    std::uint64_t keys[300];
+    std::optional<std::uint64_t> values[300];
+    for (std::uint64_t key = 0; key < 300; key++) keys[key] = key;
+    port.get_many(keys, 300, values);
+
+    bool all = true;
+    for (std::uint64_t key = 0; key < 300; key++) all = all && values[key] == std::optional<std::uint64_t>(key * 2);
+    LIRS_CHECK(all);
+
+    port.erase(7);
+    LIRS_CHECK(!port.get(7).has_value());
+    LIRS_CHECK(cache.core_count() == 3);
+}
+
+// every core's LIRSCache rejects the HIR ratio
+static void shard_errors_reach_the_constructor() {
+    Cache::Options bad = options();
+    bad.hir_ratio = 1.5;
+
+    bool threw = false;
+    try {
+        Cache cache(bad);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    LIRS_CHECK(threw);
+}
+
+int main() {
+    port_reads_its_writes();
+    shard_errors_reach_the_constructor();
+    return lirs_test_result();
+}
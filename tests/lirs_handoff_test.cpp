@@ -0,0 +1,70 @@
+// Warm handoff: the new process ends up with the old cache below its own
+// blocks, and a key it wrote during the transfer never gets the old value
+// back, even after it was evicted and dropped from S.
+
+#include "lirs_test.hpp"
+#include "../lirs_cache/include/lirs_handoff.hpp"
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using Cache = LIRSCache<std::uint64_t, std::string>;
+
+constexpr std::uint64_t kWritten = 5;
+constexpr std::uint64_t kErased = 6;
+
+static void written_keys_keep_the_new_value() {
+    std::string path = "/tmp/lirs_handoff_test." + std::to_string(::getpid()) + ".sock";
+    Cache old_cache(64, 0.1);
+    for (std::uint64_t key = 0; key < 64; key++) old_cache.put(key, "old" + std::to_string(key));
+
+    LIRSHandoffSender<std::uint64_t, std::string>::Options options;
+    options.frame_records = 8;
+    LIRSHandoffSender<std::uint64_t, std::string> sender(path, options);
+    LIRSHandoffReceiver<std::uint64_t, std::string> receiver(path);
+    LIRS_CHECK(receiver.active());
+
+    std::thread old_process([&] {
+        if (sender.accept(5000)) sender.send(old_cache);
+    });
+
+    // the new process serves before anything arrived: a write, then an erase
+    Cache cache(64, 0.1);
+    cache.put(kWritten, "new");
+    receiver.written(kWritten);
+    receiver.erased(kErased);
+
+    // the written key is pushed out of the cache and out of S
+    while (cache.size() > 0) {
+        if (!cache.evict_one()) cache.demote_one();
+    }
+    LIRS_CHECK(!cache.get(kWritten).has_value());
+
+    while (receiver.active()) {
+        if (receiver.step(cache) == 0) ::usleep(1000);
+    }
+    old_process.join();
+
+    LIRS_CHECK(receiver.done());
+    LIRS_CHECK(receiver.received() == 64);
+    LIRS_CHECK(!cache.get(kWritten).has_value());
+    LIRS_CHECK(!cache.get(kErased).has_value());
+    LIRS_CHECK(cache.get(7) == std::optional<std::string>("old7"));
+    LIRS_CHECK(cache.size() == 62);
+}
+
+// nobody listens: the new process starts cold and written() is a no-op
+static void no_sender_starts_cold() {
+    LIRSHandoffReceiver<std::uint64_t, std::string> receiver("/tmp/lirs_handoff_test.none.sock");
+    Cache cache(8);
+    receiver.written(1);
+    LIRS_CHECK(!receiver.active());
+    LIRS_CHECK(receiver.step(cache) == 0);
+}
+
+int main() {
+    written_keys_keep_the_new_value();
+    no_sender_starts_cold();
+    return lirs_test_result();
+}
@@ -0,0 +1,88 @@
+// Every header compiles on its own and every class template instantiates
+// with the key and value types the tools use.
+
+#include "../lirs_cache/include/lirs_arena.hpp"
+#include "../lirs_cache/include/lirs_arena_cache.hpp"
+#include "../lirs_cache/include/lirs_block_cache.hpp"
+#include "../lirs_cache/include/lirs_block_io.hpp"
+#include "../lirs_cache/include/lirs_buffer_pool.hpp"
+#include "../lirs_cache/include/lirs_cache.hpp"
+#include "../lirs_cache/include/lirs_cache_extension.hpp"
+#include "../lirs_cache/include/lirs_charge.hpp"
+#include "../lirs_cache/include/lirs_checkpoint.hpp"
+#include "../lirs_cache/include/lirs_checksum.hpp"
+#include "../lirs_cache/include/lirs_client.hpp"
+#include "../lirs_cache/include/lirs_codec.hpp"
+#include "../lirs_cache/include/lirs_compress.hpp"
+#include "../lirs_cache/include/lirs_compressed_cache.hpp"
+#include "../lirs_cache/include/lirs_core_cache.hpp"
+#include "../lirs_cache/include/lirs_dedup_cache.hpp"
+#include "../lirs_cache/include/lirs_handle_cache.hpp"
+#include "../lirs_cache/include/lirs_handoff.hpp"
+#include "../lirs_cache/include/lirs_hash_ring.hpp"
+#include "../lirs_cache/include/lirs_hot_keys.hpp"
+#include "../lirs_cache/include/lirs_http.hpp"
+#include "../lirs_cache/include/lirs_http_cache.hpp"
+#include "../lirs_cache/include/lirs_http_proxy.hpp"
+#include "../lirs_cache/include/lirs_image.hpp"
+#include "../lirs_cache/include/lirs_item_store.hpp"
+#include "../lirs_cache/include/lirs_lru.hpp"
+#include "../lirs_cache/include/lirs_mapped_cache.hpp"
+#include "../lirs_cache/include/lirs_memcache.hpp"
+#include "../lirs_cache/include/lirs_memory_monitor.hpp"
+#include "../lirs_cache/include/lirs_peer_cache.hpp"
+#include "../lirs_cache/include/lirs_replication.hpp"
+#include "../lirs_cache/include/lirs_reply.hpp"
+#include "../lirs_cache/include/lirs_resp.hpp"
+#include "../lirs_cache/include/lirs_server.hpp"
+#include "../lirs_cache/include/lirs_sharded_cache.hpp"
+#include "../lirs_cache/include/lirs_shared_cache.hpp"
+#include "../lirs_cache/include/lirs_slab_cache.hpp"
+#include "../lirs_cache/include/lirs_trace.hpp"
+#include "../lirs_cache/include/lirs_trace_analyzer.hpp"
+#include "../lirs_cache/include/lirs_trace_binary.hpp"
+#include <cstdint>
+#include <string>
+
+using Key = std::uint64_t;
+using Value = std::uint64_t;
+using ItemCache = LIRSCache<std::string, LIRSItemRef>;
+using ObjectCache = LIRSCache<std::string, LIRSHttpObjectRef>;
+using Store = LIRSItemStore<ItemCache>;
+
+template class LIRSCache<Key, Value>;
+template class LIRSCache<std::string, std::string>;
+template class LIRSCacheExtension<int, std::string>;
+template class LIRSLRUCache<Key, Value>;
+template class LIRSArenaCache<Key, Value>;
+template class LIRSShardedCache<Key, Value>;
+template class LIRSShardedCache<Key, Value, LIRSLRUCache<Key, Value>>;
+template class LIRSHotKeys<Key, Value>;
+template class LIRSCoreCache<Key, Value>;
+template class LIRSSpscRing<Key>;
+template class LIRSHandleCache<Key, std::string>;
+template class LIRSCompressedCache<Key>;
+template class LIRSDedupCache<Key>;
+template class LIRSSlabCache<Key>;
+template class LIRSImage<Key, Value>;
+template class LIRSMappedCache<Key, Value>;
+template class LIRSSharedCache<Key, Value>;
+template class LIRSCheckpointer<Key, std::string>;
+template class LIRSHandoffSender<Key, std::string>;
+template class LIRSHandoffReceiver<Key, std::string>;
+template class LIRSReplicationLeader<Key, std::string>;
+template class LIRSReplicationFollower<Key, std::string>;
+template class LIRSItemStore<ItemCache>;
+template class LIRSMemcacheSession<Store>;
+template class LIRSRespSession<Store>;
+template class LIRSPeerCache<Store>;
+template class LIRSHttpCache<ObjectCache>;
+template class LIRSHttpProxySession<ObjectCache>;
+template class LIRSServer<LIRSMemcacheSession<Store>>;
+template class LIRSServer<LIRSHttpProxySession<ObjectCache>>;
+
+int main() {
+    LIRSCache<Key, Value> cache(4);
+    cache.put(1, 1);
+    return cache.get(1) ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+// Hot-key replicas of the sharded cache: a write or erase empties the key in
+// every replica, a fill that raced a write is dropped, and readers hammering
+// promoted keys next to a writer never see a value older than the last write.
+
+#include "lirs_test.hpp"
+#include "../lirs_cache/include/lirs_sharded_cache.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Cache = LIRSShardedCache<std::uint64_t, std::uint64_t>;
+using HotKeys = LIRSHotKeys<std::uint64_t, std::string>;
+
+constexpr std::size_t kReplicas = 4;
+
+// f on fresh threads, one after another; consecutive thread slots cover every replica
+template <typename F>
+static void on_each_replica(F f) {
+    for (std::size_t i = 0; i < kReplicas; i++) std::thread(f).join();
+}
+
+static HotKeys::Options hot_options() {
+    HotKeys::Options options;
+    options.replicas = kReplicas;
+    return options;
+}
+
+// fill key in every replica, check each one holds value
+static void fill_everywhere(HotKeys& hot, std::uint64_t key, const std::string& value) {
+    on_each_replica([&] {
+        HotKeys::Probe probe = hot.probe(key);
+        LIRS_CHECK(probe.hot && !probe.value);
+        hot.fill(key, value, probe.generation);
+        LIRS_CHECK(hot.probe(key).value == value);
+    });
+}
+
+static void write_empties_every_replica() {
+    HotKeys hot(hot_options());
+    hot.add(7);
+    fill_everywhere(hot, 7, "old");
+
+    hot.invalidate(7);
+    on_each_replica([&] {
+        HotKeys::Probe probe = hot.probe(7);
+        LIRS_CHECK(probe.hot && !probe.value);
+    });
+
+    // an erase of a key that stays hot is the same invalidate; a demotion drops it
+    fill_everywhere(hot, 7, "new");
+    hot.drop(7);
+    on_each_replica([&] { LIRS_CHECK(!hot.probe(7).hot); });
+    LIRS_CHECK(hot.stats().invalidations == 1 && hot.stats().demotions == 1);
+}
+
+// probe, then a write lands before the value read from the shard is filled in
+static void racing_fill_dropped() {
+    HotKeys hot(hot_options());
+    hot.add(7);
+
+    HotKeys::Probe probe = hot.probe(7);
+    hot.invalidate(7);
+    hot.fill(7, "old", probe.generation);
+    LIRS_CHECK(!hot.probe(7).value);
+
+    // a promotion or demotion in between cancels the fill as well
+    probe = hot.probe(7);
+    hot.add(8);
+    hot.fill(7, "old", probe.generation);
+    LIRS_CHECK(!hot.probe(7).value);
+
+    probe = hot.probe(7);
+    hot.fill(7, "current", probe.generation);
+    LIRS_CHECK(hot.probe(7).value == std::string("current"));
+}
+
+static Cache::Options cache_options() {
+    Cache::Options options;
+    options.capacity = 4096;
+    options.shards = 4;
+    options.hot.replicas = kReplicas;
+    options.hot.max_keys = 4;
+    options.hot.sample_every = 8;
+    options.hot.period = 64;
+    options.hot.share = 0.05;
+    return options;
+}
+
+// through the cache: once the replicas serve key, put() and erase() reach every one of them
+static void cache_writes_reach_replicas() {
+    Cache cache(cache_options());
+    constexpr std::uint64_t key = 7;
+    cache.put(key, 1);
+    for (int i = 0; i < 100000 && cache.hot_keys()->keys().empty(); i++) cache.get(key);
+    LIRS_CHECK(cache.hot_keys()->keys() == std::vector<std::uint64_t>{ key });
+
+    // each replica is filled and then served, then the key changes under it
+    on_each_replica([&] {
+        std::uint64_t hits = cache.hot_keys()->stats().replica_hits;
+        for (int i = 0; i < 1000 && cache.hot_keys()->stats().replica_hits == hits; i++) LIRS_CHECK(cache.get(key) == std::uint64_t { 1 });
+        LIRS_CHECK(cache.hot_keys()->stats().replica_hits > hits);
+    });
+    cache.put(key, 2);
+    on_each_replica([&] {
+        for (int i = 0; i < 100; i++) LIRS_CHECK(cache.get(key) == std::uint64_t { 2 });
+    });
+    cache.erase(key);
+    on_each_replica([&] {
+        for (int i = 0; i < 100; i++) LIRS_CHECK(!cache.get(key));
+    });
+}
+
+// one writer bumps versions of a few hot keys, six readers check against the last finished write
+static void readers_never_stale() {
+    constexpr std::uint64_t kKeys = 4;
+    constexpr int kWrites = 20000;
+    constexpr int kReaders = 6;
+
+    Cache cache(cache_options());
+    std::vector<std::atomic<std::uint64_t>> written(kKeys);
+    for (std::uint64_t key = 0; key < kKeys; key++) {
+        cache.put(key, 1);
+        written[key] = 1;
+    }
+
+    std::atomic<bool> done { false };
+    std::atomic<int> stale { 0 };
+    std::vector<std::thread> readers;
+    for (int r = 0; r < kReaders; r++) {
+        readers.emplace_back([&, r] {
+            std::mt19937_64 rng(r);
+            while (!done.load(std::memory_order_acquire)) {
+                std::uint64_t key = rng() % kKeys;
+                std::uint64_t floor = written[key].load(std::memory_order_acquire);
+                std::optional<std::uint64_t> value = cache.get(key);
+                if (value && *value < floor) stale.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    std::mt19937_64 rng(42);
+    for (int i = 0; i < kWrites; i++) {
+        std::uint64_t key = rng() % kKeys;
+        std::uint64_t version = written[key].load(std::memory_order_relaxed) + 1;
+        if (i % 16 == 0) cache.erase(key);
+        cache.put(key, version);
+        written[key].store(version, std::memory_order_release);
+        if (i % 64 == 0) std::this_thread::yield();
+    }
+    done.store(true, std::memory_order_release);
+    for (auto& reader : readers) reader.join();
+
+    auto stats = cache.hot_keys()->stats();
+    std::printf("stress: %llu replica hits, %llu promotions, %llu invalidations, %d stale reads\n",
+                static_cast<unsigned long long>(stats.replica_hits), static_cast<unsigned long long>(stats.promotions),
+                static_cast<unsigned long long>(stats.invalidations), stale.load());
+    LIRS_CHECK(stats.promotions > 0 && stats.replica_hits > 0);
+    LIRS_CHECK(stale == 0);
+}
+
+int main() {
+    write_empties_every_replica();
+    racing_fill_dropped();
+    cache_writes_reach_replicas();
+    readers_never_stale();
+    return lirs_test_result();
+}
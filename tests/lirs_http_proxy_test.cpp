@@ -0,0 +1,284 @@
+// The caching proxy against a local origin, on a single reactor thread: a
+// miss is fetched once and then hit, concurrent misses share one fetch,
+// slow misses neither delay a hit nor reorder a pipelined connection, and
+// every request whose fetch times out gets 504, coalesced ones included.
+
+#include "lirs_test.hpp"
+#include "../lirs_cache/include/lirs_http_proxy.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using ObjectCache = LIRSCache<std::string, LIRSHttpObjectRef>;
+using Session = LIRSHttpProxySession<ObjectCache>;
+
+constexpr int kSlowMs = 1000;   // origin delay for targets under /slow/
+
+static bool send_all(int fd, const std::string& data) {
+    std::size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// one HTTP/1.1 response with a Content-Length body from buffer, reading fd as needed; empty on eof
+static std::string read_response(int fd, std::string& buffer) {
+    char chunk[4096];
+    for (;;) {
+        std::size_t end = buffer.find("\r\n\r\n");
+        if (end != std::string::npos) {
+            std::size_t length = 0;
+            std::size_t field = buffer.find("Content-Length: ");
+            if (field != std::string::npos && field < end) length = std::stoul(buffer.substr(field + 16));
+            if (buffer.size() >= end + 4 + length) {
+                std::string response = buffer.substr(0, end + 4 + length);
+                buffer.erase(0, end + 4 + length);
+                return response;
+            }
+        }
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) return std::string();
+        buffer.append(chunk, static_cast<std::size_t>(n));
+    }
+}
+
+static int connect_to(std::uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// keep-alive origin: "body of <target>", cacheable for a minute, late for /slow/ targets
+class TestOrigin {
+public:
+    TestOrigin() {
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        ::listen(listen_fd_, 64);
+        socklen_t size = sizeof(address);
+        ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address), &size);
+        port_ = ntohs(address.sin_port);
+        acceptor_ = std::thread([this] { accept_all(); });
+    }
+
+    ~TestOrigin() {
+        ::shutdown(listen_fd_, SHUT_RDWR);
+        acceptor_.join();
+        ::close(listen_fd_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int fd : fds_) ::shutdown(fd, SHUT_RDWR);
+        for (std::thread& connection : connections_) connection.join();
+        for (int fd : fds_) ::close(fd);
+    }
+
+    std::uint16_t port() const { return port_; }
+
+    int requests(const std::string& target) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return requests_[target];
+    }
+
+private:
+    void accept_all() {
+        for (;;) {
+            int fd = ::accept(listen_fd_, nullptr, nullptr);
+            if (fd < 0) return;
+            std::lock_guard<std::mutex> lock(mutex_);
+            fds_.push_back(fd);
+            connections_.emplace_back([this, fd] { serve(fd); });
+        }
+    }
+
+    void serve(int fd) {
+        std::string buffer;
+        char chunk[4096];
+        for (;;) {
+            std::size_t end = buffer.find("\r\n\r\n");
+            if (end == std::string::npos) {
+                ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+                if (n <= 0) return;
+                buffer.append(chunk, static_cast<std::size_t>(n));
+                continue;
+            }
+            std::size_t start = buffer.find(' ') + 1;
+            std::string target = buffer.substr(start, buffer.find(' ', start) - start);
+            buffer.erase(0, end + 4);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                requests_[target]++;
+            }
+            if (target.rfind("/slow/", 0) == 0) std::this_thread::sleep_for(std::chrono::milliseconds(kSlowMs));
+
+            std::string body = "body of " + target;
+            std::string response = "HTTP/1.1 200 OK\r\nCache-Control: max-age=60\r\nContent-Length: "
+                                   + std::to_string(body.size()) + "\r\n\r\n" + body;
+            if (!send_all(fd, response)) return;
+        }
+    }
+
+    int listen_fd_;
+    std::uint16_t port_;
+    std::thread acceptor_;
+    std::mutex mutex_;
+    std::vector<int> fds_;
+    std::vector<std::thread> connections_;
+    std::map<std::string, int> requests_;
+};
+
+struct Fetched {
+    std::string response;
+    double ms = 0;
+};
+
+static Fetched fetch(std::uint16_t port, const std::string& target) {
+    Fetched fetched;
+    auto start = std::chrono::steady_clock::now();
+    int fd = connect_to(port);
+    if (fd < 0) return fetched;
+    std::string buffer;
+    if (send_all(fd, "GET " + target + " HTTP/1.1\r\nHost: origin\r\n\r\n")) fetched.response = read_response(fd, buffer);
+    ::close(fd);
+    fetched.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return fetched;
+}
+
+static bool served(const Fetched& fetched, const std::string& target, const char* x_cache) {
+    const std::string& response = fetched.response;
+    return response.rfind("HTTP/1.1 200 OK\r\n", 0) == 0 && response.find(std::string("X-Cache: ") + x_cache) != std::string::npos
+        && response.size() >= target.size() + 8 && response.compare(response.size() - target.size() - 8, std::string::npos, "body of " + target) == 0;
+}
+
+static void miss_then_hit(TestOrigin& origin, std::uint16_t port) {
+    LIRS_CHECK(served(fetch(port, "/fast/a"), "/fast/a", "MISS"));
+    LIRS_CHECK(served(fetch(port, "/fast/a"), "/fast/a", "HIT"));
+    LIRS_CHECK(origin.requests("/fast/a") == 1);
+}
+
+static void concurrent_misses_coalesce(TestOrigin& origin, std::uint16_t port) {
+    std::vector<Fetched> fetched(4);
+    std::vector<std::thread> clients;
+    for (auto& result : fetched) clients.emplace_back([&result, port] { result = fetch(port, "/slow/shared"); });
+    for (auto& client : clients) client.join();
+
+    int misses = 0;
+    for (const auto& result : fetched) {
+        LIRS_CHECK(served(result, "/slow/shared", "MISS") || served(result, "/slow/shared", "HIT"));
+        if (served(result, "/slow/shared", "MISS")) misses++;
+    }
+    LIRS_CHECK(misses == 1);
+    LIRS_CHECK(origin.requests("/slow/shared") == 1);
+}
+
+// slow misses in flight on the only reactor thread: a hit is still answered at once
+static void hit_during_slow_misses(std::uint16_t port) {
+    LIRS_CHECK(served(fetch(port, "/fast/hot"), "/fast/hot", "MISS"));
+
+    std::vector<Fetched> slow(3);
+    std::vector<std::thread> clients;
+    for (std::size_t i = 0; i < slow.size(); i++) {
+        clients.emplace_back([&slow, i, port] { slow[i] = fetch(port, "/slow/" + std::to_string(i)); });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    Fetched hit = fetch(port, "/fast/hot");
+    std::printf("hit with %zu slow misses in flight: %.1f ms\n", slow.size(), hit.ms);
+    LIRS_CHECK(served(hit, "/fast/hot", "HIT"));
+    LIRS_CHECK(hit.ms < kSlowMs / 2);
+
+    for (auto& client : clients) client.join();
+    for (std::size_t i = 0; i < slow.size(); i++) LIRS_CHECK(served(slow[i], "/slow/" + std::to_string(i), "MISS"));
+}
+
+// a hit pipelined behind a slow miss is answered after it
+static void pipeline_stays_in_order(std::uint16_t port) {
+    int fd = connect_to(port);
+    LIRS_CHECK(fd >= 0);
+    if (fd < 0) return;
+    LIRS_CHECK(send_all(fd, "GET /slow/first HTTP/1.1\r\nHost: origin\r\n\r\n"
+                            "GET /fast/a HTTP/1.1\r\nHost: origin\r\n\r\n"
+                            "HEAD /fast/a HTTP/1.1\r\nHost: origin\r\nConnection: close\r\n\r\n"));
+    std::string buffer;
+    LIRS_CHECK(served(Fetched { read_response(fd, buffer) }, "/slow/first", "MISS"));
+    LIRS_CHECK(served(Fetched { read_response(fd, buffer) }, "/fast/a", "HIT"));
+
+    // HEAD: the head alone, then the proxy closes
+    std::size_t end = buffer.find("\r\n\r\n");
+    char chunk[4096];
+    for (ssize_t n = 1; end == std::string::npos && n > 0; end = buffer.find("\r\n\r\n")) {
+        n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n > 0) buffer.append(chunk, static_cast<std::size_t>(n));
+    }
+    LIRS_CHECK(end != std::string::npos && buffer.find("X-Cache: HIT") != std::string::npos);
+    LIRS_CHECK(::recv(fd, chunk, sizeof(chunk), 0) == 0);
+    ::close(fd);
+}
+
+// the leader's fetch times out, so each waiter fetches on its own and times out too
+static void timeouts_are_504(TestOrigin& origin, std::uint16_t port) {
+    std::vector<Fetched> fetched(4);
+    std::vector<std::thread> clients;
+    for (auto& result : fetched) clients.emplace_back([&result, port] { result = fetch(port, "/slow/late"); });
+    for (auto& client : clients) client.join();
+
+    for (const auto& result : fetched) LIRS_CHECK(result.response.rfind("HTTP/1.1 504 Gateway Timeout\r\n", 0) == 0);
+    LIRS_CHECK(origin.requests("/slow/late") == static_cast<int>(fetched.size()));   // nothing to share
+}
+
+int main() {
+    TestOrigin test_origin;
+
+    LIRSHttpCache<ObjectCache> cache;
+    LIRSHttpOrigin::Options origin_options;
+    origin_options.port = std::to_string(test_origin.port());
+    origin_options.timeout_ms = 5000;
+    LIRSHttpOrigin origin(origin_options);
+    LIRSHttpFetchPool fetches(4);
+
+    LIRSServer<Session>::Options options;
+    options.port = 0;
+    options.threads = 1;
+    LIRSServer<Session> server(options, [&] { return std::make_unique<Session>(cache, origin, fetches); });
+    server.start();
+
+    miss_then_hit(test_origin, server.port());
+    concurrent_misses_coalesce(test_origin, server.port());
+    hit_during_slow_misses(server.port());
+    pipeline_stays_in_order(server.port());
+    server.stop();
+
+    // an origin timeout well below the delay of /slow/ targets
+    LIRSHttpOrigin::Options short_options = origin_options;
+    short_options.timeout_ms = kSlowMs / 4;
+    LIRSHttpOrigin short_origin(short_options);
+    LIRSServer<Session> short_server(options, [&] { return std::make_unique<Session>(cache, short_origin, fetches); });
+    short_server.start();
+    timeouts_are_504(test_origin, short_server.port());
+    short_server.stop();
+
+    return lirs_test_result();
+}
@@ -0,0 +1,121 @@
+// Memory monitor against fake cgroup and PSI files: caches shrink a step at
+// a time under pressure and stop at their floor, hold between the shrink
+// and grow thresholds, and grow back to their full size once it is gone.
+
+#include "lirs_test.hpp"
+#include "../lirs_cache/include/lirs_cache.hpp"
+#include "../lirs_cache/include/lirs_memory_monitor.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+static void write_file(const std::filesystem::path& path, const std::string& text) {
+    std::ofstream out(path, std::ios::trunc);
+    out << text;
+}
+
+static void set_psi(const std::filesystem::path& path, double avg10) {
+    write_file(path, "some avg10=" + std::to_string(avg10) + " avg60=0.00 avg300=0.00 total=0\n"
+                     "full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n");
+}
+
+using Capacities = std::vector<std::size_t>;
+
+static void cgroup_v2_and_psi() {
+    std::filesystem::path dir = "/tmp/lirs_memory_monitor_test." + std::to_string(::getpid());
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    write_file(dir / "memory.current", "50\n");
+    write_file(dir / "memory.max", "100\n");
+    set_psi(dir / "pressure", 0.0);
+
+    LIRSMemoryMonitor::Options options;
+    options.cgroup_path = dir.string();
+    options.psi_path = (dir / "pressure").string();
+    LIRSMemoryMonitor monitor(options);
+
+    // steps of 5, 3 (70 * 0.05 rounded down) and 1 (8 * 0.05, but never 0)
+    std::size_t resized = 0;
+    monitor.add(100, 82, [&resized](std::size_t capacity) { resized = capacity; });
+    LIRSCache<std::uint64_t, std::uint64_t> cache(70);
+    std::mutex mutex;
+    monitor.add(cache, mutex, 10);
+    monitor.add(8, 0, [](std::size_t) {});
+
+    // at full size and no pressure there is nothing to grow
+    LIRS_CHECK(monitor.poll() == 0);
+    LIRS_CHECK(monitor.capacities() == Capacities({ 100, 70, 8 }));
+
+    // usage over shrink_usage: one step per poll, down to the floor
+    write_file(dir / "memory.current", "95\n");
+    LIRS_CHECK(monitor.poll() == -1);
+    LIRS_CHECK(monitor.capacities() == Capacities({ 95, 67, 7 }));
+    LIRS_CHECK(resized == 95 && cache.capacity() == 67);
+    for (int i = 0; i < 3; i++) monitor.poll();
+    LIRS_CHECK(monitor.capacities() == Capacities({ 82, 58, 4 }));   // 85 - 5 clamped to the floor of 82
+
+    // between grow_usage and shrink_usage: hold
+    write_file(dir / "memory.current", "85\n");
+    LIRS_CHECK(monitor.poll() == 0);
+    LIRS_CHECK(monitor.capacities() == Capacities({ 82, 58, 4 }));
+
+    // usage is low, but PSI over shrink_psi still shrinks; between grow_psi and shrink_psi it holds
+    write_file(dir / "memory.current", "50\n");
+    set_psi(dir / "pressure", 20.0);
+    LIRS_CHECK(monitor.poll() == -1);
+    LIRS_CHECK(monitor.capacities() == Capacities({ 82, 55, 3 }));
+    set_psi(dir / "pressure", 5.0);
+    LIRS_CHECK(monitor.poll() == 0);
+
+    // both low: grow a step per poll, up to the full size
+    set_psi(dir / "pressure", 0.5);
+    LIRS_CHECK(monitor.poll() == 1);
+    LIRS_CHECK(monitor.capacities() == Capacities({ 87, 58, 4 }));
+    for (int i = 0; i < 20; i++) monitor.poll();
+    LIRS_CHECK(monitor.capacities() == Capacities({ 100, 70, 8 }));
+    LIRS_CHECK(resized == 100 && cache.capacity() == 70);
+
+    // no limit and no PSI file: nothing says there is pressure
+    write_file(dir / "memory.current", "95\n");
+    write_file(dir / "memory.max", "max\n");
+    std::filesystem::remove(dir / "pressure");
+    LIRS_CHECK(monitor.read().limit == 0 && monitor.read().psi_some < 0.0);
+    LIRS_CHECK(monitor.poll() == 0);
+
+    std::filesystem::remove_all(dir);
+}
+
+// v1 files; the "unlimited" limit is ignored
+static void cgroup_v1() {
+    std::filesystem::path dir = "/tmp/lirs_memory_monitor_test.v1." + std::to_string(::getpid());
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    write_file(dir / "memory.usage_in_bytes", "95\n");
+    write_file(dir / "memory.limit_in_bytes", "100\n");
+
+    LIRSMemoryMonitor::Options options;
+    options.cgroup_path = dir.string();
+    options.psi_path = (dir / "pressure").string();
+    LIRSMemoryMonitor monitor(options);
+    monitor.add(100, 1, [](std::size_t) {});
+
+    LIRS_CHECK(monitor.poll() == -1);
+    LIRS_CHECK(monitor.capacities() == Capacities({ 95 }));
+
+    write_file(dir / "memory.limit_in_bytes", "9223372036854771712\n");
+    LIRS_CHECK(monitor.read().limit == 0);
+    LIRS_CHECK(monitor.poll() == 1);
+    LIRS_CHECK(monitor.capacities() == Capacities({ 100 }));
+
+    std::filesystem::remove_all(dir);
+}
+
+int main() {
+    cgroup_v2_and_psi();
+    cgroup_v1();
+    return lirs_test_result();
+}
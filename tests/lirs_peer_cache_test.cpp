@@ -0,0 +1,116 @@
+// Peer caching between two in-process nodes on loopback: a miss is served
+// from the key's home node when the block is LIR there, the copy arrives as
+// a local HIR block, and a value written here meanwhile is never replaced.
+
+#include "lirs_test.hpp"
+#include "../lirs_cache/include/lirs_client.hpp"
+#include "../lirs_cache/include/lirs_memcache.hpp"
+#include "../lirs_cache/include/lirs_peer_cache.hpp"
+#include "../lirs_cache/include/lirs_server.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+using Store = LIRSItemStore<>;
+using Front = LIRSPeerStore<Store>;
+using Session = LIRSMemcacheSession<Front>;
+
+struct Node {
+    Store store;
+    std::unique_ptr<LIRSPeerCache<Store>> peers;
+    std::unique_ptr<Front> front;
+    LIRSServer<Session> server;
+
+    Node() : server(options(), [this] { return std::make_unique<Session>(*front); }) {}
+
+    static LIRSServer<Session>::Options options() {
+        LIRSServer<Session>::Options options;
+        options.port = 0;
+        options.threads = 1;
+        return options;
+    }
+
+    std::string address() const { return "127.0.0.1:" + std::to_string(server.port()); }
+};
+
+static void store(Store& store, const std::string& key, const std::string& value) {
+    store.store(LIRSStoreMode::Set, key, value, 0, 0);
+}
+
+// first key (by name) whose home is node
+static std::string key_homed_on(LIRSPeerCache<Store>& peers, std::size_t node, const std::string& prefix) {
+    for (int i = 0;; i++) {
+        std::string key = prefix + std::to_string(i);
+        if (peers.peers().home(key) == node) return key;
+    }
+}
+
+static void peer_copy_is_served(Node& a, Node& b) {
+    std::string key = key_homed_on(*b.peers, 0, "lir:");
+    store(a.store, key, "from a");
+
+    LIRSItemRef item = b.peers->get(key);
+    LIRS_CHECK(item != nullptr && item->data == "from a");
+    LIRS_CHECK(b.peers->stats().peer_hits == 1);
+
+    // now local
+    item = b.peers->get(key);
+    LIRS_CHECK(item != nullptr && item->data == "from a");
+    LIRS_CHECK(b.peers->stats().local_hits == 1);
+
+    // keys homed here are not asked for, and unknown keys miss
+    LIRS_CHECK(b.peers->get(key_homed_on(*b.peers, 1, "lir:")) == nullptr);
+    LIRS_CHECK(b.peers->get(key_homed_on(*b.peers, 0, "none:")) == nullptr);
+    LIRS_CHECK(b.peers->stats().misses == 2);
+}
+
+// memcache clients of a node get its peers' blocks too
+static void sessions_go_through_peers(Node& a, Node& b) {
+    std::string key = key_homed_on(*b.peers, 0, "session:");
+    store(a.store, key, "via session");
+
+    LIRSMemcacheClient::Options options;
+    options.nodes = { b.address() };
+    LIRSMemcacheClient client(options);
+    LIRS_CHECK(client.get(key) == std::optional<std::string>("via session"));
+    LIRS_CHECK(b.store.peek(key) != nullptr);
+}
+
+// a value written here after the lookup started keeps its place
+static void resident_value_wins() {
+    Store local;
+    store(local, "k", "newer");
+    LIRSItemRef item = local.store_cold("k", "older", 0, 0);
+    LIRS_CHECK(item != nullptr && item->data == "newer");
+    LIRS_CHECK(local.peek("k")->data == "newer");
+
+    item = local.store_cold("fresh", "copy", 0, 0);
+    LIRS_CHECK(item != nullptr && item->data == "copy");
+    LIRS_CHECK(local.peek("fresh") != nullptr);
+}
+
+int main() {
+    std::vector<std::unique_ptr<Node>> nodes;
+    for (int i = 0; i < 2; i++) {
+        nodes.push_back(std::make_unique<Node>());
+        nodes.back()->server.start();
+    }
+
+    std::vector<std::string> addresses;
+    for (auto& node : nodes) addresses.push_back(node->address());
+    for (std::size_t i = 0; i < nodes.size(); i++) {
+        LIRSPeerCache<Store>::Options options;
+        options.nodes = addresses;
+        options.self = i;
+        options.timeout_ms = 200;
+        nodes[i]->peers = std::make_unique<LIRSPeerCache<Store>>(nodes[i]->store, options);
+        nodes[i]->front = std::make_unique<Front>(*nodes[i]->peers);
+    }
+
+    peer_copy_is_served(*nodes[0], *nodes[1]);
+    sessions_go_through_peers(*nodes[0], *nodes[1]);
+    resident_value_wins();
+
+    for (auto& node : nodes) node->server.stop();
+    return lirs_test_result();
+}
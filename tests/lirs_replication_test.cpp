@@ -0,0 +1,161 @@
+// Leader/follower replication: a follower that replays the leader's log
+// holds the same LIRS state, over the in-process queue and a Unix socket.
+
+#include "lirs_test.hpp"
+#include "../lirs_cache/include/lirs_replication.hpp"
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+using Cache = LIRSCache<std::uint64_t, std::string>;
+using Leader = LIRSReplicationLeader<std::uint64_t, std::string>;
+using Follower = LIRSReplicationFollower<std::uint64_t, std::string>;
+
+static std::string state(const Cache& cache) {
+    std::ostringstream os;
+    cache.save(os);
+    return os.str();
+}
+
+// a mix of every replicated operation over a key space larger than the cache
+static void workload(Leader& leader, std::mt19937_64& rng, int ops) {
+    for (int i = 0; i < ops; i++) {
+        std::uint64_t key = rng() % 200;
+        switch (rng() % 16) {
+            case 0: leader.erase(key); break;
+            case 1: leader.put_cold(key, "cold" + std::to_string(key)); break;
+            case 2: leader.evict_one(); break;
+            case 3: leader.demote_one(); break;
+            case 4: if (i % 50 == 0) leader.resize(32 + rng() % 64); break;
+            case 5: case 6: case 7: leader.put(key, "v" + std::to_string(i)); break;
+            default: leader.get(key % 80); break;
+        }
+        if (i % 97 == 0) leader.flush();
+    }
+    leader.flush();
+}
+
+static void drain(LIRSReplicationQueue& queue, Follower& follower) {
+    std::string frame;
+    while (queue.pop(frame, 0)) follower.apply(frame);
+}
+
+static void queue_follower_matches_leader() {
+    Cache primary(64, 0.1);
+    Cache replica(16, 0.1);
+    Leader::Options options;
+    options.batch_records = 37;
+    Leader leader(primary, options);
+    Follower follower(replica);
+    LIRSReplicationQueue queue;
+    std::mt19937_64 rng(1);
+
+    // the snapshot carries state written before the follower attached
+    workload(leader, rng, 500);
+    leader.attach(queue);
+    workload(leader, rng, 5000);
+    drain(queue, follower);
+
+    LIRS_CHECK(follower.synced());
+    LIRS_CHECK(follower.sequence() == leader.sequence());
+    LIRS_CHECK(replica.capacity() == primary.capacity());
+    LIRS_CHECK(state(replica) == state(primary));
+}
+
+static void gap_needs_a_new_snapshot() {
+    Cache primary(64);
+    Cache replica(64);
+    Leader leader(primary);
+    Follower follower(replica);
+    LIRSReplicationQueue queue;
+    std::mt19937_64 rng(2);
+
+    leader.attach(queue);
+    workload(leader, rng, 300);
+    drain(queue, follower);
+    LIRS_CHECK(follower.synced());
+
+    // lose one batch
+    leader.put(1, "lost");
+    leader.flush();
+    std::string frame;
+    LIRS_CHECK(queue.pop(frame, 0));
+    leader.put(2, "after");
+    leader.flush();
+    LIRS_CHECK(queue.pop(frame, 0));
+
+    bool threw = false;
+    try {
+        follower.apply(frame);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    LIRS_CHECK(threw);
+    LIRS_CHECK(!follower.synced());
+
+    // batches are ignored until a fresh snapshot arrives
+    leader.put(3, "ignored");
+    leader.flush();
+    LIRS_CHECK(queue.pop(frame, 0));
+    LIRS_CHECK(follower.apply(frame) == 0);
+
+    leader.detach(queue);
+    leader.attach(queue);
+    drain(queue, follower);
+    LIRS_CHECK(follower.synced());
+    LIRS_CHECK(state(replica) == state(primary));
+}
+
+static void full_queue_detaches_follower() {
+    Cache primary(64);
+    Leader::Options options;
+    options.batch_records = 1;
+    Leader leader(primary, options);
+    LIRSReplicationQueue queue(4);
+
+    leader.attach(queue);
+    for (int i = 0; i < 10; i++) leader.put(static_cast<std::uint64_t>(i), "x");
+    LIRS_CHECK(leader.followers() == 0);
+}
+
+static void socket_follower_matches_leader() {
+    std::string path = "/tmp/lirs_replication_test." + std::to_string(::getpid()) + ".sock";
+    Cache primary(64, 0.1);
+    Cache replica(64, 0.1);
+    Leader leader(primary);
+    Follower follower(replica);
+    std::mt19937_64 rng(3);
+
+    LIRSReplicationListener listener(path);
+    LIRSReplicationReceiver receiver(path);
+    std::unique_ptr<LIRSReplicationStream> stream = listener.accept(1000);
+    LIRS_CHECK(stream != nullptr);
+    if (stream == nullptr) return;
+
+    leader.attach(*stream);
+    std::string frame;
+    for (int round = 0; round < 10; round++) {
+        workload(leader, rng, 300);
+        while (follower.sequence() < leader.sequence() && receiver.receive(frame, 1000)) follower.apply(frame);
+    }
+    LIRS_CHECK(follower.synced());
+    LIRS_CHECK(state(replica) == state(primary));
+
+    // the follower sees the leader hang up
+    leader.detach(*stream);
+    stream.reset();
+    LIRS_CHECK(!receiver.receive(frame, 1000));
+    LIRS_CHECK(receiver.closed());
+    ::unlink(path.c_str());
+}
+
+int main() {
+    queue_follower_matches_leader();
+    gap_needs_a_new_snapshot();
+    full_queue_detaches_follower();
+    socket_follower_matches_leader();
+    return lirs_test_result();
+}
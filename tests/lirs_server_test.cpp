@@ -0,0 +1,119 @@
+// The memcache server on loopback: a second server on a port that is in use
+// fails to start instead of sharing it, and the reactors sharing one
+// listening socket answer every connection of a burst.
+
+#include "lirs_test.hpp"
+#include "../lirs_cache/include/lirs_item_store.hpp"
+#include "../lirs_cache/include/lirs_memcache.hpp"
+#include "../lirs_cache/include/lirs_server.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using Store = LIRSItemStore<>;
+using Session = LIRSMemcacheSession<Store>;
+using Server = LIRSServer<Session>;
+
+static Server::Options options(std::uint16_t port, std::size_t threads) {
+    Server::Options options;
+    options.port = port;
+    options.threads = threads;
+    return options;
+}
+
+static int connect_to(std::uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// one request, then read until the reply ends with terminator; empty on failure
+static std::string exchange(int fd, const std::string& request, const std::string& terminator) {
+    if (::send(fd, request.data(), request.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request.size())) return std::string();
+    std::string reply;
+    char chunk[4096];
+    while (reply.size() < terminator.size() || reply.compare(reply.size() - terminator.size(), terminator.size(), terminator) != 0) {
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) return std::string();
+        reply.append(chunk, static_cast<std::size_t>(n));
+    }
+    return reply;
+}
+
+static void busy_port_fails() {
+    Store store;
+    auto make_session = [&store] { return std::make_unique<Session>(store); };
+    Server first(options(0, 2), make_session);
+    first.start();
+
+    Server second(options(first.port(), 2), make_session);
+    bool threw = false;
+    try {
+        second.start();
+    } catch (const std::system_error&) {
+        threw = true;
+    }
+    LIRS_CHECK(threw);
+
+    // the first server still has the port to itself, and it is free again once stopped
+    int fd = connect_to(first.port());
+    LIRS_CHECK(fd >= 0 && exchange(fd, "version\r\n", "\r\n").rfind("VERSION ", 0) == 0);
+    if (fd >= 0) ::close(fd);
+
+    std::uint16_t port = first.port();
+    first.stop();
+    threw = false;
+    try {
+        second.start();
+    } catch (const std::system_error&) {
+        threw = true;
+    }
+    LIRS_CHECK(!threw && second.port() == port);
+    second.stop();
+}
+
+static void reactors_share_listener() {
+    Store store;
+    Server server(options(0, 4), [&store] { return std::make_unique<Session>(store); });
+    server.start();
+
+    constexpr int kClients = 64;
+    std::vector<int> fds;
+    for (int i = 0; i < kClients; i++) fds.push_back(connect_to(server.port()));
+
+    int answered = 0;
+    for (int i = 0; i < kClients; i++) {
+        if (fds[i] < 0) continue;
+        std::string key = "key:" + std::to_string(i);
+        std::string value = "value of " + key;
+        if (exchange(fds[i], "set " + key + " 0 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\n", "\r\n") != "STORED\r\n") continue;
+        if (exchange(fds[i], "get " + key + "\r\n", "END\r\n").find(value) != std::string::npos) answered++;
+    }
+    LIRS_CHECK(answered == kClients);
+    LIRS_CHECK(server.connections() == kClients);
+
+    for (int fd : fds) {
+        if (fd >= 0) ::close(fd);
+    }
+    server.stop();
+}
+
+int main() {
+    busy_port_fails();
+    reactors_share_listener();
+    return lirs_test_result();
+}
@@ -0,0 +1,116 @@
+// Shared-memory cache: processes share one segment, and a creator that dies
+// before marking the segment ready does not block its name for good.
+
+#include "lirs_test.hpp"
+#include "../lirs_cache/include/lirs_shared_cache.hpp"
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using Cache = LIRSSharedCache<std::uint64_t, std::uint64_t>;
+
+static std::string segment_name(const char* what) {
+    return "/lirs_shared_cache_test." + std::to_string(::getpid()) + "." + what;
+}
+
+static Cache::Options options() {
+    Cache::Options options;
+    options.capacity = 256;
+    options.shards = 4;
+    options.attach_timeout_ms = 50;
+    return options;
+}
+
+static off_t segment_size(const std::string& name) {
+    int fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0) return -1;
+    struct stat st;
+    off_t size = ::fstat(fd, &st) == 0 ? st.st_size : -1;
+    ::close(fd);
+    return size;
+}
+
+static void processes_share_entries() {
+    std::string name = segment_name("share");
+    Cache cache(name, options());
+    LIRS_CHECK(cache.created());
+
+    pid_t child = ::fork();
+    if (child == 0) {
+        Cache other(name, options());
+        other.put(7, 49);
+        ::_exit(other.created() ? 1 : 0);
+    }
+    int status = 0;
+    ::waitpid(child, &status, 0);
+    LIRS_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    LIRS_CHECK(cache.get(7) == std::optional<std::uint64_t>(49));
+    Cache::remove(name);
+}
+
+// a child creates the name, sizes it, and dies before ready is set (size 0 when sized is false)
+static void dead_creator_is_replaced(bool sized) {
+    std::string name = segment_name(sized ? "sized" : "empty");
+    off_t size = 0;
+    {
+        Cache probe(name, options());
+        size = segment_size(name);
+        Cache::remove(name);
+    }
+
+    pid_t child = ::fork();
+    if (child == 0) {
+        int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0 || ::flock(fd, LOCK_EX) != 0) ::_exit(1);
+        if (sized && ::ftruncate(fd, size) != 0) ::_exit(1);
+        ::_exit(0);
+    }
+    int status = 0;
+    ::waitpid(child, &status, 0);
+    LIRS_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    try {
+        Cache cache(name, options());
+        LIRS_CHECK(cache.created());
+        cache.put(1, 2);
+        LIRS_CHECK(cache.get(1) == std::optional<std::uint64_t>(2));
+        LIRS_CHECK(segment_size(name) == size);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "open after a dead creator: %s\n", e.what());
+        LIRS_CHECK(false);
+    }
+    Cache::remove(name);
+}
+
+// a creator that is alive but slow keeps its segment; the opener gives up
+static void live_creator_is_kept() {
+    std::string name = segment_name("live");
+    int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    LIRS_CHECK(fd >= 0 && ::flock(fd, LOCK_EX) == 0);
+
+    bool threw = false;
+    try {
+        Cache cache(name, options());
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    LIRS_CHECK(threw);
+    LIRS_CHECK(segment_size(name) == 0);
+
+    ::close(fd);
+    Cache::remove(name);
+}
+
+int main() {
+    processes_share_entries();
+    dead_creator_is_replaced(false);
+    dead_creator_is_replaced(true);
+    live_creator_is_kept();
+    return lirs_test_result();
+}
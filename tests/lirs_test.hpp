@@ -0,0 +1,30 @@
+#ifndef LIRS_TEST_HPP
+#define LIRS_TEST_HPP
+
+/*
+ * Minimal checks for the tests/ programs
+ *
+ *    LIRS_CHECK(cond) ── false ──► "file:line: check failed: cond", counted
+ *    return lirs_test_result();     0 when every check passed
+ */
+
+#include <cstdio>
+
+inline int lirs_test_failures = 0;
+
+#define LIRS_CHECK(cond)                                                              \
+  do {                                                                                \
+    if (!(cond)) {                                                                    \
+      std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+      lirs_test_failures++;                                                           \
+    }                                                                                 \
+  } while (0)
+
+inline int lirs_test_result() {
+
+  if (lirs_test_failures == 0) std::printf("ok\n");
+  else std::fprintf(stderr, "%d check(s) failed\n", lirs_test_failures);
+  return lirs_test_failures == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,168 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "../lirs_cache/include/lirs_cache.hpp"
+#include "../lirs_cache/include/lirs_arena_cache.hpp"
+
+static void usage() {
+    std::cerr << "usage: lirs_arena_bench [options]\n"
+              << "  --entries N            cache capacity, filled completely (default: 4000000)\n"
+              << "  --gets N               random lookups to time (default: 20000000)\n"
+              << "  --hir-ratio R          HIR ratio (default: 0.01)\n"
+              << "  --no-prefault          let arenas fault in on first touch\n"
+              << "  --only heap|4k|thp|hugetlb   run one node store (default: all)\n";
+}
+
+// dTLB load misses of this thread in user space; unavailable without perf events
+class DtlbCounter {
+public:
+    DtlbCounter() {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    ~DtlbCounter() {
+        if (fd_ >= 0) close(fd_);
+    }
+
+    bool available() const { return fd_ >= 0; }
+
+    void start() {
+        if (fd_ < 0) return;
+        ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    std::uint64_t stop() {
+        std::uint64_t count = 0;
+        if (fd_ < 0) return 0;
+        ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd_, &count, sizeof(count)) != sizeof(count)) return 0;
+        return count;
+    }
+
+private:
+    int fd_;
+};
+
+static std::uint64_t mix(std::uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+struct Config {
+    std::size_t entries = 4000000;
+    std::size_t gets = 20000000;
+    double hir_ratio = 0.01;
+    bool prefault = true;
+};
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename MakeCache>
+static void run(const std::string& name, const Config& config, MakeCache make_cache) {
+    auto start = std::chrono::steady_clock::now();
+    auto cache = make_cache();
+    double build = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < config.entries; i++) cache->put(mix(i), i);
+    double fill = seconds_since(start);
+
+    // uniform lookups over the whole key set: the TLB-hostile case
+    DtlbCounter counter;
+    std::uint64_t state = 42;
+    std::uint64_t hits = 0;
+
+    start = std::chrono::steady_clock::now();
+    counter.start();
+    for (std::size_t i = 0; i < config.gets; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        if (cache->get(mix(state % config.entries))) hits++;
+    }
+    std::uint64_t misses = counter.stop();
+    double gets = seconds_since(start);
+
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed
+              << std::setw(9) << std::setprecision(1) << build * 1e3
+              << std::setw(11) << std::setprecision(2) << config.entries / fill / 1e6
+              << std::setw(11) << config.gets / gets / 1e6
+              << std::setw(9) << std::setprecision(1) << 100.0 * hits / config.gets << "%";
+    if (counter.available()) std::cout << std::setw(14) << std::setprecision(3) << static_cast<double>(misses) / config.gets << "\n";
+    else std::cout << std::setw(14) << "n/a" << "\n";
+}
+
+static void run_arena(const char* label, LIRSHugePages huge_pages, const Config& config) {
+    LIRSArena::Options options;
+    options.huge_pages = huge_pages;
+    options.prefault = config.prefault;
+
+    std::string backing;
+    run(label, config, [&] {
+        auto cache = std::make_unique<LIRSArenaCache<std::uint64_t, std::uint64_t>>(config.entries, config.hir_ratio, 0, options);
+        backing = cache->backing_name();
+        return cache;
+    });
+    if (huge_pages != LIRSHugePages::None && backing != label) std::cout << "  (" << label << " unavailable, got " << backing << " pages)\n";
+}
+
+int main(int argc, char** argv) {
+    Config config;
+    std::string only;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--entries" && has_value) config.entries = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--gets" && has_value) config.gets = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--hir-ratio" && has_value) config.hir_ratio = std::strtod(argv[++i], nullptr);
+        else if (arg == "--no-prefault") config.prefault = false;
+        else if (arg == "--only" && has_value) only = argv[++i];
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (config.entries == 0) {
+        usage();
+        return 1;
+    }
+
+    std::cout << "entries: " << config.entries << " | gets: " << config.gets
+              << " | prefault: " << (config.prefault ? "yes" : "no") << "\n\n";
+    std::cout << std::left << std::setw(10) << "store" << std::right
+              << std::setw(9) << "build ms" << std::setw(11) << "put M/s" << std::setw(11) << "get M/s"
+              << std::setw(10) << "hits" << std::setw(14) << "dTLB miss/get" << "\n";
+
+    if (only.empty() || only == "heap") {
+        run("heap", config, [&] { return std::make_unique<LIRSCache<std::uint64_t, std::uint64_t>>(config.entries, config.hir_ratio); });
+    }
+    if (only.empty() || only == "4k") run_arena("4k", LIRSHugePages::None, config);
+    if (only.empty() || only == "thp") run_arena("thp", LIRSHugePages::Transparent, config);
+    if (only.empty() || only == "hugetlb") run_arena("hugetlb", LIRSHugePages::HugeTLB, config);
+    return 0;
+}
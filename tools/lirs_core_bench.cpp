@@ -0,0 +1,265 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include "../lirs_cache/include/lirs_cache.hpp"
+#include "../lirs_cache/include/lirs_core_cache.hpp"
+#include "../lirs_cache/include/lirs_lru.hpp"
+#include "../lirs_cache/include/lirs_sharded_cache.hpp"
+
+static void usage() {
+    std::cerr << "usage: lirs_core_bench [options]\n"
+              << "  --cores N              core threads of the shared-nothing cache (default: all CPUs)\n"
+              << "  --clients N            client threads (default: cores)\n"
+              << "  --shards N             shards of the lock-striped cache (default: 4 per client)\n"
+              << "  --keys N               key space (default: 4000000)\n"
+              << "  --capacity N           cache capacity in blocks (default: keys / 4)\n"
+              << "  --ops N                lookups per client (default: 4000000)\n"
+              << "  --batch N              keys per get_many (default: 32)\n"
+              << "  --zipf S               zipf exponent, 0 = uniform (default: 0.99)\n"
+              << "  --policy lirs|lru      replacement policy (default: lirs)\n"
+              << "  --only sharded|core    run one mode (default: both)\n"
+              << "  --hot-replicas N       sharded: read replicas of hot keys, 0 = off (default: 0)\n";
+}
+
+struct Config {
+    std::size_t cores = 0;
+    std::size_t clients = 0;
+    std::size_t shards = 0;
+    std::size_t keys = 4000000;
+    std::size_t capacity = 0;
+    std::size_t ops = 4000000;
+    std::size_t batch = 32;
+    double zipf_s = 0.99;
+    std::string policy = "lirs";
+    std::string only;
+    std::size_t hot_replicas = 0;
+};
+
+static std::uint64_t mix(std::uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// xorshift64*, one per client
+class Random {
+public:
+    explicit Random(std::uint64_t seed) : state_(mix(seed) | 1) {}
+
+    std::uint64_t next() {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        return state_ * 0x2545F4914F6CDD1DULL;
+    }
+
+    double uniform() { return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+    std::uint64_t state_;
+};
+
+// key sampler: zipf by inverse CDF, or uniform; ranks are mixed so hot keys spread over shards
+class KeySampler {
+public:
+    KeySampler(std::size_t keys, double s) : keys_(keys) {
+        if (s <= 0.0) return;
+
+        cdf_.resize(keys);
+        double sum = 0.0;
+        for (std::size_t rank = 0; rank < keys; rank++) {
+            sum += 1.0 / std::pow(static_cast<double>(rank + 1), s);
+            cdf_[rank] = sum;
+        }
+        for (double& value : cdf_) value /= sum;
+    }
+
+    std::uint64_t sample(Random& random) const {
+        std::size_t rank;
+        if (cdf_.empty()) rank = static_cast<std::size_t>(random.next() % keys_);
+        else rank = std::min<std::size_t>(keys_ - 1, static_cast<std::size_t>(std::lower_bound(cdf_.begin(), cdf_.end(), random.uniform()) - cdf_.begin()));
+        return mix(rank);
+    }
+
+private:
+    std::size_t keys_;
+    std::vector<double> cdf_;
+};
+
+struct Result {
+    double seconds = 0.0;
+    std::uint64_t lookups = 0;
+    std::uint64_t hits = 0;
+};
+
+// clients run cache-aside batches (get_many, then put the misses) through client(index, random)
+template <typename Client>
+static Result run_clients(const Config& config, Client client) {
+    std::atomic<std::size_t> ready { 0 };
+    std::atomic<bool> go { false };
+    std::vector<std::uint64_t> hits(config.clients, 0);
+    std::vector<std::thread> threads;
+
+    for (std::size_t c = 0; c < config.clients; c++) {
+        threads.emplace_back([&, c] {
+            ready++;
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            hits[c] = client(c);
+        });
+    }
+    while (ready.load() < config.clients) std::this_thread::yield();
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& thread : threads) thread.join();
+
+    Result result;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.lookups = static_cast<std::uint64_t>(config.clients) * (config.ops / config.batch * config.batch);
+    for (std::uint64_t h : hits) result.hits += h;
+    return result;
+}
+
+static void print_row(const std::string& name, const Result& result, const std::string& note) {
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed
+              << std::setw(12) << std::setprecision(2) << result.lookups / result.seconds / 1e6
+              << std::setw(11) << std::setprecision(2) << 100.0 * result.hits / result.lookups << "%"
+              << "   " << note << "\n";
+}
+
+template <typename Cache>
+static void run_sharded(const Config& config, const KeySampler& sampler) {
+    typename LIRSShardedCache<std::uint64_t, std::uint64_t, Cache>::Options options;
+    options.capacity = config.capacity;
+    options.shards = config.shards;
+    options.hot.replicas = config.hot_replicas;
+    LIRSShardedCache<std::uint64_t, std::uint64_t, Cache> cache(options);
+
+    Result result = run_clients(config, [&](std::size_t c) {
+        Random random(c + 1);
+        std::vector<std::uint64_t> keys(config.batch);
+        std::vector<std::optional<std::uint64_t>> values(config.batch);
+        std::uint64_t hits = 0;
+
+        for (std::size_t done = 0; done + config.batch <= config.ops; done += config.batch) {
+            for (auto& key : keys) key = sampler.sample(random);
+            cache.get_many(keys.data(), keys.size(), values.data());
+            for (std::size_t i = 0; i < keys.size(); i++) {
+                if (values[i]) hits++;
+                else cache.put(keys[i], keys[i]);
+            }
+        }
+        return hits;
+    });
+    std::string note = std::to_string(cache.shard_count()) + " shards";
+    if (const auto* hot = cache.hot_keys()) {
+        auto stats = hot->stats();
+        note += ", " + std::to_string(stats.hot_keys) + " hot keys, " + std::to_string(stats.replica_hits) + " replica hits";
+    }
+    print_row("sharded", result, note);
+}
+
+template <typename Cache>
+static void run_core(const Config& config, const KeySampler& sampler) {
+    typename LIRSCoreCache<std::uint64_t, std::uint64_t, Cache>::Options options;
+    options.capacity = config.capacity;
+    options.cores = config.cores;
+    LIRSCoreCache<std::uint64_t, std::uint64_t, Cache> cache(options);
+
+    Result result = run_clients(config, [&](std::size_t c) {
+        auto& port = cache.connect();
+        Random random(c + 1);
+        std::vector<std::uint64_t> keys(config.batch);
+        std::vector<std::optional<std::uint64_t>> values(config.batch);
+        std::uint64_t hits = 0;
+
+        // the puts of a batch travel with the next batch's lookups
+        for (std::size_t done = 0; done + config.batch <= config.ops; done += config.batch) {
+            for (auto& key : keys) key = sampler.sample(random);
+            port.get_many(keys.data(), keys.size(), values.data());
+            for (std::size_t i = 0; i < keys.size(); i++) {
+                if (values[i]) hits++;
+                else port.put(keys[i], keys[i]);
+            }
+        }
+        port.wait();
+        return hits;
+    });
+
+    std::uint64_t requests = 0, batches = 0;
+    std::size_t pinned = 0;
+    for (const auto& stats : cache.stats()) {
+        requests += stats.requests;
+        batches += stats.batches;
+        if (stats.cpu >= 0) pinned++;
+    }
+    std::ostringstream note;
+    note << cache.core_count() << " cores (" << pinned << " pinned), " << std::fixed << std::setprecision(1)
+         << (batches == 0 ? 0.0 : static_cast<double>(requests) / batches) << " requests/batch";
+    print_row("core", result, note.str());
+}
+
+int main(int argc, char** argv) {
+    Config config;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--cores" && has_value) config.cores = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--clients" && has_value) config.clients = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--shards" && has_value) config.shards = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--keys" && has_value) config.keys = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--capacity" && has_value) config.capacity = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--ops" && has_value) config.ops = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--batch" && has_value) config.batch = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--zipf" && has_value) config.zipf_s = std::strtod(argv[++i], nullptr);
+        else if (arg == "--policy" && has_value) config.policy = argv[++i];
+        else if (arg == "--only" && has_value) config.only = argv[++i];
+        else if (arg == "--hot-replicas" && has_value) config.hot_replicas = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            usage();
+            return 2;
+        }
+    }
+
+    if (config.cores == 0) config.cores = std::max(1u, std::thread::hardware_concurrency());
+    if (config.clients == 0) config.clients = config.cores;
+    if (config.shards == 0) config.shards = config.clients * 4;
+    if (config.capacity == 0) config.capacity = config.keys / 4;
+    if (config.keys == 0 || config.capacity == 0 || config.batch == 0 || config.ops < config.batch
+        || (config.policy != "lirs" && config.policy != "lru")) {
+        usage();
+        return 2;
+    }
+
+    KeySampler sampler(config.keys, config.zipf_s);
+
+    std::cout << "clients: " << config.clients << " | keys: " << config.keys << " | capacity: " << config.capacity
+              << " | ops: " << config.ops << " per client, batch " << config.batch
+              << " | zipf: " << config.zipf_s << " | policy: " << config.policy << "\n\n";
+    std::cout << std::left << std::setw(10) << "mode" << std::right << std::setw(12) << "lookups M/s"
+              << std::setw(12) << "hits" << "\n";
+
+    bool lru = config.policy == "lru";
+    if (config.only.empty() || config.only == "sharded") {
+        if (lru) run_sharded<LIRSLRUCache<std::uint64_t, std::uint64_t>>(config, sampler);
+        else run_sharded<LIRSCache<std::uint64_t, std::uint64_t>>(config, sampler);
+    }
+    if (config.only.empty() || config.only == "core") {
+        if (lru) run_core<LIRSLRUCache<std::uint64_t, std::uint64_t>>(config, sampler);
+        else run_core<LIRSCache<std::uint64_t, std::uint64_t>>(config, sampler);
+    }
+    return 0;
+}
@@ -0,0 +1,397 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../lirs_cache/include/lirs_cache.hpp"
+#include "../lirs_cache/include/lirs_lru.hpp"
+#include "../lirs_cache/include/lirs_item_store.hpp"
+#include "../lirs_cache/include/lirs_memcache.hpp"
+#include "../lirs_cache/include/lirs_server.hpp"
+
+static void usage() {
+    std::cerr << "usage: lirs_loadgen [options]\n"
+              << "  --host H               server address (default: 127.0.0.1)\n"
+              << "  --port N               server port (default: 11211)\n"
+              << "  --connections N        client connections, one thread each (default: 4)\n"
+              << "  --pipeline N           get commands per round trip (default: 16)\n"
+              << "  --multiget N           keys per get command (default: 1)\n"
+              << "  --requests N           total keys to get (default: 1000000)\n"
+              << "  --keys N               hot key space (default: 100000)\n"
+              << "  --key-pattern zipf|uniform   hot key distribution (default: zipf)\n"
+              << "  --zipf S               zipf exponent (default: 0.99)\n"
+              << "  --scan-ratio R         fraction of gets from sequential scans (default: 0)\n"
+              << "  --scan-keys N          keys a scan walks through before wrapping (default: 10000000)\n"
+              << "  --value-size N         bytes per value (default: 100)\n"
+              << "  --no-fill              do not set keys that missed\n"
+              << "  --seed N               workload seed (default: 1)\n"
+              << "  --compare MB           run embedded LRU and LIRS servers of MB memory and compare\n"
+              << "  --server-threads N     reactor threads of the embedded servers (default: 2)\n";
+}
+
+struct Config {
+    std::string host = "127.0.0.1";
+    std::uint16_t port = 11211;
+    std::size_t connections = 4;
+    std::size_t pipeline = 16;
+    std::size_t multiget = 1;
+    std::size_t requests = 1000000;
+    std::size_t keys = 100000;
+    bool zipf = true;
+    double zipf_s = 0.99;
+    double scan_ratio = 0.0;
+    std::size_t scan_keys = 10000000;
+    std::size_t value_size = 100;
+    bool fill = true;
+    std::uint64_t seed = 1;
+    std::size_t compare_mb = 0;
+    std::size_t server_threads = 2;
+};
+
+struct Result {
+    std::uint64_t gets = 0;       // keys requested
+    std::uint64_t hits = 0;
+    std::uint64_t commands = 0;   // get and set commands sent
+    std::uint64_t batches = 0;
+    double batch_seconds = 0.0;   // summed round-trip time
+    double seconds = 0.0;
+};
+
+static std::uint64_t mix(std::uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// xorshift64*, one per connection
+class Random {
+public:
+    explicit Random(std::uint64_t seed) : state_(mix(seed) | 1) {}
+
+    std::uint64_t next() {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        return state_ * 0x2545F4914F6CDD1DULL;
+    }
+
+    double uniform() { return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+    std::uint64_t state_;
+};
+
+// rank sampler over the hot keys: zipf by inverse CDF, or uniform
+class KeySampler {
+public:
+    KeySampler(std::size_t keys, bool zipf, double s) : keys_(keys) {
+        if (!zipf) return;
+
+        cdf_.resize(keys);
+        double sum = 0.0;
+        for (std::size_t rank = 0; rank < keys; rank++) {
+            sum += 1.0 / std::pow(static_cast<double>(rank + 1), s);
+            cdf_[rank] = sum;
+        }
+        for (double& value : cdf_) value /= sum;
+    }
+
+    std::size_t sample(Random& random) const {
+        if (cdf_.empty()) return static_cast<std::size_t>(random.next() % keys_);
+        auto found = std::lower_bound(cdf_.begin(), cdf_.end(), random.uniform());
+        return std::min<std::size_t>(keys_ - 1, static_cast<std::size_t>(found - cdf_.begin()));
+    }
+
+private:
+    std::size_t keys_;
+    std::vector<double> cdf_;
+};
+
+static int connect_to(const std::string& host, std::uint16_t port) {
+    addrinfo hints {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* found = nullptr;
+    int status = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &found);
+    if (status != 0) throw std::runtime_error("Cannot resolve " + host + ": " + gai_strerror(status));
+
+    int fd = socket(found->ai_family, found->ai_socktype, found->ai_protocol);
+    if (fd < 0 || connect(fd, found->ai_addr, found->ai_addrlen) < 0) {
+        int error = errno;
+        freeaddrinfo(found);
+        if (fd >= 0) close(fd);
+        throw std::system_error(error, std::generic_category(), "connect " + host + ":" + std::to_string(port));
+    }
+    freeaddrinfo(found);
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+// blocking connection with a read buffer for text replies
+class Client {
+public:
+    Client(const std::string& host, std::uint16_t port) : fd_(connect_to(host, port)), pos_(0) {}
+    ~Client() { close(fd_); }
+
+    void send_all(const std::string& data) {
+        std::size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = send(fd_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) throw std::system_error(errno, std::generic_category(), "send");
+            sent += static_cast<std::size_t>(n);
+        }
+    }
+
+    // next line without "\r\n"
+    std::string line() {
+        for (;;) {
+            std::size_t end = buffer_.find("\r\n", pos_);
+            if (end != std::string::npos) {
+                std::string result = buffer_.substr(pos_, end - pos_);
+                pos_ = end + 2;
+                return result;
+            }
+            fill();
+        }
+    }
+
+    void skip(std::size_t bytes) {
+        while (buffer_.size() - pos_ < bytes) fill();
+        pos_ += bytes;
+    }
+
+private:
+    void fill() {
+        if (pos_ > 0) {
+            buffer_.erase(0, pos_);
+            pos_ = 0;
+        }
+        char chunk[64 * 1024];
+        ssize_t n = recv(fd_, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) return;
+        if (n <= 0) throw std::runtime_error("Connection closed by server");
+        buffer_.append(chunk, static_cast<std::size_t>(n));
+    }
+
+    int fd_;
+    std::string buffer_;
+    std::size_t pos_;
+};
+
+static std::string hot_key(std::size_t rank) { return "key:" + std::to_string(mix(rank)); }
+static std::string scan_key(std::size_t index) { return "scan:" + std::to_string(index); }
+
+// one connection: pipelined gets, cache-aside sets for the misses in the next batch
+static Result drive(const Config& config, const KeySampler& sampler, std::size_t connection, std::uint64_t quota) {
+    Result result;
+    Client client(config.host, config.port);
+    Random random(config.seed * 1000003 + connection);
+    std::size_t scan_position = config.scan_keys / std::max<std::size_t>(1, config.connections) * connection;
+    std::string value(config.value_size, 'v');
+
+    std::string request;
+    std::vector<std::string> keys;
+    std::vector<std::string> misses;
+
+    while (result.gets < quota) {
+        request.clear();
+        for (const std::string& key : misses) {
+            request += "set " + key + " 0 0 " + std::to_string(value.size()) + " noreply\r\n";
+            request += value;
+            request += "\r\n";
+            result.commands++;
+        }
+        misses.clear();
+
+        keys.clear();
+        std::size_t commands = 0;
+        for (; commands < config.pipeline && result.gets + keys.size() < quota; commands++) {
+            request += "get";
+            for (std::size_t i = 0; i < config.multiget; i++) {
+                std::string key = random.uniform() < config.scan_ratio ? scan_key(scan_position++ % config.scan_keys)
+                                                                      : hot_key(sampler.sample(random));
+                request += ' ';
+                request += key;
+                keys.push_back(std::move(key));
+            }
+            request += "\r\n";
+        }
+        result.commands += commands;
+
+        auto start = std::chrono::steady_clock::now();
+        client.send_all(request);
+
+        // replies list hits in request order, each command ends with END
+        std::size_t next = 0;
+        for (std::size_t command = 0; command < commands; command++) {
+            std::size_t end = next + config.multiget;
+            for (std::string line = client.line(); line != "END"; line = client.line()) {
+                if (line.compare(0, 6, "VALUE ") != 0) throw std::runtime_error("Unexpected reply: " + line);
+
+                std::size_t key_end = line.find(' ', 6);
+                std::string key = line.substr(6, key_end - 6);
+                std::size_t bytes = std::strtoull(line.c_str() + line.rfind(' ') + 1, nullptr, 10);
+                client.skip(bytes + 2);
+
+                while (next < end && keys[next] != key) misses.push_back(keys[next++]);
+                if (next < end) {
+                    next++;
+                    result.hits++;
+                }
+            }
+            while (next < end) misses.push_back(keys[next++]);
+        }
+
+        result.batch_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.batches++;
+        result.gets += keys.size();
+        if (!config.fill) misses.clear();
+    }
+    return result;
+}
+
+static Result run_load(const Config& config, const KeySampler& sampler) {
+    std::vector<Result> results(config.connections);
+    std::vector<std::thread> threads;
+    std::atomic<bool> failed { false };
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < config.connections; i++) {
+        std::uint64_t quota = config.requests / config.connections + (i < config.requests % config.connections ? 1 : 0);
+        threads.emplace_back([&, i, quota] {
+            try {
+                results[i] = drive(config, sampler, i, quota);
+            } catch (const std::exception& e) {
+                std::cerr << "connection " << i << ": " << e.what() << "\n";
+                failed = true;
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    if (failed) throw std::runtime_error("Load run failed");
+
+    Result total;
+    total.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (const Result& result : results) {
+        total.gets += result.gets;
+        total.hits += result.hits;
+        total.commands += result.commands;
+        total.batches += result.batches;
+        total.batch_seconds += result.batch_seconds;
+    }
+    return total;
+}
+
+static void print_header() {
+    std::cout << std::left << std::setw(8) << "policy" << std::right
+              << std::setw(11) << "hit ratio" << std::setw(12) << "gets/s" << std::setw(12) << "cmds/s"
+              << std::setw(14) << "avg rtt us" << "\n";
+}
+
+static void print_row(const std::string& name, const Result& result) {
+    std::cout << std::left << std::setw(8) << name << std::right << std::fixed
+              << std::setw(10) << std::setprecision(2) << 100.0 * result.hits / std::max<std::uint64_t>(1, result.gets) << "%"
+              << std::setw(12) << std::setprecision(0) << result.gets / result.seconds
+              << std::setw(12) << result.commands / result.seconds
+              << std::setw(14) << std::setprecision(1) << 1e6 * result.batch_seconds / std::max<std::uint64_t>(1, result.batches) << "\n";
+}
+
+// in-process server with the given policy on a free port, then the same load against it
+template <typename Cache>
+static Result run_embedded(Config config, const KeySampler& sampler) {
+    using Store = LIRSItemStore<Cache>;
+    using Session = LIRSMemcacheSession<Store>;
+
+    typename Store::Options store_options;
+    store_options.memory = config.compare_mb << 20;
+    store_options.shards = config.server_threads * 4;
+    Store store(store_options);
+
+    typename LIRSServer<Session>::Options server_options;
+    server_options.port = 0;
+    server_options.threads = config.server_threads;
+    LIRSServer<Session> server(server_options, [&store] { return std::make_unique<Session>(store); });
+    server.start();
+
+    config.host = server_options.host;
+    config.port = server.port();
+    return run_load(config, sampler);
+}
+
+int main(int argc, char** argv) {
+    Config config;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--host" && has_value) config.host = argv[++i];
+        else if (arg == "--port" && has_value) config.port = static_cast<std::uint16_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--connections" && has_value) config.connections = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--pipeline" && has_value) config.pipeline = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--multiget" && has_value) config.multiget = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--requests" && has_value) config.requests = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--keys" && has_value) config.keys = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--key-pattern" && has_value) config.zipf = std::string(argv[++i]) != "uniform";
+        else if (arg == "--zipf" && has_value) config.zipf_s = std::strtod(argv[++i], nullptr);
+        else if (arg == "--scan-ratio" && has_value) config.scan_ratio = std::strtod(argv[++i], nullptr);
+        else if (arg == "--scan-keys" && has_value) config.scan_keys = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--value-size" && has_value) config.value_size = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--no-fill") config.fill = false;
+        else if (arg == "--seed" && has_value) config.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--compare" && has_value) config.compare_mb = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--server-threads" && has_value) config.server_threads = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            usage();
+            return 2;
+        }
+    }
+
+    if (config.connections == 0 || config.pipeline == 0 || config.multiget == 0 || config.keys == 0 || config.scan_keys == 0
+        || config.server_threads == 0) {
+        usage();
+        return 2;
+    }
+
+    KeySampler sampler(config.keys, config.zipf, config.zipf_s);
+
+    std::cout << "connections: " << config.connections << " | pipeline: " << config.pipeline << " x " << config.multiget
+              << " | requests: " << config.requests << " | keys: " << config.keys
+              << (config.zipf ? " zipf " + std::to_string(config.zipf_s) : std::string(" uniform"))
+              << " | scan ratio: " << config.scan_ratio << " | value: " << config.value_size << " B\n\n";
+
+    try {
+        print_header();
+        if (config.compare_mb == 0) {
+            print_row("server", run_load(config, sampler));
+            return 0;
+        }
+        print_row("lru", run_embedded<LIRSLRUCache<std::string, LIRSItemRef>>(config, sampler));
+        print_row("lirs", run_embedded<LIRSCache<std::string, LIRSItemRef>>(config, sampler));
+    } catch (const std::exception& e) {
+        std::cerr << "lirs_loadgen: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <csignal>
+#include <pthread.h>
+#include "../lirs_cache/include/lirs_cache.hpp"
+#include "../lirs_cache/include/lirs_lru.hpp"
+#include "../lirs_cache/include/lirs_http.hpp"
+#include "../lirs_cache/include/lirs_http_cache.hpp"
+#include "../lirs_cache/include/lirs_http_proxy.hpp"
+#include "../lirs_cache/include/lirs_server.hpp"
+
+static void usage() {
+    std::cerr << "usage: lirs_proxy --origin HOST:PORT [options]\n"
+              << "  --origin HOST:PORT     origin server to cache\n"
+              << "  --host H               address to listen on (default: 127.0.0.1)\n"
+              << "  --port N               HTTP port (default: 8080)\n"
+              << "  --threads N            reactor threads (default: 4)\n"
+              << "  --fetch-threads N      origin fetches in flight (default: 32)\n"
+              << "  --memory MB            object memory (default: 256)\n"
+              << "  --shards N             cache shards (default: 4 per thread)\n"
+              << "  --hir-ratio R          HIR ratio (default: 0.01)\n"
+              << "  --policy lirs|lru      replacement policy (default: lirs)\n"
+              << "  --object-limit BYTES   largest body cached (default: 8388608)\n"
+              << "  --origin-timeout MS    origin connect / response timeout (default: 5000)\n";
+}
+
+struct Config {
+    std::string origin_host;
+    std::string origin_port;
+    std::string host = "127.0.0.1";
+    std::uint16_t port = 8080;
+    std::size_t threads = 4;
+    std::size_t fetch_threads = 32;
+    std::size_t memory_mb = 256;
+    std::size_t shards = 0;
+    double hir_ratio = 0.01;
+    std::size_t object_limit = std::size_t { 8 } << 20;
+    int origin_timeout_ms = 5000;
+    std::string policy = "lirs";
+};
+
+template <typename Cache>
+static int serve(const Config& config, const sigset_t& signals) {
+    using Session = LIRSHttpProxySession<Cache>;
+
+    typename LIRSHttpCache<Cache>::Options cache_options;
+    cache_options.memory = config.memory_mb << 20;
+    cache_options.shards = config.shards != 0 ? config.shards : config.threads * 4;
+    cache_options.hir_ratio = config.hir_ratio;
+    cache_options.object_limit = config.object_limit;
+    LIRSHttpCache<Cache> cache(cache_options);
+
+    // one pooled connection per fetch thread: each runs one blocking fetch at a time
+    LIRSHttpOrigin::Options origin_options;
+    origin_options.host = config.origin_host;
+    origin_options.port = config.origin_port;
+    origin_options.pool_size = config.fetch_threads;
+    origin_options.timeout_ms = config.origin_timeout_ms;
+    origin_options.body_limit = std::max(origin_options.body_limit, config.object_limit);
+    LIRSHttpOrigin origin(origin_options);
+
+    // declared after the cache and origin: joined before they go away
+    LIRSHttpFetchPool fetches(config.fetch_threads);
+
+    typename LIRSServer<Session>::Options server_options;
+    server_options.host = config.host;
+    server_options.port = config.port;
+    server_options.threads = config.threads;
+
+    LIRSServer<Session> server(server_options, [&] { return std::make_unique<Session>(cache, origin, fetches); });
+    server.start();
+
+    std::cout << "lirs_proxy " << config.policy << " on " << server_options.host << ":" << server.port()
+              << " -> " << config.origin_host << ":" << config.origin_port
+              << " | threads: " << server_options.threads << " | fetch threads: " << fetches.threads() << " | shards: " << cache.cache().shard_count()
+              << " | memory: " << config.memory_mb << " MB" << std::endl;
+
+    int signal = 0;
+    sigwait(&signals, &signal);
+
+    server.stop();
+
+    auto stats = cache.stats();
+    std::uint64_t requests = stats.hits + stats.misses + stats.coalesced;
+    std::cout << "objects: " << stats.objects << " | bytes: " << stats.bytes << " | requests: " << requests
+              << " | hit ratio: " << (requests == 0 ? 0.0 : 100.0 * (stats.hits + stats.coalesced) / requests) << "%"
+              << " | coalesced: " << stats.coalesced << " | uncacheable: " << stats.uncacheable << std::endl;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    Config config;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--origin" && has_value) {
+            std::string origin = argv[++i];
+            std::size_t colon = origin.rfind(':');
+            config.origin_host = origin.substr(0, colon);
+            config.origin_port = colon == std::string::npos ? "80" : origin.substr(colon + 1);
+        }
+        else if (arg == "--host" && has_value) config.host = argv[++i];
+        else if (arg == "--port" && has_value) config.port = static_cast<std::uint16_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--threads" && has_value) config.threads = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--fetch-threads" && has_value) config.fetch_threads = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--memory" && has_value) config.memory_mb = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--shards" && has_value) config.shards = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--hir-ratio" && has_value) config.hir_ratio = std::strtod(argv[++i], nullptr);
+        else if (arg == "--policy" && has_value) config.policy = argv[++i];
+        else if (arg == "--object-limit" && has_value) config.object_limit = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--origin-timeout" && has_value) config.origin_timeout_ms = std::atoi(argv[++i]);
+        else {
+            usage();
+            return 2;
+        }
+    }
+
+    if (config.origin_host.empty() || config.memory_mb == 0 || config.threads == 0 || config.fetch_threads == 0 || config.origin_timeout_ms <= 0
+        || (config.policy != "lirs" && config.policy != "lru")) {
+        usage();
+        return 2;
+    }
+
+    // reactors inherit the blocked set; the main thread waits for the signal
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    try {
+        if (config.policy == "lru") return serve<LIRSLRUCache<std::string, LIRSHttpObjectRef>>(config, signals);
+        return serve<LIRSCache<std::string, LIRSHttpObjectRef>>(config, signals);
+    } catch (const std::exception& e) {
+        std::cerr << "lirs_proxy: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,194 @@
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <csignal>
+#include <pthread.h>
+#include "../lirs_cache/include/lirs_cache.hpp"
+#include "../lirs_cache/include/lirs_lru.hpp"
+#include "../lirs_cache/include/lirs_item_store.hpp"
+#include "../lirs_cache/include/lirs_memcache.hpp"
+#include "../lirs_cache/include/lirs_memory_monitor.hpp"
+#include "../lirs_cache/include/lirs_peer_cache.hpp"
+#include "../lirs_cache/include/lirs_resp.hpp"
+#include "../lirs_cache/include/lirs_server.hpp"
+
+static void usage() {
+    std::cerr << "usage: lirs_server [options]\n"
+              << "  --host H               address to listen on (default: 127.0.0.1)\n"
+              << "  --port N               memcached port (default: 11211)\n"
+              << "  --resp-port N          also serve the Redis protocol on port N\n"
+              << "  --threads N            reactor threads (default: 4)\n"
+              << "  --memory MB            item memory (default: 64)\n"
+              << "  --shards N             cache shards (default: 4 per thread)\n"
+              << "  --hir-ratio R          HIR ratio (default: 0.01)\n"
+              << "  --policy lirs|lru      replacement policy (default: lirs)\n"
+              << "  --item-limit BYTES     largest value (default: 1048576)\n"
+              << "  --elastic MB           shrink under memory pressure, down to MB\n"
+              << "  --hot-replicas N       read replicas of hot keys, 0 = off (default: 0)\n"
+              << "  --peers H:P,H:P,...    serve misses from peer nodes (the whole group, same order everywhere)\n"
+              << "  --self N               index of this node in --peers (default: 0)\n"
+              << "  --peer-timeout MS      longest peer lookup (default: 5)\n";
+}
+
+struct Config {
+    std::string host = "127.0.0.1";
+    std::uint16_t port = 11211;
+    std::uint16_t resp_port = 0;
+    std::size_t threads = 4;
+    std::size_t memory_mb = 64;
+    std::size_t shards = 0;
+    double hir_ratio = 0.01;
+    std::size_t item_limit = std::size_t { 1 } << 20;
+    std::size_t elastic_mb = 0;
+    std::size_t hot_replicas = 0;
+    std::string policy = "lirs";
+    std::vector<std::string> peers;
+    std::size_t self = 0;
+    int peer_timeout_ms = 5;
+};
+
+static std::vector<std::string> split_list(const std::string& list) {
+    std::vector<std::string> items;
+    std::istringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+// Front: the store the sessions use, the item store itself or a peer store over it
+template <typename Store, typename Front>
+static int run(const Config& config, const sigset_t& signals, Store& store, Front& front) {
+    using Session = LIRSMemcacheSession<Front>;
+
+    typename Session::Options session_options;
+    session_options.item_limit = config.item_limit;
+
+    typename LIRSServer<Session>::Options server_options;
+    server_options.host = config.host;
+    server_options.port = config.port;
+    server_options.threads = config.threads;
+
+    LIRSServer<Session> server(server_options, [&] { return std::make_unique<Session>(front, session_options); });
+    server.start();
+
+    // Redis clients share the same store
+    using RespSession = LIRSRespSession<Front>;
+    typename RespSession::Options resp_options;
+    resp_options.bulk_limit = config.item_limit;
+
+    typename LIRSServer<RespSession>::Options resp_server_options;
+    resp_server_options.host = config.host;
+    resp_server_options.port = config.resp_port;
+    resp_server_options.threads = config.threads;
+    LIRSServer<RespSession> resp_server(resp_server_options, [&] { return std::make_unique<RespSession>(front, resp_options); });
+    if (config.resp_port != 0) resp_server.start();
+
+    LIRSMemoryMonitor monitor;
+    if (config.elastic_mb != 0) {
+        monitor.add(store.capacity(), config.elastic_mb << 20, [&store](std::size_t memory) { store.resize(memory); });
+        monitor.start();
+    }
+
+    std::cout << "lirs_server " << config.policy << " on " << server_options.host << ":" << server.port()
+              << " | threads: " << server_options.threads << " | shards: " << store.cache().shard_count()
+              << " | memory: " << config.memory_mb << " MB";
+    if (config.resp_port != 0) std::cout << " | resp: " << resp_server.port();
+    if (!config.peers.empty()) std::cout << " | peers: " << config.peers.size() << " (self " << config.self << ")";
+    std::cout << std::endl;
+
+    int signal = 0;
+    sigwait(&signals, &signal);
+
+    monitor.stop();
+    resp_server.stop();
+    server.stop();
+
+    auto stats = store.stats();
+    std::uint64_t gets = stats.get_hits + stats.get_misses;
+    std::cout << "items: " << stats.items << " | bytes: " << stats.bytes << " | gets: " << gets
+              << " | hit ratio: " << (gets == 0 ? 0.0 : 100.0 * stats.get_hits / gets) << "%" << std::endl;
+    return 0;
+}
+
+template <typename Cache>
+static int serve(const Config& config, const sigset_t& signals) {
+    using Store = LIRSItemStore<Cache>;
+
+    typename Store::Options store_options;
+    store_options.memory = config.memory_mb << 20;
+    store_options.shards = config.shards != 0 ? config.shards : config.threads * 4;
+    store_options.hir_ratio = config.hir_ratio;
+    store_options.hot_replicas = config.hot_replicas;
+    Store store(store_options);
+
+    if (config.peers.empty()) return run(config, signals, store, store);
+
+    typename LIRSPeerCache<Store>::Options peer_options;
+    peer_options.nodes = config.peers;
+    peer_options.self = config.self;
+    peer_options.timeout_ms = config.peer_timeout_ms;
+    peer_options.hedge_after_ms = config.peer_timeout_ms / 2;
+    LIRSPeerCache<Store> peers(store, peer_options);
+    LIRSPeerStore<Store> front(peers);
+
+    int result = run(config, signals, store, front);
+
+    auto stats = peers.stats();
+    std::cout << "peer hits: " << stats.peer_hits << " | peer misses: " << stats.misses << " | hedges: " << stats.hedges << std::endl;
+    return result;
+}
+
+int main(int argc, char** argv) {
+    Config config;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--host" && has_value) config.host = argv[++i];
+        else if (arg == "--port" && has_value) config.port = static_cast<std::uint16_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--resp-port" && has_value) config.resp_port = static_cast<std::uint16_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--threads" && has_value) config.threads = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--memory" && has_value) config.memory_mb = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--shards" && has_value) config.shards = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--hir-ratio" && has_value) config.hir_ratio = std::strtod(argv[++i], nullptr);
+        else if (arg == "--policy" && has_value) config.policy = argv[++i];
+        else if (arg == "--item-limit" && has_value) config.item_limit = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--elastic" && has_value) config.elastic_mb = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--hot-replicas" && has_value) config.hot_replicas = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--peers" && has_value) config.peers = split_list(argv[++i]);
+        else if (arg == "--self" && has_value) config.self = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--peer-timeout" && has_value) config.peer_timeout_ms = std::atoi(argv[++i]);
+        else {
+            usage();
+            return 2;
+        }
+    }
+
+    if (config.memory_mb == 0 || config.threads == 0 || (config.policy != "lirs" && config.policy != "lru") ||
+        (!config.peers.empty() && (config.self >= config.peers.size() || config.peer_timeout_ms <= 0))) {
+        usage();
+        return 2;
+    }
+
+    // reactors inherit the blocked set; the main thread waits for the signal
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    try {
+        if (config.policy == "lru") return serve<LIRSLRUCache<std::string, LIRSItemRef>>(config, signals);
+        return serve<LIRSCache<std::string, LIRSItemRef>>(config, signals);
+    } catch (const std::exception& e) {
+        std::cerr << "lirs_server: " << e.what() << "\n";
+        return 1;
+    }
+}
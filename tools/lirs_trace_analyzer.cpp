@@ -0,0 +1,133 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <cstdlib>
+#include "../lirs_cache/include/lirs_trace.hpp"
+#include "../lirs_cache/include/lirs_trace_binary.hpp"
+#include "../lirs_cache/include/lirs_trace_analyzer.hpp"
+
+static void usage() {
+    std::cerr << "usage: lirs_trace_analyzer [options] <trace|->\n"
+              << "  --format plain|csv     text trace format (default: plain, binary traces are detected)\n"
+              << "  --window N             accesses per working-set window (default: 1000000)\n"
+              << "  --capacity N           cache size to predict, repeatable\n"
+              << "  --hir-ratio R          HIR ratio for the LIRS replay (default: 0.01)\n"
+              << "  --windows              print every window instead of a summary\n";
+}
+
+template <typename Reader>
+static void replay(Reader& reader, LIRSTraceAnalyzer& analyzer) {
+    LIRSTraceRecord record;
+    while (reader.next(record)) {
+        if (record.op == LIRSTraceOp::Delete) continue;
+        analyzer.access(record.key);
+    }
+}
+
+static void print_histogram(const char* title, const std::vector<std::uint64_t>& hist) {
+    std::uint64_t total = 0;
+    for (std::uint64_t count : hist) total += count;
+
+    std::cout << "[" << title << "]\n";
+    if (total == 0) {
+        std::cout << "  (empty)\n\n";
+        return;
+    }
+
+    for (std::size_t i = 0; i < hist.size(); i++) {
+        if (hist[i] == 0) continue;
+        std::cout << "  >= " << std::setw(12) << LIRSTraceAnalyzer::bucket_floor(i) << " : "
+                  << std::setw(12) << hist[i] << "  "
+                  << std::fixed << std::setprecision(2) << (100.0 * hist[i] / total) << "%\n";
+    }
+    std::cout << "\n";
+}
+
+int main(int argc, char** argv) {
+    LIRSTraceAnalyzer::Options options;
+    LIRSTraceFormat format = LIRSTraceFormat::Plain;
+    bool all_windows = false;
+    std::string path;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+
+            if (arg == "--format" && has_value) format = lirs_parse_trace_format(argv[++i]);
+            else if (arg == "--window" && has_value) options.window = std::strtoull(argv[++i], nullptr, 10);
+            else if (arg == "--capacity" && has_value) options.capacities.push_back(std::strtoull(argv[++i], nullptr, 10));
+            else if (arg == "--hir-ratio" && has_value) options.hir_ratio = std::strtod(argv[++i], nullptr);
+            else if (arg == "--windows") all_windows = true;
+            else if (arg[0] != '-' || arg == "-") path = arg;
+            else {
+                usage();
+                return 2;
+            }
+        }
+
+        if (path.empty()) {
+            usage();
+            return 2;
+        }
+
+        LIRSTraceAnalyzer analyzer(options);
+
+        if (path != "-" && LIRSBinaryTraceFormat::probe(path)) {
+            LIRSBinaryTraceReader reader(path);
+            replay(reader, analyzer);
+        } else if (path == "-") {
+            LIRSTextTraceReader reader(std::cin, format);
+            replay(reader, analyzer);
+        } else {
+            std::ifstream file(path);
+            if (!file) {
+                std::cerr << "cannot open " << path << "\n";
+                return 1;
+            }
+            LIRSTextTraceReader reader(file, format);
+            replay(reader, analyzer);
+        }
+
+        LIRSTraceAnalyzer::Report report = analyzer.report();
+
+        std::cout << "================== Trace Profile ==================\n\n";
+        std::cout << "[Summary]\n";
+        std::cout << "  Accesses: " << report.accesses << " | Distinct keys: " << report.distinct_keys
+                  << " | Cold: " << report.cold_accesses << "\n";
+        std::cout << "  Pattern: " << report.pattern << "\n\n";
+
+        print_histogram("Reuse distance (per access)", report.reuse_histogram);
+        print_histogram("IRR distribution (per key, last IRR)", report.irr_histogram);
+
+        std::cout << "[Working set] (window = " << options.window << " accesses)\n";
+        std::uint64_t peak = 0;
+        for (std::size_t i = 0; i < report.windows.size(); i++) {
+            const LIRSTraceAnalyzer::WindowStats& w = report.windows[i];
+            peak = std::max(peak, w.distinct);
+            if (all_windows) {
+                std::cout << "  #" << i << " distinct: " << w.distinct << " cold: " << w.cold
+                          << " pattern: " << w.pattern << "\n";
+            }
+        }
+        std::cout << "  Windows: " << report.windows.size() << " | Peak working set: " << peak << "\n\n";
+
+        if (!report.predictions.empty()) {
+            std::cout << "[Predicted hit ratio]\n";
+            for (const auto& p : report.predictions) {
+                std::cout << "  capacity " << std::setw(10) << p.capacity
+                          << "  LRU " << std::fixed << std::setprecision(4) << p.lru_hit_ratio
+                          << "  LIRS " << p.lirs_hit_ratio
+                          << "  -> " << (p.lirs_hit_ratio > p.lru_hit_ratio ? "LIRS" : "LRU") << "\n";
+            }
+            std::cout << "\n";
+        }
+
+        std::cout << "===================================================\n";
+    } catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include "../lirs_cache/include/lirs_trace.hpp"
+#include "../lirs_cache/include/lirs_trace_binary.hpp"
+
+static void usage() {
+    std::cerr << "usage: lirs_trace_convert [options] <text-trace|-> <binary-trace>\n"
+              << "       lirs_trace_convert --decode <binary-trace>\n"
+              << "       lirs_trace_convert --verify <binary-trace>\n"
+              << "  --format plain|csv     input text format (default: plain)\n"
+              << "  --ops                  store op types\n"
+              << "  --sizes                store value sizes\n"
+              << "  --block N              records per block (default: 65536)\n";
+}
+
+static const char* op_name(LIRSTraceOp op) {
+    switch (op) {
+        case LIRSTraceOp::Set: return "set";
+        case LIRSTraceOp::Delete: return "delete";
+        default: return "get";
+    }
+}
+
+// print a binary trace back as csv
+static int decode(const std::string& path) {
+    LIRSBinaryTraceReader reader(path);
+    LIRSTraceRecord record;
+    while (reader.next(record)) {
+        std::cout << record.key << "," << op_name(record.op) << "," << record.size << "\n";
+    }
+    return 0;
+}
+
+// check every block checksum and report decode throughput
+static int verify(const std::string& path) {
+    auto start = std::chrono::steady_clock::now();
+
+    LIRSBinaryTraceReader reader(path);
+    std::vector<LIRSTraceRecord> block;
+    std::uint64_t records = 0;
+    std::uint64_t checksum = 0;
+
+    while (reader.decode_block(block)) {
+        records += block.size();
+        for (const LIRSTraceRecord& record : block) checksum += record.key;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    double bytes = static_cast<double>(in.tellg());
+
+    if (reader.record_count() != 0 && reader.record_count() != records) {
+        std::cerr << "record count mismatch: header " << reader.record_count() << ", blocks " << records << "\n";
+        return 1;
+    }
+
+    std::cout << "records: " << records << " | bytes: " << static_cast<std::uint64_t>(bytes)
+              << " | key sum: " << checksum << "\n";
+    std::cout << "decode: " << (records / seconds / 1e6) << " M records/s, "
+              << (bytes / seconds / 1e9) << " GB/s\n";
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    LIRSTraceFormat format = LIRSTraceFormat::Plain;
+    std::uint16_t flags = 0;
+    std::uint32_t block = 65536;
+    std::string mode;
+    std::vector<std::string> paths;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+
+            if (arg == "--format" && has_value) format = lirs_parse_trace_format(argv[++i]);
+            else if (arg == "--ops") flags |= LIRSBinaryTraceFormat::kHasOp;
+            else if (arg == "--sizes") flags |= LIRSBinaryTraceFormat::kHasSize;
+            else if (arg == "--block" && has_value) block = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            else if (arg == "--decode" || arg == "--verify") mode = arg;
+            else if (arg[0] != '-' || arg == "-") paths.push_back(arg);
+            else {
+                usage();
+                return 2;
+            }
+        }
+
+        if (!mode.empty()) {
+            if (paths.size() != 1) {
+                usage();
+                return 2;
+            }
+            return mode == "--decode" ? decode(paths[0]) : verify(paths[0]);
+        }
+
+        if (paths.size() != 2) {
+            usage();
+            return 2;
+        }
+
+        std::ifstream file;
+        if (paths[0] != "-") {
+            file.open(paths[0]);
+            if (!file) {
+                std::cerr << "cannot open " << paths[0] << "\n";
+                return 1;
+            }
+        }
+
+        std::ofstream out(paths[1], std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "cannot create " << paths[1] << "\n";
+            return 1;
+        }
+
+        LIRSTextTraceReader reader(paths[0] == "-" ? std::cin : file, format);
+        LIRSBinaryTraceWriter writer(out, flags, block);
+        LIRSTraceRecord record;
+
+        while (reader.next(record)) writer.append(record);
+        writer.finish();
+
+        std::cout << "converted " << writer.records() << " records\n";
+    } catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}